@@ -36,6 +36,7 @@ public:
     QAction *actionExit;
     QAction *actionAbout;
     QAction *actionEstimate_Features;
+    QAction *actionEstimate_Features_Tiled;
     QAction *actionExtract_Point_Features;
     QAction *actionTrain_Point_Classifier;
     QAction *actionTest_Data;
@@ -76,6 +77,8 @@ public:
         actionAbout->setObjectName(QStringLiteral("actionAbout"));
         actionEstimate_Features = new QAction(PointAnalysisClass);
         actionEstimate_Features->setObjectName(QStringLiteral("actionEstimate_Features"));
+        actionEstimate_Features_Tiled = new QAction(PointAnalysisClass);
+        actionEstimate_Features_Tiled->setObjectName(QStringLiteral("actionEstimate_Features_Tiled"));
         actionExtract_Point_Features = new QAction(PointAnalysisClass);
         actionExtract_Point_Features->setObjectName(QStringLiteral("actionExtract_Point_Features"));
         actionTrain_Point_Classifier = new QAction(PointAnalysisClass);
@@ -146,6 +149,7 @@ public:
         menuFile->addAction(actionExit);
         menuHelp->addAction(actionAbout);
         menuFeature->addAction(actionEstimate_Features);
+        menuFeature->addAction(actionEstimate_Features_Tiled);
         menuFeature->addAction(actionExtract_Point_Features);
         menuFeature->addAction(actionTrain_Point_Classifier);
         menuFeature->addAction(actionCompute_sdf);
@@ -170,6 +174,7 @@ public:
         actionExit->setText(QApplication::translate("PointAnalysisClass", "Exit", 0));
         actionAbout->setText(QApplication::translate("PointAnalysisClass", "About", 0));
         actionEstimate_Features->setText(QApplication::translate("PointAnalysisClass", "Estimate Features", 0));
+        actionEstimate_Features_Tiled->setText(QApplication::translate("PointAnalysisClass", "Estimate Features (Tiled)", 0));
         actionExtract_Point_Features->setText(QApplication::translate("PointAnalysisClass", "Extract Point Features", 0));
         actionTrain_Point_Classifier->setText(QApplication::translate("PointAnalysisClass", "Train Point Classifier", 0));
         actionTest_Data->setText(QApplication::translate("PointAnalysisClass", "Test Data", 0));
@@ -22,12 +22,21 @@ template <class T> MRFEnergy<T>::MRFEnergy(GlobalSize Kglobal, ErrorFunction err
 	  m_Kglobal(Kglobal),
 	  m_vectorMaxSizeInBytes(0),
 	  m_isEnergyConstructionCompleted(false),
-	  m_buf(NULL)
+	  m_buf(NULL),
+	  m_threadNum(0),
+	  m_threadBufSizeInBytes(0),
+	  m_threadBuf(NULL),
+	  m_forwardEdges(NULL),
+	  m_forwardFirst(NULL),
+	  m_backwardEdges(NULL),
+	  m_backwardFirst(NULL)
 {
 }
 
 template <class T> MRFEnergy<T>::~MRFEnergy<T>()
 {
+	ClearParallelSchedule();
+
 	while (m_mallocBlockFirst)
 	{
 		MallocBlock* next = m_mallocBlockFirst->m_next;
@@ -82,7 +91,7 @@ template <class T> void MRFEnergy<T>::AddNodeData(NodeId i, NodeData data)
 	i->m_D.Add(m_Kglobal, i->m_K, data);
 }
 
-template <class T> void MRFEnergy<T>::AddEdge(NodeId i, NodeId j, EdgeData data)
+template <class T> typename MRFEnergy<T>::EdgeId MRFEnergy<T>::AddEdge(NodeId i, NodeId j, EdgeData data)
 {
 	if (m_isEnergyConstructionCompleted)
 	{
@@ -100,6 +109,7 @@ template <class T> void MRFEnergy<T>::AddEdge(NodeId i, NodeId j, EdgeData data)
 	e = (MRFEdge*) Malloc(MRFedgeSize);
 
 	e->m_message.Initialize(m_Kglobal, i->m_K, j->m_K, data, &i->m_D, &j->m_D);
+	e->m_isSwapped = false;
 
 	e->m_tail = i;
 	e->m_nextForward = i->m_firstForward;
@@ -110,6 +120,40 @@ template <class T> void MRFEnergy<T>::AddEdge(NodeId i, NodeId j, EdgeData data)
 	j->m_firstBackward = e;
 
 	m_edgeNum ++;
+
+	return e;
+}
+
+template <class T> void MRFEnergy<T>::SetNodeData(NodeId i, NodeData data)
+{
+	i->m_D.Initialize(m_Kglobal, i->m_K, data);
+}
+
+template <class T> void MRFEnergy<T>::SetEdgeData(EdgeId e, EdgeData data)
+{
+	// orientation used in AddEdge()
+	Node* i = (e->m_isSwapped) ? e->m_head : e->m_tail;
+	Node* j = (e->m_isSwapped) ? e->m_tail : e->m_head;
+
+	if (!m_isEnergyConstructionCompleted)
+	{
+		e->m_message.Initialize(m_Kglobal, i->m_K, j->m_K, data, &i->m_D, &j->m_D);
+		return;
+	}
+
+	// Initialize() clears the message, keep a copy in m_buf
+	int sizeI = Vector::GetSizeInBytes(m_Kglobal, i->m_K);
+	int sizeJ = Vector::GetSizeInBytes(m_Kglobal, j->m_K);
+	int messageSizeInBytes = (sizeI > sizeJ) ? sizeI : sizeJ;
+	memcpy(m_buf, e->m_message.GetMessagePtr(), messageSizeInBytes);
+
+	e->m_message.Initialize(m_Kglobal, i->m_K, j->m_K, data, &i->m_D, &j->m_D);
+	if (e->m_isSwapped)
+	{
+		e->m_message.Swap(m_Kglobal, i->m_K, j->m_K);
+	}
+
+	memcpy(e->m_message.GetMessagePtr(), m_buf, messageSizeInBytes);
 }
 
 /////////////////////////////////////////////////////////////////////////////////
@@ -228,6 +272,7 @@ template <class T> void MRFEnergy<T>::CompleteGraphConstruction()
 				e->m_message.Swap(m_Kglobal, i->m_K, j->m_K);
 				e->m_tail = j;
 				e->m_head = i;
+				e->m_isSwapped = !e->m_isSwapped;
 
 				MRFEdge* eNext = e->m_nextForward;
 
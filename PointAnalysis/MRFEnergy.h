@@ -25,6 +25,7 @@ template <class T> class MRFEnergy
 {
 private:
 	struct Node;
+	struct MRFEdge;
 
 public:
 	typedef typename T::Label      Label;
@@ -35,7 +36,12 @@ public:
 	typedef typename T::EdgeData   EdgeData;
 
 	typedef Node* NodeId;
+	typedef MRFEdge* EdgeId;
 	typedef void (*ErrorFunction)(char* msg);
+	// Called by Minimize_TRW_S() and Minimize_BP() whenever the energy is computed
+	// (for BP lowerBound is not available and is set to 0); time is in seconds since
+	// the start of the minimization. Returning false stops the algorithm.
+	typedef bool (*IterationFunction)(void* data, int iter, REAL lowerBound, REAL energy, double time);
 
 	// Constructor. Function errorFn is called with an error message, if an error occurs.
 	MRFEnergy(GlobalSize Kglobal, ErrorFunction errorFn = NULL);
@@ -62,12 +68,21 @@ public:
 	// (see the corresponding message*.h file for description).
 	// Note: information in data is copied into internal memory.
 	// Cannot be called after energy construction is completed.
-	void AddEdge(NodeId i, NodeId j, EdgeData data);
+	EdgeId AddEdge(NodeId i, NodeId j, EdgeData data);
 
 	//////////////////////////////////////////////////////////
 	//                Energy construction end               //
 	//////////////////////////////////////////////////////////
 
+	// Replace node parameter (respectively edge parameters, given in the
+	// orientation (i,j) used in AddEdge()) of an existing node or edge.
+	// Messages are kept, so that a subsequent Minimize_TRW_S() or Minimize_BP()
+	// without ZeroMessages() is warm-started from the previous solution.
+	// May be called at any time. Not supported for TypeBinary and TypeBinaryFast
+	// (their edges add terms to the node parameters).
+	void SetNodeData(NodeId i, NodeData data);
+	void SetEdgeData(EdgeId e, EdgeData data);
+
 	// Clears all messages. Completes energy construction (if not completed yet).
 	void ZeroMessages();
 
@@ -95,18 +110,43 @@ public:
 			m_iterMax = 1000000;
 			m_printIter = 5;     // After 10 iterations start printing the lower bound
 			m_printMinIter = 10; // and the energy every 5 iterations.
+			m_threadNum = 1; // sequential message passing
+			m_gapEps = -1; // not used
+			m_stagnationIter = 0; // not used
+			m_stagnationEps = 0;
+			m_timeMax = 0; // not used
+			m_iterFn = NULL; // print to stdout
+			m_iterFnData = NULL;
 		}
 
 		// stopping criterion
 		REAL		m_eps; // stop if the increase in the lower bound during one iteration is less or equal than m_eps.
 						   // Used only if m_eps >= 0, and only for TRW-S algorithm.
 		int			m_iterMax; // maximum number of iterations
+		REAL		m_gapEps; // stop if energy - lowerBound <= m_gapEps * |energy|, checked whenever the energy is computed.
+						      // Used only if m_gapEps >= 0, and only for TRW-S algorithm.
+		int			m_stagnationIter; // stop if neither the lower bound nor the energy improved (by more than
+								      // m_stagnationEps * |value|) during the last m_stagnationIter iterations.
+								      // Used only if m_stagnationIter > 0.
+		REAL		m_stagnationEps;
+		double		m_timeMax; // stop after m_timeMax seconds (wall clock). Used only if m_timeMax > 0.
 
 		// Option for printing lower bound and the energy.
 		// Note: computing solution and its energy is slow
 		// (it is comparable to the cost of one iteration).
 		int		m_printIter; // print lower bound and energy every m_printIter iterations
 		int		m_printMinIter; // do not print lower bound and energy before m_printMinIter iterations
+
+		// If set, m_iterFn(m_iterFnData, ...) is called instead of printing the lower bound and the energy.
+		IterationFunction	m_iterFn;
+		void*				m_iterFnData;
+
+		// Number of threads used for message passing (TRW-S and BP).
+		// Messages leaving the current node do not depend on each other, so they are
+		// computed in parallel; the node schedule is unchanged, hence the messages,
+		// the lower bound and the solution are the same as with m_threadNum = 1
+		// (up to the summation order of the lower bound). Requires OpenMP, ignored otherwise.
+		int		m_threadNum;
 	};
 
 	// Returns number of iterations. Sets lowerBound and energy.
@@ -145,7 +185,6 @@ private:
 	typedef typename T::Vector Vector;
 	typedef typename T::Edge   Edge;
 
-	struct MRFEdge;
 	struct MallocBlock;
 
 	ErrorFunction	m_errorFn;
@@ -162,9 +201,24 @@ private:
 	char*			m_buf; // buffer of size m_vectorMaxSizeInBytes 
 					       //              + max(m_vectorMaxSizeInBytes, Edge::GetBufSizeInBytes(m_vectorMaxSizeInBytes))
 
+	// parallel message passing (see Options::m_threadNum)
+	int				m_threadNum; // number of threads m_threadBuf was allocated for
+	int				m_threadBufSizeInBytes; // size of the scratch buffer of one thread
+	char*			m_threadBuf; // m_threadNum scratch buffers used by Edge::UpdateMessage()
+	MRFEdge**		m_forwardEdges; // edges grouped by tail; edges of node i are
+	int*			m_forwardFirst; // m_forwardEdges[m_forwardFirst[i->m_ordering] .. m_forwardFirst[i->m_ordering+1])
+	MRFEdge**		m_backwardEdges; // same for edges grouped by head
+	int*			m_backwardFirst;
+
 	void CompleteGraphConstruction(); // nodes and edges cannot be added after calling this function
 	void SetMonotonicTrees();
 
+	bool SetParallelSchedule(int threadNum); // returns false if messages are to be passed sequentially
+	void ClearParallelSchedule();
+	// passes messages from i along its forward (dir=0) or backward (dir=1) edges in parallel,
+	// returns the sum of the values returned by Edge::UpdateMessage()
+	REAL UpdateMessagesParallel(Node* i, Vector* Di, int dir, bool useGamma);
+
 	REAL ComputeSolutionAndEnergy(); // sets Node::m_solution, returns value of the energy
 
 
@@ -195,6 +249,8 @@ private:
 		REAL		m_gammaForward; // = rho_{ij} / rho_{i} where i=m_tail, j=m_head
 		REAL		m_gammaBackward; // = rho_{ij} / rho_{j} where i=m_tail, j=m_head
 
+		bool		m_isSwapped; // true if m_tail and m_head were exchanged by CompleteGraphConstruction()
+
 		Edge		m_message; // must be the last member in the struct since its size is not fixed.
 					           // Stores edge information and either forward or backward message.
 					           // Most of the time it's the backward message; it gets replaced
@@ -1,85 +1,195 @@
 #include "PAPointCloud.h"
 
 
-PAPointCloud::PAPointCloud()
+PAPointCloud::PAPointCloud() : m_size(0), m_stride(0), m_radius(0)
 {
-	m_radius = 0;
 }
 
-PAPointCloud::PAPointCloud(int size)
+PAPointCloud::PAPointCloud(int size) : m_size(0), m_stride(0), m_radius(0)
 {
-	m_radius = 0;
-	pointList.resize(size);
-	//for (int i = 0; i < size; i++)
-	//{
-	//	PAPoint nullPoint;
-	//	pointList.push_back(nullPoint);
-	//}
+	resize(size);
 }
 
 PAPointCloud::PAPointCloud(const PAPointCloud &cloud)
+	: m_columns(cloud.m_columns), m_labels(cloud.m_labels), m_size(cloud.m_size), m_stride(cloud.m_stride), m_radius(cloud.m_radius)
 {
-	pointList = std::vector<PAPoint>(cloud.getPoints());
-	m_radius = cloud.getRadius();
 }
 
 PAPointCloud::~PAPointCloud()
 {
-	//pointList.clear();
 }
 
-void PAPointCloud::addPoint(PAPoint point)
+int PAPointCloud::size() const
 {
-	pointList.push_back(point);
+	return m_size;
 }
 
-PAPoint & PAPointCloud::at(int index)
+void PAPointCloud::resize(int newsize)
 {
-	return pointList[index];
+	int stride = (newsize + COLUMN_ALIGN - 1) / COLUMN_ALIGN * COLUMN_ALIGN;
+	if (stride != m_stride)
+	{
+		/* Move every column to its new offset */
+		std::vector<float, Eigen::aligned_allocator<float>> columns(NUM_OF_COLUMNS * stride, 0.0f);
+		int kept = m_size < newsize ? m_size : newsize;
+		for (int c = 0; c < NUM_OF_COLUMNS; c++)
+			std::copy(column(c), column(c) + kept, columns.begin() + c * stride);
+		m_columns.swap(columns);
+		m_stride = stride;
+	}
+	else if (newsize > m_size)
+	{
+		for (int c = 0; c < NUM_OF_COLUMNS; c++)
+			std::fill(column(c) + m_size, column(c) + newsize, 0.0f);
+	}
+	m_labels.resize(newsize, NULL_LABEL);
+	m_size = newsize;
 }
 
-PAPoint & PAPointCloud::operator[](int index)
+PASpan<float> PAPointCloud::feature(int f)
 {
-	return pointList[index];
+	return PASpan<float>(column(f), m_size);
 }
 
-int PAPointCloud::size()
+PASpan<const float> PAPointCloud::feature(int f) const
 {
-	return pointList.size();
+	return PASpan<const float>(column(f), m_size);
 }
 
-void PAPointCloud::resize(int newsize)
+PASpan<float> PAPointCloud::x()
 {
-	if (newsize > size())
-	{
-		int num_of_added = newsize - size();
-		for (int i = 0; i < num_of_added; i++)
-		{
-			if (i == 8778)
-				std::cout << "";
-			PAPoint nullPoint;
-			pointList.push_back(nullPoint);
-		}
-	}
-	else
-	{
-		int num_of_removed = size() - newsize;
-		for (int i = 0; i < num_of_removed; i++)
-			pointList.pop_back();
-	}
+	return PASpan<float>(column(POSITION_X), m_size);
+}
+
+PASpan<const float> PAPointCloud::x() const
+{
+	return PASpan<const float>(column(POSITION_X), m_size);
+}
+
+PASpan<float> PAPointCloud::y()
+{
+	return PASpan<float>(column(POSITION_Y), m_size);
+}
+
+PASpan<const float> PAPointCloud::y() const
+{
+	return PASpan<const float>(column(POSITION_Y), m_size);
+}
+
+PASpan<float> PAPointCloud::z()
+{
+	return PASpan<float>(column(POSITION_Z), m_size);
+}
+
+PASpan<const float> PAPointCloud::z() const
+{
+	return PASpan<const float>(column(POSITION_Z), m_size);
+}
+
+PASpan<int> PAPointCloud::labels()
+{
+	return PASpan<int>(m_labels.data(), m_size);
+}
+
+PASpan<const int> PAPointCloud::labels() const
+{
+	return PASpan<const int>(m_labels.data(), m_size);
+}
+
+float PAPointCloud::feature(int index, int f) const
+{
+	return column(f)[index];
+}
+
+void PAPointCloud::setFeatures(int index, int part, const double feats[PART])
+{
+	for (int i = 0; i < PART; i++)
+		column(part * PART + i)[index] = feats[i];
+}
+
+void PAPointCloud::setFeatures(int index, int part, const QVector<double> &feats)
+{
+	setFeatures(index, part, feats.constData());
+}
+
+void PAPointCloud::setHeight(int index, float heightvalue)
+{
+	column(PAPoint::height)[index] = heightvalue;
+}
+
+void PAPointCloud::setSdf(int index, float sdfvalue)
+{
+	column(PAPoint::sdf)[index] = sdfvalue;
+}
+
+void PAPointCloud::setLabel(int index, int l)
+{
+	m_labels[index] = l;
+}
+
+int PAPointCloud::getLabel(int index) const
+{
+	return m_labels[index];
+}
+
+void PAPointCloud::setPosition(int index, float x, float y, float z)
+{
+	column(POSITION_X)[index] = x;
+	column(POSITION_Y)[index] = y;
+	column(POSITION_Z)[index] = z;
+}
+
+Eigen::Vector3f PAPointCloud::getPosition(int index) const
+{
+	return Eigen::Vector3f(column(POSITION_X)[index], column(POSITION_Y)[index], column(POSITION_Z)[index]);
 }
 
 using namespace std;
-void PAPointCloud::writeToFile(const char *filename)
+string PAPointCloud::toString(int index) const
+{
+	string featStr;
+	for (int i = 0; i < DIMEN - 1; i++)
+		featStr.append(to_string(column(i)[index]) + ",");
+	featStr.append(to_string(column(DIMEN - 1)[index]));
+
+	int part_label = m_labels[index];
+	if (part_label >= 0 && part_label <= 10)
+		featStr.append("," + to_string(part_label));
+
+	return featStr;
+}
+
+PAPoint PAPointCloud::getPoint(int index) const
+{
+	double feats[DIMEN];
+	for (int i = 0; i < DIMEN; i++)
+		feats[i] = column(i)[index];
+
+	PAPoint point(feats);
+	point.setLabel(m_labels[index]);
+	point.setPosition(column(POSITION_X)[index], column(POSITION_Y)[index], column(POSITION_Z)[index]);
+	return point;
+}
+
+void PAPointCloud::setPoint(int index, const PAPoint &point)
+{
+	for (int i = 0; i < DIMEN; i++)
+		column(i)[index] = point[i];
+	m_labels[index] = point.getLabel();
+	setPosition(index, point.x(), point.y(), point.z());
+}
+
+void PAPointCloud::writeToFile(const char *filename, const QVector<int> &rows) const
 {
 	ofstream out(filename);
 	if (out.is_open())
 	{
 		//out << size() << endl;
-		for (int i = 0; i < size(); i++){
-			int label = pointList.at(i).getLabel();
-			if (label == 9294 || label >= 0 && label <= 10)
-				out << pointList.at(i).toString() << endl;
+		for (int row = 0; row < size(); row++){
+			int i = rows.isEmpty() ? row : rows[row];
+			int label = m_labels[i];
+			if (label == NULL_LABEL || label >= 0 && label <= 10)
+				out << toString(i) << endl;
 		}
 
 		out.close();
@@ -95,8 +205,3 @@ float PAPointCloud::getRadius() const
 {
 	return m_radius;
 }
-
-std::vector<PAPoint> PAPointCloud::getPoints() const
-{
-	return pointList;
-}
\ No newline at end of file
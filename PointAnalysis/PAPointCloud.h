@@ -2,8 +2,38 @@
 #include <vector>
 #include <fstream>
 #include <iostream>
+#include <Eigen\Core>
 #include "PAPoint.h"
 
+/*
+ * Non-owning view of size contiguous elements (a column of PAPointCloud or a range of it).
+ * The view stays valid until the cloud it points into is resized or destroyed.
+ */
+template <class T> class PASpan
+{
+public:
+	PASpan() : m_data(NULL), m_size(0) {}
+	PASpan(T *data, int size) : m_data(data), m_size(size) {}
+
+	T & operator[](int i) const { return m_data[i]; }
+	T * data() const { return m_data; }
+	int size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	T * begin() const { return m_data; }
+	T * end() const { return m_data + m_size; }
+	PASpan<T> subspan(int offset, int count) const { return PASpan<T>(m_data + offset, count); }
+
+private:
+	T *m_data;
+	int m_size;
+};
+
+/*
+ * Point cloud stored as columns (structure of arrays): DIMEN float feature columns, x, y, z
+ * position columns and an int label column. All float columns live in one aligned buffer and
+ * are padded to a multiple of 8 floats, so every column starts on an SSE boundary and a
+ * per-feature pass streams through contiguous memory.
+ */
 class PAPointCloud
 {
 public:
@@ -12,19 +42,50 @@ public:
 	PAPointCloud(const PAPointCloud &cloud);
 	~PAPointCloud();
 
-	void addPoint(PAPoint point);
-	void addPoint(PAPoint point, int index);
-	PAPoint & at(int index);
-	PAPoint & operator[](int index);
 	void resize(int newsize);
-	int size();
-	void writeToFile(const char *file);
+	int size() const;
+	void writeToFile(const char *file, const QVector<int> &rows = QVector<int>()) const;    /* rows: the point of each line, all points in order if empty */
 	void setRadius(float radius);
 	float getRadius() const;
-	std::vector<PAPoint> getPoints() const;
+
+	/* Columns */
+	PASpan<float> feature(int f);
+	PASpan<const float> feature(int f) const;
+	PASpan<float> x();
+	PASpan<const float> x() const;
+	PASpan<float> y();
+	PASpan<const float> y() const;
+	PASpan<float> z();
+	PASpan<const float> z() const;
+	PASpan<int> labels();
+	PASpan<const int> labels() const;
+
+	/* Single point accessors */
+	float feature(int index, int f) const;
+	void setFeatures(int index, int part, const double feats[PART]);
+	void setFeatures(int index, int part, const QVector<double> &feats);
+	void setHeight(int index, float heightvalue);
+	void setSdf(int index, float sdfvalue);
+	void setLabel(int index, int l);
+	int getLabel(int index) const;
+	void setPosition(int index, float x, float y, float z);
+	Eigen::Vector3f getPosition(int index) const;
+	std::string toString(int index) const;
+
+	/* Copy one point out of / into the columns */
+	PAPoint getPoint(int index) const;
+	void setPoint(int index, const PAPoint &point);
 
 private:
-	std::vector<PAPoint> pointList;
+	enum { COLUMN_ALIGN = 8 };    /* column padding in floats */
+	enum { POSITION_X = DIMEN, POSITION_Y, POSITION_Z, NUM_OF_COLUMNS };
+
+	std::vector<float, Eigen::aligned_allocator<float>> m_columns;    /* NUM_OF_COLUMNS columns of m_stride floats */
+	std::vector<int> m_labels;
+	int m_size;
+	int m_stride;
 	float m_radius;
-};
 
+	float * column(int c) { return m_columns.data() + c * m_stride; }
+	const float * column(int c) const { return m_columns.data() + c * m_stride; }
+};
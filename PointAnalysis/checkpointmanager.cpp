@@ -0,0 +1,202 @@
+#include "checkpointmanager.h"
+#include <cstdio>
+
+static const char *STAGE_NAMES[CheckpointManager::NUM_OF_STAGES] = { "features", "probabilities", "candidates", "potentials", "solution" };
+
+CheckpointManager::CheckpointManager(std::string model_name)
+	: m_directory(CHECKPOINT_DIR + model_name + "/")
+{
+	for (int i = 0; i < NUM_OF_STAGES; i++)
+	{
+		m_keys[i] = 0;
+		m_loaded[i] = false;
+	}
+	QDir().mkpath(QString::fromStdString(m_directory));
+}
+
+CheckpointManager::~CheckpointManager()
+{
+}
+
+std::string CheckpointManager::stageFilename(STAGE stage) const
+{
+	return m_directory + STAGE_NAMES[stage] + ".pack";
+}
+
+unsigned long long CheckpointManager::checksum(const char *data, long long size)
+{
+	/* FNV-1a */
+	unsigned long long h = 14695981039346656037ULL;
+	for (long long i = 0; i < size; i++)
+	{
+		h ^= (unsigned char)data[i];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
+void CheckpointManager::setKey(STAGE stage, unsigned long long key)
+{
+	if (m_keys[stage] != key)
+		m_loaded[stage] = false;
+	m_keys[stage] = key;
+}
+
+unsigned long long CheckpointManager::getKey(STAGE stage) const
+{
+	return m_keys[stage];
+}
+
+bool CheckpointManager::load(STAGE stage, QByteArray &payload)
+{
+	m_loaded[stage] = false;
+	std::ifstream in(stageFilename(stage).c_str(), std::ios::in | std::ios::binary);
+	if (!in.is_open())
+		return false;
+
+	Header header;
+	in.read((char *)&header, sizeof(Header));
+	if (!in || header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION || header.stage != stage
+		|| header.key != m_keys[stage] || header.size < 0)
+		return false;
+
+	payload.resize(header.size);
+	in.read(payload.data(), header.size);
+	if (!in || checksum(payload.constData(), header.size) != header.checksum)
+		return false;
+
+	qDebug("Checkpoint: resume from the %s of %s.", STAGE_NAMES[stage], m_directory.c_str());
+	m_loaded[stage] = true;
+	return true;
+}
+
+bool CheckpointManager::save(STAGE stage, const QByteArray &payload)
+{
+	if (m_loaded[stage])
+		return true;
+
+	std::string filename = stageFilename(stage);
+	std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	Header header;
+	header.magic = CHECKPOINT_MAGIC;
+	header.version = CHECKPOINT_VERSION;
+	header.stage = stage;
+	header.reserved = 0;
+	header.key = m_keys[stage];
+	header.checksum = checksum(payload.constData(), payload.size());
+	header.size = payload.size();
+	out.write((const char *)&header, sizeof(Header));
+	out.write(payload.constData(), payload.size());
+	out.close();
+
+	m_loaded[stage] = out.good();
+	return m_loaded[stage];
+}
+
+void CheckpointManager::remove(STAGE stage)
+{
+	std::remove(stageFilename(stage).c_str());
+	m_loaded[stage] = false;
+}
+
+QByteArray CheckpointManager::packPointCloud(const PAPointCloud &pointcloud)
+{
+	QByteArray payload;
+	QDataStream out(&payload, QIODevice::WriteOnly);
+	int size = pointcloud.size();
+	out << size << DIMEN << pointcloud.getRadius();
+	for (int f = 0; f < DIMEN; f++)
+		out.writeRawData((const char *)pointcloud.feature(f).data(), size * sizeof(float));
+	out.writeRawData((const char *)pointcloud.x().data(), size * sizeof(float));
+	out.writeRawData((const char *)pointcloud.y().data(), size * sizeof(float));
+	out.writeRawData((const char *)pointcloud.z().data(), size * sizeof(float));
+	out.writeRawData((const char *)pointcloud.labels().data(), size * sizeof(int));
+	return payload;
+}
+
+PAPointCloud * CheckpointManager::unpackPointCloud(const QByteArray &payload)
+{
+	QDataStream in(payload);
+	int size, dimen;
+	float radius;
+	in >> size >> dimen >> radius;
+	if (in.status() != QDataStream::Ok || dimen != DIMEN || size < 0)
+		return NULL;
+
+	PAPointCloud *pointcloud = new PAPointCloud(size);
+	pointcloud->setRadius(radius);
+	for (int f = 0; f < DIMEN; f++)
+		in.readRawData((char *)pointcloud->feature(f).data(), size * sizeof(float));
+	in.readRawData((char *)pointcloud->x().data(), size * sizeof(float));
+	in.readRawData((char *)pointcloud->y().data(), size * sizeof(float));
+	in.readRawData((char *)pointcloud->z().data(), size * sizeof(float));
+	if (in.readRawData((char *)pointcloud->labels().data(), size * sizeof(int)) != size * (int)sizeof(int))
+	{
+		delete(pointcloud);
+		return NULL;
+	}
+	return pointcloud;
+}
+
+QByteArray CheckpointManager::packDistributions(const QVector<QMap<int, float>> &distributions)
+{
+	QByteArray payload;
+	QDataStream out(&payload, QIODevice::WriteOnly);
+	out << distributions;
+	return payload;
+}
+
+bool CheckpointManager::unpackDistributions(const QByteArray &payload, QVector<QMap<int, float>> &distributions)
+{
+	QDataStream in(payload);
+	in >> distributions;
+	return in.status() == QDataStream::Ok && !distributions.isEmpty();
+}
+
+QByteArray CheckpointManager::packCandidates(const QVector<PAPart> &candidates)
+{
+	QByteArray payload;
+	QDataStream out(&payload, QIODevice::WriteOnly);
+	out << candidates;
+	return payload;
+}
+
+bool CheckpointManager::unpackCandidates(const QByteArray &payload, QVector<PAPart> &candidates)
+{
+	QDataStream in(payload);
+	in >> candidates;
+	return in.status() == QDataStream::Ok;
+}
+
+QByteArray CheckpointManager::packPotentials(const QVector<double> &unary, const QVector<double> &pairwise)
+{
+	QByteArray payload;
+	QDataStream out(&payload, QIODevice::WriteOnly);
+	out << unary << pairwise;
+	return payload;
+}
+
+bool CheckpointManager::unpackPotentials(const QByteArray &payload, QVector<double> &unary, QVector<double> &pairwise)
+{
+	QDataStream in(payload);
+	in >> unary >> pairwise;
+	return in.status() == QDataStream::Ok;
+}
+
+QByteArray CheckpointManager::packSolution(const QMap<int, int> &parts_picked)
+{
+	QByteArray payload;
+	QDataStream out(&payload, QIODevice::WriteOnly);
+	out << parts_picked;
+	return payload;
+}
+
+bool CheckpointManager::unpackSolution(const QByteArray &payload, QMap<int, int> &parts_picked)
+{
+	QDataStream in(payload);
+	in >> parts_picked;
+	return in.status() == QDataStream::Ok;
+}
@@ -0,0 +1,84 @@
+#ifndef CHECKPOINTMANAGER_H
+#define CHECKPOINTMANAGER_H
+
+#include <QByteArray>
+#include <QDataStream>
+#include <QDir>
+#include <QVector>
+#include <QMap>
+#include <QDebug>
+#include <fstream>
+#include <string>
+#include "PAPointCloud.h"
+#include "papart.h"
+
+#define CHECKPOINT_MAGIC 0x4b434150    /* "PACK" */
+#define CHECKPOINT_VERSION 1
+#define CHECKPOINT_DIR "../data/checkpoints/"
+
+/*
+ * Binary checkpoints of the stages of StructureAnalyser, one file per stage in
+ * ../data/checkpoints/<model name>/. Each stage has a dependency key, the hash of the key
+ * of the stage before it and of its own inputs and parameters, and a checkpoint is only
+ * valid under the key it was saved with. Changing a parameter of a stage thus invalidates
+ * it and the stages after it, while the stages before it are still loaded. The keys are mixed
+ * with DerivedCache::combine.
+ *   header: int magic, int version, int stage, int reserved, unsigned long long key,
+ *           unsigned long long checksum (of the payload), long long size (of the payload)
+ */
+class CheckpointManager
+{
+public:
+	enum STAGE{
+		FEATURES,
+		PROBABILITIES,
+		CANDIDATES,
+		POTENTIALS,
+		SOLUTION,
+		NUM_OF_STAGES
+	};
+
+	CheckpointManager(std::string model_name);
+	~CheckpointManager();
+
+	void setKey(STAGE stage, unsigned long long key);
+	unsigned long long getKey(STAGE stage) const;
+	/* The payload of the checkpoint of stage, false if there is none under the key of the stage */
+	bool load(STAGE stage, QByteArray &payload);
+	/* Does nothing if the checkpoint has just been loaded under the same key */
+	bool save(STAGE stage, const QByteArray &payload);
+	void remove(STAGE stage);
+
+	/* Payloads of the stages */
+	static QByteArray packPointCloud(const PAPointCloud &pointcloud);
+	static PAPointCloud * unpackPointCloud(const QByteArray &payload);
+	static QByteArray packDistributions(const QVector<QMap<int, float>> &distributions);
+	static bool unpackDistributions(const QByteArray &payload, QVector<QMap<int, float>> &distributions);
+	static QByteArray packCandidates(const QVector<PAPart> &candidates);
+	static bool unpackCandidates(const QByteArray &payload, QVector<PAPart> &candidates);
+	static QByteArray packPotentials(const QVector<double> &unary, const QVector<double> &pairwise);
+	static bool unpackPotentials(const QByteArray &payload, QVector<double> &unary, QVector<double> &pairwise);
+	static QByteArray packSolution(const QMap<int, int> &parts_picked);
+	static bool unpackSolution(const QByteArray &payload, QMap<int, int> &parts_picked);
+
+private:
+	struct Header
+	{
+		int magic;
+		int version;
+		int stage;
+		int reserved;
+		unsigned long long key;
+		unsigned long long checksum;
+		long long size;
+	};
+
+	std::string m_directory;
+	unsigned long long m_keys[NUM_OF_STAGES];
+	bool m_loaded[NUM_OF_STAGES];    /* The checkpoint on disk matches the current key of the stage */
+
+	std::string stageFilename(STAGE stage) const;
+	static unsigned long long checksum(const char *data, long long size);
+};
+
+#endif // CHECKPOINTMANAGER_H
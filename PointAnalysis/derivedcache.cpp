@@ -0,0 +1,121 @@
+#include "derivedcache.h"
+#include <cstdio>
+
+DerivedCache::DerivedCache(const std::string &directory, long long max_bytes)
+	: m_directory(directory), m_max_bytes(max_bytes)
+{
+	QDir().mkpath(QString::fromStdString(m_directory));
+}
+
+DerivedCache::~DerivedCache()
+{
+}
+
+std::string DerivedCache::entryFilename(unsigned long long key) const
+{
+	return m_directory + QString::number(key, 16).rightJustified(16, '0').toStdString() + ".padc";
+}
+
+unsigned long long DerivedCache::hashFile(const char *filename)
+{
+	std::ifstream in(filename, std::ios::in | std::ios::binary);
+	if (!in.is_open())
+		return 0;
+
+	unsigned long long h = 14695981039346656037ULL;
+	std::vector<char> buffer(1 << 16);
+	while (in)
+	{
+		in.read(buffer.data(), buffer.size());
+		std::streamsize count = in.gcount();
+		for (std::streamsize i = 0; i < count; i++)
+		{
+			h ^= (unsigned char)buffer[i];
+			h *= 1099511628211ULL;
+		}
+	}
+	return h;
+}
+
+unsigned long long DerivedCache::combine(unsigned long long key, double param)
+{
+	const unsigned char *bytes = (const unsigned char *)&param;
+	for (int i = 0; i < (int)sizeof(double); i++)
+	{
+		key ^= bytes[i];
+		key *= 1099511628211ULL;
+	}
+	return key;
+}
+
+bool DerivedCache::load(unsigned long long key, int ncolumns, int nrows, std::vector<float> &values)
+{
+	std::string filename = entryFilename(key);
+	std::fstream in(filename.c_str(), std::ios::in | std::ios::out | std::ios::binary);
+	if (!in.is_open())
+		return false;
+
+	Header header;
+	in.read((char *)&header, sizeof(Header));
+	if (!in || header.magic != DERIVED_CACHE_MAGIC || header.version != DERIVED_CACHE_VERSION
+		|| header.key != key || header.ncolumns != ncolumns || header.nrows != nrows)
+		return false;
+
+	values.resize((size_t)ncolumns * nrows);
+	in.read((char *)values.data(), values.size() * sizeof(float));
+	if (!in)
+		return false;
+
+	/* Rewrite the header to touch the file, the eviction goes by the modification time */
+	in.seekp(0);
+	in.write((const char *)&header, sizeof(Header));
+	in.close();
+
+	qDebug("DerivedCache: hit %s.", filename.c_str());
+	return true;
+}
+
+bool DerivedCache::store(unsigned long long key, int ncolumns, int nrows, const float *values)
+{
+	std::string filename = entryFilename(key);
+	std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+
+	Header header;
+	header.magic = DERIVED_CACHE_MAGIC;
+	header.version = DERIVED_CACHE_VERSION;
+	header.ncolumns = ncolumns;
+	header.nrows = nrows;
+	header.key = key;
+	out.write((const char *)&header, sizeof(Header));
+	out.write((const char *)values, (size_t)ncolumns * nrows * sizeof(float));
+	bool ok = out.good();
+	out.close();
+
+	if (!ok)
+	{
+		std::remove(filename.c_str());
+		return false;
+	}
+	evict();
+	return true;
+}
+
+void DerivedCache::evict()
+{
+	/* Oldest entries first */
+	QDir dir(QString::fromStdString(m_directory));
+	QFileInfoList entries = dir.entryInfoList(QStringList() << "*.padc", QDir::Files, QDir::Time | QDir::Reversed);
+
+	long long total = 0;
+	for (QFileInfoList::iterator it = entries.begin(); it != entries.end(); ++it)
+		total += it->size();
+
+	for (QFileInfoList::iterator it = entries.begin(); it != entries.end() && total > m_max_bytes; ++it)
+	{
+		total -= it->size();
+		qDebug() << "DerivedCache: evict" << it->fileName();
+		dir.remove(it->fileName());
+	}
+}
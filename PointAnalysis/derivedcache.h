@@ -0,0 +1,60 @@
+#ifndef DERIVEDCACHE_H
+#define DERIVEDCACHE_H
+
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDebug>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#define DERIVED_CACHE_MAGIC 0x43444150    /* "PADC" */
+#define DERIVED_CACHE_VERSION 1
+#define DERIVED_CACHE_DIR "../data/cache/"
+#define DERIVED_CACHE_MAX_BYTES (2048LL * 1024 * 1024)    /* The least recently used entries are evicted above this size */
+
+/* Tags of the kinds of entries, mixed into the keys */
+#define DERIVED_CACHE_NORMALS 1
+#define DERIVED_CACHE_CURVATURES 2
+
+/*
+ * Disk cache of per-point data derived from an input model (normals, multi-scale curvatures).
+ * An entry is a table of nrows x ncolumns floats stored column by column in one file named by
+ * its key, the key being the content hash of the input file mixed with the parameters the data
+ * depends on. Reading an entry touches its file, and storing one evicts the least recently
+ * used entries until the cache is below its size limit.
+ *   header: int magic, int version, int ncolumns, int nrows, unsigned long long key
+ */
+class DerivedCache
+{
+public:
+	DerivedCache(const std::string &directory = DERIVED_CACHE_DIR, long long max_bytes = DERIVED_CACHE_MAX_BYTES);
+	~DerivedCache();
+
+	bool load(unsigned long long key, int ncolumns, int nrows, std::vector<float> &values);
+	bool store(unsigned long long key, int ncolumns, int nrows, const float *values);
+
+	/* FNV-1a of the content of filename, 0 if it can't be read */
+	static unsigned long long hashFile(const char *filename);
+	/* Mix a parameter into a key */
+	static unsigned long long combine(unsigned long long key, double param);
+
+private:
+	struct Header
+	{
+		int magic;
+		int version;
+		int ncolumns;
+		int nrows;
+		unsigned long long key;
+	};
+
+	std::string m_directory;
+	long long m_max_bytes;
+
+	std::string entryFilename(unsigned long long key) const;
+	void evict();
+};
+
+#endif // DERIVEDCACHE_H
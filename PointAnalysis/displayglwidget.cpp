@@ -5,6 +5,10 @@ DisplayGLWidget::DisplayGLWidget(QWidget *parent)
 	m_xRot(0), m_yRot(0), m_zRot(0), outputNo(0), m_color(0.39, 1.0, 0.0), m_cameraPositionZ(0)
 {
 	m_model = new PCModel();
+	m_octree = PointOctree::build(m_model->constData(), 9, m_model->vertexCount());
+	m_modelDirty = true;
+	m_labelsDirty = false;
+	m_obbsDirty = true;
 	m_obbVbos.resize(4);
 	m_OBBs.resize(4);
 	for (int i = 0; i < 4; i++)
@@ -24,9 +28,13 @@ void DisplayGLWidget::cleanup()
 {
 	makeCurrent();
 	m_meshModelVbo.destroy();
+	m_labelVbo.destroy();
 	delete m_program;
 	m_program = 0;
 	delete(m_model);
+	m_model = NULL;
+	delete(m_octree);
+	m_octree = NULL;
 	for (int i = 0; i < m_OBBs.size(); i++)
 		delete(m_OBBs[i]);
 	m_OBBs.clear();
@@ -90,7 +98,12 @@ void DisplayGLWidget::setModel(PCModel *model)
 		m_obbVbos[i].release();
 	m_obbVbos.clear();*/
 
-	setupVertexAttribs();
+	delete(m_octree);
+	m_octree = PointOctree::build(m_model->constData(), 9, m_model->vertexCount());
+	emit addDebugText("Built the octree of the model, " + QString::number(m_octree->chunkCount()) + " chunks.");
+
+	/* The buffers are written in paintGL, where the context is current */
+	m_modelDirty = true;
 	update();
 }
 
@@ -104,16 +117,19 @@ static const char *vertexShaderSourceCore =
 "in vec4 vertex;\n"
 "in vec3 normal;\n"
 "in vec3 color;\n"
+"in float colorIndex;\n"
 "out vec3 vert;\n"
 "out vec3 vertNormal;\n"
 "out vec3 vertColor;\n"
 "uniform mat4 projMatrix;\n"
 "uniform mat4 mvMatrix;\n"
 "uniform mat3 normalMatrix;\n"
+"uniform vec3 palette[11];\n"
+"uniform int usePalette;\n"
 "void main() {\n"
 "   vert = vertex.xyz;\n"
 "   vertNormal = normalMatrix * normal;\n"
-"   vertColor = color;\n"
+"   vertColor = usePalette != 0 ? palette[int(colorIndex + 0.5)] : color;\n"
 "   gl_Position = projMatrix * mvMatrix * vertex;\n"
 "}\n";
 
@@ -136,15 +152,18 @@ static const char *vertexShaderSource =
 "attribute vec4 vertex;\n"
 "attribute vec3 normal;\n"
 "attribute vec4 color;\n"
+"attribute float colorIndex;\n"
 "varying vec3 vert;\n"
 "varying vec3 vertNormal;\n"
 "varying vec4 vertColor;\n"
 "uniform mat4 projMatrix;\n"
 "uniform mat4 mvMatrix;\n"
 "uniform mat3 normalMatrix;\n"
+"uniform vec3 palette[11];\n"
+"uniform int usePalette;\n"
 "void main() {\n"
 "   vert = vertex.xyz;\n"
-"   vertColor = color;\n"
+"   vertColor = usePalette != 0 ? vec4(palette[int(colorIndex + 0.5)], 1.0) : color;\n"
 "   vertNormal = normalMatrix * normal;\n"
 "   gl_Position = projMatrix * mvMatrix * vertex;\n"
 "}\n";
@@ -181,6 +200,7 @@ void DisplayGLWidget::initializeGL()
 	m_program->bindAttributeLocation("vertex", 0);
 	m_program->bindAttributeLocation("normal", 1);
 	m_program->bindAttributeLocation("color", 2);
+	m_program->bindAttributeLocation("colorIndex", 3);
 	m_program->link();
 
 	m_program->bind();
@@ -188,6 +208,8 @@ void DisplayGLWidget::initializeGL()
 	m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
 	m_normalMatrixLoc = m_program->uniformLocation("normalMatrix");
 	m_lightPosLoc = m_program->uniformLocation("lightPos");
+	m_paletteLoc = m_program->uniformLocation("palette");
+	m_usePaletteLoc = m_program->uniformLocation("usePalette");
 	//m_colorLoc = m_program->uniformLocation("vertColor");
 
 	// Create a vertex array object. In OpenGL ES 2.0 and OpenGL 2.x
@@ -209,34 +231,88 @@ void DisplayGLWidget::initializeGL()
 	// Light position is fixed.
 	m_program->setUniformValue(m_lightPosLoc, QVector3D(0, 0, 70));
 
+	/* The points are colored from their label in the shader */
+	m_program->setUniformValueArray(m_paletteLoc, &COLORS[0][0], NUM_OF_COLORS, 3);
+
 	m_program->release();
 }
 
 void DisplayGLWidget::setupVertexAttribs()
 {
 	// Setup our vertex buffer object.
-	m_meshModelVbo.create();
-	m_meshModelVbo.bind();
-	m_meshModelVbo.allocate(m_model->constData(), m_model->count() * sizeof(GLfloat));
-	m_meshModelVbo.bind();
-	/*QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
-	f->glEnableVertexAttribArray(0);
-	f->glEnableVertexAttribArray(1);
-	f->glEnableVertexAttribArray(2);
-	f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), 0);
-	f->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
-	f->glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 10 * sizeof(GLfloat), reinterpret_cast<void *>(6 * sizeof(GLfloat)));*/
+	if (!m_meshModelVbo.isCreated())
+		m_meshModelVbo.create();
+	if (!m_labelVbo.isCreated())
+		m_labelVbo.create();
+	if (m_modelDirty)
+	{
+		if (m_octree->size() != m_model->vertexCount())
+		{
+			delete(m_octree);
+			m_octree = PointOctree::build(m_model->constData(), 9, m_model->vertexCount());
+		}
+
+		/* The points go to the buffer in the octree order, through a small staging buffer */
+		int nvertices = m_octree->size();
+		QVector<GLfloat> staging(LOD_UPLOAD_POINTS * 6);
+		m_meshModelVbo.bind();
+		m_meshModelVbo.allocate(nvertices * 6 * sizeof(GLfloat));
+		for (int first = 0; first < nvertices; first += LOD_UPLOAD_POINTS)
+		{
+			int count = qMin(LOD_UPLOAD_POINTS, nvertices - first);
+			m_octree->gather(m_model->constData(), 9, 6, first, count, staging.data());
+			m_meshModelVbo.write(first * 6 * sizeof(GLfloat), staging.constData(), count * 6 * sizeof(GLfloat));
+		}
+		m_meshModelVbo.release();
+
+		m_labelVbo.bind();
+		m_labelVbo.allocate(nvertices);
+		m_labelVbo.release();
+		m_dirtyChunks.fill(true, m_octree->chunkCount());
+		m_labelsDirty = true;
+		m_modelDirty = false;
+	}
+	if (m_labelsDirty)
+		uploadLabels();
 
-	m_meshModelVbo.release();
+	if (m_obbsDirty)
+	{
+		for (int i = 0; i < m_obbVbos.size(); i++)
+		{
+			if (!m_obbVbos[i].isCreated())
+				m_obbVbos[i].create();
+			m_obbVbos[i].bind();
+			m_obbVbos[i].allocate(m_OBBs[i]->constData(), m_OBBs[i]->count() * sizeof(float));
+			m_obbVbos[i].release();
+		}
+		m_obbsDirty = false;
+	}
+}
 
-	for (int i = 0; i < m_obbVbos.size(); i++)
+void DisplayGLWidget::uploadLabels()
+{
+	/* Only the runs of chunks with recolored points are written */
+	QVector<unsigned char> staging;
+	m_labelVbo.bind();
+	int nchunks = m_dirtyChunks.size();
+	for (int c = 0; c < nchunks; c++)
 	{
-		m_obbVbos[i].create();
-		m_obbVbos[i].bind();
-		m_obbVbos[i].allocate(m_OBBs[i]->constData(), m_OBBs[i]->count() * sizeof(float));
-		m_obbVbos[i].bind();
-		m_obbVbos[i].release();
+		if (!m_dirtyChunks[c])
+			continue;
+		int last = c;
+		while (last + 1 < nchunks && m_dirtyChunks[last + 1])
+			last++;
+		int first = m_octree->chunkFirst(c);
+		int count = m_octree->chunkFirst(last) + m_octree->chunkSize(last) - first;
+		staging.resize(count);
+		m_octree->gather(m_model->colorIndexData(), first, count, staging.data());
+		m_labelVbo.write(first, staging.constData(), count);
+		for (int k = c; k <= last; k++)
+			m_dirtyChunks[k] = false;
+		c = last;
 	}
+	m_labelVbo.release();
+	m_labelsDirty = false;
 }
 
 void DisplayGLWidget::paintGL()
@@ -245,17 +321,8 @@ void DisplayGLWidget::paintGL()
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_CULL_FACE);
 
-	/* paint 1st object */
-	m_meshModelVbo.bind();
-
-	QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
-
-	f->glEnableVertexAttribArray(0);
-	f->glEnableVertexAttribArray(1);
-	f->glEnableVertexAttribArray(2);
-	f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), 0);
-	f->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
-	f->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(6 * sizeof(GLfloat)));
+	if (m_modelDirty || m_labelsDirty || m_obbsDirty)
+		setupVertexAttribs();
 
 	m_world.setToIdentity();
 	m_world.translate(m_model->getCenter().x(), m_model->getCenter().y(), m_model->getCenter().z());
@@ -265,20 +332,42 @@ void DisplayGLWidget::paintGL()
 	m_world.translate(-m_model->getCenter().x(), -m_model->getCenter().y(), -m_model->getCenter().z());
 
 	QOpenGLVertexArrayObject::Binder vaoBinder(&m_vao);
+	QOpenGLFunctions *f = QOpenGLContext::currentContext()->functions();
+
+	/* paint 1st object, the positions and normals from one buffer, the color indices from another */
+	m_meshModelVbo.bind();
+	f->glEnableVertexAttribArray(0);
+	f->glEnableVertexAttribArray(1);
+	f->glDisableVertexAttribArray(2);
+	f->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), 0);
+	f->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
+	m_labelVbo.bind();
+	f->glEnableVertexAttribArray(3);
+	f->glVertexAttribPointer(3, 1, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GLubyte), 0);
+	m_labelVbo.release();
+
 	m_program->bind();
 	m_program->setUniformValue(m_projMatrixLoc, m_proj);
 	m_program->setUniformValue(m_mvMatrixLoc, m_camera * m_world);
+	m_program->setUniformValue(m_usePaletteLoc, 1);
 	//m_program->setUniformValue(m_colorLoc, m_color);
 
 	QMatrix3x3 normalMatrix = m_world.normalMatrix();
 	m_program->setUniformValue(m_normalMatrixLoc, normalMatrix);
 	glPointSize(2.0);
-	glDrawArrays(GL_POINTS, 0, m_model->vertexCount());
+
+	/* Only the chunks of the octree in the view frustum, at the detail their size on screen calls for */
+	QMatrix4x4 mvMatrix = m_camera * m_world;
+	float pixels_per_unit = m_proj(1, 1) * height / 2.0f;
+	m_octree->select(m_proj * mvMatrix, mvMatrix, pixels_per_unit, LOD_POINT_BUDGET, m_drawRanges);
+	for (int i = 0; i < m_drawRanges.size(); i++)
+		glDrawArrays(GL_POINTS, m_drawRanges[i].first, m_drawRanges[i].second);
 
 	//glFinish();
 	//m_vao.release();
 
 	m_program->release();
+	f->glDisableVertexAttribArray(3);
 
 	/* Draw the oriented bounding boxes for parts */
 	for (int i = 0; i < m_obbVbos.size(); i++)
@@ -297,6 +386,7 @@ void DisplayGLWidget::paintGL()
 		m_program->bind();
 		m_program->setUniformValue(m_projMatrixLoc, m_proj);
 		m_program->setUniformValue(m_mvMatrixLoc, m_camera * m_world);
+		m_program->setUniformValue(m_usePaletteLoc, 0);
 
 		m_program->setUniformValue(m_normalMatrixLoc, normalMatrix);
 		glDrawArrays(GL_TRIANGLES, 0, m_OBBs[i]->vertexCount());
@@ -363,7 +453,21 @@ void DisplayGLWidget::outputPointCloud()
 void DisplayGLWidget::updateLabels()
 {
 	emit addDebugText("Update the labels of points in GLWidget.");
-	setupVertexAttribs();
+
+	/* Mark the chunks of the recolored points, the positions and normals stay as they are */
+	const QVector<int> &recolored = m_model->getRecoloredPoints();
+	if (!m_modelDirty && m_octree->size() == m_model->vertexCount())
+	{
+		if (recolored.size() > m_model->vertexCount() / FULL_RECOLOR_FRACTION)
+			m_dirtyChunks.fill(true, m_octree->chunkCount());
+		else
+		{
+			for (int i = 0; i < recolored.size(); i++)
+				m_dirtyChunks[m_octree->chunkAt(m_octree->rankOf(recolored[i]))] = true;
+		}
+		if (!recolored.isEmpty())
+			m_labelsDirty = true;
+	}
 	update();
 }
 
@@ -389,6 +493,6 @@ void DisplayGLWidget::setOBBs(QVector<OBB *> obbs)
 		//delete(temp_to_delete);
 	}
 
-	setupVertexAttribs();
+	m_obbsDirty = true;
 	update();
 }
\ No newline at end of file
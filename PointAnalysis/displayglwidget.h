@@ -17,6 +17,11 @@
 #include <fstream>
 #include <string>
 #include "obb.h"
+#include "pointoctree.h"
+
+#define LOD_POINT_BUDGET 2000000    /* Most points drawn in a frame */
+#define LOD_UPLOAD_POINTS 65536    /* Points copied to the vertex buffer at a time */
+#define FULL_RECOLOR_FRACTION 4    /* All labels are uploaded when more than 1 / FULL_RECOLOR_FRACTION of the points change color */
 
 QT_FORWARD_DECLARE_CLASS(QOpenGLShaderProgram)
 
@@ -53,6 +58,7 @@ protected:
 
 private:
 	void setupVertexAttribs();
+	void uploadLabels();
 	void setXRotation(int angle);
 	void setYRotation(int angle);
 	void setZRotation(int angle);
@@ -66,15 +72,24 @@ private:
 	double m_cameraPositionZ;
 	QPoint m_lastPos;
 	QOpenGLVertexArrayObject m_vao;
-	QOpenGLBuffer m_meshModelVbo;
+	QOpenGLBuffer m_meshModelVbo;    /* Position and normal of the points */
+	QOpenGLBuffer m_labelVbo;    /* Index in COLORS of the color of the points, a byte each */
 	QVector<QOpenGLBuffer> m_obbVbos;
 	QOpenGLShaderProgram *m_program;
 	PCModel *m_model;
+	PointOctree *m_octree;    /* Octree of the points of m_model, m_meshModelVbo holds them in its order */
+	QVector<QPair<int, int>> m_drawRanges;    /* Ranges of m_meshModelVbo drawn in the last frame */
+	bool m_modelDirty;    /* m_meshModelVbo is out of date */
+	bool m_labelsDirty;    /* Some chunks of m_labelVbo are out of date */
+	QVector<bool> m_dirtyChunks;
+	bool m_obbsDirty;
 	QVector<OBB *> m_OBBs;
 	int m_projMatrixLoc;
 	int m_mvMatrixLoc;
 	int m_normalMatrixLoc;
 	int m_lightPosLoc;
+	int m_paletteLoc;
+	int m_usePaletteLoc;
 	int m_colorLoc;
 	QVector3D m_color;
 	QMatrix4x4 m_proj;
@@ -1,4 +1,5 @@
 #include "energyfunctions.h"
+#include "derivedcache.h"
 
 using namespace std;
 using namespace Eigen;
@@ -12,82 +13,55 @@ float EnergyFunctions::w5 = 100.0;
 EnergyFunctions::EnergyFunctions(string modelClassName) : m_modelClassName(modelClassName), m_null_label(10)
 {
 	cout << "Consruct EnegerFunctions" << endl;
-	/* Load the part relations priors from file */
-	const int DIMENSION = 32;
-	string covariance_path = "../data/parts_relations/" + m_modelClassName + "_covariance.txt";
-	string mean_path = "../data/parts_relations/" + m_modelClassName + "_mean.txt";
-	ifstream cov_in(covariance_path.c_str());
-	ifstream mean_in(mean_path.c_str());
-
-	/* Load the covariance matrices of each parts pair */
-	if (cov_in.is_open())
+	/* Map the binary bundle of the part relations priors, or build it from the text priors once */
+	string priors_path = "../data/parts_relations/" + m_modelClassName + RELATION_PRIORS_SUFFIX;
+	m_priors = RelationPriors::open(priors_path);
+	if (m_priors == NULL)
 	{
-		char buffer[512];
-		while (!cov_in.eof())
-		{
-			/* Read the part labels pair */
-			cov_in.getline(buffer, 512);
-			int label1, label2;
-			if (strlen(buffer) > 0)
-			{
-				QString labels(buffer);
-				label1 = labels.section(' ', 0, 0).toInt();
-				label2 = labels.section(' ', 1, 1).toInt();
-
-
-				/* Read covariance matrix row by row */
-				MatrixXf covariance(DIMENSION, DIMENSION);
-				for (int i = 0; i < DIMENSION; i++)
-				{
-					VectorXf row(DIMENSION);
-					cov_in.getline(buffer, 512);
-					QStringList row_str = QString(buffer).split(' ');
-					for (int j = 0; j < DIMENSION; j++)
-						row(j) = row_str[j].toFloat();
-
-					covariance.row(i) = row;
-				}
-
-				m_covariance_matrices.insert(QPair<int, int>(label1, label2), covariance);
-			}
-		}
-
-		cov_in.close();
+		string covariance_path = "../data/parts_relations/" + m_modelClassName + "_covariance.txt";
+		string mean_path = "../data/parts_relations/" + m_modelClassName + "_mean.txt";
+		m_priors = RelationPriors::loadText(covariance_path, mean_path);
+		if (m_priors == NULL)
+			m_priors = RelationPriors::build(QMap<QPair<int, int>, VectorXd>(), QMap<QPair<int, int>, MatrixXd>());
+		else if (!m_priors->save(priors_path))
+			qDebug("EnergyFunctions: cannot save %s.", priors_path.c_str());
 	}
+	m_priors_key = DerivedCache::hashFile(priors_path.c_str());
+	qDebug("EnergyFunctions: %d part relation priors.", m_priors->size());
+}
 
-	/* Load the mean vectors of each parts pair */
-	if (mean_in.is_open())
-	{
-		char buffer[512];
-		while (!mean_in.eof())
-		{
-			/* Read the part labels pair */
-			mean_in.getline(buffer, 512);
-			int label1, label2;
-			if (strlen(buffer) > 0)
-			{
-				QString labels(buffer);
-				label1 = labels.section(' ', 0, 0).toInt();
-				label2 = labels.section(' ', 1, 1).toInt();
-
-
-				/* Read the mean vectors */
-				VectorXf mean_vec(DIMENSION);
-				mean_in.getline(buffer, 512);
-				QStringList vec_str = QString(buffer).split(' ');
-				for (int j = 0; j < vec_str.size(); j++)
-					mean_vec(j) = vec_str[j].toFloat();
-
-				m_mean_vectors.insert(QPair<int, int>(label1, label2), mean_vec);
-			}
-		}
-
-		mean_in.close();
-	}
+void EnergyFunctions::setWeights(float weight1, float weight2, float weight3, float weight4, float weight5)
+{
+	w1 = weight1;
+	w2 = weight2;
+	w3 = weight3;
+	w4 = weight4;
+	w5 = weight5;
+}
+
+void EnergyFunctions::getWeights(float &weight1, float &weight2, float &weight3, float &weight4, float &weight5)
+{
+	weight1 = w1;
+	weight2 = w2;
+	weight3 = w3;
+	weight4 = w4;
+	weight5 = w5;
+}
+
+unsigned long long EnergyFunctions::getParametersKey() const
+{
+	unsigned long long key = m_priors_key;
+	key = DerivedCache::combine(key, w1);
+	key = DerivedCache::combine(key, w2);
+	key = DerivedCache::combine(key, w3);
+	key = DerivedCache::combine(key, w4);
+	key = DerivedCache::combine(key, w5);
+	return DerivedCache::combine(key, m_null_label);
 }
 
 EnergyFunctions::~EnergyFunctions()
 {
+	delete(m_priors);
 }
 
 void EnergyFunctions::setPointCloud(PAPointCloud * pointcloud)
@@ -122,7 +96,6 @@ double EnergyFunctions::Epnt(PAPart part, int label)
 
 	for (int i = 0; i < vertices_indices.size(); i++)
 	{
-		PAPoint point = m_pointcloud->at(vertices_indices[i]);
 		QMap<int, float> distribution = m_distributions[vertices_indices[i]];
 		float score = distribution.value(label);
 		double e;
@@ -157,25 +130,16 @@ double EnergyFunctions::Epair(PAPartRelation relation, int cluster_no_1, int clu
 		if (label1 == m_null_label || label2 == m_null_label)
 			return INF / 2.0;
 		/* If two assumed labels are the same, set the energy value to infinity */
-		if (label1 == label2 || !m_mean_vectors.contains(QPair<int, int>(label1, label2)))
+		int prior = m_priors->find(label1, label2);
+		if (label1 == label2 || prior < 0)
 			return INF;
 
 		/* If the two assumed labels are the labels of real parts */
 		//PAPartRelation relation(part1, part2);
-		VectorXf relation_vec(relation.getDimension());
-
 		std::vector<float> relation_feature = relation.getFeatureVector_Float();
-		for (int i = 0; i < 32; i++)
-			relation_vec(i) = relation_feature[i];
-
-		VectorXf mean_vec = m_mean_vectors.value(QPair<int, int>(label1, label2));
-		MatrixXf covariance = m_covariance_matrices.value(QPair<int, int>(label1, label2));
-		MatrixXf cov_inverse = covariance.inverse();
-		VectorXf std_mean = relation_vec - mean_vec;
 
-		float energy_square_without_w = std_mean.transpose() * cov_inverse * std_mean;
-		//cout << "energy_square = " << energy_square << endl;
-		float energy = w4 * std::sqrt(energy_square_without_w);
+		/* Mahalanobis distance to the prior, from the Cholesky factor of its covariance */
+		float energy = w4 * m_priors->mahalanobis(prior, relation_feature.data());
 		//cout << "Epair = " << energy << endl;
 
 		return energy;
@@ -13,6 +13,7 @@
 #include "PAPoint.h"
 #include "gencandidatesthread.h"
 #include "utils.h"
+#include "relationpriors.h"
 
 #define INF 1E9 /* The infinite value */
 
@@ -25,6 +26,11 @@ public:
 	void setPointCloud(PAPointCloud *pointcloud);
 	void setDistributions(QVector<QMap<int, float>> distributions);
 	int getNullLabelName() { return m_null_label; }
+	/* Set the weights of the energy terms. Predictions running afterwards use the new weights. */
+	static void setWeights(float weight1, float weight2, float weight3, float weight4, float weight5);
+	static void getWeights(float &weight1, float &weight2, float &weight3, float &weight4, float &weight5);
+	/* Hash of the weights and of the part relations priors, the potentials depend on nothing else than them and their inputs */
+	unsigned long long getParametersKey() const;
 	/* 
 	 Epnt
 	 The function computing the point classification energy.
@@ -49,11 +55,11 @@ public:
 
 private:
 	std::string m_modelClassName;
-	QMap<QPair<int, int>, Eigen::MatrixXf> m_covariance_matrices;
-	QMap<QPair<int, int>, Eigen::VectorXf> m_mean_vectors;
+	RelationPriors *m_priors;    /* The part relations priors of the class */
 	QVector<QMap<int, float>> m_distributions;
 	PAPointCloud *m_pointcloud;
 	int m_null_label;
+	unsigned long long m_priors_key;    /* Content hash of the priors bundle */
 
 	static float w1, w2, w3, w4, w5;
 };
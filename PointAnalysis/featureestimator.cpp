@@ -1,25 +1,23 @@
 #include "featureestimator.h"
 
 FeatureEstimator::FeatureEstimator(QObject *parent)
-	: QObject(parent)
+	: QObject(parent), m_index(NULL), m_content_hash(0), m_reordered(false), m_curvature_cached(false)
 {
 	m_cloud = pcl::PointCloud<pcl::PointXYZ>::Ptr(new pcl::PointCloud<pcl::PointXYZ>);
 	m_normals = pcl::PointCloud<pcl::Normal>::Ptr(new pcl::PointCloud < pcl::Normal>);
 }
 
 FeatureEstimator::FeatureEstimator(PCModel *pcModel, PHASE phase, QObject *parent)
-	: QObject(parent), finish_count(NUM_OF_THREADS), m_phase(phase)
+	: QObject(parent), finish_count(NUM_OF_THREADS), m_phase(phase), m_index(NULL), m_curvature_cached(false)
 {
-	qDebug() << "Initializing the feature estimator...";
-	emit addDebugText("Initializing the feature estimator...");
+	LOG_INFO(Logger::Features, "Initializing the feature estimator...");
 	m_cloud = pcl::PointCloud<pcl::PointXYZ>::Ptr(new pcl::PointCloud<pcl::PointXYZ>);
 	m_normals = pcl::PointCloud<pcl::Normal>::Ptr(new pcl::PointCloud < pcl::Normal>);
 	m_pointcloudFile = QString(pcModel->getInputFilename().c_str());
 	m_pointcloud = new PAPointCloud(pcModel->vertexCount());
 	m_pointcloud->setRadius(pcModel->getRadius());
 
-	qDebug() << "Before initialization, the size of cloud is" << m_cloud->size();
-	qDebug("The cloud should have %d points.", pcModel->vertexCount());
+	LOG_DEBUG(Logger::Features, "The cloud should have %d points.", pcModel->vertexCount());
 	for (int i = 0; i < pcModel->vertexCount(); i++)
 	{
 		int gap = i * 9;
@@ -35,18 +33,18 @@ FeatureEstimator::FeatureEstimator(PCModel *pcModel, PHASE phase, QObject *paren
 		m_cloud->push_back(p);
 		pcl::Normal normal(nx, ny, nz);
 		m_normals->push_back(normal);
-		m_pointcloud->at(i).setPosition(x, y, z);
+		m_pointcloud->setPosition(i, x, y, z);
 	}
 
 	m_radius = pcModel->getRadius();
 	m_points_labels = pcModel->getLabels();
 	m_sdf = pcModel->getSdf();
+	m_content_hash = pcModel->getContentHash();
+	m_reordered = pcModel->isReordered();
+	openSpatialIndex(pcModel);
 
-	qDebug() << "After initialization, the size of cloud is" << m_cloud->size();
-
-	qRegisterMetaType<QVector<QVector<double>>>("FeatureVector");
-	qDebug() << "Initialization done.";
-	emit addDebugText("Initialization done.");
+	LOG_DEBUG(Logger::Features, "After initialization, the size of cloud is %d.", (int)m_cloud->size());
+	LOG_INFO(Logger::Features, "Initialization done.");
 }
 
 void FeatureEstimator::reset(PCModel *pcModel)
@@ -56,8 +54,7 @@ void FeatureEstimator::reset(PCModel *pcModel)
 	{
 		if (m_subthreads[i] != NULL)
 		{
-			if (m_subthreads[i]->isRunning())
-				m_subthreads[i]->terminate();
+			m_subthreads[i]->cancel();
 			delete(m_subthreads[i]);
 			m_subthreads[i] = NULL;
 		}
@@ -68,8 +65,7 @@ void FeatureEstimator::reset(PCModel *pcModel)
 	if (m_normals->size())
 		m_normals->clear();
 
-	qDebug() << "Reset the feature estimator...";
-	emit addDebugText("Reset the feature estimator...");
+	LOG_INFO(Logger::Features, "Reset the feature estimator...");
 	m_cloud = pcl::PointCloud<pcl::PointXYZ>::Ptr(new pcl::PointCloud<pcl::PointXYZ>);
 	m_normals = pcl::PointCloud<pcl::Normal>::Ptr(new pcl::PointCloud < pcl::Normal>);
 	m_pointcloudFile = QString::fromStdString(pcModel->getInputFilename());
@@ -90,16 +86,18 @@ void FeatureEstimator::reset(PCModel *pcModel)
 		m_cloud->push_back(p);
 		pcl::Normal normal(nx, ny, nz);
 		m_normals->push_back(normal);
-		m_pointcloud->at(i).setPosition(x, y, z);
+		m_pointcloud->setPosition(i, x, y, z);
 	}
 
 	m_radius = pcModel->getRadius();
 	m_points_labels = pcModel->getLabels();
 	m_sdf = pcModel->getSdf();
+	m_content_hash = pcModel->getContentHash();
+	m_reordered = pcModel->isReordered();
+	openSpatialIndex(pcModel);
 
 	finish_count = NUM_OF_THREADS;
-	qDebug() << "Resetting done.";
-	emit addDebugText("Resetting done.");
+	LOG_INFO(Logger::Features, "Resetting done.");
 }
 
 FeatureEstimator::~FeatureEstimator()
@@ -109,100 +107,135 @@ FeatureEstimator::~FeatureEstimator()
 	{
 		if (m_subthreads[i] != NULL)
 		{
-			if (m_subthreads[i]->isRunning())
-				m_subthreads[i]->terminate();
+			m_subthreads[i]->cancel();
 			delete(m_subthreads[i]);
 			m_subthreads[i] = NULL;
 		}
 	}
 	m_subthreads.clear();
+
+	if (m_index != NULL)
+	{
+		delete(m_index);
+		m_index = NULL;
+	}
+}
+
+void FeatureEstimator::openSpatialIndex(PCModel *pcModel)
+{
+	if (m_index != NULL)
+		delete(m_index);
+
+	/* The index is saved next to the feature cache and mapped again if the model hasn't changed */
+	std::string index_filename = "../data/features_test/" + Utils::getModelName(m_pointcloudFile).toStdString() + ".pidx";
+	const GLfloat *data = pcModel->constData();
+	m_index = SpatialIndex::openOrBuild(index_filename, data, data + 1, data + 2, 9, pcModel->vertexCount(), SPATIAL_INDEX_CELL_COEF * m_radius);
+
+	LOG_INFO(Logger::Features, "Spatial index %s %s.", m_index->isMapped() ? "mapped from" : "built and saved to", index_filename.c_str());
+}
+
+unsigned long long FeatureEstimator::curvatureKey() const
+{
+	/* The curvatures depend on the point order and the search radii */
+	unsigned long long key = DerivedCache::combine(m_content_hash, DERIVED_CACHE_CURVATURES);
+	key = DerivedCache::combine(key, LOAD_NORMAL_ORIENTATION);
+	key = DerivedCache::combine(key, m_reordered);
+	key = DerivedCache::combine(key, m_radius);
+	key = DerivedCache::combine(key, NUM_OF_THREADS - 1);
+	return key;
+}
+
+bool FeatureEstimator::loadCurvatures()
+{
+	if (m_content_hash == 0)
+		return false;
+
+	DerivedCache cache;
+	int npoints = m_pointcloud->size();
+	std::vector<float> curvatures;
+	if (!cache.load(curvatureKey(), NUM_OF_THREADS - 1, npoints, curvatures))
+		return false;
+
+	for (int part = 0; part < NUM_OF_THREADS - 1; part++)
+		std::memcpy(m_pointcloud->feature(part * PART + PART - 1).data(), curvatures.data() + (size_t)part * npoints, npoints * sizeof(float));
+	LOG_INFO(Logger::Features, "Curvatures loaded from the cache.");
+	return true;
+}
+
+void FeatureEstimator::storeCurvatures()
+{
+	if (m_content_hash == 0)
+		return;
+
+	DerivedCache cache;
+	int npoints = m_pointcloud->size();
+	std::vector<float> curvatures((size_t)(NUM_OF_THREADS - 1) * npoints);
+	for (int part = 0; part < NUM_OF_THREADS - 1; part++)
+		std::memcpy(curvatures.data() + (size_t)part * npoints, m_pointcloud->feature(part * PART + PART - 1).data(), npoints * sizeof(float));
+	cache.store(curvatureKey(), NUM_OF_THREADS - 1, npoints, curvatures.data());
+}
+
+void FeatureEstimator::setLabelsAndSdf()
+{
+	/* Labels of the training data, the FeatureThread leaves the sdf column of the training data to the mesh sdf values */
+	if (m_points_labels.size() > 0)
+	{
+		for (int i = 0; i < m_pointcloud->size(); i++)
+		{
+			m_pointcloud->setLabel(i, m_points_labels[i]);
+			if (m_phase == PHASE::TRAINING && i < m_sdf.size())
+				m_pointcloud->setSdf(i, m_sdf[i]);
+		}
+	}
 }
 
 void FeatureEstimator::estimateFeatures()
 {
 	finish_count = NUM_OF_THREADS;
-	qDebug() << "Estimating the point features...";
-	emit addDebugText("Estimating the point features...");
+	setLabelsAndSdf();
+	m_curvature_cached = loadCurvatures();
+	LOG_INFO(Logger::Features, "Estimating the point features...");
 	/* Create subthread to estimate point features in 5 different search radius */
-	qDebug() << "Create 6 FeatureThreads, each of which esitmate the point features in a particular search radius.";
-	emit addDebugText("Create 6 FeatureThreads, each of which esitmate the point features in a particular search radius.");
+	LOG_DEBUG(Logger::Features, "Create %d FeatureThreads, each of which esitmate the point features in a particular search radius.", NUM_OF_THREADS);
 
 	for (int i = 0; i < NUM_OF_THREADS; i++)
 	{
 		double coefficient = 0.1 * (i + 1);
-		FeatureThread * thread = new FeatureThread(i, m_cloud, m_normals, m_radius, coefficient, this);
-		connect(thread, SIGNAL(estimateCompleted(int, QVector<QVector<double>>)), this, SLOT(receiveFeatures(int, QVector<QVector<double>>)));
-		connect(thread, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
+		FeatureThread * thread = new FeatureThread(i, m_cloud, m_normals, m_index, m_radius, coefficient, m_pointcloud, this);
+		connect(thread, SIGNAL(estimateCompleted(int)), this, SLOT(receiveFeatures(int)));
 		/* If it is the thread computing sdf values, then sent the filename of the point cloud to it */
 		if (m_phase == PHASE::TRAINING && i == NUM_OF_THREADS - 1)
 			thread->setInputFilename(m_pointcloudFile);
+		thread->setCurvatureCached(m_curvature_cached);
 
 		m_subthreads.push_back(thread);
 		thread->start();
 	}
 }
 
-void FeatureEstimator::receiveFeatures(int sid, QVector<QVector<double>> points_feats)
+void FeatureEstimator::receiveFeatures(int sid)
 {
-	qDebug("Receive features from FeatureThread-%d", sid);
-	QString dtext = "Receive features from FeatureThread-" + QString::number(sid);
-	emit addDebugText(dtext);
-
-	int size = points_feats.size();
-	
-	if (sid < NUM_OF_THREADS - 1)   /* It is the thread which computes features based on neighborhood */
-	{
-		for (int i = 0; i < size; i++)
-		{
-			QVector<double> feat = points_feats[i];
-			if (feat.size() >= 5)    
-				m_pointcloud->at(i).setFeatures(sid, feat);
-			
-			//qDebug() << pointcloud[i].toString().c_str();
-		}
-	}
-	else    /* It is the thread which computes height and sdf */
-	{
-		if (m_points_labels.size() > 0){
-			const int BUFFER_SIZE = 10;
-			char buffer[BUFFER_SIZE];
-			for (int i = 0; i < size; i++)
-			{
-				/* Set the height and sdf for each point */
-				QVector<double> feat = points_feats[i];
-				m_pointcloud->at(i).setHeight(feat[0]);
-				if (m_phase == PHASE::TRAINING)
-					m_pointcloud->at(i).setSdf(m_sdf[i]);
-				else
-					m_pointcloud->at(i).setSdf(feat[1]);
-
-				/* Set part label for each point */
-				m_pointcloud->at(i).setLabel(m_points_labels[i]);
-			}
-		}
-		else
-		{
-			for (int i = 0; i < size; i++)
-			{
-				/* Set the height and sdf */
-				QVector<double> feat = points_feats[i];
-				m_pointcloud->at(i).setHeight(feat[0]);
-				m_pointcloud->at(i).setSdf(feat[1]);
-			}
-		}
-	}
+	/* The FeatureThread has written its columns of m_pointcloud already */
+	LOG_DEBUG(Logger::Features, "Receive features from FeatureThread-%d", sid);
 
 	finish_count--;
 	if (finish_count == 0)
 	{
+		if (!m_curvature_cached)
+			storeCurvatures();
 		emit estimateCompleted(m_pointcloud);
 		finish_count = NUM_OF_THREADS;
 	}
 }
 
-void FeatureEstimator::onDebugTextAdded(QString text)
+void FeatureEstimator::cancel()
 {
-	emit addDebugText(text);
+	/* The results the threads have sent meanwhile are dropped with them, the caller deletes the estimator */
+	for (int i = 0; i < m_subthreads.size(); i++)
+	{
+		if (m_subthreads[i] != NULL)
+			m_subthreads[i]->cancel();
+	}
 }
 
 void FeatureEstimator::setPhase(PHASE phase)
@@ -17,8 +17,9 @@
 #include <CGAL/Cartesian_d.h>
 #include "featurethread.h"
 #include "PAPointCloud.h"
-
-#define NUM_OF_THREADS 6
+#include "spatialindex.h"
+#include "derivedcache.h"
+#include "normalestimator.h"
 
 typedef CGAL::Cartesian_d<double>              K;
 typedef CGAL::Min_sphere_annulus_d_traits_d<K> Traits;
@@ -41,14 +42,13 @@ public:
 	void estimateFeatures();
 	void reset(PCModel * pcModel);
 	void setPhase(PHASE phase);
+	void cancel();    /* Stops the FeatureThreads and waits for them, estimateCompleted is not emitted for them */
 
 	public slots:
-	void receiveFeatures(int id, QVector<QVector<double>> feats);
-	void onDebugTextAdded(QString text);
+	void receiveFeatures(int id);
 
 signals:
 	void estimateCompleted(PAPointCloud *cloud);
-	void addDebugText(QString text);
 
 private:
 	pcl::PointCloud<pcl::PointXYZ>::Ptr m_cloud;
@@ -57,10 +57,20 @@ private:
 	int finish_count;
 	QVector<FeatureThread *> m_subthreads;
 	PAPointCloud *m_pointcloud;
+	SpatialIndex *m_index;    /* Radius searches of all FeatureThreads */
 	QString m_pointcloudFile;
 	QVector<int> m_points_labels;
 	PHASE m_phase;
 	QVector<double> m_sdf;
+	unsigned long long m_content_hash;    /* Of the input file of the model */
+	bool m_reordered;
+	bool m_curvature_cached;
+
+	void setLabelsAndSdf();
+	void openSpatialIndex(PCModel *pcModel);
+	unsigned long long curvatureKey() const;
+	bool loadCurvatures();
+	void storeCurvatures();
 
 	//QVector<int> getLabels(QString segfile);
 };
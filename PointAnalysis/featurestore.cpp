@@ -0,0 +1,102 @@
+#include "featurestore.h"
+
+FeatureStore::FeatureStore() : m_npoints(0), m_written(0)
+{
+}
+
+FeatureStore::~FeatureStore()
+{
+	close();
+}
+
+bool FeatureStore::open(const char *filename, int npoints)
+{
+	close();
+	m_out.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!m_out.is_open())
+		return false;
+
+	int header[4] = { FEATURE_STORE_MAGIC, FEATURE_STORE_VERSION, npoints, DIMEN };
+	m_out.write((const char *)header, sizeof(header));
+	m_npoints = npoints;
+	m_written = 0;
+	return true;
+}
+
+void FeatureStore::writeChunk(const PAPointCloud &cloud, const int *indices, int count)
+{
+	if (!m_out.is_open() || count <= 0)
+		return;
+
+	m_out.write((const char *)&count, sizeof(int));
+	m_out.write((const char *)indices, count * sizeof(int));
+	for (int f = 0; f < DIMEN; f++)    /* The columns are contiguous, no gathering */
+		m_out.write((const char *)cloud.feature(f).data(), count * sizeof(float));
+	m_out.write((const char *)cloud.labels().data(), count * sizeof(int));
+	m_written += count;
+}
+
+void FeatureStore::close()
+{
+	if (m_out.is_open())
+	{
+		if (m_written != m_npoints)
+			qDebug("FeatureStore: %d of %d points written.", m_written, m_npoints);
+		m_out.close();
+	}
+}
+
+int FeatureStore::writtenPoints() const
+{
+	return m_written;
+}
+
+PAPointCloud * FeatureStore::load(const char *filename)
+{
+	std::ifstream in(filename, std::ios::in | std::ios::binary);
+	if (!in.is_open())
+		return NULL;
+
+	int header[4];
+	in.read((char *)header, sizeof(header));
+	if (!in || header[0] != FEATURE_STORE_MAGIC || header[1] != FEATURE_STORE_VERSION || header[3] != DIMEN)
+		return NULL;
+
+	int npoints = header[2];
+	PAPointCloud *cloud = new PAPointCloud(npoints);
+	std::vector<int> indices;
+	std::vector<float> values;
+	std::vector<int> labels;
+	int count;
+	while (in.read((char *)&count, sizeof(int)) && count > 0 && count <= npoints)
+	{
+		indices.resize(count);
+		values.resize(count);
+		labels.resize(count);
+		in.read((char *)indices.data(), count * sizeof(int));
+		for (int i = 0; i < count; i++)
+		{
+			if (indices[i] < 0 || indices[i] >= npoints)
+			{
+				qDebug("FeatureStore: invalid point index %d in %s.", indices[i], filename);
+				delete(cloud);
+				return NULL;
+			}
+		}
+
+		for (int f = 0; f < DIMEN; f++)
+		{
+			in.read((char *)values.data(), count * sizeof(float));
+			PASpan<float> column = cloud->feature(f);
+			for (int i = 0; i < count; i++)
+				column[indices[i]] = values[i];
+		}
+		in.read((char *)labels.data(), count * sizeof(int));
+		if (!in)    /* Truncated chunk */
+			break;
+		for (int i = 0; i < count; i++)
+			cloud->setLabel(indices[i], labels[i]);
+	}
+
+	return cloud;
+}
@@ -0,0 +1,39 @@
+#ifndef FEATURESTORE_H
+#define FEATURESTORE_H
+
+#include <fstream>
+#include <string>
+#include "PAPointCloud.h"
+
+#define FEATURE_STORE_MAGIC 0x53464150    /* "PAFS" */
+#define FEATURE_STORE_VERSION 1
+
+/*
+ * Binary point features file that is written in chunks, so the features of a point cloud
+ * can be produced piece by piece without ever holding all of them. Layout:
+ *   header: int magic, int version, int npoints, int dimen
+ *   chunks: int count, int indices[count], float features[dimen][count], int labels[count]
+ * indices are the rows of the chunk in the whole point cloud, every point is in one chunk.
+ */
+class FeatureStore
+{
+public:
+	FeatureStore();
+	~FeatureStore();
+
+	bool open(const char *filename, int npoints);
+	/* Write rows [0, count) of cloud as the points indices[0..count-1] of the whole point cloud */
+	void writeChunk(const PAPointCloud &cloud, const int *indices, int count);
+	void close();
+	int writtenPoints() const;
+
+	/* Read a whole file into a point cloud (without positions), NULL if it is not a feature store */
+	static PAPointCloud * load(const char *filename);
+
+private:
+	std::ofstream m_out;
+	int m_npoints;
+	int m_written;
+};
+
+#endif // FEATURESTORE_H
@@ -7,15 +7,15 @@
 #include <pcl/point_cloud.h>
 #include <pcl/search/kdtree.h>
 #include <pcl/common/impl/centroid.hpp>
-#include <pcl/features/normal_3d.h>
 #include <boost/smart_ptr/shared_ptr.hpp>
 #include <QVector>
-#include "PAPoint.h"
+#include "PAPointCloud.h"
 #include "utils.h"
 #include "pointfeaturethread.h"
 
+#define NUM_OF_THREADS 6    /* FeatureThreads of a model, one per search radius and one for the sdf */
 #define NUM_OF_SUBTHREAD 8
-#define FLOAT_INF 100.0
+#define FEATURE_INTERRUPT_POINTS 1024    /* Points between the checks of an interruption of the sdf */
 
 class FeatureThread : public QThread
 {
@@ -23,20 +23,20 @@ class FeatureThread : public QThread
 
 public:
 	FeatureThread(int id, pcl::PointCloud<pcl::PointXYZ>::Ptr c, pcl::PointCloud<pcl::Normal>::Ptr n, 
-		double radius, double coef, QObject *parent = 0);
+		const SpatialIndex *index, double radius, double coef, PAPointCloud *out, QObject *parent = 0);
 	~FeatureThread();
 
 	void setInputFilename(QString filename);
+	void setCurvatureCached(bool cached);
+	void cancel();    /* Stops the thread and its subthreads and waits for them */
 
 	public slots:
-	void receiveFeatures(int id, QList<QVector<double>> points_feats);
+	void receiveFeatures(int id);
 	void nextEstimateStep();
-	void onDebugTextAdded(QString text);
 
 signals:
-	void estimateCompleted(int id, QVector<QVector<double>> points_feats);
+	void estimateCompleted(int id);
 	void firstStepCompleted();
-	void addDebugText(QString text);
 
 protected:
 	void run();
@@ -44,14 +44,15 @@ protected:
 private:
 	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud;
 	pcl::PointCloud<pcl::Normal>::Ptr normals;
-	pcl::search::KdTree<pcl::PointXYZ>::Ptr kdtree;
+	const SpatialIndex *index;    /* Shared by all FeatureThreads, owned by the FeatureEstimator */
 	double radius;
 	double coefficient;
 	int id;
-	QVector<QVector<double>> cloud_feats;
+	PAPointCloud *features;    /* Shared output, the thread writes the columns of part id (or height and sdf) */
 	QVector<PointFeatureThread *> subthreads;
 	int finish_count;
 	QString input_filename;
+	bool curvature_cached;
 
 	void estimate();
 };
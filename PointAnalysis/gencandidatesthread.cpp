@@ -1,7 +1,7 @@
 #include "gencandidatesthread.h"
 
 GenCandidatesThread::GenCandidatesThread(QObject *parent)
-	: QThread(parent), m_num_of_candidates(0)
+	: QThread(parent), m_num_of_candidates(0), m_index(NULL), m_own_index(NULL)
 {
 	qRegisterMetaType<PAPart>("PAPart");
 	qRegisterMetaType<Part_Candidates>("PartCandidates");
@@ -9,7 +9,7 @@ GenCandidatesThread::GenCandidatesThread(QObject *parent)
 }
 
 GenCandidatesThread::GenCandidatesThread(PAPointCloud *pointcloud, std::string model_name, QVector<QMap<int, float>> distribution, QObject *parent)
-	: QThread(parent), m_num_of_candidates(0), m_model_name(model_name)
+	: QThread(parent), m_num_of_candidates(0), m_model_name(model_name), m_index(NULL), m_own_index(NULL)
 {
 	qRegisterMetaType<PAPart>("PAPart");
 	qRegisterMetaType<Part_Candidates>("PartCandidates");
@@ -18,8 +18,9 @@ GenCandidatesThread::GenCandidatesThread(PAPointCloud *pointcloud, std::string m
 }
 
 GenCandidatesThread::GenCandidatesThread(std::string model_name, int num_of_candidates, QObject *parent)
-	: QThread(parent), m_num_of_candidates(num_of_candidates), m_model_name(model_name)
+	: QThread(parent), m_num_of_candidates(num_of_candidates), m_model_name(model_name), m_index(NULL), m_own_index(NULL)
 {
+	m_pointcloud = NULL;
 
 }
 
@@ -33,6 +34,17 @@ GenCandidatesThread::~GenCandidatesThread()
 
 	if (isRunning())
 		terminate();
+
+	if (m_own_index != NULL)
+	{
+		delete(m_own_index);
+		m_own_index = NULL;
+	}
+}
+
+void GenCandidatesThread::setSpatialIndex(const SpatialIndex *index)
+{
+	m_index = index;
 }
 
 void GenCandidatesThread::run()
@@ -47,6 +59,7 @@ using namespace pcl;
 using namespace std;
 void GenCandidatesThread::generateCandidates()
 {
+	TRACE_SCOPE("candidates");
 	int num_of_candidates = 0;
 
 	/* Check whether the candidats of the model have already been genearted */
@@ -59,8 +72,7 @@ void GenCandidatesThread::generateCandidates()
 	}
 	else    /* If the candidates of the model have not ever been estimates, then gnerate them */
 	{
-		onDebugTextAdded("Generating parts candidates...");
-		qDebug() << "Generating parts candidates...";
+		LOG_INFO(Logger::Candidates, "Generating parts candidates...");
 
 		const float CLASS_CONFIDENCE = 0.7;
 		int numOfClasses = m_distribution[0].size();
@@ -107,6 +119,8 @@ void GenCandidatesThread::generateCandidates()
 		/* Create numOfClasses containers to store points belonging to different part class */
 		QMap<int, PointCloud<PointXYZ>::Ptr> parts_clouds;
 		QMap<int, QList<int>> vertices_indices;    /* The indices of points in each part point cloud */
+		QVector<int> point_parts(size, -1);    /* The part point cloud each point is assigned to */
+		QVector<int> point_vertices(size, -1);    /* The index of each point in its part point cloud */
 		QList<int> keys = m_distribution[0].keys();
 		QList<int>::iterator key_it;
 		for (key_it = keys.begin(); key_it != keys.end(); ++key_it)
@@ -129,12 +143,14 @@ void GenCandidatesThread::generateCandidates()
 		}
 
 		/* Assign each point to a certain container of parts_clouds */
-		onDebugTextAdded("Assign each point to a certain part point cloud.");
-		qDebug() << "Assign each point to a certain part point cloud.";
+		LOG_DEBUG(Logger::Candidates, "Assign each point to a certain part point cloud.");
+		PASpan<float> xs = m_pointcloud->x();
+		PASpan<float> ys = m_pointcloud->y();
+		PASpan<float> zs = m_pointcloud->z();
 		for (int i = 0; i < size; i++)
 		{
 			QMap<int, float> distribution = m_distribution[i];
-			PAPoint point = m_pointcloud->at(i);
+			PointXYZ point(xs[i], ys[i], zs[i]);
 			bool ok = false;
 
 			QVector<float> symmetry_scores(symmetry_groups.size());    /* The classification scores of symmetry groups */
@@ -147,7 +163,9 @@ void GenCandidatesThread::generateCandidates()
 					score_sum += distribution.value(*label_it);
 				if (score_sum > 0.7 || Utils::float_equal(score_sum, 0.7))
 				{
-					parts_clouds[group[0]]->push_back(PointXYZ(point.x(), point.y(), point.z()));
+					point_parts[i] = group[0];
+					point_vertices[i] = parts_clouds[group[0]]->size();
+					parts_clouds[group[0]]->push_back(point);
 					vertices_indices[group[0]].push_back(i);
 					ok = true;
 					break;
@@ -162,7 +180,9 @@ void GenCandidatesThread::generateCandidates()
 					int label = keys[j];
 					if (!symmetry_set.contains(label) && (distribution.value(label) > 0.7 || Utils::float_equal(distribution.value(label), 0.7)))
 					{
-						parts_clouds[label]->push_back(PointXYZ(point.x(), point.y(), point.z()));
+						point_parts[i] = label;
+						point_vertices[i] = parts_clouds[label]->size();
+						parts_clouds[label]->push_back(point);
 						vertices_indices[label].push_back(i);
 						ok = true;
 						break;
@@ -171,18 +191,29 @@ void GenCandidatesThread::generateCandidates()
 			}
 		}
 
+		/* The neighbors of the points are searched in the whole point cloud and filtered by part */
+		if (m_index == NULL)
+		{
+			m_own_index = SpatialIndex::build(xs.data(), ys.data(), zs.data(), 1, size, 
+				SPATIAL_INDEX_CELL_COEF * (m_pointcloud->getRadius() == 0 ? 1.0 : m_pointcloud->getRadius()));
+			m_index = m_own_index;
+		}
+
 		/* Generate part candidates for each part point cloud */
 		int cluster_count = 0;    /* The index of connected component, used to mark which point cluster each candidate stands for */
 		QVector<OBB *> point_clusters_obbs;    /* The OBBs of the point clusters used to display */
 		QMap<int, PointCloud<PointXYZ>::Ptr>::iterator part_cloud_it;
 		for (part_cloud_it = parts_clouds.begin(); part_cloud_it != parts_clouds.end(); ++part_cloud_it)
 		{
+			/* Stopped by StructureAnalyser::cancel() */
+			if (isInterruptionRequested())
+				return;
+
 			int label_name = part_cloud_it.key();
 			PointCloud<PointXYZ>::Ptr part_cloud = part_cloud_it.value();
 			QList<int> part_indices = vertices_indices.value(label_name);
 
-			onDebugTextAdded("Generate candidates for part " + QString::number(label_name));
-			qDebug("Generating candidates for part-%d...", label_name);
+			LOG_INFO(Logger::Candidates, "Generating candidates for part-%d...", label_name);
 
 			Graph graph;
 			int nvertices = part_cloud->size();    /* The number of vertices in this graph */
@@ -191,13 +222,7 @@ void GenCandidatesThread::generateCandidates()
 			if (nvertices > 3)
 			{
 				/* Introduce edges if the distance between two points is below 0.2 of the scan radius */
-				/* Genarate a kd-tree for searching */
-				onDebugTextAdded("Part-" + QString::number(label_name) + ": Add edges to the graph.");
-				qDebug("Part-%d: Add edges to the graph.", label_name);
-
-				KdTreeFLANN<PointXYZ> kdtree;
-				kdtree.setInputCloud(part_cloud);
-				qDebug("Part-%d: Kd-tree is built successfully.", label_name);
+				LOG_DEBUG(Logger::Candidates, "Part-%d: Add edges to the graph.", label_name);
 
 				std::vector<int> pointIdxRadiusSearch;
 				std::vector<float> pointRadiusSquaredDistance;
@@ -207,12 +232,14 @@ void GenCandidatesThread::generateCandidates()
 				for (int j = 0; j < nvertices; j++)
 				{
 					//qDebug("Part-%d: Find neighbors of vertex-%d/%d.", label_name, j, nvertices);
-					PointXYZ searchPoint = part_cloud->at(j);
-					if (kdtree.radiusSearch(searchPoint, radius, pointIdxRadiusSearch, pointRadiusSquaredDistance) > 0)
+					if (m_index->radiusSearch(part_indices[j], radius, pointIdxRadiusSearch, pointRadiusSquaredDistance) > 0)
 					{
 						for (int k = 0; k < pointIdxRadiusSearch.size(); k++)
 						{
-							int idx = pointIdxRadiusSearch[k];
+							int neighbor = pointIdxRadiusSearch[k];
+							if (point_parts[neighbor] != label_name)
+								continue;
+							int idx = point_vertices[neighbor];
 							if (idx > j)    /* Only add edge between j and vertices behind it */
 							{
 								boost::add_edge(j, idx, graph);
@@ -222,8 +249,7 @@ void GenCandidatesThread::generateCandidates()
 				}
 
 				/* Obtain connected component of the graph */
-				onDebugTextAdded("Part-" + QString::number(label_name) + ": Compute connected component of the graph.");
-				qDebug("Part-%d: Compute connected component of the graph.", label_name);
+				LOG_DEBUG(Logger::Candidates, "Part-%d: Compute connected component of the graph.", label_name);
 
 				std::vector<int> components(boost::num_vertices(graph));
 				int num_of_components = boost::connected_components(graph, &components[0]);    /* Calculate the connected components */
@@ -242,14 +268,12 @@ void GenCandidatesThread::generateCandidates()
 				/* For each connected component, generate 24 candidate OBBs */
 				QVector<PAPart> candidates;
 
-				onDebugTextAdded("Part-" + QString::number(label_name) + ": Generating candidates...");
-				qDebug("Part-%d: Generating candidates...", label_name);
+				LOG_DEBUG(Logger::Candidates, "Part-%d: Generating candidates from %d connected components...", label_name, num_of_components);
 
 				int candidates_count = 0;
 				for (int j = 0; j < num_of_components; j++)
 				{
-					onDebugTextAdded("Part-" + QString::number(label_name) + ": Generate candidate OBBs for connected-component-" + QString::number(j) + ".");
-					qDebug("Part-%d: Generate candidate OBBs for connected-component-%d.", label_name, j);
+					LOG_DEBUG(Logger::Candidates, "Part-%d: Generate candidate OBBs for connected-component-%d.", label_name, j);
 
 					/* Just compute the connected component with at least 2 vertices in it,
 					* because it will cause an error to compute eigen vectors of the OBB which contains only 1 point */
@@ -264,8 +288,7 @@ void GenCandidatesThread::generateCandidates()
 						for (int k = 0; k < cand_obbs.size(); k++)
 						{
 							/* Create PAPart object from OBB */
-							onDebugTextAdded("Part-" + QString::number(label_name) + ": Create a part for OBB-" + QString::number(j) + "-" + QString::number(k) + " as a candidate.");
-							qDebug("Part-%d: Create a part for OBB-%d-%d as a candidate.", label_name, j, k);
+							LOG_DEBUG(Logger::Candidates, "Part-%d: Create a part for OBB-%d-%d as a candidate.", label_name, j, k);
 							PAPart candidate(cand_obbs[k]);
 							candidate.setClusterNo(cluster_count);  /* Set the cluster number to the index of the current connected component */
 							/* Set the indices of points assigned to this part to the PAPart object */
@@ -282,14 +305,12 @@ void GenCandidatesThread::generateCandidates()
 				}
 				part_candidates.append(candidates);
 
-				onDebugTextAdded("Part-" + QString::number(label_name) + ":Generating part candidates for part-" + QString::number(label_name) + " done.");
-				qDebug("Part-%d: Generating part candidates for part-%d done.", label_name, label_name);
+				LOG_INFO(Logger::Candidates, "Part-%d: Generating part candidates for part-%d done.", label_name, label_name);
 			}
 			/* If the point cloud does not has a part of label i */
 			else
 			{
-				onDebugTextAdded("Part-" + QString::number(label_name) + ": The point cloud does not have part-" + QString::number(label_name) + ".");
-				qDebug("Part-%d: The point cloud does not have part-%d.", label_name, label_name);
+				LOG_INFO(Logger::Candidates, "Part-%d: The point cloud does not have part-%d.", label_name, label_name);
 			}
 		}
 
@@ -297,20 +318,13 @@ void GenCandidatesThread::generateCandidates()
 		emit genCandidatesDone(num_of_candidates, part_candidates);
 		//emit setOBBs(point_clusters_obbs);
 
-		onDebugTextAdded("Parts candidates generating done.");
-		qDebug() << "Parts candidates generating done.";
+		LOG_INFO(Logger::Candidates, "Parts candidates generating done.");
 	}
 }
 
-void GenCandidatesThread::onDebugTextAdded(QString text)
-{
-	emit addDebugText(text);
-}
-
 void GenCandidatesThread::loadCandidatesFromFiles()
 {
-	onDebugTextAdded("Load candidates from local files.");
-	qDebug() << "Load candidates from local files.";
+	LOG_INFO(Logger::Candidates, "Load candidates from local files.");
 
 	Part_Candidates candidates(m_num_of_candidates);
 	for (int i = 0; i < m_num_of_candidates; i++)
@@ -322,6 +336,5 @@ void GenCandidatesThread::loadCandidatesFromFiles()
 
 	emit genCandidatesDone(m_num_of_candidates, candidates);
 
-	onDebugTextAdded("Parts candidates loading done.");
-	qDebug() << "Parts candidates loading done.";
+	LOG_INFO(Logger::Candidates, "Parts candidates loading done.");
 }
\ No newline at end of file
@@ -10,7 +10,6 @@
 #include <fstream>
 #include <pcl/point_types.h>
 #include <pcl/point_cloud.h>
-#include <pcl/kdtree/kdtree_flann.h>
 #include <boost\graph\adjacency_list.hpp>
 #include <boost/graph/connected_components.hpp>
 #include "PAPointCloud.h"
@@ -18,6 +17,7 @@
 #include "obbestimator.h"
 #include "papart.h"
 #include "utils.h"
+#include "spatialindex.h"
 
 typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS> Graph;
 typedef QVector<PAPart> Part_Candidates;
@@ -33,11 +33,9 @@ public:
 	GenCandidatesThread(PAPointCloud *pointcloud, std::string model_name, QVector<QMap<int, float>> distribution, QObject *parent = 0);
 	~GenCandidatesThread();
 
-	public slots:
-	void onDebugTextAdded(QString text);
-	
+	void setSpatialIndex(const SpatialIndex *index);    /* Index of the points of the point cloud, built in memory if not set */
+
 signals:
-	void addDebugText(QString text);
 	void genCandidatesDone(int num_of_candidates, Part_Candidates part_candidates);
 	void setOBBs(QVector<OBB *> obbs);
 
@@ -49,6 +47,8 @@ private:
 	QVector<QMap<int, float>> m_distribution;
 	int m_num_of_candidates;
 	std::string m_model_name;
+	const SpatialIndex *m_index;
+	SpatialIndex *m_own_index;
 
 	void generateCandidates();
 	void loadCandidatesFromFiles();
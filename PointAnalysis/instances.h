@@ -13,6 +13,7 @@
 #include "typeBinaryFast.h"
 #include "typePotts.h"
 #include "typeGeneral.h"
+#include "typeFixedGeneral.h"
 #include "typeTruncatedLinear.h"
 #include "typeTruncatedQuadratic.h"
 #include "typeTruncatedLinear2D.h"
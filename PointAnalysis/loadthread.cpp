@@ -1,13 +1,13 @@
 #include "loadthread.h"
 
 LoadThread::LoadThread(QObject *parent)
-	: QThread(parent)
+	: QThread(parent), m_reorder(LOAD_SPATIAL_REORDER)
 {
 
 }
 
 LoadThread::LoadThread(std::string name, PHASE phase, QObject *parent)
-	: QThread(parent)
+	: QThread(parent), m_reorder(LOAD_SPATIAL_REORDER)
 {
 	filename = name;
 	m_phase = phase;
@@ -28,14 +28,16 @@ void LoadThread::run()
 {
 	QString msg = "Loading points from " + QString::fromStdString(filename) + "...";
 	emit addDebugText(msg);
+	long start_time = Utils::getCurrentTime();
 	loadPointCloud();
 	qDebug() << "Load points done.";
-	emit addDebugText("Load points done.");
+	emit addDebugText("Load points done in " + QString::number(Utils::getCurrentTime() - start_time) + " ms.");
 }
 
 using namespace std;
 void LoadThread::loadPointCloud()
 {
+	TRACE_SCOPE("load");
 	PCModel *model;
 	if (m_phase == PHASE::TRAINING)
 		model = Utils::loadPointCloud_CGAL_SDF(filename.c_str());
@@ -44,10 +46,22 @@ void LoadThread::loadPointCloud()
 		model = Utils::loadPointCloud_CGAL(filename.c_str());
 		//model = Utils::loadPointCloud(filename.c_str());
 	}
+
+	/* The labels and sdf values are reordered with the points, the outputs are written back in the load order */
+	if (m_reorder && model != NULL)
+	{
+		model->spatialReorder();
+		emit addDebugText("Points reordered along the Z-order curve.");
+	}
 	emit loadPointsCompleted(model);
 }
 
 void LoadThread::setPhase(PHASE phase)
 {
 	m_phase = phase;
+}
+
+void LoadThread::setSpatialReorder(bool reorder)
+{
+	m_reorder = reorder;
 }
\ No newline at end of file
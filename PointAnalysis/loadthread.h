@@ -7,6 +7,8 @@
 #include "pcmodel.h"
 #include "utils.h"
 
+#define LOAD_SPATIAL_REORDER true    /* Sort the loaded points along the Z-order curve for the neighborhood searches */
+
 class LoadThread : public QThread
 {
 	Q_OBJECT
@@ -23,6 +25,7 @@ public:
 
 	void setLoadFileName(std::string filename);
 	void setPhase(PHASE phase);
+	void setSpatialReorder(bool reorder);
 
 signals:
 	void loadPointsCompleted(PCModel *model);
@@ -36,6 +39,7 @@ protected:
 private:
 	std::string filename;
 	PHASE m_phase;
+	bool m_reorder;
 
 	void loadPointCloud();
 };
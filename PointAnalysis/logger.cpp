@@ -0,0 +1,229 @@
+#include "logger.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <cstdarg>
+#include <cstdio>
+#include <vector>
+#include "tracer.h"
+
+std::atomic<int> Logger::s_thresholds[Logger::NUM_OF_CHANNELS] = { { LOG_LEVEL_INFO }, { LOG_LEVEL_INFO }, { LOG_LEVEL_INFO }, { LOG_LEVEL_INFO } };
+
+struct LogRecord
+{
+	int level;
+	int channel;
+	QString text;
+};
+
+/*
+ * The messages of a thread not handed to the sinks yet. Its thread appends to it and the timer
+ * of the Logger takes the records out of it, so it has its own lock, which is almost never
+ * contended. Flushed when the thread finishes.
+ */
+struct LogBuffer
+{
+	QMutex mutex;
+	std::vector<LogRecord> records;
+	long long first_time;    /* Of the oldest record, ns */
+
+	LogBuffer() : first_time(0)
+	{
+		records.reserve(LOG_THREAD_BUFFER);
+		Logger *logger = Logger::instance();
+		QMutexLocker locker(&logger->m_buffers_mutex);
+		logger->m_buffers.append(this);
+	}
+	~LogBuffer()
+	{
+		Logger *logger = Logger::instance();
+		{
+			QMutexLocker locker(&logger->m_buffers_mutex);
+			logger->m_buffers.removeOne(this);
+		}
+		flush();
+	}
+
+	/* From any thread */
+	void flush()
+	{
+		std::vector<LogRecord> taken;
+		{
+			QMutexLocker locker(&mutex);
+			if (records.empty())
+				return;
+			taken.swap(records);
+			records.reserve(LOG_THREAD_BUFFER);
+		}
+
+		Logger *logger = Logger::instance();
+		int console_level, display_level;
+		unsigned int display_channels;
+		{
+			QMutexLocker locker(&logger->m_mutex);
+			console_level = logger->m_console_level;
+			display_level = logger->m_display_level;
+			display_channels = logger->m_display_channels;
+		}
+
+		QStringList display;
+		for (int i = 0; i < (int)taken.size(); i++)
+		{
+			const LogRecord &r = taken[i];
+			if (r.level >= console_level)
+				qDebug().noquote() << r.text;
+			if (r.level >= display_level && (display_channels & (1u << r.channel)) != 0)
+				display.append(r.text);
+		}
+		if (!display.isEmpty())
+			logger->queueForDisplay(display);
+	}
+};
+
+static LogBuffer & threadLogBuffer()
+{
+	static thread_local LogBuffer buffer;
+	return buffer;
+}
+
+bool LogSite::pass()
+{
+	long long period = Tracer::now() / (LOG_RATE_PERIOD_MS * 1000000LL);
+	long long current = m_period.load(std::memory_order_relaxed);
+	if (period != current && m_period.compare_exchange_strong(current, period))
+		m_count.store(0);
+
+	if (m_count.fetch_add(1) < LOG_RATE_BURST)
+		return true;
+	m_suppressed.fetch_add(1);
+	return false;
+}
+
+Logger::Logger()
+	: QObject(NULL), m_console_level(LOG_LEVEL_INFO), m_display_level(LOG_LEVEL_NONE), m_display_channels(0), m_dropped(0)
+{
+	connect(&m_timer, SIGNAL(timeout()), this, SLOT(deliver()));
+	m_timer.start(LOG_FLUSH_INTERVAL_MS);
+}
+
+Logger * Logger::instance()
+{
+	/* Never deleted, the buffers of the threads still flush into it when they finish at exit.
+	 * Created by the first call, which has to be in the GUI thread for the timer */
+	static Logger *logger = new Logger;
+	return logger;
+}
+
+void Logger::write(int level, int channel, int suppressed, const char *format, ...)
+{
+	char text[512];
+	std::vector<char> long_text;
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(text, sizeof(text), format, args);
+	va_end(args);
+	const char *message = text;
+	if (length >= (int)sizeof(text))
+	{
+		long_text.resize(length + 1);
+		va_start(args, format);
+		vsnprintf(long_text.data(), long_text.size(), format, args);
+		va_end(args);
+		message = long_text.data();
+	}
+
+	LogRecord record;
+	record.level = level;
+	record.channel = channel;
+	record.text = QString::fromUtf8(message);
+	if (level == LOG_LEVEL_WARNING)
+		record.text.prepend("Warning: ");
+	else if (level >= LOG_LEVEL_ERROR)
+		record.text.prepend("Error: ");
+	if (suppressed > 0)
+		record.text.append(" (" + QString::number(suppressed) + " similar messages suppressed)");
+
+	LogBuffer &buffer = threadLogBuffer();
+	long long now = Tracer::now();
+	bool full;
+	{
+		QMutexLocker locker(&buffer.mutex);
+		if (buffer.records.empty())
+			buffer.first_time = now;
+		buffer.records.push_back(record);
+		full = (int)buffer.records.size() >= LOG_THREAD_BUFFER || now - buffer.first_time >= LOG_FLUSH_INTERVAL_MS * 1000000LL;
+	}
+
+	/* Warnings and errors are not held back */
+	if (full || level >= LOG_LEVEL_WARNING)
+		buffer.flush();
+}
+
+void Logger::flushThread()
+{
+	threadLogBuffer().flush();
+}
+
+void Logger::setConsoleLevel(int level)
+{
+	QMutexLocker locker(&m_mutex);
+	m_console_level = level;
+	updateThresholds();
+}
+
+void Logger::subscribe(int level, unsigned int channels)
+{
+	QMutexLocker locker(&m_mutex);
+	m_display_level = level;
+	m_display_channels = channels;
+	updateThresholds();
+}
+
+void Logger::unsubscribe()
+{
+	subscribe(LOG_LEVEL_NONE, 0);
+}
+
+void Logger::updateThresholds()
+{
+	for (int c = 0; c < NUM_OF_CHANNELS; c++)
+	{
+		int threshold = m_console_level;
+		if ((m_display_channels & (1u << c)) != 0 && m_display_level < threshold)
+			threshold = m_display_level;
+		s_thresholds[c].store(threshold, std::memory_order_relaxed);
+	}
+}
+
+void Logger::queueForDisplay(const QStringList &messages)
+{
+	QMutexLocker locker(&m_mutex);
+	m_display_queue.append(messages);
+	int excess = m_display_queue.size() - LOG_DISPLAY_QUEUE;
+	if (excess > 0)
+	{
+		m_display_queue.erase(m_display_queue.begin(), m_display_queue.begin() + excess);
+		m_dropped += excess;
+	}
+}
+
+void Logger::deliver()
+{
+	/* The buffers of the threads that have not logged for a while, and of the GUI thread */
+	{
+		QMutexLocker locker(&m_buffers_mutex);
+		for (int i = 0; i < m_buffers.size(); i++)
+			m_buffers[i]->flush();
+	}
+
+	QStringList messages;
+	{
+		QMutexLocker locker(&m_mutex);
+		if (m_display_queue.isEmpty())
+			return;
+		messages.swap(m_display_queue);
+		if (m_dropped > 0)
+			messages.prepend(QString::number(m_dropped) + " messages dropped, the display could not keep up.");
+		m_dropped = 0;
+	}
+	emit messagesLogged(messages);
+}
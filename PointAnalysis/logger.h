@@ -0,0 +1,127 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <QObject>
+#include <QStringList>
+#include <QTimer>
+#include <QMutex>
+#include <atomic>
+
+#define LOG_LEVEL_DEBUG 0
+#define LOG_LEVEL_INFO 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_ERROR 3
+#define LOG_LEVEL_NONE 4
+
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG    /* The messages below it are compiled out */
+#endif
+#define LOG_RATE_BURST 20    /* Messages of one call site passed per period, the others are counted */
+#define LOG_RATE_PERIOD_MS 1000
+#define LOG_THREAD_BUFFER 64    /* Messages a thread keeps before handing them to the sinks */
+#define LOG_FLUSH_INTERVAL_MS 100    /* Period of the timer handing the buffers of all threads to the sinks, and the messages to the GUI */
+#define LOG_DISPLAY_QUEUE 4096    /* Messages waiting for the GUI, the oldest are dropped */
+
+/*
+ * Messages of the workers, in place of the addDebugText signals relayed from thread to thread.
+ * A message has a level and a channel; it is formatted (printf style) only if a sink wants its
+ * level on its channel and its call site is not over the rate limit, so the arguments of a
+ * message nobody reads are not even evaluated:
+ *
+ *   LOG_DEBUG(Logger::Inference, "Add Node_%d: %s", i, qPrintable(text));
+ *
+ * The messages are buffered per thread and handed over in batches, when a buffer is full, on
+ * a warning, and every LOG_FLUSH_INTERVAL_MS for the buffers of all threads. The console sink
+ * writes them with qDebug; the GUI subscribes to the levels and channels it displays and
+ * receives them every LOG_FLUSH_INTERVAL_MS as one messagesLogged() signal.
+ */
+struct LogBuffer;
+
+class Logger : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum Channel
+	{
+		General,
+		Features,
+		Candidates,
+		Inference,
+		NUM_OF_CHANNELS
+	};
+
+	static Logger * instance();
+
+	/* Whether a message of level on channel goes to any sink */
+	static bool enabled(int level, int channel)
+	{
+		return level >= s_thresholds[channel].load(std::memory_order_relaxed);
+	}
+	static void write(int level, int channel, int suppressed, const char *format, ...);
+	/* Hand the buffered messages of the calling thread to the sinks */
+	static void flushThread();
+
+	void setConsoleLevel(int level);
+	/* Receive the messages of at least level on the channels of the mask (1 << channel) with messagesLogged() */
+	void subscribe(int level, unsigned int channels);
+	void unsubscribe();
+
+signals:
+	void messagesLogged(QStringList messages);
+
+private slots:
+	void deliver();
+
+private:
+	Logger();
+
+	static std::atomic<int> s_thresholds[NUM_OF_CHANNELS];
+	int m_console_level;
+	int m_display_level;
+	unsigned int m_display_channels;
+	QMutex m_mutex;
+	QStringList m_display_queue;
+	int m_dropped;
+	QTimer m_timer;
+	QMutex m_buffers_mutex;
+	QList<LogBuffer *> m_buffers;    /* Of the threads that have logged, flushed by the timer */
+
+	void updateThresholds();
+	void queueForDisplay(const QStringList &messages);
+
+	friend struct LogBuffer;
+};
+
+/* Rate limit of a call site: LOG_RATE_BURST messages per LOG_RATE_PERIOD_MS */
+class LogSite
+{
+public:
+	LogSite() : m_period(0), m_count(0), m_suppressed(0) {}
+
+	bool pass();
+	/* The messages dropped since the last one passed */
+	int takeSuppressed() { return m_suppressed.exchange(0); }
+
+private:
+	std::atomic<long long> m_period;
+	std::atomic<int> m_count;
+	std::atomic<int> m_suppressed;
+};
+
+#define PA_LOG(level, channel, ...) \
+	do { \
+		if ((level) >= LOG_MIN_LEVEL && Logger::enabled(level, channel)) \
+		{ \
+			static LogSite log_site_; \
+			if (log_site_.pass()) \
+				Logger::write(level, channel, log_site_.takeSuppressed(), __VA_ARGS__); \
+		} \
+	} while (0)
+
+#define LOG_DEBUG(channel, ...) PA_LOG(LOG_LEVEL_DEBUG, channel, __VA_ARGS__)
+#define LOG_INFO(channel, ...) PA_LOG(LOG_LEVEL_INFO, channel, __VA_ARGS__)
+#define LOG_WARNING(channel, ...) PA_LOG(LOG_LEVEL_WARNING, channel, __VA_ARGS__)
+#define LOG_ERROR(channel, ...) PA_LOG(LOG_LEVEL_ERROR, channel, __VA_ARGS__)
+
+#endif // LOGGER_H
@@ -1,11 +1,220 @@
 #include "pointanalysis.h"
 #include <QtWidgets/QApplication>
+#include <QGuiApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <cstring>
 #include "gencandidatesthread.h"
+#include "offscreenrenderer.h"
+#include "syntheticdataset.h"
+#include "throughputharness.h"
+#include "sdfcalculator.h"
+
+/*
+ * Headless rendering of labeled models to PNG files, no window is shown:
+ *   PointAnalysis --render <list of models> [--render-out <dir>] [--render-views <file>] [--render-threads <n>]
+ *     [--render-software] [-platform offscreen]
+ */
+static int renderHeadless(int argc, char *argv[])
+{
+	/* Software OpenGL (opengl32sw) for the machines without a GPU driver, set before the application is created */
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--render-software") == 0)
+			QCoreApplication::setAttribute(Qt::AA_UseSoftwareOpenGL);
+	}
+	QGuiApplication a(argc, argv);
+	QStringList args = a.arguments();
+
+	QString list_path, output_dir = "../data/render", views_path;
+	int nthreads = 0;
+	for (int i = 1; i + 1 < args.size(); i++)
+	{
+		if (args[i] == "--render")
+			list_path = args[i + 1];
+		else if (args[i] == "--render-out")
+			output_dir = args[i + 1];
+		else if (args[i] == "--render-views")
+			views_path = args[i + 1];
+		else if (args[i] == "--render-threads")
+			nthreads = args[i + 1].toInt();
+	}
+
+	QStringList models;
+	QFile list_file(list_path);
+	if (!list_file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		qDebug() << "Cannot open the list of models" << list_path;
+		return 1;
+	}
+	QTextStream in(&list_file);
+	while (!in.atEnd())
+	{
+		QString line = in.readLine().trimmed();
+		if (line.length() > 0)
+			models.append(line);
+	}
+
+	QVector<OffscreenRenderer::Viewpoint> views = views_path.isEmpty() ? OffscreenRenderer::defaultViewpoints() : OffscreenRenderer::loadViewpoints(views_path);
+	int written = OffscreenRenderer::renderBatch(models, views, output_dir, nthreads);
+	return written == models.size() * views.size() ? 0 : 1;
+}
+
+/*
+ * Synthetic COSEG-like models (see SyntheticDataset), no window is shown:
+ *   PointAnalysis --synthetic <number of models> [--synthetic-class <name>] [--synthetic-shape chair|table]
+ *     [--synthetic-points <n>] [--synthetic-seed <seed>]
+ * The models are listed in ../data/<name>_list.txt, the input of --throughput.
+ */
+static int generateSynthetic(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QStringList args = a.arguments();
+
+	int nmodels = 0, npoints = SYNTHETIC_DATASET_POINTS;
+	unsigned int seed = SYNTHETIC_DATASET_SEED;
+	QString class_name = "synthetic_chairs";
+	SyntheticDataset::SHAPE shape = SyntheticDataset::CHAIR;
+	for (int i = 1; i + 1 < args.size(); i++)
+	{
+		if (args[i] == "--synthetic")
+			nmodels = args[i + 1].toInt();
+		else if (args[i] == "--synthetic-class")
+			class_name = args[i + 1];
+		else if (args[i] == "--synthetic-shape")
+			shape = args[i + 1] == "table" ? SyntheticDataset::TABLE : SyntheticDataset::CHAIR;
+		else if (args[i] == "--synthetic-points")
+			npoints = args[i + 1].toInt();
+		else if (args[i] == "--synthetic-seed")
+			seed = args[i + 1].toUInt();
+	}
+
+	SyntheticDataset dataset(class_name.toStdString(), shape, npoints, seed);
+	QStringList models = dataset.generate(nmodels);
+	Logger::flushThread();
+	return models.size() == nmodels && nmodels > 0 ? 0 : 1;
+}
+
+/*
+ * The whole analysis of a list of models one after the other, reporting the models per hour, the latency
+ * percentiles of the stages and the peak memory (see ThroughputHarness), no window is shown:
+ *   PointAnalysis --throughput <list of models> [--throughput-class <name>] [--throughput-out <file>]
+ *     [--throughput-warm] [--throughput-verbose] [--trws-time-budget <s>]
+ * The class (of the classifier, label names and priors) is the name of the list without _list.txt by default.
+ * The time budget of TRW-S per model is TRWS_TIME_BUDGET by default, 0 for no limit.
+ */
+static int runThroughput(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QStringList args = a.arguments();
+
+	QString list_path, class_name, output_path = THROUGHPUT_REPORT;
+	bool warm = false, verbose = false;
+	double time_budget = TRWS_TIME_BUDGET;
+	for (int i = 1; i < args.size(); i++)
+	{
+		if (args[i] == "--throughput-warm")
+			warm = true;
+		else if (args[i] == "--throughput-verbose")
+			verbose = true;
+		else if (i + 1 < args.size())
+		{
+			if (args[i] == "--throughput")
+				list_path = args[i + 1];
+			else if (args[i] == "--throughput-class")
+				class_name = args[i + 1];
+			else if (args[i] == "--throughput-out")
+				output_path = args[i + 1];
+			else if (args[i] == "--trws-time-budget")
+				time_budget = args[i + 1].toDouble();
+		}
+	}
+	if (class_name.isEmpty())
+		class_name = QFileInfo(list_path).fileName().remove("_list.txt");
+	Logger::instance()->setConsoleLevel(verbose ? LOG_LEVEL_INFO : LOG_LEVEL_WARNING);
+
+	QStringList models;
+	QFile list_file(list_path);
+	if (!list_file.open(QIODevice::ReadOnly | QIODevice::Text))
+	{
+		qDebug() << "Cannot open the list of models" << list_path;
+		return 1;
+	}
+	QTextStream in(&list_file);
+	while (!in.atEnd())
+	{
+		QString line = in.readLine().trimmed();
+		if (line.length() > 0)
+			models.append(line);
+	}
+	if (models.isEmpty())
+	{
+		qDebug() << "No model in" << list_path;
+		return 1;
+	}
+
+	ThroughputHarness harness(models, class_name.toStdString(), warm);
+	harness.setTrwsTimeBudget(time_budget);
+	QObject::connect(&harness, SIGNAL(finished()), &a, SLOT(quit()));
+	harness.start();
+	a.exec();
+	return harness.writeReport(output_path) ? 0 : 1;
+}
+
+/*
+ * Compares the sdf values of SdfCalculator with the ones of CGAL::sdf_values on a mesh, no window is shown:
+ *   PointAnalysis --sdf-parity <off file> [--sdf-parity-tolerance <t>]
+ * Fails if the mean absolute difference of the normalized facet values is over the tolerance (SDF_PARITY_TOLERANCE).
+ */
+static int checkSdfParity(int argc, char *argv[])
+{
+	QCoreApplication a(argc, argv);
+	QStringList args = a.arguments();
+
+	QString mesh_path;
+	double tolerance = SDF_PARITY_TOLERANCE;
+	for (int i = 1; i + 1 < args.size(); i++)
+	{
+		if (args[i] == "--sdf-parity")
+			mesh_path = args[i + 1];
+		else if (args[i] == "--sdf-parity-tolerance")
+			tolerance = args[i + 1].toDouble();
+	}
+
+	Polyhedron_with_id mesh;
+	std::ifstream input(mesh_path.toStdString().c_str());
+	if (!input || !(input >> mesh) || mesh.empty())
+	{
+		qDebug() << "Cannot read the mesh" << mesh_path;
+		return 1;
+	}
+	CGAL::set_halfedgeds_items_id(mesh);
+
+	double mean_error, max_error;
+	SdfCalculator::parity(mesh, mean_error, max_error);
+	bool passed = mean_error <= tolerance;
+	qDebug("%s: %d facets, mean difference %.4f, largest difference %.4f with CGAL::sdf_values (tolerance %.4f), %s.",
+		qPrintable(mesh_path), (int)mesh.size_of_facets(), mean_error, max_error, tolerance, passed ? "passed" : "failed");
+	return passed ? 0 : 1;
+}
 
 int main(int argc, char *argv[])
 {
 	qRegisterMetaType<Part_Candidates>("PartCandidates");
 	QCoreApplication::addLibraryPath("./");
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--render") == 0)
+			return renderHeadless(argc, argv);
+		if (strcmp(argv[i], "--synthetic") == 0)
+			return generateSynthetic(argc, argv);
+		if (strcmp(argv[i], "--throughput") == 0)
+			return runThroughput(argc, argv);
+		if (strcmp(argv[i], "--sdf-parity") == 0)
+			return checkSdfParity(argc, argv);
+	}
+
 	QApplication a(argc, argv);
 	PointAnalysis w;
 	w.show();
@@ -2,10 +2,19 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <math.h>
+#include <chrono>
 #include "MRFEnergy.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "instances.inc"
 
+// nodes with fewer edges in the current direction are processed sequentially,
+// since the cost of starting the threads would exceed the gain
+#define PARALLEL_MIN_EDGE_NUM 32
+
 template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowerBound, REAL& energy, REAL* min_marginals)
 {
 	Node* i;
@@ -20,7 +29,9 @@ template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowe
 		CompleteGraphConstruction();
 	}
 
-	printf("TRW_S algorithm\n");
+	bool parallel = SetParallelSchedule(options.m_threadNum);
+	if (parallel) printf("TRW_S algorithm (%d threads)\n", m_threadNum);
+	else          printf("TRW_S algorithm\n");
 
 	SetMonotonicTrees();
 
@@ -30,6 +41,11 @@ template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowe
 	iter = 0;
 	bool lastIter = false;
 
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	int lastImprovementIter = 0;
+	REAL lowerBoundBest = 0, energyBest = 0;
+	bool energyComputed = false, energyBestSet = false;
+
 	// main loop
 	for (iter=1; ; iter++)
 	{
@@ -57,7 +73,11 @@ template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowe
 			// lowerBound += vMin;                                  // during the forward pass
 
 			// pass messages from i to nodes with higher m_ordering
-			for (e=i->m_firstForward; e; e=e->m_nextForward)
+			if (parallel)
+			{
+				UpdateMessagesParallel(i, Di, 0, true);
+			}
+			else for (e=i->m_firstForward; e; e=e->m_nextForward)
 			{
 				assert(e->m_tail == i);
 				j = e->m_head;
@@ -95,7 +115,11 @@ template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowe
 			lowerBound += vMin;
 
 			// pass messages from i to nodes with smaller m_ordering
-			for (e=i->m_firstBackward; e; e=e->m_nextBackward)
+			if (parallel)
+			{
+				lowerBound += UpdateMessagesParallel(i, Di, 1, true);
+			}
+			else for (e=i->m_firstBackward; e; e=e->m_nextBackward)
 			{
 				assert(e->m_head == i);
 				j = e->m_tail;
@@ -119,14 +143,25 @@ template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowe
 		//          check stopping criterion          //
 		////////////////////////////////////////////////
 
+		double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
 		// print lower bound and energy, if necessary
+		energyComputed = false;
 		if (  lastIter || 
 			( iter>=options.m_printMinIter && 
 			(options.m_printIter<1 || iter%options.m_printIter==0) )
 		)
 		{
 			energy = ComputeSolutionAndEnergy();
-			printf("iter %d: lower bound = %f, energy = %f\n", iter, lowerBound, energy);
+			energyComputed = true;
+			if (options.m_iterFn)
+			{
+				if (!options.m_iterFn(options.m_iterFnData, iter, lowerBound, energy, time)) lastIter = true;
+			}
+			else
+			{
+				printf("iter %d: lower bound = %f, energy = %f\n", iter, lowerBound, energy);
+			}
 		}
 
 		if (lastIter) break;
@@ -140,6 +175,41 @@ template <class T> int MRFEnergy<T>::Minimize_TRW_S(Options& options, REAL& lowe
 			}
 			lowerBoundPrev = lowerBound;
 		}
+
+		// check the gap between the energy and the lower bound
+		if (options.m_gapEps >= 0 && energyComputed)
+		{
+			if (energy - lowerBound <= options.m_gapEps * fabs(energy))
+			{
+				lastIter = true;
+			}
+		}
+
+		// check stagnation
+		if (options.m_stagnationIter > 0)
+		{
+			if (iter == 1 || lowerBound - lowerBoundBest > options.m_stagnationEps * fabs(lowerBoundBest))
+			{
+				lowerBoundBest = lowerBound;
+				lastImprovementIter = iter;
+			}
+			if (energyComputed && (!energyBestSet || energyBest - energy > options.m_stagnationEps * fabs(energyBest)))
+			{
+				energyBest = energy;
+				energyBestSet = true;
+				lastImprovementIter = iter;
+			}
+			if (iter - lastImprovementIter >= options.m_stagnationIter)
+			{
+				lastIter = true;
+			}
+		}
+
+		// check time budget
+		if (options.m_timeMax > 0 && time >= options.m_timeMax)
+		{
+			lastIter = true;
+		}
 	}
 
 	return iter;
@@ -150,7 +220,6 @@ template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, REAL& energy,
 	Node* i;
 	Node* j;
 	MRFEdge* e;
-	REAL vMin;
 	int iter;
 
 	if (!m_isEnergyConstructionCompleted)
@@ -158,7 +227,9 @@ template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, REAL& energy,
 		CompleteGraphConstruction();
 	}
 
-	printf("BP algorithm\n");
+	bool parallel = SetParallelSchedule(options.m_threadNum);
+	if (parallel) printf("BP algorithm (%d threads)\n", m_threadNum);
+	else          printf("BP algorithm\n");
 
 	Vector* Di = (Vector*) m_buf;
 	void* buf = (void*) (m_buf + m_vectorMaxSizeInBytes);
@@ -166,6 +237,11 @@ template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, REAL& energy,
 	iter = 0;
 	bool lastIter = false;
 
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	int lastImprovementIter = 0;
+	REAL energyBest = 0;
+	bool energyComputed = false, energyBestSet = false;
+
 	// main loop
 	for (iter=1; ; iter++)
 	{
@@ -189,7 +265,11 @@ template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, REAL& energy,
 			}
 
 			// pass messages from i to nodes with higher m_ordering
-			for (e=i->m_firstForward; e; e=e->m_nextForward)
+			if (parallel)
+			{
+				UpdateMessagesParallel(i, Di, 0, false);
+			}
+			else for (e=i->m_firstForward; e; e=e->m_nextForward)
 			{
 				assert(i == e->m_tail);
 				j = e->m_head;
@@ -222,14 +302,18 @@ template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, REAL& energy,
 			}
 
 			// pass messages from i to nodes with smaller m_ordering
-			for (e=i->m_firstBackward; e; e=e->m_nextBackward)
+			if (parallel)
+			{
+				UpdateMessagesParallel(i, Di, 1, false);
+			}
+			else for (e=i->m_firstBackward; e; e=e->m_nextBackward)
 			{
 				assert(i == e->m_head);
 				j = e->m_tail;
 
 				const REAL gamma = 1;
 
-				vMin = e->m_message.UpdateMessage(m_Kglobal, i->m_K, j->m_K, Di, gamma, 1, buf);
+				e->m_message.UpdateMessage(m_Kglobal, i->m_K, j->m_K, Di, gamma, 1, buf);
 			}
 
 			if (lastIter && min_marginals)
@@ -246,18 +330,50 @@ template <class T> int MRFEnergy<T>::Minimize_BP(Options& options, REAL& energy,
 		//          check stopping criterion          //
 		////////////////////////////////////////////////
 
+		double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
 		// print energy, if necessary
+		energyComputed = false;
 		if ( lastIter || 
 			( iter>=options.m_printMinIter && 
 			(options.m_printIter<1 || iter%options.m_printIter==0) )
 		)
 		{
 			energy = ComputeSolutionAndEnergy();
-			printf("iter %d: energy = %f\n", iter, energy);
+			energyComputed = true;
+			if (options.m_iterFn)
+			{
+				if (!options.m_iterFn(options.m_iterFnData, iter, 0, energy, time)) lastIter = true;
+			}
+			else
+			{
+				printf("iter %d: energy = %f\n", iter, energy);
+			}
 		}
 
 		// if finishFlag==true terminate
 		if (lastIter) break;
+
+		// check stagnation (energy only, BP does not compute a lower bound)
+		if (options.m_stagnationIter > 0)
+		{
+			if (energyComputed && (!energyBestSet || energyBest - energy > options.m_stagnationEps * fabs(energyBest)))
+			{
+				energyBest = energy;
+				energyBestSet = true;
+				lastImprovementIter = iter;
+			}
+			if (iter - lastImprovementIter >= options.m_stagnationIter)
+			{
+				lastIter = true;
+			}
+		}
+
+		// check time budget
+		if (options.m_timeMax > 0 && time >= options.m_timeMax)
+		{
+			lastIter = true;
+		}
 	}
 
 	return iter;
@@ -305,3 +421,109 @@ template <class T> typename T::REAL MRFEnergy<T>::ComputeSolutionAndEnergy()
 
 	return E;
 }
+
+template <class T> bool MRFEnergy<T>::SetParallelSchedule(int threadNum)
+{
+	Node* i;
+	MRFEdge* e;
+
+#ifdef _OPENMP
+	if (threadNum > omp_get_max_threads()) threadNum = omp_get_max_threads();
+#else
+	threadNum = 1; // compiled without OpenMP
+#endif
+	if (threadNum <= 1)
+	{
+		return false;
+	}
+
+	// edge arrays do not change after graph construction, build them once
+	if (!m_forwardEdges)
+	{
+		m_forwardEdges  = new MRFEdge*[m_edgeNum];
+		m_backwardEdges = new MRFEdge*[m_edgeNum];
+		m_forwardFirst  = new int[m_nodeNum+1];
+		m_backwardFirst = new int[m_nodeNum+1];
+
+		int f = 0, b = 0;
+		for (i=m_nodeFirst; i; i=i->m_next)
+		{
+			m_forwardFirst[i->m_ordering] = f;
+			for (e=i->m_firstForward; e; e=e->m_nextForward)
+			{
+				m_forwardEdges[f ++] = e;
+			}
+			m_backwardFirst[i->m_ordering] = b;
+			for (e=i->m_firstBackward; e; e=e->m_nextBackward)
+			{
+				m_backwardEdges[b ++] = e;
+			}
+		}
+		m_forwardFirst[m_nodeNum] = f;
+		m_backwardFirst[m_nodeNum] = b;
+		assert(f == m_edgeNum && b == m_edgeNum);
+	}
+
+	// one scratch buffer per thread (same size as the second part of m_buf),
+	// rounded up to a cache line so that threads do not share lines
+	if (m_threadNum < threadNum)
+	{
+		delete [] m_threadBuf;
+		int bufSize = Edge::GetBufSizeInBytes(m_vectorMaxSizeInBytes);
+		if (bufSize < m_vectorMaxSizeInBytes) bufSize = m_vectorMaxSizeInBytes;
+		m_threadBufSizeInBytes = (bufSize + 63) & ~63;
+		m_threadBuf = new char[threadNum*m_threadBufSizeInBytes];
+	}
+	m_threadNum = threadNum;
+
+	return true;
+}
+
+template <class T> void MRFEnergy<T>::ClearParallelSchedule()
+{
+	delete [] m_threadBuf;
+	delete [] m_forwardEdges;
+	delete [] m_forwardFirst;
+	delete [] m_backwardEdges;
+	delete [] m_backwardFirst;
+	m_threadBuf = NULL;
+	m_forwardEdges = m_backwardEdges = NULL;
+	m_forwardFirst = m_backwardFirst = NULL;
+	m_threadNum = 0;
+}
+
+template <class T> typename T::REAL MRFEnergy<T>::UpdateMessagesParallel(Node* i, Vector* Di, int dir, bool useGamma)
+{
+	MRFEdge** edges;
+	int n;
+	REAL vMinSum = 0;
+
+	if (dir == 0)
+	{
+		edges = m_forwardEdges + m_forwardFirst[i->m_ordering];
+		n = m_forwardFirst[i->m_ordering+1] - m_forwardFirst[i->m_ordering];
+	}
+	else
+	{
+		edges = m_backwardEdges + m_backwardFirst[i->m_ordering];
+		n = m_backwardFirst[i->m_ordering+1] - m_backwardFirst[i->m_ordering];
+	}
+
+	// Di is only read; every edge owns its message, every thread its scratch buffer
+#pragma omp parallel for num_threads(m_threadNum) schedule(static) reduction(+:vMinSum) if(n >= PARALLEL_MIN_EDGE_NUM)
+	for (int k=0; k<n; k++)
+	{
+		MRFEdge* e = edges[k];
+#ifdef _OPENMP
+		void* buf = (void*) (m_threadBuf + omp_get_thread_num()*m_threadBufSizeInBytes);
+#else
+		void* buf = (void*) m_threadBuf;
+#endif
+		Node* j = (dir == 0) ? e->m_head : e->m_tail;
+		REAL gamma = (!useGamma) ? 1 : ((dir == 0) ? e->m_gammaForward : e->m_gammaBackward);
+
+		vMinSum += e->m_message.UpdateMessage(m_Kglobal, i->m_K, j->m_K, Di, gamma, dir, buf);
+	}
+
+	return vMinSum;
+}
@@ -0,0 +1,134 @@
+#include "mrfsolver.h"
+
+bool MRFSolver::updateHash(unsigned long long &hash, const REAL *table, int size)
+{
+	/* FNV-1a over the bytes of the table */
+	const unsigned char *bytes = (const unsigned char *)table;
+	unsigned long long h = 14695981039346656037ULL;
+	for (int i = 0; i < size * (int)sizeof(REAL); i++)
+	{
+		h ^= bytes[i];
+		h *= 1099511628211ULL;
+	}
+
+	bool changed = (h != hash);
+	hash = h;
+	return changed;
+}
+
+/* Builds the types and arguments of MRFEnergy<T> from the label count */
+template <class T> struct MRFTypeTraits;
+
+template <> struct MRFTypeTraits<TypeGeneral>
+{
+	static bool isFixed() { return false; }
+	static TypeGeneral::LocalSize localSize(int label_num) { return TypeGeneral::LocalSize(label_num); }
+	static TypeGeneral::EdgeData edgeData(TypeGeneral::REAL *V) { return TypeGeneral::EdgeData(TypeGeneral::GENERAL, V); }
+};
+
+template <int K> struct MRFTypeTraits<TypeFixedGeneral<K> >
+{
+	static bool isFixed() { return true; }
+	static typename TypeFixedGeneral<K>::LocalSize localSize(int label_num) { assert(label_num == K); return typename TypeFixedGeneral<K>::LocalSize(); }
+	static typename TypeFixedGeneral<K>::EdgeData edgeData(typename TypeFixedGeneral<K>::REAL *V) { return typename TypeFixedGeneral<K>::EdgeData(V); }
+};
+
+template <class T> class MRFSolverImpl : public MRFSolver
+{
+public:
+	MRFSolverImpl(int label_num, int node_num) : MRFSolver(label_num, node_num)
+	{
+		m_mrf = new MRFEnergy<T>(typename T::GlobalSize());
+		m_nodes = new typename MRFEnergy<T>::NodeId[node_num];
+	}
+
+	~MRFSolverImpl()
+	{
+		delete[] m_nodes;
+		delete(m_mrf);
+	}
+
+	void addNode(int node_idx, REAL *D)
+	{
+		m_nodes[node_idx] = m_mrf->AddNode(MRFTypeTraits<T>::localSize(m_label_num), typename T::NodeData(D));
+		updateHash(m_node_hashes[node_idx], D, m_label_num);
+	}
+
+	void addEdge(int node_idx1, int node_idx2, REAL *V)
+	{
+		std::pair<int, int> key(node_idx1, node_idx2);
+		m_edges[key] = m_mrf->AddEdge(m_nodes[node_idx1], m_nodes[node_idx2], MRFTypeTraits<T>::edgeData(V));
+		updateHash(m_edge_hashes[key], V, m_label_num * m_label_num);
+	}
+
+	bool updateNode(int node_idx, REAL *D)
+	{
+		if (!updateHash(m_node_hashes[node_idx], D, m_label_num))
+			return false;
+		m_mrf->SetNodeData(m_nodes[node_idx], typename T::NodeData(D));
+		return true;
+	}
+
+	bool updateEdge(int node_idx1, int node_idx2, REAL *V)
+	{
+		std::pair<int, int> key(node_idx1, node_idx2);
+		assert(m_edges.find(key) != m_edges.end());    /* same orientation as in addEdge() */
+		if (!updateHash(m_edge_hashes[key], V, m_label_num * m_label_num))
+			return false;
+		m_mrf->SetEdgeData(m_edges[key], MRFTypeTraits<T>::edgeData(V));
+		return true;
+	}
+
+	void setAutomaticOrdering() { m_mrf->SetAutomaticOrdering(); }
+	void zeroMessages() { m_mrf->ZeroMessages(); }
+	void addRandomMessages(unsigned int random_seed, REAL min_value, REAL max_value) { m_mrf->AddRandomMessages(random_seed, min_value, max_value); }
+
+	int minimize_TRW_S(Options &options, REAL &lower_bound, REAL &energy)
+	{
+		typename MRFEnergy<T>::Options opt;
+		opt.m_eps = options.m_eps;
+		opt.m_iterMax = options.m_iterMax;
+		opt.m_gapEps = options.m_gapEps;
+		opt.m_stagnationIter = options.m_stagnationIter;
+		opt.m_stagnationEps = options.m_stagnationEps;
+		opt.m_timeMax = options.m_timeMax;
+		opt.m_printIter = options.m_printIter;
+		opt.m_printMinIter = options.m_printMinIter;
+		opt.m_iterFn = options.m_iterFn;
+		opt.m_iterFnData = options.m_iterFnData;
+		opt.m_threadNum = options.m_threadNum;
+		m_minimized = true;
+		return m_mrf->Minimize_TRW_S(opt, lower_bound, energy);
+	}
+
+	int getSolution(int node_idx) { return m_mrf->GetSolution(m_nodes[node_idx]); }
+	bool isFixedLabelNum() const { return MRFTypeTraits<T>::isFixed(); }
+
+private:
+	MRFEnergy<T> *m_mrf;
+	typename MRFEnergy<T>::NodeId *m_nodes;
+	std::map<std::pair<int, int>, typename MRFEnergy<T>::EdgeId> m_edges;
+};
+
+MRFSolver * createMRFSolver(int label_num, int node_num)
+{
+	switch (label_num)
+	{
+	case 2: return new MRFSolverImpl<TypeFixedGeneral<2> >(label_num, node_num);
+	case 3: return new MRFSolverImpl<TypeFixedGeneral<3> >(label_num, node_num);
+	case 4: return new MRFSolverImpl<TypeFixedGeneral<4> >(label_num, node_num);
+	case 5: return new MRFSolverImpl<TypeFixedGeneral<5> >(label_num, node_num);
+	case 6: return new MRFSolverImpl<TypeFixedGeneral<6> >(label_num, node_num);
+	case 7: return new MRFSolverImpl<TypeFixedGeneral<7> >(label_num, node_num);
+	case 8: return new MRFSolverImpl<TypeFixedGeneral<8> >(label_num, node_num);
+	case 9: return new MRFSolverImpl<TypeFixedGeneral<9> >(label_num, node_num);
+	case 10: return new MRFSolverImpl<TypeFixedGeneral<10> >(label_num, node_num);
+	case 11: return new MRFSolverImpl<TypeFixedGeneral<11> >(label_num, node_num);
+	case 12: return new MRFSolverImpl<TypeFixedGeneral<12> >(label_num, node_num);
+	case 13: return new MRFSolverImpl<TypeFixedGeneral<13> >(label_num, node_num);
+	case 14: return new MRFSolverImpl<TypeFixedGeneral<14> >(label_num, node_num);
+	case 15: return new MRFSolverImpl<TypeFixedGeneral<15> >(label_num, node_num);
+	case 16: return new MRFSolverImpl<TypeFixedGeneral<16> >(label_num, node_num);
+	default: return new MRFSolverImpl<TypeGeneral>(label_num, node_num);
+	}
+}
@@ -0,0 +1,59 @@
+#ifndef MRFSOLVER_H
+#define MRFSOLVER_H
+
+#include <vector>
+#include <map>
+#include <utility>
+#include "MRFEnergy.h"
+
+/*
+ * Label-count independent front end of MRFEnergy used by PredictionThread.
+ * Nodes are addressed by index in [0, node_num). createMRFSolver() picks
+ * MRFEnergy<TypeFixedGeneral<K>> when the number of labels K is in [2, 16]
+ * (the instances in instances.inc) and MRFEnergy<TypeGeneral> otherwise.
+ *
+ * The solver can be kept as an inference session: after the first minimization
+ * updateNode()/updateEdge() replace only the tables that changed (detected by hash)
+ * and the next minimization starts from the previous messages.
+ */
+class MRFSolver
+{
+public:
+	typedef TypeGeneral::REAL REAL;
+	typedef MRFEnergy<TypeGeneral>::Options Options;
+
+	MRFSolver(int label_num, int node_num) : m_label_num(label_num), m_node_num(node_num), m_node_hashes(node_num, 0), m_minimized(false) {}
+	virtual ~MRFSolver() {}
+
+	/* D: label_num unary costs; V: label_num * label_num pairwise costs with V(ki, kj) = V[ki + label_num * kj] */
+	virtual void addNode(int node_idx, REAL *D) = 0;
+	virtual void addEdge(int node_idx1, int node_idx2, REAL *V) = 0;
+	/* Replace the table of a node or edge added before; return false (and do nothing) if it is unchanged */
+	virtual bool updateNode(int node_idx, REAL *D) = 0;
+	virtual bool updateEdge(int node_idx1, int node_idx2, REAL *V) = 0;
+
+	virtual void setAutomaticOrdering() = 0;
+	virtual void zeroMessages() = 0;
+	virtual void addRandomMessages(unsigned int random_seed, REAL min_value, REAL max_value) = 0;
+	virtual int minimize_TRW_S(Options &options, REAL &lower_bound, REAL &energy) = 0;
+	virtual int getSolution(int node_idx) = 0;
+
+	int labelNum() const { return m_label_num; }
+	int nodeNum() const { return m_node_num; }
+	virtual bool isFixedLabelNum() const = 0;
+	bool isWarm() const { return m_minimized; }    /* true if the messages of a previous minimization are kept */
+
+protected:
+	int m_label_num;
+	int m_node_num;
+	std::vector<unsigned long long> m_node_hashes;
+	std::map<std::pair<int, int>, unsigned long long> m_edge_hashes;
+	bool m_minimized;
+
+	/* Set hash to the hash of table, return true if it was different */
+	static bool updateHash(unsigned long long &hash, const REAL *table, int size);
+};
+
+MRFSolver * createMRFSolver(int label_num, int node_num);
+
+#endif // MRFSOLVER_H
@@ -1,7 +1,8 @@
 ﻿#include "myglwidget.h"
 
 MyGLWidget::MyGLWidget(QWidget *parent)
-	: QOpenGLWidget(parent)
+	: QOpenGLWidget(parent), m_program(0), m_modelVboVertices(0), m_obbVboVertices(0),
+	m_modelDirty(true), m_labelsDirty(false), m_obbsDirty(true)
 {
 	m = 3;
 	m_model = new PCModel();
@@ -9,6 +10,7 @@ MyGLWidget::MyGLWidget(QWidget *parent)
 	m_yRot = 0;
 	m_zRot = 0;
 
+	m_core = QCoreApplication::arguments().contains(QStringLiteral("--coreprofile"));
 	m_transparent = QCoreApplication::arguments().contains(QStringLiteral("--transparent"));
 	if (m_transparent)
 		setAttribute(Qt::WA_TranslucentBackground);
@@ -18,7 +20,26 @@ MyGLWidget::MyGLWidget(QWidget *parent)
 
 MyGLWidget::~MyGLWidget()
 {
+	cleanup();
+}
 
+void MyGLWidget::cleanup()
+{
+	if (m_program == 0)
+		return;
+
+	makeCurrent();
+	m_modelVbo.destroy();
+	m_obbVbo.destroy();
+	m_modelVao.destroy();
+	m_obbVao.destroy();
+	delete m_program;
+	m_program = 0;
+	doneCurrent();
+
+	/* A new context gets all the buffers again */
+	m_modelDirty = true;
+	m_obbsDirty = true;
 }
 
 void MyGLWidget::setModel(PCModel *model)
@@ -30,170 +51,269 @@ void MyGLWidget::setModel(PCModel *model)
 	m_model = model;
 	connect(m_model, SIGNAL(onLabelsChanged()), this, SLOT(updateLabels()));
 	delete(temp);
+	m_modelDirty = true;
 
 	/* Clear the current oriented bounding boxes */
-	for (int i = 0; i < m_OBBs.size(); i++)
-	{
-		delete(m_OBBs[i]);
-		m_OBBs.remove(i);
-	}
-
-	m_OBBs.clear();
+	clearOBBs();
 
 	update();
 }
 
+static const char *vertexShaderSourceCore =
+"#version 150\n"
+"in vec4 vertex;\n"
+"in vec3 normal;\n"
+"in vec3 color;\n"
+"out vec3 vertNormal;\n"
+"out vec3 vertColor;\n"
+"uniform mat4 projMatrix;\n"
+"uniform mat4 mvMatrix;\n"
+"uniform mat3 normalMatrix;\n"
+"uniform float pointSize;\n"
+"void main() {\n"
+"   vertNormal = normalMatrix * normal;\n"
+"   vertColor = color;\n"
+"   gl_PointSize = pointSize;\n"
+"   gl_Position = projMatrix * mvMatrix * vertex;\n"
+"}\n";
+
+static const char *fragmentShaderSourceCore =
+"#version 150\n"
+"in highp vec3 vertNormal;\n"
+"in highp vec3 vertColor;\n"
+"out highp vec4 fragColor;\n"
+"uniform highp float pointSize;\n"
+"uniform highp float alpha;\n"
+"highp float diffuse(highp vec3 N, highp vec3 L) {\n"
+"   highp float NL = dot(N, normalize(L));\n"
+"   highp vec3 H = normalize(normalize(L) + vec3(0.0, 0.0, 1.0));\n"
+"   return NL > 0.0 ? 0.23 * NL + 0.115 * max(dot(N, H), 0.0) : 0.0;\n"
+"}\n"
+"void main() {\n"
+"   if (pointSize > 0.0) {\n"
+"      highp vec2 c = gl_PointCoord * 2.0 - 1.0;\n"
+"      if (dot(c, c) > 1.0) discard;\n"
+"   }\n"
+"   highp vec3 N = normalize(vertNormal);\n"
+"   highp float I = diffuse(N, vec3(1.0, 1.0, 1.0)) + diffuse(N, vec3(1.0, 1.0, -1.0)) + diffuse(N, vec3(1.0, -1.0, 1.0))\n"
+"      + diffuse(N, vec3(1.0, -1.0, -1.0)) + diffuse(N, vec3(-1.0, 1.0, 1.0));\n"
+"   fragColor = vec4(clamp(vertColor * (0.2 + I), 0.0, 1.0), alpha);\n"
+"}\n";
+
+static const char *vertexShaderSource =
+"#version 120\n"
+"attribute vec4 vertex;\n"
+"attribute vec3 normal;\n"
+"attribute vec3 color;\n"
+"varying vec3 vertNormal;\n"
+"varying vec3 vertColor;\n"
+"uniform mat4 projMatrix;\n"
+"uniform mat4 mvMatrix;\n"
+"uniform mat3 normalMatrix;\n"
+"uniform float pointSize;\n"
+"void main() {\n"
+"   vertNormal = normalMatrix * normal;\n"
+"   vertColor = color;\n"
+"   gl_PointSize = pointSize;\n"
+"   gl_Position = projMatrix * mvMatrix * vertex;\n"
+"}\n";
+
+static const char *fragmentShaderSource =
+"#version 120\n"
+"varying highp vec3 vertNormal;\n"
+"varying highp vec3 vertColor;\n"
+"uniform highp float pointSize;\n"
+"uniform highp float alpha;\n"
+"highp float diffuse(highp vec3 N, highp vec3 L) {\n"
+"   highp float NL = dot(N, normalize(L));\n"
+"   highp vec3 H = normalize(normalize(L) + vec3(0.0, 0.0, 1.0));\n"
+"   return NL > 0.0 ? 0.23 * NL + 0.115 * max(dot(N, H), 0.0) : 0.0;\n"
+"}\n"
+"void main() {\n"
+"   if (pointSize > 0.0) {\n"
+"      highp vec2 c = gl_PointCoord * 2.0 - 1.0;\n"
+"      if (dot(c, c) > 1.0) discard;\n"
+"   }\n"
+"   highp vec3 N = normalize(vertNormal);\n"
+"   highp float I = diffuse(N, vec3(1.0, 1.0, 1.0)) + diffuse(N, vec3(1.0, 1.0, -1.0)) + diffuse(N, vec3(1.0, -1.0, 1.0))\n"
+"      + diffuse(N, vec3(1.0, -1.0, -1.0)) + diffuse(N, vec3(-1.0, 1.0, 1.0));\n"
+"   gl_FragColor = vec4(clamp(vertColor * (0.2 + I), 0.0, 1.0), alpha);\n"
+"}\n";
+
 void MyGLWidget::initializeGL()
 {
+	/* The context is recreated whenever the top-level window changes, so the GL resources are freed on
+	 * aboutToBeDestroyed() and built again here */
+	connect(context(), &QOpenGLContext::aboutToBeDestroyed, this, &MyGLWidget::cleanup);
+
 	initializeOpenGLFunctions();
-	glClearColor(255, 255, 255, m_transparent ? 0 : 1);
+	glClearColor(1.0, 1.0, 1.0, m_transparent ? 0 : 1);
 
 	glClearDepth(1.0f);
 	glEnable(GL_DEPTH_TEST);
 	glEnable(GL_BLEND);
-	glEnable(GL_COLOR_MATERIAL);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); //指定混合函数
 	glDepthFunc(GL_LEQUAL);
-	glHint(GL_PERSPECTIVE_CORRECTION_HINT, GL_NICEST);
-	glShadeModel(GL_SMOOTH);
-	init_light();
-}
+	/* The points are sized by the vertex shader and shaded as round sprites */
+	glEnable(GL_PROGRAM_POINT_SIZE);
+	if (!m_core)
+		glEnable(GL_POINT_SPRITE);
+
+	/* The lights of the fixed pipeline this widget used to draw with, five white directional
+	 * lights of intensity 0.23 in eye coordinates, are evaluated in the fragment shader */
+	m_program = new QOpenGLShaderProgram;
+	m_program->addShaderFromSourceCode(QOpenGLShader::Vertex, m_core ? vertexShaderSourceCore : vertexShaderSource);
+	m_program->addShaderFromSourceCode(QOpenGLShader::Fragment, m_core ? fragmentShaderSourceCore : fragmentShaderSource);
+	m_program->bindAttributeLocation("vertex", 0);
+	m_program->bindAttributeLocation("normal", 1);
+	m_program->bindAttributeLocation("color", 2);
+	if (!m_program->link())
+		qDebug() << "MyGLWidget: linking the shaders failed," << m_program->log();
+
+	m_program->bind();
+	m_projMatrixLoc = m_program->uniformLocation("projMatrix");
+	m_mvMatrixLoc = m_program->uniformLocation("mvMatrix");
+	m_normalMatrixLoc = m_program->uniformLocation("normalMatrix");
+	m_pointSizeLoc = m_program->uniformLocation("pointSize");
+	m_alphaLoc = m_program->uniformLocation("alpha");
+
+	/* One vertex array object per buffer records its attribute layout once. In OpenGL 2.x
+	 * implementations they may not be supported, then the layout is set before each draw */
+	m_modelVbo.create();
+	m_obbVbo.create();
+	if (m_modelVao.create())
+	{
+		QOpenGLVertexArrayObject::Binder vaoBinder(&m_modelVao);
+		setupVertexAttribs(m_modelVbo);
+	}
+	if (m_obbVao.create())
+	{
+		QOpenGLVertexArrayObject::Binder vaoBinder(&m_obbVao);
+		setupVertexAttribs(m_obbVbo);
+	}
+	m_program->release();
 
-void MyGLWidget::init_light()
-{
-	GLfloat white_light[] = { 0.23, 0.23, 0.23, 1.0 };
-
-	GLfloat light_position0[] = { 1.0, 1.0, 1.0, 0.0 };
-	GLfloat light_position1[] = { 1.0, 1.0, -1.0, 0.0 };
-	GLfloat light_position2[] = { 1.0, -1.0, 1.0, 0.0 };
-	GLfloat light_position3[] = { 1.0, -1.0, -1.0, 0.0 };
-	GLfloat light_position4[] = { -1.0, 1.0, 1.0, 0.0 };
-	GLfloat light_position5[] = { -1.0, -1.0, 1.0, 0.0 };
-	GLfloat light_position6[] = { -1.0, 1.0, -1.0, 0.0 };
-	GLfloat light_position7[] = { -1.0, -1.0, -1.0, 0.0 };
-
-	glLightfv(GL_LIGHT0, GL_POSITION, light_position0); glLightfv(GL_LIGHT0, GL_DIFFUSE, white_light); glLightfv(GL_LIGHT0, GL_SPECULAR, white_light);
-	glLightfv(GL_LIGHT1, GL_POSITION, light_position1); glLightfv(GL_LIGHT1, GL_DIFFUSE, white_light); glLightfv(GL_LIGHT1, GL_SPECULAR, white_light);
-	glLightfv(GL_LIGHT2, GL_POSITION, light_position2); glLightfv(GL_LIGHT2, GL_DIFFUSE, white_light); glLightfv(GL_LIGHT2, GL_SPECULAR, white_light);
-	glLightfv(GL_LIGHT3, GL_POSITION, light_position3); glLightfv(GL_LIGHT3, GL_DIFFUSE, white_light); glLightfv(GL_LIGHT3, GL_SPECULAR, white_light);
-	glLightfv(GL_LIGHT4, GL_POSITION, light_position4); glLightfv(GL_LIGHT4, GL_DIFFUSE, white_light); glLightfv(GL_LIGHT4, GL_SPECULAR, white_light);
-	glLightfv(GL_LIGHT5, GL_POSITION, light_position5); glLightfv(GL_LIGHT5, GL_DIFFUSE, white_light); glLightfv(GL_LIGHT5, GL_SPECULAR, white_light);
-	glLightfv(GL_LIGHT6, GL_POSITION, light_position6); glLightfv(GL_LIGHT6, GL_DIFFUSE, white_light); glLightfv(GL_LIGHT6, GL_SPECULAR, white_light);
-	glLightfv(GL_LIGHT7, GL_POSITION, light_position7); glLightfv(GL_LIGHT7, GL_DIFFUSE, white_light); glLightfv(GL_LIGHT7, GL_SPECULAR, white_light);
-
-	glEnable(GL_LIGHTING);
-	glEnable(GL_LIGHT0);
-	glEnable(GL_LIGHT1);
-	glEnable(GL_LIGHT2);
-	glEnable(GL_LIGHT3);
-	glEnable(GL_LIGHT4);
-	//glEnable(GL_LIGHT5);
-	//glEnable(GL_LIGHT6);
-	//glEnable(GL_LIGHT7);
+	m_modelVboVertices = 0;
+	m_obbVboVertices = 0;
+	m_modelDirty = true;
+	m_obbsDirty = true;
 }
 
-void MyGLWidget::paintGL()
+void MyGLWidget::setupVertexAttribs(QOpenGLBuffer &vbo)
 {
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-	glClearColor(1.0, 1.0, 1.0, 1.0f);
-	draw();
-	glFlush();
-	glFinish();
+	/* Interleaved vertices of 9 floats: position, normal and color */
+	vbo.bind();
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), 0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(6 * sizeof(GLfloat)));
+	vbo.release();
 }
 
-void MyGLWidget::draw()
+void MyGLWidget::uploadModel()
 {
-	glPushMatrix();
-
-	GLfloat no_mat[4] = { 0.0, 0.0, 0, 1 };
-	GLfloat mat_diffuse[4] = { 0, 0, 0, 1 };		//r±íÊ¾´óÖµ£¬b±íÊ¾Ð¡Öµ
-	GLfloat mat_specular[4] = { 0.5, 0.5, 0.5, 1 };
-	float no_shininess[4] = { 1, 1, 1, 0 };
-	glMaterialfv(GL_FRONT, GL_AMBIENT, no_mat);
-	glMaterialfv(GL_FRONT, GL_SPECULAR, mat_specular);
-	glMaterialfv(GL_FRONT, GL_SHININESS, no_shininess);
-	glMaterialfv(GL_FRONT, GL_EMISSION, no_mat);
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
-
-	/*QVector4D eye = QVector4D(0.0, 0.0, m, 1.0);
-	gluLookAt(eye.x(), eye.y(), eye.z(), 0.0, 0.0, 0.0, 0.0, 1.0, 0.0);*/
-
-	glTranslatef(m_model->getCenter().x(), m_model->getCenter().y(), m_model->getCenter().z());
-	glRotatef(m_xRot, 1.0, 0.0, 0.0);
-	glRotatef(m_yRot, 0.0, 1.0, 0.0);
-	glRotatef(m_zRot, 0.0, 0.0, 1.0);
-	glTranslatef(-m_model->getCenter().x(), -m_model->getCenter().y(), -m_model->getCenter().z());
-
-
-
-	/* Draw the point cloud model m_model */
-	glPointSize(2.0);
-	glBegin(GL_POINTS);
 	int nvertices = m_model->vertexCount();
-	for (int i = 0; i < nvertices; i++)
+	m_modelVbo.bind();
+	if (m_modelDirty || nvertices != m_modelVboVertices)
 	{
-		const GLfloat *data = m_model->constData() + i * 9;
-		GLfloat x = data[0];
-		GLfloat y = data[1];
-		GLfloat z = data[2];
-		GLfloat nx = data[3];
-		GLfloat ny = data[4];
-		GLfloat nz = data[5];
-		float cr = data[6];
-		float cg = data[7];
-		float cb = data[8];
-
-		GLfloat color[4] = { cr, cg, cb, 1.0 };
-		//glMaterialfv(GL_FRONT, GL_DIFFUSE, color);
-		glColor4f(cr, cg, cb, 1.0);
-		glNormal3f(nx, ny, nz);
-
-		glVertex3f(m * x, m* y, m * z);
+		m_modelVbo.allocate(m_model->constData(), m_model->count() * sizeof(GLfloat));
+		m_modelVboVertices = nvertices;
 	}
-	glEnd();
+	else
+		m_modelVbo.write(0, m_model->constData(), m_model->count() * sizeof(GLfloat));    /* Same layout, new colors */
+	m_modelVbo.release();
 
-	/* Draw the oriented bounding boxes of the parts */
-	int nboxes = m_OBBs.size();
-	for (int i = 0; i < nboxes; i++)
+	m_modelDirty = false;
+	m_labelsDirty = false;
+}
+
+void MyGLWidget::uploadOBBs()
+{
+	/* The triangles of all the boxes in one buffer, in the layout of the model with the color of the box */
+	int nvertices = 0;
+	for (int i = 0; i < m_OBBs.size(); i++)
+		nvertices += m_OBBs[i]->vertexCount();
+
+	QVector<GLfloat> data(nvertices * 9);
+	GLfloat *p = data.data();
+	for (int i = 0; i < m_OBBs.size(); i++)
 	{
 		int nfaces = m_OBBs[i]->facetCount();
 		QVector3D color = m_OBBs[i]->getColor();
-		glColor4f(color.x(), color.y(), color.z(), 0.5);
-
-		glBegin(GL_TRIANGLES);
 		for (int j = 0; j < nfaces; j++)
 		{
-			const GLfloat *data = m_OBBs[i]->constData() + j * 12;
-			GLfloat v0x = data[0];
-			GLfloat v0y = data[1];
-			GLfloat v0z = data[2];
-			GLfloat v1x = data[3];
-			GLfloat v1y = data[4];
-			GLfloat v1z = data[5];
-			GLfloat v2x = data[6];
-			GLfloat v2y = data[7];
-			GLfloat v2z = data[8];
-			GLfloat nx = data[9];
-			GLfloat ny = data[10];
-			GLfloat nz = data[11];
-
-			//glMaterialfv(GL_FRONT, GL_DIFFUSE, color);
-
-			glNormal3f(nx, ny, nz);
-
-			glVertex3f(m * v0x, m * v0y, m * v0z);
-			glVertex3f(m * v1x, m * v1y, m * v1z);
-			glVertex3f(m * v2x, m * v2y, m * v2z);
+			const GLfloat *facet = m_OBBs[i]->constData() + j * 12;
+			for (int k = 0; k < 3; k++)
+			{
+				p[0] = facet[3 * k];
+				p[1] = facet[3 * k + 1];
+				p[2] = facet[3 * k + 2];
+				p[3] = facet[9];
+				p[4] = facet[10];
+				p[5] = facet[11];
+				p[6] = color.x();
+				p[7] = color.y();
+				p[8] = color.z();
+				p += 9;
+			}
 		}
-
-		glEnd();
 	}
 
-	//glColor4f(1.0, 0.0, 0.0, 0.5);
-	//drawCylinder(0, 0.5, 0.0, 0, -0.5, 0, 0.7);
-	glPopMatrix();
+	m_obbVbo.bind();
+	m_obbVbo.allocate(data.constData(), data.size() * sizeof(GLfloat));
+	m_obbVbo.release();
+	m_obbVboVertices = nvertices;
+	m_obbsDirty = false;
+}
+
+void MyGLWidget::paintGL()
+{
+	glClearColor(1.0, 1.0, 1.0, m_transparent ? 0 : 1);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+	if (m_modelDirty || m_labelsDirty)
+		uploadModel();
+	if (m_obbsDirty)
+		uploadOBBs();
+
+	/* Rotate around the center of the model, which is scaled by m */
+	QVector3D center = m_model->getCenter();
+	QMatrix4x4 world;
+	world.translate(center);
+	world.rotate(m_xRot, 1.0, 0.0, 0.0);
+	world.rotate(m_yRot, 0.0, 1.0, 0.0);
+	world.rotate(m_zRot, 0.0, 0.0, 1.0);
+	world.translate(-center);
+	world.scale(m);
+
+	m_program->bind();
+	m_program->setUniformValue(m_projMatrixLoc, m_proj);
+	m_program->setUniformValue(m_mvMatrixLoc, world);
+	m_program->setUniformValue(m_normalMatrixLoc, world.normalMatrix());
+
+	/* Draw the point cloud model m_model */
+	m_program->setUniformValue(m_pointSizeLoc, (GLfloat)POINT_SPRITE_SIZE);
+	m_program->setUniformValue(m_alphaLoc, (GLfloat)1.0);
+	if (m_modelVao.isCreated())
+		m_modelVao.bind();
+	else
+		setupVertexAttribs(m_modelVbo);
+	glDrawArrays(GL_POINTS, 0, m_modelVboVertices);
+
+	/* Draw the oriented bounding boxes of the parts */
+	m_program->setUniformValue(m_pointSizeLoc, (GLfloat)0.0);
+	m_program->setUniformValue(m_alphaLoc, (GLfloat)OBB_ALPHA);
+	if (m_obbVao.isCreated())
+		m_obbVao.bind();
+	else
+		setupVertexAttribs(m_obbVbo);
+	glDrawArrays(GL_TRIANGLES, 0, m_obbVboVertices);
+
+	if (m_obbVao.isCreated())
+		m_obbVao.release();
+	m_program->release();
 }
 
 void MyGLWidget::resizeGL(int width, int height)
@@ -202,16 +322,14 @@ void MyGLWidget::resizeGL(int width, int height)
 	if (height == 0) {    // Prevent A Divide By Zero By  
 		height = 1;    // Making Height Equal One  
 	}
-	glViewport(0, 0, width, height);    // Reset The Current Viewport  
-	glMatrixMode(GL_PROJECTION);       // Select The Projection Matrix  
-	glLoadIdentity();                  // Reset The Projection Matrix  
+	if (width == 0)
+		width = 1;
 
+	m_proj.setToIdentity();
 	if (width <= height)
-		glOrtho(-nRange, nRange, -nRange*height / width, nRange*height / width, -nRange, nRange);
+		m_proj.ortho(-nRange, nRange, -nRange*height / width, nRange*height / width, -nRange, nRange);
 	else
-		glOrtho(-nRange*width / height, nRange*width / height, -nRange, nRange, -nRange, nRange);
-	glMatrixMode(GL_MODELVIEW);      // Select The Modelview Matrix  
-	glLoadIdentity();
+		m_proj.ortho(-nRange*width / height, nRange*width / height, -nRange, nRange, -nRange, nRange);
 }
 
 void MyGLWidget::mousePressEvent(QMouseEvent *event)
@@ -288,17 +406,14 @@ void MyGLWidget::setOBBs(QVector<OBB *> obbs)
 	int size = obbs.size();
 
 	/* Delete all the OBB in current m_OBBs */
-	for (int i = 0; i < m_OBBs.size(); i++)
-	{
-		delete(m_OBBs[i]);
-		m_OBBs.remove(i);
-	}
+	clearOBBs();
 
 	m_OBBs.resize(size);
 
 	int i = 0;
 	for (QVector<OBB *>::iterator it = obbs.begin(); it != obbs.end(); it++)
 		m_OBBs[i++] = *it;
+	m_obbsDirty = true;
 
 	update();
 }
@@ -311,59 +426,14 @@ void MyGLWidget::onDebugTextAdded(QString text)
 void MyGLWidget::updateLabels()
 {
 	emit addDebugText("Update the labels of points in GLWidget.");
+	m_labelsDirty = true;
 	update();
 }
 
-void MyGLWidget::drawCylinder(float x0, float y0, float z0, float x1, float y1, float z1, double radius)
+void MyGLWidget::clearOBBs()
 {
-	GLdouble  dir_x = x1 - x0;
-	GLdouble  dir_y = y1 - y0;
-	GLdouble  dir_z = z1 - z0;
-	GLdouble  bone_length = sqrt(dir_x*dir_x + dir_y*dir_y + dir_z*dir_z);
-	static GLUquadricObj *  quad_obj = NULL;
-	if (quad_obj == NULL)
-		quad_obj = gluNewQuadric();
-	gluQuadricDrawStyle(quad_obj, GLU_LINE);
-	gluQuadricNormals(quad_obj, GLU_SMOOTH);
-	glPushMatrix();
-
-	glTranslated(x0, y0, z0);
-	//Calculate length. 
-	double  length;
-	length = sqrt(dir_x*dir_x + dir_y*dir_y + dir_z*dir_z);
-	if (length < 0.0001) {
-		dir_x = 0.0; dir_y = 0.0; dir_z = 1.0;  length = 1.0;
-	}
-	dir_x /= length;  dir_y /= length;  dir_z /= length;
-	GLdouble  up_x, up_y, up_z;
-	up_x = 0.0;
-	up_y = 1.0;
-	up_z = 0.0;
-	double side_x, side_y, side_z;
-	side_x = up_y * dir_z - up_z * dir_y;
-	side_y = up_z * dir_x - up_x * dir_z;
-	side_z = up_x * dir_y - up_y * dir_x;
-	length = sqrt(side_x*side_x + side_y*side_y + side_z*side_z);
-	if (length < 0.0001) {
-		side_x = 1.0; side_y = 0.0; side_z = 0.0;  length = 1.0;
-	}
-	side_x /= length;  side_y /= length;  side_z /= length;
-	up_x = dir_y * side_z - dir_z * side_y;
-	up_y = dir_z * side_x - dir_x * side_z;
-	up_z = dir_x * side_y - dir_y * side_x;
-
-	//Transformation matrix  
-	GLdouble  m[16] = { side_x, side_y, side_z, 0.0,
-		up_x, up_y, up_z, 0.0,
-		dir_x, dir_y, dir_z, 0.0,
-		0.0, 0.0, 0.0, 1.0 };
-	glMultMatrixd(m);
-
-	//Param for cylinder
-	GLdouble slices = 8.0;
-	GLdouble stack = 128.0;
-
-	//gluQuadricDrawStyle(GLU_FILL);
-	gluCylinder(quad_obj, radius, radius, bone_length, slices, stack);
-	glPopMatrix();
-}
\ No newline at end of file
+	for (int i = 0; i < m_OBBs.size(); i++)
+		delete(m_OBBs[i]);
+	m_OBBs.clear();
+	m_obbsDirty = true;
+}
@@ -2,19 +2,31 @@
 #define MYGLWIDGET_H
 
 #include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <QOpenGLVertexArrayObject>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QMatrix4x4>
 #include <QDebug>
 #include <QString>
-#include <QtOpenGL>
 #include <QtGui>
 #include "pcmodel.h"
 #include "obb.h"
-#include <Windows.h>
-#include <GL/glu.h>
 
 #ifndef PI
 #define PI 3.1415926536
 #endif
 
+#ifndef GL_PROGRAM_POINT_SIZE
+#define GL_PROGRAM_POINT_SIZE 0x8642
+#endif
+#ifndef GL_POINT_SPRITE
+#define GL_POINT_SPRITE 0x8861
+#endif
+
+#define POINT_SPRITE_SIZE 2.0    /* Diameter of the points, in pixels */
+#define OBB_ALPHA 0.5    /* Opacity of the oriented bounding boxes */
+
 class MyGLWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
 	Q_OBJECT
@@ -37,6 +49,7 @@ signals:
 	void addDebugText(QString text);
 
 	public slots:
+	void cleanup();
 	void setXRotation(int angle);
 	void setYRotation(int angle);
 	void setZRotation(int angle);
@@ -48,34 +61,47 @@ signals:
 protected:
 	void initializeGL();
 	void paintGL();
-	void init_light();
 	void resizeGL(int w, int h);
 	void mousePressEvent(QMouseEvent *event);
 	void mouseMoveEvent(QMouseEvent *event);
 	//void mouseReleaseEvent(QMouseEvent *event);
 	void wheelEvent(QWheelEvent *e);
 
-	private slots:
-	void draw();
-
 private:
-	void normalizeAngle(int &angle);
-	void drawSphere(GLfloat xx, GLfloat yy, GLfloat zz, GLfloat radius, GLfloat M, GLfloat N);
-	void ProcessPicks(GLint nPicks, GLuint pickBuffer[]);
-	void drawCylinder(float x0, float y0, float z0, float x1, float y1, float z1, double radius);
-
-	static GLint _colorList[12][3];
+	void uploadModel();
+	void uploadOBBs();
+	void setupVertexAttribs(QOpenGLBuffer &vbo);
+	void clearOBBs();
 
 	GLfloat m_xRot;
 	GLfloat m_yRot;
 	GLfloat m_zRot;
 	bool m_transparent;
+	bool m_core;
 	float m;
 	PCModel * m_model;
 	QVector<OBB *> m_OBBs;
 
+	/* The buffers live on the GPU and are only written when the geometry or the labels change */
+	QOpenGLShaderProgram *m_program;
+	QOpenGLVertexArrayObject m_modelVao;
+	QOpenGLVertexArrayObject m_obbVao;
+	QOpenGLBuffer m_modelVbo;
+	QOpenGLBuffer m_obbVbo;
+	int m_modelVboVertices;    /* Vertices allocated in m_modelVbo */
+	int m_obbVboVertices;
+	bool m_modelDirty;    /* The geometry of the model changed */
+	bool m_labelsDirty;    /* Only the colors of the model changed */
+	bool m_obbsDirty;
+	int m_projMatrixLoc;
+	int m_mvMatrixLoc;
+	int m_normalMatrixLoc;
+	int m_pointSizeLoc;
+	int m_alphaLoc;
+	QMatrix4x4 m_proj;
+
 	QPoint m_lastPos;
 	bool clickEvent;
 };
 
-#endif // MYGLWIDGET_H
\ No newline at end of file
+#endif // MYGLWIDGET_H
@@ -0,0 +1,235 @@
+#include "normalestimator.h"
+#include <algorithm>
+
+NormalEstimator::NormalEstimator(ORIENTATION orientation, int jet_neighbors, int orient_neighbors)
+	: m_orientation(orientation), m_jet_neighbors(jet_neighbors), m_orient_neighbors(orient_neighbors), m_viewpoint(0, 0, 0),
+	m_search_time(0), m_jet_time(0), m_graph_time(0), m_orient_time(0)
+{
+}
+
+NormalEstimator::~NormalEstimator()
+{
+}
+
+void NormalEstimator::setViewpoint(Point3 viewpoint)
+{
+	m_viewpoint = viewpoint;
+}
+
+QString NormalEstimator::timingReport() const
+{
+	return "Neighbor search " + QString::number(m_search_time) + " ms, jet fitting " + QString::number(m_jet_time)
+		+ " ms, orientation graph " + QString::number(m_graph_time) + " ms, orientation " + QString::number(m_orient_time) + " ms.";
+}
+
+bool NormalEstimator::estimate(PointList &points)
+{
+	TRACE_SCOPE("normals");
+	m_search_time = m_jet_time = m_graph_time = m_orient_time = 0;
+
+	/* Too few points for the jet fitting of the parallel path */
+	if (m_orientation == MST || (int)points.size() <= m_jet_neighbors)
+	{
+		long start_time = Utils::getCurrentTime();
+		CGAL::jet_estimate_normals<Concurrency_tag>(points.begin(), points.end(),
+			CGAL::First_of_pair_property_map<PointVectorPair>(),
+			CGAL::Second_of_pair_property_map<PointVectorPair>(),
+			m_jet_neighbors);
+		m_jet_time = Utils::getCurrentTime() - start_time;
+
+		start_time = Utils::getCurrentTime();
+		CGAL::mst_orient_normals(points.begin(), points.end(),
+			CGAL::First_of_pair_property_map<PointVectorPair>(),
+			CGAL::Second_of_pair_property_map<PointVectorPair>(),
+			m_orient_neighbors);
+		m_orient_time = Utils::getCurrentTime() - start_time;
+		return false;
+	}
+
+	/* One neighbor search serves both the jet fitting and the orientation graph */
+	int k = std::min((int)points.size(), std::max(m_jet_neighbors, m_orient_neighbors));
+	std::vector<int> neighbors;
+	estimateJet(points, neighbors, k);
+
+	if (m_orientation == PROPAGATION)
+		orientPropagation(points, neighbors, k);
+	else
+		orientViewpoint(points);
+	return true;
+}
+
+void NormalEstimator::estimateJet(PointList &points, std::vector<int> &neighbors, int k)
+{
+	typedef CGAL::Monge_via_jet_fitting<Kernel> Monge_jet_fitting;
+	typedef Monge_jet_fitting::Monge_form Monge_form;
+
+	long start_time = Utils::getCurrentTime();
+	int npoints = points.size();
+	std::vector<float> coords(3 * npoints);
+	float min[3], max[3];
+	for (int i = 0; i < npoints; i++)
+	{
+		const Point3 &p = points[i].first;
+		float c[3] = { (float)p.x(), (float)p.y(), (float)p.z() };
+		for (int a = 0; a < 3; a++)
+		{
+			coords[3 * i + a] = c[a];
+			if (i == 0 || c[a] < min[a]) min[a] = c[a];
+			if (i == 0 || c[a] > max[a]) max[a] = c[a];
+		}
+	}
+
+	/* Cells of about the spacing of points on a surface */
+	float diagonal = sqrt((max[0] - min[0]) * (max[0] - min[0]) + (max[1] - min[1]) * (max[1] - min[1]) + (max[2] - min[2]) * (max[2] - min[2]));
+	SpatialIndex *index = SpatialIndex::build(&coords[0], &coords[1], &coords[2], 3, npoints, 2.0 * diagonal / sqrt((float)npoints));
+
+	neighbors.resize((size_t)npoints * k);
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 0; i < npoints; i++)
+	{
+		std::vector<int> indices;
+		std::vector<float> sqr_distances;
+		index->nearestKSearch(&coords[3 * i], k, indices, sqr_distances);
+		for (int j = 0; j < k; j++)
+			neighbors[(size_t)i * k + j] = indices[j];
+	}
+	delete(index);
+	m_search_time = Utils::getCurrentTime() - start_time;
+
+	/* The jet fitting of CGAL::jet_estimate_normals, over the first m_jet_neighbors neighbors */
+	start_time = Utils::getCurrentTime();
+	int kjet = std::min(k, m_jet_neighbors);
+#pragma omp parallel for schedule(dynamic, 256)
+	for (int i = 0; i < npoints; i++)
+	{
+		std::vector<Point3> neighborhood(kjet);
+		for (int j = 0; j < kjet; j++)
+			neighborhood[j] = points[neighbors[(size_t)i * k + j]].first;
+
+		Monge_jet_fitting monge_fit;
+		Monge_form monge_form = monge_fit(neighborhood.begin(), neighborhood.end(), 2, 1);
+		points[i].second = monge_form.normal_direction();
+	}
+	m_jet_time = Utils::getCurrentTime() - start_time;
+}
+
+void NormalEstimator::orientPropagation(PointList &points, const std::vector<int> &neighbors, int k)
+{
+	/* Symmetric k-nearest neighbor graph in compressed rows */
+	long start_time = Utils::getCurrentTime();
+	int npoints = points.size();
+	int korient = std::min(k, m_orient_neighbors);
+	std::vector<int> degrees(npoints + 1, 0);
+	for (int i = 0; i < npoints; i++)
+	{
+		for (int j = 0; j < korient; j++)
+		{
+			int n = neighbors[(size_t)i * k + j];
+			if (n != i)
+			{
+				degrees[i]++;
+				degrees[n]++;
+			}
+		}
+	}
+	std::vector<int> starts(npoints + 1, 0);
+	for (int i = 0; i < npoints; i++)
+		starts[i + 1] = starts[i] + degrees[i];
+	std::vector<int> edges(starts[npoints]);
+	std::vector<int> fill(starts.begin(), starts.end() - 1);
+	for (int i = 0; i < npoints; i++)
+	{
+		for (int j = 0; j < korient; j++)
+		{
+			int n = neighbors[(size_t)i * k + j];
+			if (n != i)
+			{
+				edges[fill[i]++] = n;
+				edges[fill[n]++] = i;
+			}
+		}
+	}
+	m_graph_time = Utils::getCurrentTime() - start_time;
+
+	/* Seeds by decreasing height, the highest point of each component is oriented towards +Z as in CGAL */
+	start_time = Utils::getCurrentTime();
+	std::vector<std::pair<double, int>> seeds(npoints);
+	for (int i = 0; i < npoints; i++)
+		seeds[i] = std::make_pair(-points[i].first.z(), i);
+	std::sort(seeds.begin(), seeds.end());
+
+	std::vector<int> rings(npoints, -1);    /* The ring of the search each point was oriented in */
+	std::vector<int> frontier, next;
+	int ring = 0;
+	for (int s = 0; s < npoints; s++)
+	{
+		int seed = seeds[s].second;
+		if (rings[seed] >= 0)
+			continue;
+		if (points[seed].second.z() < 0)
+			points[seed].second = -points[seed].second;
+		rings[seed] = ring++;
+		frontier.assign(1, seed);
+
+		while (!frontier.empty())
+		{
+			/* Gather the next ring */
+			next.clear();
+			for (int f = 0; f < (int)frontier.size(); f++)
+			{
+				int i = frontier[f];
+				for (int e = starts[i]; e < starts[i + 1]; e++)
+				{
+					int n = edges[e];
+					if (rings[n] < 0)
+					{
+						rings[n] = ring;
+						next.push_back(n);
+					}
+				}
+			}
+
+			/* Orient each point of the ring against the most parallel normal oriented before the ring */
+#pragma omp parallel for schedule(dynamic, 256)
+			for (int r = 0; r < (int)next.size(); r++)
+			{
+				int i = next[r];
+				Vector normal = points[i].second;
+				double best = -1;
+				double best_dot = 0;
+				for (int e = starts[i]; e < starts[i + 1]; e++)
+				{
+					int n = edges[e];
+					if (rings[n] >= 0 && rings[n] < ring)
+					{
+						double dot = normal * points[n].second;
+						if (std::abs(dot) > best)
+						{
+							best = std::abs(dot);
+							best_dot = dot;
+						}
+					}
+				}
+				if (best_dot < 0)
+					points[i].second = -normal;
+			}
+
+			ring++;
+			frontier.swap(next);
+		}
+	}
+	m_orient_time = Utils::getCurrentTime() - start_time;
+}
+
+void NormalEstimator::orientViewpoint(PointList &points)
+{
+	long start_time = Utils::getCurrentTime();
+	int npoints = points.size();
+#pragma omp parallel for
+	for (int i = 0; i < npoints; i++)
+	{
+		if (points[i].second * (m_viewpoint - points[i].first) < 0)
+			points[i].second = -points[i].second;
+	}
+	m_orient_time = Utils::getCurrentTime() - start_time;
+}
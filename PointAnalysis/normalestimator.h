@@ -0,0 +1,58 @@
+#ifndef NORMALESTIMATOR_H
+#define NORMALESTIMATOR_H
+
+#include <QString>
+#include <QDebug>
+#include <vector>
+#include <CGAL/Monge_via_jet_fitting.h>
+#include "utils.h"
+#include "spatialindex.h"
+
+#define NORMAL_JET_NEIGHBORS 18    /* K-nearest neighbors of the jet fitting, 3 rings */
+#define NORMAL_ORIENT_NEIGHBORS 16    /* K-nearest neighbors of the orientation graph */
+
+/*
+ * Normal estimation of the loaders. The jet fitting runs with OpenMP over the k nearest
+ * neighbors given by a SpatialIndex, whether CGAL is linked with TBB or not.
+ * The normals are then oriented by one of:
+ * MST - CGAL::mst_orient_normals, serial, moves the unoriented points to the end of the list;
+ * PROPAGATION - breadth-first propagation over the symmetric k-nearest neighbor graph from the
+ *   highest point, each ring of the search is oriented in parallel against the most parallel
+ *   normal of the rings before it, the points keep their order;
+ * VIEWPOINT - each normal is turned towards the sensor origin, the points keep their order.
+ */
+class NormalEstimator
+{
+public:
+	enum ORIENTATION{
+		MST,
+		PROPAGATION,
+		VIEWPOINT
+	};
+
+	NormalEstimator(ORIENTATION orientation = PROPAGATION, int jet_neighbors = NORMAL_JET_NEIGHBORS, int orient_neighbors = NORMAL_ORIENT_NEIGHBORS);
+	~NormalEstimator();
+
+	void setViewpoint(Point3 viewpoint);    /* The sensor origin, used by VIEWPOINT */
+	/* Estimate and orient the normals of points, returns false if the points have been reordered (MST) */
+	bool estimate(PointList &points);
+	QString timingReport() const;
+
+private:
+	ORIENTATION m_orientation;
+	int m_jet_neighbors;
+	int m_orient_neighbors;
+	Point3 m_viewpoint;
+	long m_search_time;    /* The time spent in each sub-stage of the last estimate(), in ms */
+	long m_jet_time;
+	long m_graph_time;
+	long m_orient_time;
+
+	void estimateJet(PointList &points, std::vector<int> &neighbors, int k);
+	void orientPropagation(PointList &points, const std::vector<int> &neighbors, int k);
+	void orientViewpoint(PointList &points);
+};
+
+#define LOAD_NORMAL_ORIENTATION NormalEstimator::PROPAGATION    /* Orientation of the normals of the loaded models */
+
+#endif // NORMALESTIMATOR_H
@@ -0,0 +1,327 @@
+#include "offscreenrenderer.h"
+#include "renderthread.h"
+#include "obbestimator.h"
+#include "utils.h"
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QMap>
+
+#ifndef GL_PROGRAM_POINT_SIZE
+#define GL_PROGRAM_POINT_SIZE 0x8642
+#endif
+
+static const char *vertexShaderSource =
+"#version 120\n"
+"attribute vec4 vertex;\n"
+"attribute vec3 normal;\n"
+"attribute vec3 color;\n"
+"varying vec3 vertNormal;\n"
+"varying vec3 vertColor;\n"
+"uniform mat4 projMatrix;\n"
+"uniform mat4 mvMatrix;\n"
+"uniform mat3 normalMatrix;\n"
+"uniform float pointSize;\n"
+"void main() {\n"
+"   vertNormal = normalMatrix * normal;\n"
+"   vertColor = color;\n"
+"   gl_PointSize = pointSize;\n"
+"   gl_Position = projMatrix * mvMatrix * vertex;\n"
+"}\n";
+
+/* The points are flat colored, the labeled files have no normals; the boxes are lit from the eye */
+static const char *fragmentShaderSource =
+"#version 120\n"
+"varying highp vec3 vertNormal;\n"
+"varying highp vec3 vertColor;\n"
+"uniform highp float alpha;\n"
+"uniform highp float lighting;\n"
+"void main() {\n"
+"   highp float NL = abs(normalize(vertNormal).z);\n"
+"   highp vec3 col = mix(vertColor, vertColor * (0.3 + 0.7 * NL), lighting);\n"
+"   gl_FragColor = vec4(clamp(col, 0.0, 1.0), alpha);\n"
+"}\n";
+
+OffscreenRenderer::OffscreenRenderer(QOffscreenSurface *surface, int width, int height)
+	: m_surface(surface), m_context(NULL), m_fbo(NULL), m_program(NULL), m_width(width), m_height(height),
+	m_npoints(0), m_obbVertices(0), m_radius(1.0)
+{
+	m_context = new QOpenGLContext();
+	m_context->setFormat(surface->requestedFormat());
+	if (!m_context->create() || !m_context->makeCurrent(surface))
+	{
+		qDebug() << "OffscreenRenderer: cannot create an OpenGL context.";
+		return;
+	}
+	initializeOpenGLFunctions();
+
+	QOpenGLFramebufferObjectFormat format;
+	format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	format.setSamples(RENDER_SAMPLES);
+	m_fbo = new QOpenGLFramebufferObject(m_width, m_height, format);
+
+	QOpenGLShaderProgram *program = new QOpenGLShaderProgram;
+	program->addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource);
+	program->addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource);
+	program->bindAttributeLocation("vertex", 0);
+	program->bindAttributeLocation("normal", 1);
+	program->bindAttributeLocation("color", 2);
+	if (!m_fbo->isValid() || !program->link())
+	{
+		qDebug() << "OffscreenRenderer: cannot set up the framebuffer or the shaders," << program->log();
+		delete program;
+		m_context->doneCurrent();
+		return;
+	}
+	m_program = program;
+
+	m_pointsVbo.create();
+	m_obbVbo.create();
+	m_context->doneCurrent();
+}
+
+OffscreenRenderer::~OffscreenRenderer()
+{
+	if (m_context->makeCurrent(m_surface))
+	{
+		m_pointsVbo.destroy();
+		m_obbVbo.destroy();
+		delete m_program;
+		delete m_fbo;
+		m_context->doneCurrent();
+	}
+	delete m_context;
+}
+
+void OffscreenRenderer::setupVertexAttribs(QOpenGLBuffer &vbo)
+{
+	/* Interleaved vertices of 9 floats: position, normal and color */
+	vbo.bind();
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), 0);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(3 * sizeof(GLfloat)));
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(GLfloat), reinterpret_cast<void *>(6 * sizeof(GLfloat)));
+	vbo.release();
+}
+
+void OffscreenRenderer::setScene(PCModel *model, const QVector<OBB *> &obbs)
+{
+	if (!isValid())
+		return;
+	m_context->makeCurrent(m_surface);
+
+	m_pointsVbo.bind();
+	m_pointsVbo.allocate(model->constData(), model->count() * sizeof(GLfloat));
+	m_pointsVbo.release();
+	m_npoints = model->vertexCount();
+	m_center = model->getCenter();
+	m_radius = model->getRadius() > 0 ? model->getRadius() : 1.0;
+
+	/* The triangles of the boxes in the layout of the points, with the color of their box */
+	int nvertices = 0;
+	for (int i = 0; i < obbs.size(); i++)
+		nvertices += obbs[i]->vertexCount();
+	QVector<GLfloat> data(nvertices * 9);
+	GLfloat *p = data.data();
+	for (int i = 0; i < obbs.size(); i++)
+	{
+		QVector3D color = obbs[i]->getColor();
+		for (int j = 0; j < obbs[i]->facetCount(); j++)
+		{
+			const GLfloat *facet = obbs[i]->constData() + j * 12;
+			for (int k = 0; k < 3; k++)
+			{
+				p[0] = facet[3 * k];
+				p[1] = facet[3 * k + 1];
+				p[2] = facet[3 * k + 2];
+				p[3] = facet[9];
+				p[4] = facet[10];
+				p[5] = facet[11];
+				p[6] = color.x();
+				p[7] = color.y();
+				p[8] = color.z();
+				p += 9;
+			}
+		}
+	}
+	m_obbVbo.bind();
+	m_obbVbo.allocate(data.constData(), data.size() * sizeof(GLfloat));
+	m_obbVbo.release();
+	m_obbVertices = nvertices;
+
+	m_context->doneCurrent();
+}
+
+QImage OffscreenRenderer::render(const Viewpoint &view)
+{
+	if (!isValid())
+		return QImage();
+	m_context->makeCurrent(m_surface);
+	m_fbo->bind();
+
+	glViewport(0, 0, m_width, m_height);
+	glClearColor(1.0, 1.0, 1.0, 1.0);
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glEnable(GL_PROGRAM_POINT_SIZE);
+
+	float distance = view.distance * m_radius;
+	QMatrix4x4 proj;
+	proj.perspective(RENDER_FIELD_OF_VIEW, GLfloat(m_width) / m_height, qMax(0.01f * m_radius, distance - 2 * m_radius), distance + 2 * m_radius);
+	QMatrix4x4 camera;
+	camera.lookAt(QVector3D(0, 0, distance), QVector3D(0, 0, 0), QVector3D(0, 1.0, 0));
+	QMatrix4x4 world;
+	world.rotate(view.xRot, 1, 0, 0);
+	world.rotate(view.yRot, 0, 1, 0);
+	world.rotate(view.zRot, 0, 0, 1);
+	world.translate(-m_center);
+
+	m_program->bind();
+	m_program->setUniformValue("projMatrix", proj);
+	m_program->setUniformValue("mvMatrix", camera * world);
+	m_program->setUniformValue("normalMatrix", (camera * world).normalMatrix());
+
+	/* The points, then the translucent boxes over them without writing the depth */
+	m_program->setUniformValue("pointSize", (GLfloat)RENDER_POINT_SIZE);
+	m_program->setUniformValue("alpha", (GLfloat)1.0);
+	m_program->setUniformValue("lighting", (GLfloat)0.0);
+	setupVertexAttribs(m_pointsVbo);
+	glDrawArrays(GL_POINTS, 0, m_npoints);
+
+	m_program->setUniformValue("alpha", (GLfloat)RENDER_OBB_ALPHA);
+	m_program->setUniformValue("lighting", (GLfloat)1.0);
+	setupVertexAttribs(m_obbVbo);
+	glDepthMask(GL_FALSE);
+	glDrawArrays(GL_TRIANGLES, 0, m_obbVertices);
+	glDepthMask(GL_TRUE);
+	m_program->release();
+
+	/* Resolves the multisampled framebuffer */
+	QImage image = m_fbo->toImage();
+	m_fbo->release();
+	m_context->doneCurrent();
+	return image;
+}
+
+QVector<OffscreenRenderer::Viewpoint> OffscreenRenderer::defaultViewpoints(int nviews)
+{
+	/* Evenly around the vertical axis, seen from a little above */
+	QVector<Viewpoint> views(nviews);
+	for (int i = 0; i < nviews; i++)
+	{
+		views[i].xRot = RENDER_ELEVATION;
+		views[i].yRot = 360.0 * i / nviews;
+		views[i].zRot = 0;
+		views[i].distance = RENDER_DISTANCE;
+	}
+	return views;
+}
+
+QVector<OffscreenRenderer::Viewpoint> OffscreenRenderer::loadViewpoints(const QString &filename)
+{
+	QVector<Viewpoint> views;
+	QFile file(filename);
+	if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+		return views;
+
+	QTextStream in(&file);
+	while (!in.atEnd())
+	{
+		QStringList values = in.readLine().split(' ', QString::SkipEmptyParts);
+		if (values.size() < 3)
+			continue;
+		Viewpoint view;
+		view.xRot = values[0].toFloat();
+		view.yRot = values[1].toFloat();
+		view.zRot = values[2].toFloat();
+		view.distance = values.size() > 3 ? values[3].toFloat() : RENDER_DISTANCE;
+		views.push_back(view);
+	}
+	return views;
+}
+
+PCModel * OffscreenRenderer::loadScene(const QString &filename, QVector<OBB *> &obbs)
+{
+	QVector<float> coordinates;
+	QVector<int> labels;
+	if (!Utils::loadLabeledPoints(filename.toStdString().c_str(), coordinates, labels))
+		return NULL;
+
+	/* The labeled files have no normals, the points are drawn unlit */
+	int nvertices = labels.size();
+	QVector<float> data(nvertices * 6);
+	for (int i = 0; i < nvertices; i++)
+	{
+		float *p = data.data() + i * 6;
+		p[0] = coordinates[3 * i];
+		p[1] = coordinates[3 * i + 1];
+		p[2] = coordinates[3 * i + 2];
+		p[3] = 0;
+		p[4] = 0;
+		p[5] = 1.0;
+	}
+	PCModel *model = new PCModel(nvertices, data, labels);
+	model->setInputFilename(filename.toStdString());
+
+	/* The box of each part with a color, as PCAThread computes them */
+	QMap<int, pcl::PointCloud<pcl::PointXYZ>::Ptr> parts;
+	for (int i = 0; i < nvertices; i++)
+	{
+		int label = labels[i];
+		if (label < 0 || label >= NUM_OF_COLORS)
+			continue;
+		if (!parts.contains(label))
+			parts.insert(label, pcl::PointCloud<pcl::PointXYZ>::Ptr(new pcl::PointCloud<pcl::PointXYZ>));
+		const GLfloat *point = model->constData() + i * 9;
+		parts[label]->push_back(pcl::PointXYZ(point[0], point[1], point[2]));
+	}
+	for (QMap<int, pcl::PointCloud<pcl::PointXYZ>::Ptr>::iterator it = parts.begin(); it != parts.end(); ++it)
+	{
+		if (it.value()->size() < 4)
+			continue;
+		OBBEstimator obbe(it.key(), it.value());
+		OBB *obb = obbe.computeOBB();
+		obb->triangulate();
+		obbs.push_back(obb);
+	}
+	return model;
+}
+
+int OffscreenRenderer::renderBatch(const QStringList &models, const QVector<Viewpoint> &views, const QString &output_dir, int nthreads)
+{
+	if (models.isEmpty() || views.isEmpty())
+		return 0;
+	QDir().mkpath(output_dir);
+	if (nthreads <= 0)
+		nthreads = QThread::idealThreadCount();
+	nthreads = qMin(nthreads, models.size());
+
+	/* The surfaces are created here in the GUI thread, the contexts in the threads using them */
+	QAtomicInt next_task(0);
+	QVector<QOffscreenSurface *> surfaces(nthreads);
+	QVector<RenderThread *> threads(nthreads);
+	for (int i = 0; i < nthreads; i++)
+	{
+		surfaces[i] = new QOffscreenSurface();
+		surfaces[i]->create();
+		threads[i] = new RenderThread(i, models, views, output_dir, surfaces[i], &next_task);
+		/* Printed in the render thread, a queued call would only run once wait() has returned */
+		QObject::connect(threads[i], &RenderThread::addDebugText, threads[i], [](QString text) { qDebug() << text; }, Qt::DirectConnection);
+		threads[i]->start();
+	}
+
+	int written = 0;
+	for (int i = 0; i < nthreads; i++)
+	{
+		threads[i]->wait();
+		written += threads[i]->imagesWritten();
+		delete(threads[i]);
+		delete(surfaces[i]);
+	}
+	qDebug("Rendered %d images of %d models to %s.", written, models.size(), output_dir.toStdString().c_str());
+	return written;
+}
@@ -0,0 +1,83 @@
+#ifndef OFFSCREENRENDERER_H
+#define OFFSCREENRENDERER_H
+
+#include <QOpenGLContext>
+#include <QOffscreenSurface>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLBuffer>
+#include <QMatrix4x4>
+#include <QImage>
+#include <QStringList>
+#include <QVector>
+#include <QDebug>
+#include "pcmodel.h"
+#include "obb.h"
+
+#define RENDER_WIDTH 512    /* Size of the rendered images, in pixels */
+#define RENDER_HEIGHT 512
+#define RENDER_SAMPLES 4    /* Multisampling of the framebuffer */
+#define RENDER_POINT_SIZE 3.0
+#define RENDER_OBB_ALPHA 0.35
+#define RENDER_FIELD_OF_VIEW 30.0    /* Vertical, in degrees */
+#define RENDER_DISTANCE 4.2    /* Distance of the eye from the center of the model, in radii of the model */
+#define RENDER_VIEWS 8    /* Viewpoints around the model when none are given */
+#define RENDER_ELEVATION 20.0    /* Elevation of these viewpoints, in degrees */
+
+/*
+ * Renders a model and the oriented bounding boxes of its parts into images, without a window.
+ * A renderer owns an OpenGL context and a framebuffer object and draws into them on an offscreen
+ * surface, so it needs no desktop session (run with -platform offscreen, or with software OpenGL).
+ * The context belongs to the thread that created the renderer and must only be used from it; the
+ * surface however has to be created in the GUI thread, so it is given to the constructor.
+ * renderBatch() renders a list of models from a list of viewpoints to PNG files with one
+ * RenderThread, each with its own renderer, per core.
+ */
+class OffscreenRenderer : protected QOpenGLFunctions
+{
+public:
+	/* The model is rotated around its center by xRot, then yRot, then zRot degrees and seen from distance radii */
+	struct Viewpoint
+	{
+		float xRot;
+		float yRot;
+		float zRot;
+		float distance;
+	};
+
+	OffscreenRenderer(QOffscreenSurface *surface, int width = RENDER_WIDTH, int height = RENDER_HEIGHT);
+	~OffscreenRenderer();
+
+	bool isValid() const { return m_program != NULL; }
+	/* Upload the points and the boxes, which are not kept */
+	void setScene(PCModel *model, const QVector<OBB *> &obbs);
+	QImage render(const Viewpoint &view);
+
+	static QVector<Viewpoint> defaultViewpoints(int nviews = RENDER_VIEWS);
+	/* A viewpoint per line: xRot yRot zRot [distance] */
+	static QVector<Viewpoint> loadViewpoints(const QString &filename);
+	/* Load a labeled model (an off file next to its seg file) and compute the boxes of its labels */
+	static PCModel * loadScene(const QString &filename, QVector<OBB *> &obbs);
+	/* Render each model from each viewpoint to output_dir/<model name>_<viewpoint>.png, returns the number of images written.
+	 * Must be called from the GUI thread */
+	static int renderBatch(const QStringList &models, const QVector<Viewpoint> &views, const QString &output_dir, int nthreads = 0);
+
+private:
+	QOffscreenSurface *m_surface;
+	QOpenGLContext *m_context;
+	QOpenGLFramebufferObject *m_fbo;
+	QOpenGLShaderProgram *m_program;
+	QOpenGLBuffer m_pointsVbo;
+	QOpenGLBuffer m_obbVbo;
+	int m_width;
+	int m_height;
+	int m_npoints;
+	int m_obbVertices;
+	float m_radius;
+	QVector3D m_center;
+
+	void setupVertexAttribs(QOpenGLBuffer &vbo);
+};
+
+#endif // OFFSCREENRENDERER_H
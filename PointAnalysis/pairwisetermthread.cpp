@@ -11,7 +11,7 @@ PairwiseTermThread::PairwiseTermThread(int id, Part_Candidates part_candidates,
 	: QThread(parent), m_part_candidates(part_candidates), m_start(start), m_end(end), m_energy_functions(energy_functions),
 	m_label_names(label_names), m_id(id)
 {
-	qDebug("Create PairwiseTermThread-%d to compute pairwise potentials of Node-%d to Node-%d", id, start, end);
+	LOG_DEBUG(Logger::Inference, "Create PairwiseTermThread-%d to compute pairwise potentials of Node-%d to Node-%d", id, start, end);
 	qRegisterMetaType<Pairwise_Potentials>("PairwisePotentials");
 }
 
@@ -27,6 +27,7 @@ void PairwiseTermThread::run()
 
 void PairwiseTermThread::computePairwisePotentials()
 {
+	TRACE_SCOPE_ARG("pairwise", m_id);
 	int num_of_candidates = m_part_candidates.size();
 	int labelNum = m_label_names.size();
 	int N1 = m_end - m_start + 1;
@@ -264,4 +264,36 @@ OBB * PAPart::generateOBB()
 	OBB *obb = new OBB(x_axis, y_axis, z_axis, centroid, (double)x_length, (double)y_length, (double)z_length, m_label);
 	obb->triangulate();
 	return obb;
-}
\ No newline at end of file
+}
+/* Binary form of a part for the checkpoints of the candidates */
+QDataStream & operator<<(QDataStream &out, const PAPart &part)
+{
+	out.writeRawData((const char *)part.m_rotate.data(), 9 * sizeof(float));
+	out.writeRawData((const char *)part.m_translate.data(), 3 * sizeof(float));
+	out.writeRawData((const char *)part.m_scale.data(), 3 * sizeof(float));
+	out.writeRawData((const char *)part.m_height.data(), 4 * sizeof(float));
+	out.writeRawData((const char *)part.m_axes.data(), 9 * sizeof(float));
+	out << part.m_label << part.m_cluster_no << (int)part.m_vertices_indices.size();
+	out.writeRawData((const char *)part.m_vertices_indices.data(), part.m_vertices_indices.size() * sizeof(int));
+	return out;
+}
+
+QDataStream & operator>>(QDataStream &in, PAPart &part)
+{
+	in.readRawData((char *)part.m_rotate.data(), 9 * sizeof(float));
+	in.readRawData((char *)part.m_translate.data(), 3 * sizeof(float));
+	in.readRawData((char *)part.m_scale.data(), 3 * sizeof(float));
+	in.readRawData((char *)part.m_height.data(), 4 * sizeof(float));
+	in.readRawData((char *)part.m_axes.data(), 9 * sizeof(float));
+	int nindices = 0;
+	in >> part.m_label >> part.m_cluster_no >> nindices;
+	if (in.status() != QDataStream::Ok || nindices < 0)
+	{
+		in.setStatus(QDataStream::ReadCorruptData);
+		return in;
+	}
+	part.m_vertices_indices.resize(nindices);
+	if (in.readRawData((char *)part.m_vertices_indices.data(), nindices * sizeof(int)) != nindices * (int)sizeof(int))
+		in.setStatus(QDataStream::ReadPastEnd);
+	return in;
+}
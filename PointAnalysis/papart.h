@@ -5,6 +5,7 @@
 #include <qvector.h>
 #include <qvector3d.h>
 #include <QList>
+#include <QDataStream>
 #include <vector>
 #include <string>
 #include <fstream>
@@ -38,6 +39,9 @@ public:
 	void saveToFile(std::string name);
 	OBB * generateOBB();
 
+	friend QDataStream & operator<<(QDataStream &out, const PAPart &part);
+	friend QDataStream & operator>>(QDataStream &in, PAPart &part);
+
 private:
 	Eigen::Matrix3f m_rotate;    /* Rotation matrix of 3x3 */
 	Eigen::Vector3f m_translate;
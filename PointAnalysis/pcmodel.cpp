@@ -1,16 +1,18 @@
 #include "pcmodel.h"
+#include "spatialindex.h"
 
 using namespace std;
 
-PCModel::PCModel() : m_count(0), max(0)
+PCModel::PCModel() : m_count(0), max(0), m_content_hash(0)
 {
 	center = QVector3D(0, 0, 0);
 }
 
 PCModel::PCModel(int nvertices, pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, pcl::PointCloud<pcl::Normal>::Ptr normals)
-	: m_count(0), max(0)
+	: m_count(0), max(0), m_content_hash(0)
 {
 	m_data.resize(9 * nvertices);
+	m_color_indices.fill(UNLABELED_COLOR, nvertices);
 	//m_curvature.resize(nvertices);
 
 	for (int i = 0; i < nvertices; i++)
@@ -33,10 +35,11 @@ PCModel::PCModel(int nvertices, pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, pcl::
 }
 
 PCModel::PCModel(int nvertices, QVector<float> data)
-	: m_count(0), max(0)
+	: m_count(0), max(0), m_content_hash(0)
 {
 	double xmean = 0, ymean = 0, zmean = 0;
 	m_data.resize(9 * nvertices);
+	m_color_indices.fill(UNLABELED_COLOR, nvertices);
 
 	for (int i = 0; i < nvertices; i++)
 	{
@@ -59,11 +62,12 @@ PCModel::PCModel(int nvertices, QVector<float> data)
 }
 
 PCModel::PCModel(int nvertices, QVector<float> data, QVector<int> labels)
-	: m_count(0), max(0)
+	: m_count(0), max(0), m_content_hash(0)
 {
 	double xmean = 0, ymean = 0, zmean = 0;
 	m_data.resize(9 * nvertices);
 	m_labels.resize(nvertices);
+	m_color_indices.resize(nvertices);
 	m_label_names.clear();
 
 	for (int i = 0; i < nvertices; i++)
@@ -75,12 +79,9 @@ PCModel::PCModel(int nvertices, QVector<float> data, QVector<int> labels)
 		GLfloat nx = p[3];
 		GLfloat ny = p[4];
 		GLfloat nz = p[5];
-		QVector3D color;
 		int label = labels[i];
-		if (label <= 10 && label >= 0)
-			color = QVector3D(COLORS[labels[i]][0], COLORS[labels[i]][1], COLORS[labels[i]][2]);
-		else
-			color = QVector3D(COLORS[10][0], COLORS[10][1], COLORS[10][2]);
+		m_color_indices[i] = colorIndex(label);
+		QVector3D color(COLORS[m_color_indices[i]][0], COLORS[m_color_indices[i]][1], COLORS[m_color_indices[i]][2]);
 		add(QVector3D(x, y, z), QVector3D(nx, ny, nz), color);
 
 		if (!m_label_names.contains(label))
@@ -118,6 +119,11 @@ void PCModel::add(const QVector3D &v, const QVector3D &n, const QVector3D &c)
 	m_count += 9;
 }
 
+unsigned char PCModel::colorIndex(int label)
+{
+	return label >= 0 && label < NUM_OF_COLORS ? label : UNLABELED_COLOR;
+}
+
 void PCModel::transform(QMatrix4x4 transMatrix)
 {
 	for (int i = 0; i < m_count; i += 9)
@@ -160,6 +166,7 @@ void PCModel::output(const char *filename)
 		out << "property float nz" << std::endl;
 		out << "end_header" << std::endl;
 
+		/* Write the points in the order they were loaded */
 		int onePercent = m_count * 0.01;
 		int progress_count = 1;
 		for (int i = 0; i < m_count; i += 9)
@@ -169,7 +176,7 @@ void PCModel::output(const char *filename)
 				emit(outputProgressReport(progress_count));
 				progress_count++;
 			}
-			GLfloat *p = m_data.data() + i;
+			GLfloat *p = m_data.data() + (isReordered() ? m_load_order[i / 9] * 9 : i);
 			out << p[0] << " " << p[1] << " " << p[2] << " "
 				<< p[3] << " " << p[4] << " " << p[5] << std::endl;
 		}
@@ -183,6 +190,9 @@ void PCModel::output(const char *filename)
 void PCModel::clear()
 {
 	m_data.clear();
+	m_color_indices.clear();
+	m_recolored_points.clear();
+	m_load_order.clear();
 	m_count = 0;
 	center.setX(0);
 	center.setY(0);
@@ -263,16 +273,24 @@ void PCModel::setLabels(QVector<int> labels)
 	m_label_names.clear();
 	m_labels.clear();
 	m_labels.resize(labels.size());
+	m_recolored_points.clear();
 	//m_labels = labels;
 	for (int i = 0; i < vertexCount(); i++)
 	{
 		m_labels[i] = labels[i];
-
-		GLfloat *point = m_data.data() + i * 9;
 		int label = m_labels[i];
-		point[6] = COLORS[m_labels[i]][0];
-		point[7] = COLORS[m_labels[i]][1];
-		point[8] = COLORS[m_labels[i]][2];
+
+		/* Only the points whose color changes are rewritten, and remembered for the views to update */
+		unsigned char color_index = colorIndex(label);
+		if (color_index != m_color_indices[i])
+		{
+			GLfloat *point = m_data.data() + i * 9;
+			point[6] = COLORS[color_index][0];
+			point[7] = COLORS[color_index][1];
+			point[8] = COLORS[color_index][2];
+			m_color_indices[i] = color_index;
+			m_recolored_points.push_back(i);
+		}
 
 		if (!m_label_names.contains(label))
 			m_label_names.push_back(label);
@@ -306,4 +324,49 @@ QList<int> PCModel::getLabelNames()
 int PCModel::numOfClasses()
 {
 	return m_label_names.size();
+}
+
+void PCModel::spatialReorder()
+{
+	/* Sort the points along the Z-order curve, so the neighbors of a point are mostly close in memory */
+	int nvertices = vertexCount();
+	std::vector<int> order;    /* The old index of each point */
+	SpatialIndex::mortonOrder(m_data.constData(), m_data.constData() + 1, m_data.constData() + 2, 9, nvertices, order);
+
+	QVector<GLfloat> data(m_count);
+	QVector<int> labels(m_labels.size());
+	QVector<unsigned char> color_indices(m_color_indices.size());
+	QVector<double> sdf(m_sdf.size());
+	QVector<int> new_index(nvertices);    /* The new index of each point */
+	for (int i = 0; i < nvertices; i++)
+	{
+		int old = order[i];
+		std::memcpy(data.data() + i * 9, m_data.constData() + old * 9, 9 * sizeof(GLfloat));
+		if (old < m_labels.size())
+			labels[i] = m_labels[old];
+		if (old < m_color_indices.size())
+			color_indices[i] = m_color_indices[old];
+		if (old < m_sdf.size())
+			sdf[i] = m_sdf[old];
+		new_index[old] = i;
+	}
+
+	/* Compose with the previous reordering, if any */
+	if (isReordered())
+	{
+		for (int k = 0; k < nvertices; k++)
+			m_load_order[k] = new_index[m_load_order[k]];
+	}
+	else
+		m_load_order = new_index;
+
+	m_data = data;
+	m_labels = labels;
+	m_color_indices = color_indices;
+	m_sdf = sdf;
+}
+
+QVector<int> PCModel::getLoadOrder()
+{
+	return m_load_order;
 }
\ No newline at end of file
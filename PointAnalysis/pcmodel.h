@@ -37,6 +37,8 @@ const float COLORS[11][3] = {
 	{ 0.0, 0.5, 0.5 },
 	{ 0.5, 0.5, 0.5 }
 };
+#define NUM_OF_COLORS 11
+#define UNLABELED_COLOR 10    /* Index in COLORS of the points without a label */
 
 class PCModel : public QObject
 {
@@ -53,6 +55,10 @@ public:
 	GLfloat *data() { return m_data.data(); }
 	int count() const { return m_count; }
 	int vertexCount() const { return m_count / 9; }
+	/* Index in COLORS of the color of each point, the same colors as in the data */
+	const unsigned char *colorIndexData() const { return m_color_indices.constData(); }
+	/* The points whose color changed in the last setLabels() */
+	const QVector<int> & getRecoloredPoints() const { return m_recolored_points; }
 	//void addFrame(PCModel model, QMatrix4x4 trans);
 	QVector3D getCenter();
 	void output(const char *filename);
@@ -66,6 +72,11 @@ public:
 	void setSdf(QVector<double> sdf);
 	QList<int> getLabelNames();
 	int numOfClasses();
+	void spatialReorder();
+	bool isReordered() const { return !m_load_order.isEmpty(); }
+	QVector<int> getLoadOrder();
+	void setContentHash(unsigned long long hash) { m_content_hash = hash; }
+	unsigned long long getContentHash() const { return m_content_hash; }    /* Hash of the input file, 0 if unknown */
 
 	public slots:
 	void setLabels(QVector<int> labels);
@@ -79,6 +90,8 @@ signals:
 private:
 	QVector<GLfloat> m_data;
 	QVector<int> m_labels;
+	QVector<unsigned char> m_color_indices;
+	QVector<int> m_recolored_points;
 	int m_count;
 	QVector3D center;  /* the center of the minimal bounding sphere */
 	double max;
@@ -86,8 +99,11 @@ private:
 	std::string inputfilename;
 	QVector<double> m_sdf;
 	QList<int> m_label_names;
+	unsigned long long m_content_hash;
+	QVector<int> m_load_order;    /* The index in the model of each point in the order they were loaded, empty if not reordered */
 
 	void add(const QVector3D &v, const QVector3D &n, const QVector3D &c);
+	static unsigned char colorIndex(int label);
 	void transform(QMatrix4x4 transMatrix);
 	void normalize();
 };
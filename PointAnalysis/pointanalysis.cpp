@@ -13,6 +13,7 @@ PointAnalysis::PointAnalysis(QWidget *parent)
 	connect(ui.actionOpen, SIGNAL(triggered()), this, SLOT(load()));
 	connect(ui.actionSave, SIGNAL(triggered()), this, SLOT(saveModel()));
 	connect(ui.actionEstimate_Features, SIGNAL(triggered()), this, SLOT(estimateFeatures()));
+	connect(ui.actionEstimate_Features_Tiled, SIGNAL(triggered()), this, SLOT(estimateFeaturesTiled()));
 	connect(ui.actionExtract_Point_Features, SIGNAL(triggered()), this, SLOT(extractPointFeatures()));
 	connect(&pfe, SIGNAL(reportStatus(QString)), this, SLOT(setStatMessage(QString)));
 	connect(&pfe, SIGNAL(showModel(PCModel *)), ui.displayGLWidget, SLOT(setModel(PCModel *)));
@@ -27,10 +28,16 @@ PointAnalysis::PointAnalysis(QWidget *parent)
 	connect(ui.actionCompute_OBB, SIGNAL(triggered()), this, SLOT(computeOBB()));
 	connect(ui.actionTrain_Parts_Relations, SIGNAL(triggered()), this, SLOT(trainPartRelations()));
 	connect(ui.actionStructure_Inference, SIGNAL(triggered()), this, SLOT(inferStructure()));
+	connect(ui.actionEnergy_Weights, SIGNAL(triggered()), this, SLOT(setEnergyWeights()));
+	connect(ui.actionTRWS_Time_Budget, SIGNAL(triggered()), this, SLOT(setTrwsTimeBudget()));
 	connect(&m_analyser, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
 	connect(&m_analyser, SIGNAL(sendOBBs(QVector<OBB *>)), ui.displayGLWidget, SLOT(setOBBs(QVector<OBB *>)));
+	/* The workers of the analysis log through the Logger, the debug text only takes the messages it shows */
+	Logger::instance()->subscribe(DEBUG_TEXT_LEVEL, (1u << Logger::NUM_OF_CHANNELS) - 1);
+	connect(Logger::instance(), SIGNAL(messagesLogged(QStringList)), this, SLOT(onMessagesLogged(QStringList)));
 
 	fe = NULL;
+	tiledFeatureThread = NULL;
 	trainThread = NULL;
 	loadThread = NULL;
 	outputThread = NULL;
@@ -146,7 +153,6 @@ void PointAnalysis::estimateFeatures()
 	ui.statusBar->showMessage("Estimating points features of " + QString::fromStdString(filename) + "...");
 	fe = new FeatureEstimator(ui.displayGLWidget->getModel(), FeatureEstimator::PHASE::TESTING, this);
 	connect(fe, SIGNAL(estimateCompleted(PAPointCloud *)), this, SLOT(featureEstimateCompleted(PAPointCloud *)));
-	connect(fe, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
 	fe->estimateFeatures();
 }
 
@@ -157,11 +163,52 @@ void PointAnalysis::featureEstimateCompleted(PAPointCloud *pointcloud)
 	std::string outputname = "../data/features_test/" + filename + ".csv";
 	onDebugTextAdded("Save the point cloud features to file " + QString::fromStdString(outputname) + ".");
 	setStatMessage("Saving the point cloud features to file" + QString::fromStdString(outputname) + "...");
-	pointcloud->writeToFile(outputname.c_str());
+	pointcloud->writeToFile(outputname.c_str(), ui.displayGLWidget->getModel()->getLoadOrder());
 	disconnect(fe, SIGNAL(estimateCompleted(PAPointCloud *)), this, SLOT(featureEstimateCompleted(PAPointCloud *)));
 	ui.statusBar->showMessage("Point features estimation done.");
 }
 
+void PointAnalysis::estimateFeaturesTiled()
+{
+	if (tiledFeatureThread != NULL)
+	{
+		if (tiledFeatureThread->isRunning())
+			tiledFeatureThread->terminate();
+		delete(tiledFeatureThread);
+		tiledFeatureThread = NULL;
+	}
+
+	/* The points are streamed from the file, so the model doesn't have to be loaded */
+	QString filepath = QFileDialog::getOpenFileName(this, tr("Estimate Features (Tiled)"),
+		"../../Data",
+		tr("Object File Format (*.off);;XYZ Point Cloud (*.xyz)"));
+
+	if (filepath.length() > 0)
+	{
+		std::string outputname = "../data/features_test/" + Utils::getModelName(filepath).toStdString() + ".paf";
+		onDebugTextAdded("Estimate point features of " + filepath + " tile by tile.");
+		ui.statusBar->showMessage("Estimating points features of " + filepath + " tile by tile...");
+		ui.mainProgressBar->setValue(0);
+
+		tiledFeatureThread = new TiledFeatureThread(filepath.toStdString(), outputname, TILE_MAX_POINTS, this);
+		connect(tiledFeatureThread, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
+		connect(tiledFeatureThread, SIGNAL(tileDone(int, int)), this, SLOT(onTileDone(int, int)));
+		connect(tiledFeatureThread, SIGNAL(estimateCompleted(QString)), this, SLOT(onTiledEstimateDone(QString)));
+		tiledFeatureThread->start();
+	}
+}
+
+void PointAnalysis::onTileDone(int tile, int ntiles)
+{
+	ui.mainProgressBar->setValue(100 * (tile + 1) / ntiles);
+}
+
+void PointAnalysis::onTiledEstimateDone(QString store_filename)
+{
+	onDebugTextAdded("Point features estimation done, saved to " + store_filename + ".");
+	ui.statusBar->showMessage("Point features estimation done.");
+}
+
 void PointAnalysis::setStatMessage(QString msg)
 {
 	ui.statusBar->showMessage(msg, 0);
@@ -205,6 +252,12 @@ void PointAnalysis::onDebugTextAdded(QString text)
 	ui.debugTextEdit->append(text);
 }
 
+void PointAnalysis::onMessagesLogged(QStringList messages)
+{
+	/* One append for the batch of messages */
+	ui.debugTextEdit->append(messages.join("\n"));
+}
+
 void PointAnalysis::testPointCloud()
 {
 	if (testPcThread.isRunning())
@@ -316,8 +369,8 @@ void PointAnalysis::onTrainPartsDone()
 {
 	if (trainPartsThread != NULL)
 	{
-		if (trainPartsThread->isRunning())
-			trainPartsThread->terminate();
+		/* finish() is the last thing run() does, let it return */
+		trainPartsThread->wait();
 		delete(trainPartsThread);
 		trainPartsThread = NULL;
 	}
@@ -327,4 +380,41 @@ void PointAnalysis::inferStructure()
 {
 	m_analyser.setPointCloud(ui.displayGLWidget->getModel());
 	m_analyser.execute();
+}
+
+void PointAnalysis::setEnergyWeights()
+{
+	/* The weights of the five terms, the structure inferred last is predicted again with them */
+	float w[5];
+	EnergyFunctions::getWeights(w[0], w[1], w[2], w[3], w[4]);
+	QString current;
+	for (int i = 0; i < 5; i++)
+		current += (i > 0 ? " " : "") + QString::number(w[i]);
+	bool ok;
+	QString text = QInputDialog::getText(this, "Energy Weights", "Weights w1 to w5:", QLineEdit::Normal, current, &ok);
+	if (!ok)
+		return;
+	QStringList values = text.split(' ', QString::SkipEmptyParts);
+	if (values.size() != 5)
+	{
+		onDebugTextAdded("Energy weights: five values are expected.");
+		return;
+	}
+	for (int i = 0; i < 5; i++)
+		w[i] = values[i].toFloat();
+	EnergyFunctions::setWeights(w[0], w[1], w[2], w[3], w[4]);
+	onDebugTextAdded("Energy weights set to " + text.simplified() + ".");
+	m_analyser.repredict();
+}
+
+void PointAnalysis::setTrwsTimeBudget()
+{
+	/* Of the next predictions, a prediction checkpointed under another budget is computed again */
+	bool ok;
+	double seconds = QInputDialog::getDouble(this, "TRW-S Time Budget", "Seconds per model (0 for no limit):",
+		m_analyser.getTrwsTimeBudget(), 0, 3600, 1, &ok);
+	if (!ok)
+		return;
+	m_analyser.setTrwsTimeBudget(seconds);
+	onDebugTextAdded("TRW-S time budget set to " + QString::number(seconds) + " s.");
 }
\ No newline at end of file
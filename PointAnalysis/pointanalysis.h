@@ -3,6 +3,7 @@
 
 #include <QtWidgets/QMainWindow>
 #include <qfiledialog.h>
+#include <QInputDialog>
 #include <QVector>
 #include "ui_pointanalysis.h"
 #include "utils.h"
@@ -11,6 +12,7 @@
 #include "progressdialog1.h"
 #include "loadthread.h"
 #include "featureestimator.h"
+#include "tiledfeaturethread.h"
 #include "PAPointCloud.h"
 #include "pointfeatureextractor.h"
 #include "trainthread.h"
@@ -22,6 +24,9 @@
 #include "trainpartsthread.h"
 #include "papart.h"
 #include "structureanalyser.h"
+#include "logger.h"
+
+#define DEBUG_TEXT_LEVEL LOG_LEVEL_INFO    /* The debug text shows the messages of the workers from this level on */
 
 class PointAnalysis : public QMainWindow
 {
@@ -39,12 +44,16 @@ public:
 	void getProgressReport(int value);
 	void estimateFeatures();
 	void featureEstimateCompleted(PAPointCloud *cloud);
+	void estimateFeaturesTiled();
+	void onTileDone(int tile, int ntiles);
+	void onTiledEstimateDone(QString store_filename);
 	void testPointCloud();
 	void setStatMessage(QString stat);
 	void extractPointFeatures();
 	void trainPointClassifier();
 	void onTrainingCompleted();
 	void onDebugTextAdded(QString text);
+	void onMessagesLogged(QStringList messages);
 	void onTestCompleted(QVector<int> labels);
 	void computeSdf();
 	void onComputeSdfDone();
@@ -55,6 +64,8 @@ public:
 	void trainPartRelations();
 	void onTrainPartsDone();
 	void inferStructure();
+	void setEnergyWeights();
+	void setTrwsTimeBudget();
 
 private:
 	Ui::PointAnalysisClass ui;
@@ -62,6 +73,7 @@ private:
 	OutputThread *outputThread;
 	LoadThread *loadThread;
 	FeatureEstimator *fe;
+	TiledFeatureThread *tiledFeatureThread;
 	std::string filename;
 	PointFeatureExtractor pfe;
 	TrainThread *trainThread;
@@ -11,7 +11,6 @@ PointFeatureExtractor::PointFeatureExtractor(QObject *parent)
 	connect(&loadThread, SIGNAL(loadPointsCompleted(PCModel *)), this, SLOT(receiveModel(PCModel *)));
 	connect(&fe, SIGNAL(estimateCompleted(PAPointCloud *)), this, SLOT(oneEstimateCompleted(PAPointCloud *)));
 	connect(&loadThread, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
-	connect(&fe, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
 	fe.setPhase(FeatureEstimator::PHASE::TRAINING);
 	loadThread.setPhase(LoadThread::PHASE::TRAINING);
 }
@@ -25,7 +24,6 @@ PointFeatureExtractor::PointFeatureExtractor(std::string modelClassName, QObject
 	connect(&loadThread, SIGNAL(loadPointsCompleted(PCModel *)), this, SLOT(receiveModel(PCModel *)));
 	connect(&fe, SIGNAL(estimateCompleted(PAPointCloud *)), this, SLOT(oneEstimateCompleted(PAPointCloud *)));
 	connect(&loadThread, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
-	connect(&fe, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
 	fe.setPhase(FeatureEstimator::PHASE::TRAINING);
 	loadThread.setPhase(LoadThread::PHASE::TRAINING);
 }
@@ -101,6 +99,7 @@ void PointFeatureExtractor::receiveModel(PCModel *pcModel)
 	}
 
 	/* Set point cloud to be estimated to pcModel */
+	m_load_order = pcModel->getLoadOrder();
 	fe.reset(pcModel);
 	stat_msg = "Estimating Features of " + modelname + "...";
 	emit reportStatus(stat_msg);
@@ -111,8 +110,8 @@ void PointFeatureExtractor::receiveModel(PCModel *pcModel)
 
 void PointFeatureExtractor::oneEstimateCompleted(PAPointCloud *cloud)
 {
-	/* Output the point features of the model into file */
-	cloud->writeToFile(getOutFilename(currentId).c_str());
+	/* Output the point features of the model into file, in the order of the points of its file */
+	cloud->writeToFile(getOutFilename(currentId).c_str(), m_load_order);
 	QString stat_msg = "Model " + getModelName(currentId) + " estimation done.";
 	qDebug() << stat_msg;
 	emit reportStatus(stat_msg);
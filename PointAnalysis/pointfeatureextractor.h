@@ -3,6 +3,7 @@
 
 #include <QThread>
 #include <QDebug>
+#include <QVector>
 #include <qlist.h>
 #include <QtAlgorithms>
 #include <string>
@@ -39,6 +40,7 @@ private:
 	LoadThread loadThread;
 	std::string m_modelClassName;
 	QList<int> m_label_names;
+	QVector<int> m_load_order;    /* Of the model being estimated, the point of each row of its file */
 
 	void estimateFeatures();
 	std::string getOutFilename(int index);
@@ -1,22 +1,21 @@
 #include "pointfeaturethread.h"
 
 PointFeatureThread::PointFeatureThread(int super, int idno, pcl::PointCloud<pcl::PointXYZ>::Ptr c, pcl::PointCloud<pcl::Normal>::Ptr n,
-	pcl::search::KdTree<pcl::PointXYZ>::Ptr tree, float co, double rad, int start, int e, QObject *parent)
-	: QThread(parent)
+	const SpatialIndex *sindex, float co, double rad, int start, int e, PAPointCloud *out, QObject *parent)
+	: QThread(parent), curvature_cached(false)
 {
-	qDebug("PointFeatureThread-%d-%d is created.", super, idno);
-	QString dtext = "PointFeatureThread-" + QString::number(super) + "-" + QString::number(idno) + " is created";
-	emit addDebugText(dtext);
+	LOG_DEBUG(Logger::Features, "PointFeatureThread-%d-%d is created.", super, idno);
 
 	cloud = c;
 	normals = n;
-	kdtree = tree;
+	index = sindex;
 	begin = start;
 	end = e;
 	id = idno;
 	superid = super;
 	coef = co;
 	radius = rad;
+	features = out;
 }
 
 PointFeatureThread::~PointFeatureThread()
@@ -27,34 +26,47 @@ PointFeatureThread::~PointFeatureThread()
 
 void PointFeatureThread::run()
 {
-	QList<QVector<double>> points_feats;
-	estimate(points_feats);
-	emit estimateCompleted(id, points_feats);
+	estimate();
+	if (!isInterruptionRequested())
+		emit estimateCompleted(id);
 }
 
 using namespace pcl;
 using namespace Eigen;
 
-void PointFeatureThread::estimate(QList<QVector<double>> &points_feats)
+void PointFeatureThread::estimate()
 {
 	/* Compute the geometry features of each point in the sub point cloud */
-	qDebug("PointFeatureThread-%d-%d: Computing geometry features for each point...", superid, id);
-	QString dtext = "PointFeatureThread-" + QString::number(superid) + "-" + QString::number(id) + ": Computing geometry features for each point...";
-	emit addDebugText(dtext);
+	LOG_DEBUG(Logger::Features, "PointFeatureThread-%d-%d: Computing geometry features for each point...", superid, id);
 
+	TRACE_SCOPE_ARG("features", superid);    /* One stage per radius */
+	estimateRange(cloud, index, radius * coef, begin, end, features, superid, !curvature_cached);
+}
+
+void PointFeatureThread::setCurvatureCached(bool cached)
+{
+	curvature_cached = cached;
+}
+
+void PointFeatureThread::estimateRange(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, const SpatialIndex *index,
+	double search_radius, int begin, int end, PAPointCloud *features, int part, bool curvature)
+{
 	std::vector<int> pointIdxRadiusSearch;
 	std::vector<float> pointRadiusSquaredDistance;
 
+	PASpan<float> evqu0_col = features->feature(part * PART + 0);
+	PASpan<float> evqu1_col = features->feature(part * PART + 1);
+	PASpan<float> grav0_col = features->feature(part * PART + 2);
+	PASpan<float> grav1_col = features->feature(part * PART + 3);
+	PASpan<float> curvature_col = features->feature(part * PART + PART - 1);
+
 	for (int i = begin; i <= end; i++)
 	{
 		/* Declear the feature variables of the point */
-		double evqu0 = 0, evqu1 = 0, grav0 = 0, grav1 = 0, curvature = 0;
-
-		/* Extract the search point from the point cloud */
-		pcl::PointXYZ searchPoint = cloud->at(i);
+		double evqu0 = 0, evqu1 = 0, grav0 = 0, grav1 = 0, curv = FLOAT_INF;
 
 		/* Find the neighbors of the point */
-		if (kdtree->radiusSearch(searchPoint, radius * coef, pointIdxRadiusSearch, pointRadiusSquaredDistance) > 0)
+		if (index->radiusSearch(i, search_radius, pointIdxRadiusSearch, pointRadiusSquaredDistance) > 0)
 		{
 			//qDebug("The number of neighbors of (%f, %f, %f) is %d\n", searchPoint.x, searchPoint.y, searchPoint.z, pointIdxRadiusSearch.size());
 			PointCloud<PointXYZ> neighborhood;
@@ -107,17 +119,28 @@ void PointFeatureThread::estimate(QList<QVector<double>> &points_feats)
 			grav0 = gm0.data()[0].real();
 			MatrixXcd gm2 = eigenvectors.col(thirdno).transpose() * g;
 			grav1 = gm2.data()[0].real();
+
+			/* Surface variation over the centered covariance, the curvature of pcl::NormalEstimation */
+			if (curvature && neighborhood.size() >= 3)
+			{
+				Eigen::Matrix3f centered_cov;
+				Eigen::Vector4f centroid;
+				computeMeanAndCovarianceMatrix(neighborhood, centered_cov, centroid);
+				Eigen::Vector3f centered_evalues = Eigen::SelfAdjointEigenSolver<Eigen::Matrix3f>(centered_cov, Eigen::EigenvaluesOnly).eigenvalues();
+				float sum = centered_evalues.sum();
+				float variation = sum != 0 ? centered_evalues[0] / sum : 0;    /* The eigenvalues are in increasing order */
+				if (variation >= 0 && variation <= 1.0)
+					curv = variation;
+			}
 		}
-		curvature = normals->at(i).curvature;
 		//sdf = Utils::sdf(cloud, normals, i);
 
-		/* Add the point feature vector to list */
-		QVector<double> feat;
-		feat.push_back(evqu0);
-		feat.push_back(evqu1);
-		feat.push_back(grav0);
-		feat.push_back(grav1);
-		feat.push_back(curvature);
-		points_feats.push_back(feat);
+		/* Write the point features to its row of the output */
+		evqu0_col[i] = evqu0;
+		evqu1_col[i] = evqu1;
+		grav0_col[i] = grav0;
+		grav1_col[i] = grav1;
+		if (curvature)
+			curvature_col[i] = curv;
 	}
 }
@@ -9,8 +9,12 @@
 #include <pcl/common/impl/centroid.hpp>
 #include <Eigen/src/Core/MatrixBase.h>
 #include <Eigen\src\Eigenvalues\EigenSolver.h>
-#include "PAPoint.h"
+#include <Eigen\src\Eigenvalues\SelfAdjointEigenSolver.h>
+#include "PAPointCloud.h"
 #include "utils.h"
+#include "spatialindex.h"
+
+#define FLOAT_INF 100.0    /* The curvature of points with too few neighbors */
 
 class PointFeatureThread : public QThread
 {
@@ -18,12 +22,18 @@ class PointFeatureThread : public QThread
 
 public:
 	PointFeatureThread(int super, int id, pcl::PointCloud<pcl::PointXYZ>::Ptr c, pcl::PointCloud<pcl::Normal>::Ptr n,
-		pcl::search::KdTree<pcl::PointXYZ>::Ptr tree, float co, double rad, int start, int e, QObject *parent = 0);
+		const SpatialIndex *index, float co, double rad, int start, int e, PAPointCloud *out, QObject *parent = 0);
 	~PointFeatureThread();
 
+	void setCurvatureCached(bool cached);
+
+	/* Write the features of points [begin, end] of cloud to the columns of part, index holds the points of cloud,
+	 * the curvature column is left untouched if curvature is false */
+	static void estimateRange(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, const SpatialIndex *index,
+		double search_radius, int begin, int end, PAPointCloud *features, int part, bool curvature = true);
+
 signals:
-	void estimateCompleted(int id, QList<QVector<double>> points_feats);
-	void addDebugText(QString text);
+	void estimateCompleted(int id);
 
 protected:
 	void run();
@@ -31,15 +41,17 @@ protected:
 private:
 	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud;
 	pcl::PointCloud<pcl::Normal>::Ptr normals;
-	pcl::search::KdTree<pcl::PointXYZ>::Ptr kdtree;
+	const SpatialIndex *index;
 	int begin;
 	int end;
 	int id;
 	int superid;
 	float coef;
 	double radius;
+	PAPointCloud *features;    /* Shared output, the thread writes rows [begin, end] of the columns of part superid */
+	bool curvature_cached;    /* The curvatures have been loaded from the DerivedCache */
 
-	void estimate(QList<QVector<double>> &points_feats);
+	void estimate();
 };
 
 #endif // POINTFEATURETHREAD_H
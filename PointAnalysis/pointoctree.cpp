@@ -0,0 +1,276 @@
+#include "pointoctree.h"
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <cstring>
+
+#define BUDGET_PASSES 8    /* Tries of scaling the detail levels down to the point budget */
+
+PointOctree::PointOctree()
+{
+}
+
+PointOctree::~PointOctree()
+{
+}
+
+PointOctree * PointOctree::build(const float *data, int stride, int npoints)
+{
+	PointOctree *octree = new PointOctree();
+	octree->m_order.resize(npoints);
+	for (int i = 0; i < npoints; i++)
+		octree->m_order[i] = i;
+	if (npoints == 0)
+		return octree;
+
+	float min[3], max[3];
+	for (int k = 0; k < 3; k++)
+		min[k] = max[k] = data[k];
+	for (int i = 1; i < npoints; i++)
+	{
+		const float *p = data + (long long)i * stride;
+		for (int k = 0; k < 3; k++)
+		{
+			min[k] = std::min(min[k], p[k]);
+			max[k] = std::max(max[k], p[k]);
+		}
+	}
+
+	std::vector<int> buffer(npoints);
+	octree->buildNode(data, stride, 0, npoints, min, max, 0, buffer);
+
+	octree->m_ranks.resize(npoints);
+	for (int i = 0; i < npoints; i++)
+		octree->m_ranks[octree->m_order[i]] = i;
+	return octree;
+}
+
+int PointOctree::buildNode(const float *data, int stride, int first, int count, const float min[3], const float max[3], int depth, std::vector<int> &buffer)
+{
+	int index = m_nodes.size();
+	m_nodes.push_back(Node());
+	Node node;
+	node.first = first;
+	node.count = count;
+	node.chunk = -1;
+	for (int o = 0; o < 8; o++)
+		node.children[o] = -1;
+
+	/* Tight bounds of the points, the cell bounds only decide how they are split */
+	const float *p0 = data + (long long)m_order[first] * stride;
+	for (int k = 0; k < 3; k++)
+		node.min[k] = node.max[k] = p0[k];
+	for (int i = first + 1; i < first + count; i++)
+	{
+		const float *p = data + (long long)m_order[i] * stride;
+		for (int k = 0; k < 3; k++)
+		{
+			node.min[k] = std::min(node.min[k], p[k]);
+			node.max[k] = std::max(node.max[k], p[k]);
+		}
+	}
+
+	if (count <= LOD_CHUNK_POINTS || depth >= LOD_MAX_DEPTH)
+	{
+		/* A leaf: shuffle its points so the prefixes are its detail levels */
+		std::mt19937 generator(first);
+		std::shuffle(m_order.begin() + first, m_order.begin() + first + count, generator);
+
+		Chunk chunk;
+		chunk.first = first;
+		chunk.count = count;
+		float sqr_radius = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			chunk.center[k] = (node.min[k] + node.max[k]) / 2;
+			sqr_radius += (node.max[k] - chunk.center[k]) * (node.max[k] - chunk.center[k]);
+		}
+		chunk.radius = std::sqrt(sqr_radius);
+		node.chunk = m_chunks.size();
+		m_chunks.push_back(chunk);
+		m_nodes[index] = node;
+		return index;
+	}
+
+	/* Counting sort of the points by the octant of the cell they fall in */
+	float mid[3];
+	for (int k = 0; k < 3; k++)
+		mid[k] = (min[k] + max[k]) / 2;
+	int starts[9] = { 0 };
+	for (int i = first; i < first + count; i++)
+	{
+		const float *p = data + (long long)m_order[i] * stride;
+		int octant = (p[0] > mid[0] ? 1 : 0) | (p[1] > mid[1] ? 2 : 0) | (p[2] > mid[2] ? 4 : 0);
+		starts[octant + 1]++;
+	}
+	for (int o = 0; o < 8; o++)
+		starts[o + 1] += starts[o];
+	int offsets[8];
+	memcpy(offsets, starts, sizeof(offsets));
+	for (int i = first; i < first + count; i++)
+	{
+		const float *p = data + (long long)m_order[i] * stride;
+		int octant = (p[0] > mid[0] ? 1 : 0) | (p[1] > mid[1] ? 2 : 0) | (p[2] > mid[2] ? 4 : 0);
+		buffer[first + offsets[octant]++] = m_order[i];
+	}
+	std::copy(buffer.begin() + first, buffer.begin() + first + count, m_order.begin() + first);
+
+	/* The children in octant order, so the leaves are in the octree order of the points */
+	m_nodes[index] = node;
+	for (int o = 0; o < 8; o++)
+	{
+		if (starts[o + 1] == starts[o])
+			continue;
+		float child_min[3], child_max[3];
+		for (int k = 0; k < 3; k++)
+		{
+			bool upper = ((o >> k) & 1) != 0;
+			child_min[k] = upper ? mid[k] : min[k];
+			child_max[k] = upper ? max[k] : mid[k];
+		}
+		int child = buildNode(data, stride, first + starts[o], starts[o + 1] - starts[o], child_min, child_max, depth + 1, buffer);
+		m_nodes[index].children[o] = child;
+	}
+	return index;
+}
+
+void PointOctree::gather(const float *data, int stride, int components, int first, int count, float *out) const
+{
+	for (int i = 0; i < count; i++)
+		memcpy(out + (long long)i * components, data + (long long)m_order[first + i] * stride, components * sizeof(float));
+}
+
+void PointOctree::gather(const unsigned char *data, int first, int count, unsigned char *out) const
+{
+	for (int i = 0; i < count; i++)
+		out[i] = data[m_order[first + i]];
+}
+
+int PointOctree::chunkAt(int i) const
+{
+	/* The last chunk starting at or before i */
+	int low = 0, high = m_chunks.size() - 1;
+	while (low < high)
+	{
+		int mid = (low + high + 1) / 2;
+		if (m_chunks[mid].first <= i)
+			low = mid;
+		else
+			high = mid - 1;
+	}
+	return low;
+}
+
+void PointOctree::cull(int node_index, const float planes[6][4], bool inside, std::vector<int> &visible) const
+{
+	const Node &node = m_nodes[node_index];
+	if (!inside)
+	{
+		inside = true;
+		for (int i = 0; i < 6; i++)
+		{
+			const float *plane = planes[i];
+			/* The corners of the box furthest along and against the normal of the plane */
+			float far_distance = plane[3], near_distance = plane[3];
+			for (int k = 0; k < 3; k++)
+			{
+				far_distance += plane[k] * (plane[k] > 0 ? node.max[k] : node.min[k]);
+				near_distance += plane[k] * (plane[k] > 0 ? node.min[k] : node.max[k]);
+			}
+			if (far_distance < 0)
+				return;
+			if (near_distance < 0)
+				inside = false;
+		}
+	}
+
+	if (node.chunk >= 0)
+	{
+		visible.push_back(node.chunk);
+		return;
+	}
+	for (int o = 0; o < 8; o++)
+	{
+		if (node.children[o] >= 0)
+			cull(node.children[o], planes, inside, visible);
+	}
+}
+
+int PointOctree::levelCount(int count, float wanted)
+{
+	/* The smallest level with at least the wanted points */
+	int level_count = count;
+	for (int level = 1; level < LOD_LEVELS && (level_count >> 2) >= wanted; level++)
+		level_count >>= 2;
+	return std::max(level_count, std::min(count, LOD_MIN_CHUNK_POINTS));
+}
+
+int PointOctree::select(const QMatrix4x4 &mvp, const QMatrix4x4 &mv, float pixels_per_unit, int budget, QVector<QPair<int, int>> &ranges) const
+{
+	ranges.clear();
+	if (m_nodes.empty())
+		return 0;
+
+	/* The planes of the frustum, a point p is inside if dot(plane, (p, 1)) >= 0 for all of them */
+	float planes[6][4];
+	QVector4D w = mvp.row(3);
+	for (int i = 0; i < 3; i++)
+	{
+		QVector4D r = mvp.row(i);
+		QVector4D lower = w + r, upper = w - r;
+		for (int k = 0; k < 4; k++)
+		{
+			planes[2 * i][k] = lower[k];
+			planes[2 * i + 1][k] = upper[k];
+		}
+	}
+
+	std::vector<int> visible;
+	cull(0, planes, false, visible);
+
+	/* The points a chunk deserves by the area of its projected bounding sphere */
+	const float PI_F = 3.14159265f;
+	std::vector<float> wanted(visible.size());
+	for (int i = 0; i < (int)visible.size(); i++)
+	{
+		const Chunk &chunk = m_chunks[visible[i]];
+		float distance = -(mv * QVector3D(chunk.center[0], chunk.center[1], chunk.center[2])).z();
+		if (pixels_per_unit <= 0 || distance <= chunk.radius)
+			wanted[i] = (float)chunk.count;
+		else
+		{
+			float projected_radius = chunk.radius * pixels_per_unit / distance;
+			wanted[i] = PI_F * projected_radius * projected_radius / LOD_PIXELS_PER_POINT;
+		}
+	}
+
+	/* Scale the levels down until they fit the budget */
+	std::vector<int> counts(visible.size());
+	float scale = 1;
+	long long total = 0;
+	for (int pass = 0; pass < BUDGET_PASSES; pass++)
+	{
+		total = 0;
+		for (int i = 0; i < (int)visible.size(); i++)
+		{
+			counts[i] = levelCount(m_chunks[visible[i]].count, wanted[i] * scale);
+			total += counts[i];
+		}
+		if (budget <= 0 || total <= budget)
+			break;
+		scale *= (float)budget / total;
+	}
+
+	/* Chunks drawn whole that follow each other are drawn at once */
+	bool extendable = false;    /* The last range ends with a whole chunk */
+	for (int i = 0; i < (int)visible.size(); i++)
+	{
+		const Chunk &chunk = m_chunks[visible[i]];
+		if (extendable && ranges.last().first + ranges.last().second == chunk.first)
+			ranges.last().second += counts[i];
+		else
+			ranges.push_back(QPair<int, int>(chunk.first, counts[i]));
+		extendable = counts[i] == chunk.count;
+	}
+	return (int)total;
+}
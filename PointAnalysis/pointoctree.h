@@ -0,0 +1,81 @@
+#ifndef POINTOCTREE_H
+#define POINTOCTREE_H
+
+#include <QMatrix4x4>
+#include <QPair>
+#include <QVector>
+#include <vector>
+
+#define LOD_CHUNK_POINTS 16384    /* Most points in a leaf chunk of the octree */
+#define LOD_MAX_DEPTH 16
+#define LOD_LEVELS 6    /* Detail levels of a chunk, each a quarter of the points of the previous one */
+#define LOD_PIXELS_PER_POINT 4.0    /* Screen area a drawn point is given, in pixels */
+#define LOD_MIN_CHUNK_POINTS 64    /* Fewest points drawn of a visible chunk */
+
+/*
+ * Octree over the points of a model for level-of-detail rendering. The points are reordered so
+ * that every node covers a contiguous range of them and the points of each leaf chunk are
+ * shuffled: any prefix of a chunk is an even subsample of it, so the detail levels of a chunk
+ * are the prefixes of 1, 1/4, 1/16... of its points and need no storage of their own.
+ * Selecting the chunks to draw culls the octree against the view frustum, gives each visible
+ * chunk the level its projected size calls for and scales the levels down to the point budget.
+ */
+class PointOctree
+{
+public:
+	~PointOctree();
+
+	/* Build from npoints points, point i being (data[i * stride], data[i * stride + 1], data[i * stride + 2]) */
+	static PointOctree * build(const float *data, int stride, int npoints);
+
+	int size() const { return m_order.size(); }
+	int chunkCount() const { return m_chunks.size(); }
+	/* The index in the model of the point at position i of the octree order, and the other way round */
+	int pointAt(int i) const { return m_order[i]; }
+	int rankOf(int point) const { return m_ranks[point]; }
+	/* The chunk of the point at position i of the octree order, and the range of a chunk */
+	int chunkAt(int i) const;
+	int chunkFirst(int chunk) const { return m_chunks[chunk].first; }
+	int chunkSize(int chunk) const { return m_chunks[chunk].count; }
+	/* Copy the first components floats of the records of stride floats of the points in
+	 * [first, first + count) of the octree order to out, packed */
+	void gather(const float *data, int stride, int components, int first, int count, float *out) const;
+	/* Copy the bytes of the points in [first, first + count) of the octree order to out */
+	void gather(const unsigned char *data, int first, int count, unsigned char *out) const;
+
+	/* Ranges (first, count) of the octree order to draw, merged where contiguous.
+	 * mvp: model to clip coordinates, mv: model to eye coordinates, pixels_per_unit: projected
+	 * size in pixels of one unit at distance 1 from the eye, 0 to draw the visible chunks whole */
+	int select(const QMatrix4x4 &mvp, const QMatrix4x4 &mv, float pixels_per_unit, int budget, QVector<QPair<int, int>> &ranges) const;
+
+private:
+	struct Node
+	{
+		float min[3];
+		float max[3];
+		int first;    /* Range of the points of the node in the octree order */
+		int count;
+		int children[8];    /* -1 where there is no child */
+		int chunk;    /* Index of the chunk of a leaf, -1 for an inner node */
+	};
+
+	struct Chunk
+	{
+		int first;
+		int count;
+		float center[3];
+		float radius;    /* Of the bounding sphere of the chunk */
+	};
+
+	std::vector<Node> m_nodes;    /* The root first */
+	std::vector<Chunk> m_chunks;    /* In the octree order */
+	std::vector<int> m_order;
+	std::vector<int> m_ranks;    /* The position in m_order of each point */
+
+	PointOctree();
+	int buildNode(const float *data, int stride, int first, int count, const float min[3], const float max[3], int depth, std::vector<int> &buffer);
+	void cull(int node, const float planes[6][4], bool inside, std::vector<int> &visible) const;
+	static int levelCount(int count, float wanted);
+};
+
+#endif // POINTOCTREE_H
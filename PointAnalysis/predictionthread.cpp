@@ -1,13 +1,15 @@
 #include "predictionthread.h"
 
 PredictionThread::PredictionThread(QObject *parent)
-	: QThread(parent), m_is_clean(true)
+	: QThread(parent), mrf(NULL), m_session(NULL), m_warm_start(false), m_is_clean(true), m_potentials_given(false), m_stage_begin(0),
+	m_time_budget(TRWS_TIME_BUDGET), m_trws_time(0), m_iteration_begin(0)
 {
 	qRegisterMetaType<QMap<int, int>>("PartsPicked");
 }
 
 PredictionThread::PredictionThread(EnergyFunctions *energy_functions, Part_Candidates part_candidates, QList<int> label_names, QObject *parent)
-	: QThread(parent), m_is_clean(true)
+	: QThread(parent), mrf(NULL), m_session(NULL), m_warm_start(false), m_is_clean(true), m_potentials_given(false), m_stage_begin(0),
+	m_time_budget(TRWS_TIME_BUDGET), m_trws_time(0), m_iteration_begin(0)
 {
 	m_energy_functions = energy_functions;
 	m_ncandidates = part_candidates.size();
@@ -50,18 +52,31 @@ PredictionThread::~PredictionThread()
 	m_pairwise_threads.clear();
 }
 
+void PredictionThread::cancel()
+{
+	/* A term thread computes a range of the candidates, not long; TRW-S stops at its next iteration */
+	for (int i = 0; i < m_unary_threads.size(); i++)
+	{
+		if (m_unary_threads[i] != NULL)
+			m_unary_threads[i]->wait();
+	}
+	for (int i = 0; i < m_pairwise_threads.size(); i++)
+	{
+		if (m_pairwise_threads[i] != NULL)
+			m_pairwise_threads[i]->wait();
+	}
+	requestInterruption();
+	wait();
+}
+
 void PredictionThread::clean()
 {
 	if (mrf != NULL)
 	{
-		delete(mrf);
+		if (mrf != m_session)
+			delete(mrf);
 		mrf = NULL;
 	}
-	if (nodes != NULL)
-	{
-		delete(nodes);
-		nodes = NULL;
-	}
 
 	m_is_clean = true;
 }
@@ -74,22 +89,50 @@ void PredictionThread::run()
 
 void PredictionThread::predictLabelsAndOrientations()
 {
-	MRFEnergy<TypeGeneral>::Options options;
+	MRFSolver::Options options;
 	TypeGeneral::REAL energy, lowerBound;
 
 	const int nodeNum = m_ncandidates;   /* the number of nodes */
 	const int labelNum = m_label_names.size();   /* the number of labels */
 
-	/* Function below is optional - it may help if, for example, nodes are added in a random order */
-	mrf->SetAutomaticOrdering();
+	if (!m_warm_start)
+	{
+		/* Function below is optional - it may help if, for example, nodes are added in a random order */
+		mrf->setAutomaticOrdering();
+	}
 
 	/* Execute TRW-S algorithm */
-	options.m_iterMax = 100; // maximum number of iterations
-	options.m_printIter = 10;
+	options.m_iterMax = TRWS_MAX_ITER; // maximum number of iterations
+	options.m_gapEps = TRWS_GAP_EPS;
+	options.m_stagnationIter = TRWS_STAGNATION_ITER;
+	options.m_stagnationEps = TRWS_STAGNATION_EPS;
+	options.m_timeMax = m_time_budget;
+	options.m_printIter = 1;    /* computing the energy costs about 1/K of an iteration */
 	options.m_printMinIter = 0;
-	mrf->ZeroMessages();
-	mrf->AddRandomMessages(0, 0.0, 1.0);
-	mrf->Minimize_TRW_S(options, lowerBound, energy);
+	options.m_iterFn = &PredictionThread::onIteration;
+	options.m_iterFnData = this;
+	options.m_threadNum = QThread::idealThreadCount(); // pass the messages of one node in parallel
+	if (m_warm_start)
+	{
+		/* Keep the messages of the previous prediction */
+		LOG_INFO(Logger::Inference, "TRW-S warm start, %d potential tables changed.", m_changed_tables);
+	}
+	else
+	{
+		mrf->zeroMessages();
+		mrf->addRandomMessages(0, 0.0, 1.0);
+	}
+	int iter;
+	m_trws_time = 0;
+	{
+		TRACE_SCOPE("trws");
+		m_iteration_begin = Tracer::now();
+		iter = mrf->minimize_TRW_S(options, lowerBound, energy);
+	}
+	double gap = energy != 0 ? (double)(energy - lowerBound) / fabs((double)energy) : (double)(energy - lowerBound);
+	bool over_budget = m_time_budget > 0 && m_trws_time >= m_time_budget;
+	LOG_INFO(Logger::Inference, "TRW-S stopped after %d iterations in %.3f s%s: lower bound = %g, energy = %g, relative gap = %g (%g to stop).",
+		iter, m_trws_time, over_budget ? " (time budget reached)" : "", (double)lowerBound, (double)energy, gap, (double)TRWS_GAP_EPS);
 
 	/* Read soluntions */
 	std::vector<int> labels(nodeNum);
@@ -98,21 +141,84 @@ void PredictionThread::predictLabelsAndOrientations()
 
 	for (int i = 0; i < nodeNum; i++)
 	{
-		labels[i] = mrf->GetSolution(nodes[i]);
+		labels[i] = mrf->getSolution(i);
 		if (labels[i] != null_label)
 		{
 			//assert(parts_picked.contains(labels[i]));
 			if (parts_picked.contains(labels[i]))
-				qDebug() << "parts_picked.contains(labels[i])!";
+				LOG_WARNING(Logger::Inference, "Part label %d is picked by more than one candidate.", labels[i]);
 			else
 				parts_picked.insert(labels[i], i);
-			std::cout << "Part label " << labels[i] << " corresponds to Candidate-" << i << std::endl;
+			LOG_DEBUG(Logger::Inference, "Part label %d corresponds to Candidate-%d.", labels[i], i);
 		}
 	}
 
+	/* TRW-S was stopped by cancel(), the solution is of no use */
+	if (isInterruptionRequested())
+		return;
 	emit predictionDone(parts_picked);
 }
 
+bool PredictionThread::onIteration(void *data, int iter, TypeGeneral::REAL lower_bound, TypeGeneral::REAL energy, double time)
+{
+	PredictionThread *thread = (PredictionThread *)data;
+	LOG_DEBUG(Logger::Inference, "TRW-S iteration %d: lower bound %f, energy %f, %.3f s.", iter, (double)lower_bound, (double)energy, time);
+	thread->m_trws_time = time;
+#if TRACE_ENABLED
+	/* The count and mean time of the iterations in the summary of the trace */
+	long long now = Tracer::now();
+	Tracer::record("trws iteration", thread->m_iteration_begin, now);
+	thread->m_iteration_begin = now;
+#endif
+
+	return !thread->isInterruptionRequested();
+}
+
+void PredictionThread::setTimeBudget(double seconds)
+{
+	m_time_budget = seconds;
+}
+
+void PredictionThread::setInferenceSession(MRFSolver *session)
+{
+	m_session = session;
+}
+
+void PredictionThread::setPotentials(QVector<double> unary, QVector<double> pairwise)
+{
+	int labelNum = m_label_names.size();
+	if (unary.size() != m_ncandidates * labelNum
+		|| pairwise.size() != m_ncandidates * (m_ncandidates - 1) / 2 * labelNum * labelNum)
+	{
+		LOG_WARNING(Logger::Inference, "PredictionThread: the potential tables don't match the candidates, computing them again.");
+		return;
+	}
+	m_unary_table = unary;
+	m_pairwise_table = pairwise;
+	m_potentials_given = true;
+}
+
+int PredictionThread::pairIndex(int i, int j) const
+{
+	return i * m_ncandidates - i * (i + 1) / 2 + (j - i - 1);
+}
+
+void PredictionThread::setNode(int node_idx, TypeGeneral::REAL *D)
+{
+	if (!m_warm_start)
+		mrf->addNode(node_idx, D);
+	else if (mrf->updateNode(node_idx, D))
+		m_changed_tables++;
+}
+
+void PredictionThread::setEdge(int i, int j, TypeGeneral::REAL *V)
+{
+	if (!m_warm_start)
+		mrf->addEdge(i, j, V);
+	else if (mrf->updateEdge(i, j, V))
+		m_changed_tables++;
+}
+
 void PredictionThread::execute()
 {
 	if (!m_is_clean)
@@ -124,10 +230,37 @@ void PredictionThread::execute()
 	const int nodeNum = m_ncandidates;   /* the number of nodes */
 	int num_of_classes = labelNum - 1;    /* '-1' is to remove the null label */
 
-	mrf = new MRFEnergy<TypeGeneral>(TypeGeneral::GlobalSize());
-	nodes = new MRFEnergy<TypeGeneral>::NodeId[nodeNum];
+	if (m_session != NULL)
+	{
+		assert(m_session->labelNum() == labelNum && m_session->nodeNum() == nodeNum);
+		mrf = m_session;
+		m_warm_start = m_session->isWarm();    /* otherwise the session is empty and built below */
+	}
+	else
+	{
+		mrf = createMRFSolver(labelNum, nodeNum);
+		m_warm_start = false;
+	}
+	m_changed_tables = 0;
+	if (mrf->isFixedLabelNum())
+		LOG_DEBUG(Logger::Inference, "Using MRF energy specialized for %d labels.", labelNum);
 	m_is_clean = false;
 
+	if (m_potentials_given)
+	{
+		LOG_INFO(Logger::Inference, "Use the potentials computed before.");
+		for (int i = 0; i < nodeNum; i++)
+			setNode(i, m_unary_table.data() + i * labelNum);
+		for (int i = 0; i < nodeNum; i++)
+			for (int j = i + 1; j < nodeNum; j++)
+				setEdge(i, j, m_pairwise_table.data() + pairIndex(i, j) * labelNum * labelNum);
+		start();
+		return;
+	}
+	m_stage_begin = Tracer::now();
+	m_unary_table.resize(nodeNum * labelNum);
+	m_pairwise_table.resize(nodeNum * (nodeNum - 1) / 2 * labelNum * labelNum);
+
 	/* Create 8 subthreads to set unary potentials */
 	int num_of_rounds, candidates_num_per_thread;
 	if (nodeNum > NUM_OF_SUBTHREADS)
@@ -174,9 +307,17 @@ void PredictionThread::execute()
 	//std::cout << "Duration = " << end_time - start_time << " ms." << std::endl;
 }
 
+QString PredictionThread::potentialsText(const double *D, int labelNum)
+{
+	QString text;
+	for (int j = 0; j < labelNum; j++)
+		text.append((j > 0 ? " " : "") + QString::number(D[j]));
+	return text;
+}
+
 void PredictionThread::onGetUnaryPotentials(int id, int start_idx, Unary_Potentials unary_potentials)
 {
-	qDebug("Received unary potentials of Node-%d to Node-%d from UnaryTermThread-%d.", start_idx, start_idx + unary_potentials.size() - 1, id);
+	LOG_DEBUG(Logger::Inference, "Received unary potentials of Node-%d to Node-%d from UnaryTermThread-%d.", start_idx, start_idx + unary_potentials.size() - 1, id);
 	
 	int labelNum = m_label_names.size();
 	int count = 0;
@@ -184,13 +325,10 @@ void PredictionThread::onGetUnaryPotentials(int id, int start_idx, Unary_Potenti
 	{
 		TypeGeneral::REAL *D = *it;
 		int node_idx = start_idx + count;
-		nodes[node_idx] = mrf->AddNode(TypeGeneral::LocalSize(labelNum), TypeGeneral::NodeData(D));
-
-		QString unary_potential_str = "Add Node_" + QString::number(node_idx) + ": ";
-		for (int j = 0; j < labelNum - 1; j++)
-			unary_potential_str.append(QString::number(D[j]) + " ");
-		unary_potential_str.append(QString::number(D[labelNum - 1]));
-		qDebug() << unary_potential_str;
+		setNode(node_idx, D);
+		memcpy(m_unary_table.data() + node_idx * labelNum, D, labelNum * sizeof(double));
+		/* The text of the potentials is only built when the debug messages are read */
+		LOG_DEBUG(Logger::Inference, "Add Node_%d: %s", node_idx, qPrintable(potentialsText(D, labelNum)));
 
 		count++;
 		delete(D);
@@ -201,7 +339,10 @@ void PredictionThread::onGetUnaryPotentials(int id, int start_idx, Unary_Potenti
 	/* If it is the last thread to compute unary potentials, then start threads to compute pairwise potentials */
 	if (unfinished_unary_threads == 0)
 	{
-		qDebug() << "The unary potentials setting done.";
+		LOG_INFO(Logger::Inference, "The unary potentials setting done.");
+#if TRACE_ENABLED
+		Tracer::record("unary stage", m_stage_begin, Tracer::now());
+#endif
 
 		const int NUM_OF_SUBTHREADS = 16;
 		int num_of_cands = m_part_candidates.size();
@@ -214,7 +355,7 @@ void PredictionThread::onGetUnaryPotentials(int id, int start_idx, Unary_Potenti
 
 		int start_idx = 0;
 		int i;
-		start_time = Utils::getCurrentTime();
+		m_stage_begin = Tracer::now();
 		for (i = 0; i < NUM_OF_SUBTHREADS && start_idx < num_of_cands; i++)
 		{
 			int end;
@@ -248,8 +389,9 @@ void PredictionThread::onGetUnaryPotentials(int id, int start_idx, Unary_Potenti
 
 void PredictionThread::onGetPairwisePotentials(int id, int start_idx, Pairwise_Potentials pairwise_potentials)
 {
-	qDebug("Received pairwise potentials of Node-%d to Node-%d from PairwiseTermThread-%d.", start_idx, start_idx + pairwise_potentials.size() - 1, id);
+	LOG_DEBUG(Logger::Inference, "Received pairwise potentials of Node-%d to Node-%d from PairwiseTermThread-%d.", start_idx, start_idx + pairwise_potentials.size() - 1, id);
 
+	int labelNum = m_label_names.size();
 	int outter_count = 0;
 	for (Pairwise_Potentials::iterator outter_it = pairwise_potentials.begin(); outter_it != pairwise_potentials.end(); ++outter_it)
 	{
@@ -262,7 +404,8 @@ void PredictionThread::onGetPairwisePotentials(int id, int start_idx, Pairwise_P
 			double * V = *inner_it;
 			int second_cand_idx = first_cand_idx + inner_count;
 
-			mrf->AddEdge(nodes[first_cand_idx], nodes[second_cand_idx], TypeGeneral::EdgeData(TypeGeneral::GENERAL, V));
+			setEdge(first_cand_idx, second_cand_idx, V);
+			memcpy(m_pairwise_table.data() + pairIndex(first_cand_idx, second_cand_idx) * labelNum * labelNum, V, labelNum * labelNum * sizeof(double));
 
 			inner_count++;
 			delete(V);
@@ -275,10 +418,13 @@ void PredictionThread::onGetPairwisePotentials(int id, int start_idx, Pairwise_P
 
 	if (unfinished_pairwise_threads == 0)
 	{
-		qDebug() << "The pairwise potentials setting done.";
-		end_time = Utils::getCurrentTime();
-		int duration = end_time - start_time;
-		qDebug("Time spent: %d ms.", duration);
+		LOG_INFO(Logger::Inference, "The pairwise potentials setting done.");
+		long long end = Tracer::now();
+#if TRACE_ENABLED
+		Tracer::record("pairwise stage", m_stage_begin, end);
+#endif
+		LOG_INFO(Logger::Inference, "Pairwise potentials computed in %lld ms.", (end - m_stage_begin) / 1000000);
+		emit potentialsReady(m_unary_table, m_pairwise_table);
 		start();
 	}
 }
\ No newline at end of file
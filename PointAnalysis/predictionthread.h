@@ -6,11 +6,18 @@
 #include <qvector.h>
 #include <assert.h>
 #include "gencandidatesthread.h"
-#include "MRFEnergy.h"
+#include "mrfsolver.h"
 #include "energyfunctions.h"
 #include "pairwisetermthread.h"
 #include "unarytermthread.h"
 
+/* Stopping criteria of TRW-S (see MRFEnergy::Options) */
+#define TRWS_MAX_ITER 100
+#define TRWS_GAP_EPS 1e-3    /* relative gap between energy and lower bound */
+#define TRWS_STAGNATION_ITER 10
+#define TRWS_STAGNATION_EPS 1e-5
+#define TRWS_TIME_BUDGET 5.0    /* seconds per model by default, see setTimeBudget() */
+
 /*
  * The sub thread used to do  part lebels and orientations prediction. 
  */
@@ -24,6 +31,15 @@ public:
 	~PredictionThread();
 
 	void execute();
+	void cancel();    /* Stops the computing of the potentials and TRW-S and waits for them, predictionDone is not emitted */
+	/* Use an inference session kept by the caller instead of a new MRF (the thread does not delete it).
+	 * The session must be empty or minimized before with the same numbers of labels and candidates;
+	 * in the latter case only the changed tables are replaced and TRW-S starts from the previous messages. */
+	void setInferenceSession(MRFSolver *session);
+	/* Minimize over potential tables computed before (see potentialsReady()) instead of computing them */
+	void setPotentials(QVector<double> unary, QVector<double> pairwise);
+	/* Wall clock seconds TRW-S may run, 0 for no limit */
+	void setTimeBudget(double seconds);
 
 	public slots:
 	void onGetUnaryPotentials(int id, int start_idx, Unary_Potentials unary_potentials);
@@ -32,6 +48,10 @@ public:
 
 signals:
 	void predictionDone(QMap<int, int> parts_picked);
+	/* All the potentials, emitted before the minimization.
+	 * unary - nodeNum x labelNum tables, node by node.
+	 * pairwise - labelNum x labelNum tables of the pairs (i, j > i), in the order of i then j. */
+	void potentialsReady(QVector<double> unary, QVector<double> pairwise);
 	//void predictionDone();
 	//void testSignal();
 
@@ -45,16 +65,28 @@ private:
 	EnergyFunctions *m_energy_functions;
 	QVector<PairwiseTermThread *> m_pairwise_threads;
 	QVector<UnaryTermThread *> m_unary_threads;
-	MRFEnergy<TypeGeneral>* mrf;
-	MRFEnergy<TypeGeneral>::NodeId* nodes;
+	MRFSolver *mrf;    /* MRFEnergy specialized for the number of labels */
+	MRFSolver *m_session;
+	bool m_warm_start;
+	int m_changed_tables;
 	int unfinished_unary_threads;
 	int unfinished_pairwise_threads;
 	bool m_is_clean;
-	long start_time;
-	long end_time;
+	QVector<double> m_unary_table;
+	QVector<double> m_pairwise_table;
+	bool m_potentials_given;    /* The tables were set by setPotentials() */
+	long long m_stage_begin;    /* Tracer::now() when the unary or the pairwise stage started */
+	double m_time_budget;
+	double m_trws_time;    /* s, at the last iteration of TRW-S */
+	long long m_iteration_begin;    /* Tracer::now() when the current iteration of TRW-S started */
 
 	void predictLabelsAndOrientations();
 	void clean();
+	int pairIndex(int i, int j) const;
+	void setNode(int node_idx, TypeGeneral::REAL *D);
+	void setEdge(int i, int j, TypeGeneral::REAL *V);
+	static QString potentialsText(const double *D, int labelNum);
+	static bool onIteration(void *data, int iter, TypeGeneral::REAL lower_bound, TypeGeneral::REAL energy, double time);
 	
 };
 
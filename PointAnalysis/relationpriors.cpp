@@ -0,0 +1,242 @@
+#include "relationpriors.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <QDebug>
+
+#define MAX_REGULARIZATION_STEPS 12    /* Tries of growing regularizations of a covariance that is not positive definite */
+
+RelationPriors::RelationPriors() : m_file(NULL), m_header(NULL), m_entries(NULL), m_means(NULL), m_covariances(NULL), m_factors(NULL)
+{
+}
+
+RelationPriors::~RelationPriors()
+{
+	if (m_file != NULL)
+	{
+		m_file->close();    /* Unmaps the file */
+		delete(m_file);
+		m_file = NULL;
+	}
+}
+
+long long RelationPriors::bufferSize(int npairs)
+{
+	const int D = RELATION_PRIORS_DIMENSION;
+	return sizeof(Header) + (long long)npairs * (sizeof(Entry) + (D + 2 * D * D) * sizeof(float));
+}
+
+bool RelationPriors::attach(const char *data, long long size)
+{
+	if (size < (long long)sizeof(Header))
+		return false;
+
+	const Header *header = (const Header *)data;
+	if (header->magic != RELATION_PRIORS_MAGIC || header->version != RELATION_PRIORS_VERSION
+		|| header->dimension != RELATION_PRIORS_DIMENSION || header->npairs < 0 || size != bufferSize(header->npairs))
+		return false;
+
+	const int D = RELATION_PRIORS_DIMENSION;
+	m_header = header;
+	m_entries = (const Entry *)(data + sizeof(Header));
+	m_means = (const float *)(m_entries + header->npairs);
+	m_covariances = m_means + (long long)header->npairs * D;
+	m_factors = m_covariances + (long long)header->npairs * D * D;
+	return true;
+}
+
+RelationPriors * RelationPriors::build(const QMap<QPair<int, int>, Eigen::VectorXd> &means, const QMap<QPair<int, int>, Eigen::MatrixXd> &covariances)
+{
+	const int D = RELATION_PRIORS_DIMENSION;
+
+	/* The pairs with both a mean and a covariance, sorted by labels as the keys of QMap */
+	QList<QPair<int, int>> label_pairs;
+	for (QMap<QPair<int, int>, Eigen::VectorXd>::const_iterator it = means.begin(); it != means.end(); ++it)
+	{
+		if (it.value().size() == D && covariances.contains(it.key())
+			&& covariances.value(it.key()).rows() == D && covariances.value(it.key()).cols() == D)
+			label_pairs.push_back(it.key());
+	}
+	int npairs = label_pairs.size();
+
+	Header header;
+	header.magic = RELATION_PRIORS_MAGIC;
+	header.version = RELATION_PRIORS_VERSION;
+	header.dimension = D;
+	header.npairs = npairs;
+
+	RelationPriors *priors = new RelationPriors();
+	long long size = bufferSize(npairs);
+	priors->m_buffer.resize(size);
+	char *data = priors->m_buffer.data();
+	memcpy(data, &header, sizeof(Header));
+	priors->attach(data, size);
+
+	Entry *entries = (Entry *)priors->m_entries;
+	float *mean_data = (float *)priors->m_means;
+	float *covariance_data = (float *)priors->m_covariances;
+	float *factor_data = (float *)priors->m_factors;
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int i = 0; i < npairs; i++)
+	{
+		Eigen::VectorXd mean = means.value(label_pairs[i]);
+		Eigen::MatrixXd covariance = covariances.value(label_pairs[i]);
+
+		/* Regularize the covariance until it can be factorized */
+		double regularization = 0;
+		Eigen::LLT<Eigen::MatrixXd> llt(covariance);
+		double scale = std::max(covariance.trace() / D, 1e-12);
+		for (int step = 0; llt.info() != Eigen::Success && step < MAX_REGULARIZATION_STEPS; step++)
+		{
+			regularization = scale * std::pow(10.0, step - 8);
+			llt.compute(covariance + regularization * Eigen::MatrixXd::Identity(D, D));
+		}
+		if (llt.info() != Eigen::Success)
+			qDebug("RelationPriors: the covariance of (%d, %d) is not positive definite.", label_pairs[i].first, label_pairs[i].second);
+		Eigen::MatrixXd factor = llt.matrixL();
+
+		entries[i].label1 = label_pairs[i].first;
+		entries[i].label2 = label_pairs[i].second;
+		entries[i].log_det = (float)(2.0 * factor.diagonal().array().log().sum());
+		entries[i].regularization = (float)regularization;
+		Eigen::Map<Eigen::VectorXf>(mean_data + (long long)i * D, D) = mean.cast<float>();
+		Eigen::Map<Eigen::MatrixXf>(covariance_data + (long long)i * D * D, D, D) = covariance.cast<float>();
+		Eigen::Map<Eigen::MatrixXf>(factor_data + (long long)i * D * D, D, D) = factor.cast<float>();
+	}
+
+	return priors;
+}
+
+RelationPriors * RelationPriors::open(const std::string &filename)
+{
+	QFile *file = new QFile(QString::fromStdString(filename));
+	if (!file->open(QIODevice::ReadOnly))
+	{
+		delete(file);
+		return NULL;
+	}
+
+	uchar *data = file->map(0, file->size());
+	RelationPriors *priors = new RelationPriors();
+	priors->m_file = file;
+	if (data == NULL || !priors->attach((const char *)data, file->size()))
+	{
+		delete(priors);
+		return NULL;
+	}
+	return priors;
+}
+
+RelationPriors * RelationPriors::loadText(const std::string &covariance_path, const std::string &mean_path)
+{
+	const int D = RELATION_PRIORS_DIMENSION;
+	std::ifstream cov_in(covariance_path.c_str());
+	std::ifstream mean_in(mean_path.c_str());
+	if (!cov_in.is_open() || !mean_in.is_open())
+		return NULL;
+
+	/* Each prior is a line of the label pair followed by the D rows of the covariance matrix, or by the mean vector */
+	QMap<QPair<int, int>, Eigen::MatrixXd> covariances;
+	std::string line;
+	while (std::getline(cov_in, line))
+	{
+		std::istringstream labels(line);
+		int label1, label2;
+		if (!(labels >> label1 >> label2))
+			continue;
+
+		Eigen::MatrixXd covariance(D, D);
+		for (int i = 0; i < D && std::getline(cov_in, line); i++)
+		{
+			std::istringstream row(line);
+			for (int j = 0; j < D; j++)
+				row >> covariance(i, j);
+		}
+		covariances.insert(QPair<int, int>(label1, label2), covariance);
+	}
+
+	QMap<QPair<int, int>, Eigen::VectorXd> means;
+	while (std::getline(mean_in, line))
+	{
+		std::istringstream labels(line);
+		int label1, label2;
+		if (!(labels >> label1 >> label2))
+			continue;
+
+		Eigen::VectorXd mean = Eigen::VectorXd::Zero(D);
+		if (std::getline(mean_in, line))
+		{
+			std::istringstream row(line);
+			for (int j = 0; j < D; j++)
+				row >> mean(j);
+		}
+		means.insert(QPair<int, int>(label1, label2), mean);
+	}
+
+	return build(means, covariances);
+}
+
+bool RelationPriors::save(const std::string &filename) const
+{
+	std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+	out.write((const char *)m_header, bufferSize(m_header->npairs));
+	return out.good();
+}
+
+int RelationPriors::size() const
+{
+	return m_header->npairs;
+}
+
+bool RelationPriors::isMapped() const
+{
+	return m_file != NULL;
+}
+
+int RelationPriors::find(int label1, int label2) const
+{
+	/* Binary search in the table sorted by label pairs */
+	int low = 0, high = m_header->npairs - 1;
+	while (low <= high)
+	{
+		int mid = (low + high) / 2;
+		const Entry &entry = m_entries[mid];
+		if (entry.label1 == label1 && entry.label2 == label2)
+			return mid;
+		if (entry.label1 < label1 || (entry.label1 == label1 && entry.label2 < label2))
+			low = mid + 1;
+		else
+			high = mid - 1;
+	}
+	return -1;
+}
+
+const float * RelationPriors::mean(int prior) const
+{
+	return m_means + (long long)prior * RELATION_PRIORS_DIMENSION;
+}
+
+const float * RelationPriors::covariance(int prior) const
+{
+	return m_covariances + (long long)prior * RELATION_PRIORS_DIMENSION * RELATION_PRIORS_DIMENSION;
+}
+
+float RelationPriors::logDeterminant(int prior) const
+{
+	return m_entries[prior].log_det;
+}
+
+float RelationPriors::mahalanobis(int prior, const float *x) const
+{
+	const int D = RELATION_PRIORS_DIMENSION;
+	Eigen::Map<const Eigen::Matrix<float, D, D>> factor(m_factors + (long long)prior * D * D);
+	Eigen::Map<const Eigen::Matrix<float, D, 1>> mean_vec(mean(prior));
+	Eigen::Map<const Eigen::Matrix<float, D, 1>> x_vec(x);
+
+	/* (x - m)' inv(L L') (x - m) = |inv(L) (x - m)|^2 */
+	Eigen::Matrix<float, D, 1> y = factor.triangularView<Eigen::Lower>().solve(x_vec - mean_vec);
+	return y.norm();
+}
@@ -0,0 +1,83 @@
+#ifndef RELATIONPRIORS_H
+#define RELATIONPRIORS_H
+
+#include <QFile>
+#include <QMap>
+#include <QPair>
+#include <QString>
+#include <Eigen/Core>
+#include <Eigen/Cholesky>
+#include <vector>
+#include <string>
+#include <fstream>
+
+#define RELATION_PRIORS_MAGIC 0x52504150    /* "PAPR" */
+#define RELATION_PRIORS_VERSION 1
+#define RELATION_PRIORS_DIMENSION 32    /* The dimension of the part relation feature vector */
+#define RELATION_PRIORS_SUFFIX "_priors.papr"    /* ../data/parts_relations/<class>_priors.papr */
+
+/*
+ * The Gaussian priors of the part relations of a class, one per ordered pair of part labels,
+ * in one flat bundle: a table of the label pairs sorted by labels, then the mean vectors, the
+ * covariance matrices and the lower Cholesky factors of the covariances, all column-major floats.
+ * The bundle is written by TrainPartsThread next to the text priors and memory-mapped
+ * (QFile::map) by EnergyFunctions, so nothing is parsed or factorized at inference start.
+ *   header: int magic, int version, int dimension, int npairs
+ *   table: npairs x (int label1, int label2, float log_det, float regularization)
+ *   means: npairs x dimension, covariances and factors: npairs x dimension x dimension
+ * All queries are const and may run from many threads at once.
+ */
+class RelationPriors
+{
+public:
+	~RelationPriors();
+
+	/* Factorize the covariances and build the bundle in memory */
+	static RelationPriors * build(const QMap<QPair<int, int>, Eigen::VectorXd> &means, const QMap<QPair<int, int>, Eigen::MatrixXd> &covariances);
+	/* Map the bundle saved in filename, NULL if there is no valid one */
+	static RelationPriors * open(const std::string &filename);
+	/* Read the text priors (<class>_covariance.txt and <class>_mean.txt) and build the bundle in memory */
+	static RelationPriors * loadText(const std::string &covariance_path, const std::string &mean_path);
+	bool save(const std::string &filename) const;
+
+	int size() const;
+	bool isMapped() const;
+	/* The index of the prior of the label pair, -1 if there is none */
+	int find(int label1, int label2) const;
+	const float * mean(int prior) const;
+	const float * covariance(int prior) const;
+	float logDeterminant(int prior) const;
+	/* Mahalanobis distance of the relation feature x to the prior */
+	float mahalanobis(int prior, const float *x) const;
+
+private:
+	struct Header
+	{
+		int magic;
+		int version;
+		int dimension;
+		int npairs;
+	};
+
+	struct Entry
+	{
+		int label1;
+		int label2;
+		float log_det;    /* log of the determinant of the covariance */
+		float regularization;    /* added to the diagonal of the covariance to make it positive definite */
+	};
+
+	std::vector<char> m_buffer;    /* Owned buffer of a bundle built in memory */
+	QFile *m_file;    /* Mapped file of an opened bundle */
+	const Header *m_header;
+	const Entry *m_entries;
+	const float *m_means;
+	const float *m_covariances;
+	const float *m_factors;
+
+	RelationPriors();
+	bool attach(const char *data, long long size);
+	static long long bufferSize(int npairs);
+};
+
+#endif // RELATIONPRIORS_H
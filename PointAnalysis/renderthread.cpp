@@ -0,0 +1,57 @@
+#include "renderthread.h"
+
+RenderThread::RenderThread(int id, QStringList models, QVector<OffscreenRenderer::Viewpoint> views, QString output_dir,
+	QOffscreenSurface *surface, QAtomicInt *next_task, QObject *parent)
+	: QThread(parent), m_id(id), m_models(models), m_views(views), m_output_dir(output_dir),
+	m_surface(surface), m_next_task(next_task), m_written(0)
+{
+
+}
+
+RenderThread::~RenderThread()
+{
+	if (isRunning())
+		terminate();
+}
+
+void RenderThread::run()
+{
+	/* The context of the renderer belongs to this thread */
+	OffscreenRenderer renderer(m_surface);
+	if (!renderer.isValid())
+	{
+		qDebug("RenderThread %d: no OpenGL context.", m_id);
+		emit renderCompleted(m_id);
+		return;
+	}
+
+	for (int i = m_next_task->fetchAndAddOrdered(1); i < m_models.size(); i = m_next_task->fetchAndAddOrdered(1))
+	{
+		QVector<OBB *> obbs;
+		PCModel *model = OffscreenRenderer::loadScene(m_models[i], obbs);
+		if (model == NULL)
+		{
+			emit addDebugText("Cannot load " + m_models[i] + ", not rendered.");
+			continue;
+		}
+
+		renderer.setScene(model, obbs);
+		QString modelname = Utils::getModelName(m_models[i]);
+		for (int v = 0; v < m_views.size(); v++)
+		{
+			QImage image = renderer.render(m_views[v]);
+			QString path = m_output_dir + "/" + modelname + "_" + QString::number(v) + ".png";
+			if (image.save(path, "PNG"))
+				m_written++;
+			else
+				emit addDebugText("Cannot write " + path + ".");
+		}
+		emit addDebugText("Rendered " + modelname + " from " + QString::number(m_views.size()) + " viewpoints.");
+
+		delete(model);
+		for (int k = 0; k < obbs.size(); k++)
+			delete(obbs[k]);
+	}
+
+	emit renderCompleted(m_id);
+}
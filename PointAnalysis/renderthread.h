@@ -0,0 +1,44 @@
+#ifndef RENDERTHREAD_H
+#define RENDERTHREAD_H
+
+#include <QThread>
+#include <QStringList>
+#include <QAtomicInt>
+#include <QOffscreenSurface>
+#include "offscreenrenderer.h"
+#include "utils.h"
+
+/*
+ * Renders the models of a list from the given viewpoints with its own OffscreenRenderer. The
+ * threads of a batch share the index of the next model to render, each takes the next one as
+ * soon as it is done.
+ */
+class RenderThread : public QThread
+{
+	Q_OBJECT
+
+public:
+	RenderThread(int id, QStringList models, QVector<OffscreenRenderer::Viewpoint> views, QString output_dir,
+		QOffscreenSurface *surface, QAtomicInt *next_task, QObject *parent = 0);
+	~RenderThread();
+
+	int imagesWritten() const { return m_written; }
+
+signals:
+	void addDebugText(QString text);
+	void renderCompleted(int id);
+
+protected:
+	void run();
+
+private:
+	int m_id;
+	QStringList m_models;
+	QVector<OffscreenRenderer::Viewpoint> m_views;
+	QString m_output_dir;
+	QOffscreenSurface *m_surface;    /* Created in the GUI thread, owned by the caller */
+	QAtomicInt *m_next_task;    /* The index of the next model of m_models to render, shared by the threads */
+	int m_written;
+};
+
+#endif // RENDERTHREAD_H
@@ -0,0 +1,164 @@
+#include "sdfcalculator.h"
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+SdfCalculator::SdfCalculator(Polyhedron_with_id &mesh, double cone_angle, int number_of_rays, bool adaptive, int min_rays)
+	: m_mesh(mesh), m_cone_angle(cone_angle), m_number_of_rays(number_of_rays), m_adaptive(adaptive), m_min_rays(min_rays)
+{
+	m_facets.resize(mesh.size_of_facets());
+	m_normals.resize(mesh.size_of_facets());
+	for (Polyhedron_with_id::Facet_iterator facet_it = mesh.facets_begin(); facet_it != mesh.facets_end(); ++facet_it)
+	{
+		Polyhedron_with_id::Halfedge_handle he = facet_it->halfedge();
+		Vector normal = CGAL::normal(he->vertex()->point(), he->next()->vertex()->point(), he->next()->next()->vertex()->point());
+		double length = std::sqrt(normal.squared_length());
+		m_facets[facet_it->id()] = facet_it;
+		m_normals[facet_it->id()] = length > 0 ? normal / length : CGAL::NULL_VECTOR;
+	}
+}
+
+SdfCalculator::~SdfCalculator()
+{
+}
+
+void SdfCalculator::sampleDisk(int number_of_rays, std::vector<RaySample> &samples)
+{
+	/* Vogel spiral, evenly spread samples of the unit disk */
+	const double GOLDEN_ANGLE = CGAL_PI * (3.0 - std::sqrt(5.0));
+	samples.resize(number_of_rays);
+	for (int i = 0; i < number_of_rays; i++)
+	{
+		double r = std::sqrt((i + 0.5) / number_of_rays);
+		double theta = i * GOLDEN_ANGLE;
+		samples[i].x = r * std::cos(theta);
+		samples[i].y = r * std::sin(theta);
+	}
+}
+
+bool SdfCalculator::isSmooth(Facet_handle facet) const
+{
+	const double cos_smooth = std::cos(SDF_SMOOTH_ANGLE / 180.0 * CGAL_PI);
+	const Vector &normal = m_normals[facet->id()];
+	Polyhedron_with_id::Halfedge_around_facet_circulator he = facet->facet_begin(), end = he;
+	do
+	{
+		if (!he->opposite()->is_border() && normal * m_normals[he->opposite()->facet()->id()] < cos_smooth)
+			return false;
+	} while (++he != end);
+	return true;
+}
+
+double SdfCalculator::facetSdf(const Tree &tree, Facet_handle facet, const std::vector<RaySample> &samples) const
+{
+	const Vector &normal = m_normals[facet->id()];
+	if (normal == CGAL::NULL_VECTOR)
+		return -1.0;
+
+	/* The rays start from the centroid of the facet */
+	Vector sum = CGAL::NULL_VECTOR;
+	int nvertices = 0;
+	Polyhedron_with_id::Halfedge_around_facet_circulator he = facet->facet_begin(), end = he;
+	do
+	{
+		sum = sum + (he->vertex()->point() - CGAL::ORIGIN);
+		nvertices++;
+	} while (++he != end);
+	Point3 center = CGAL::ORIGIN + sum / nvertices;
+
+	/* Frame of the disk of directions, centered on the inward normal */
+	Vector u = std::abs(normal.x()) < 0.9 ? CGAL::cross_product(normal, Vector(1, 0, 0)) : CGAL::cross_product(normal, Vector(0, 1, 0));
+	u = u / std::sqrt(u.squared_length());
+	Vector v = CGAL::cross_product(normal, u);
+	double radius = std::tan(m_cone_angle / 360.0 * CGAL_PI);
+
+	std::vector<std::pair<double, double>> hits;    /* distance, weight */
+	hits.reserve(samples.size());
+	for (int i = 0; i < (int)samples.size(); i++)
+	{
+		Vector offset = radius * (samples[i].x * u + samples[i].y * v);
+		Kernel::Ray_3 ray(center, -normal + offset);
+		boost::optional<Tree::Intersection_and_primitive_id<Kernel::Ray_3>::Type> hit = tree.first_intersection(ray, SkipFacet(facet));
+		if (!hit)
+			continue;
+		const Point3 *point = boost::get<Point3>(&(hit->first));
+		if (point == NULL)
+			continue;
+		/* The rays close to the normal weigh more */
+		double weight = 1.0 / std::sqrt(1.0 + offset.squared_length());
+		hits.push_back(std::make_pair(std::sqrt(CGAL::squared_distance(center, *point)), weight));
+	}
+	if (hits.empty())
+		return -1.0;
+
+	/* Drop the hits further than a standard deviation from the median */
+	std::sort(hits.begin(), hits.end());
+	double median = hits[hits.size() / 2].first;
+	double mean = 0;
+	for (int i = 0; i < (int)hits.size(); i++)
+		mean += hits[i].first;
+	mean /= hits.size();
+	double deviation = 0;
+	for (int i = 0; i < (int)hits.size(); i++)
+		deviation += (hits[i].first - mean) * (hits[i].first - mean);
+	deviation = std::sqrt(deviation / hits.size());
+
+	double sdf = 0, weights = 0;
+	for (int i = 0; i < (int)hits.size(); i++)
+	{
+		if (std::abs(hits[i].first - median) <= deviation)
+		{
+			sdf += hits[i].first * hits[i].second;
+			weights += hits[i].second;
+		}
+	}
+	return weights > 0 ? sdf / weights : median;
+}
+
+void SdfCalculator::compute(std::vector<double> &facets_sdf, int nthreads)
+{
+#ifdef _OPENMP
+	if (nthreads <= 0)
+		nthreads = omp_get_num_procs();
+#endif
+	/* The tree is built before the threads query it */
+	Tree tree(faces(m_mesh).first, faces(m_mesh).second, m_mesh);
+	tree.build();
+
+	std::vector<RaySample> samples, smooth_samples;
+	sampleDisk(m_number_of_rays, samples);
+	sampleDisk(m_adaptive ? std::min(m_min_rays, m_number_of_rays) : m_number_of_rays, smooth_samples);
+
+	int nfacets = m_facets.size();
+	facets_sdf.resize(nfacets);
+#pragma omp parallel for schedule(dynamic, SDF_FACET_CHUNK) num_threads(nthreads) if(nthreads > 1 && nfacets >= SDF_PARALLEL_MIN_FACETS)
+	for (int i = 0; i < nfacets; i++)
+	{
+		const std::vector<RaySample> &facet_samples = m_adaptive && isSmooth(m_facets[i]) ? smooth_samples : samples;
+		facets_sdf[i] = facetSdf(tree, m_facets[i], facet_samples);
+	}
+}
+
+void SdfCalculator::parity(Polyhedron_with_id &mesh, double &mean_error, double &max_error)
+{
+	mean_error = 0;
+	max_error = 0;
+	int nfacets = mesh.size_of_facets();
+	if (nfacets == 0)
+		return;
+
+	std::vector<double> facets_sdf(nfacets), cgal_sdf(nfacets);
+	Facet_sdf_map sdf_property_map(facets_sdf), cgal_property_map(cgal_sdf);
+	SdfCalculator calculator(mesh, SDF_CONE_ANGLE, SDF_NUMBER_OF_RAYS, false);
+	calculator.compute(facets_sdf);
+	CGAL::sdf_values_postprocessing(mesh, sdf_property_map);
+	CGAL::sdf_values(mesh, cgal_property_map, SDF_CONE_ANGLE / 180.0 * CGAL_PI, SDF_NUMBER_OF_RAYS, true);
+
+	for (int i = 0; i < nfacets; i++)
+	{
+		double error = std::abs(facets_sdf[i] - cgal_sdf[i]);
+		mean_error += error;
+		max_error = std::max(max_error, error);
+	}
+	mean_error /= nfacets;
+}
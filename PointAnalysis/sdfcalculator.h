@@ -0,0 +1,99 @@
+#ifndef SDFCALCULATOR_H
+#define SDFCALCULATOR_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <CGAL/Polyhedron_items_with_id_3.h>
+#include <CGAL/AABB_tree.h>
+#include <CGAL/AABB_traits.h>
+#include <CGAL/AABB_face_graph_triangle_primitive.h>
+#include "utils.h"
+
+#define SDF_NUMBER_OF_RAYS 100    /* rays cast per facet */
+#define SDF_CONE_ANGLE 45.0    /* opening angle of the cone of rays, in degrees */
+#define SDF_ADAPTIVE_RAYS false    /* cast fewer rays from the facets of smooth regions */
+#define SDF_ADAPTIVE_MIN_RAYS 25    /* rays cast per facet of a smooth region in the adaptive mode */
+#define SDF_SMOOTH_ANGLE 10.0    /* a facet is smooth if the normals of its neighbors are within this angle of its own, in degrees */
+#define SDF_FACET_CHUNK 256    /* facets a thread takes at a time */
+#define SDF_PARALLEL_MIN_FACETS 20000    /* smaller meshes are computed by the calling thread alone */
+#define SDF_PARITY_TOLERANCE 0.05    /* mean absolute difference with CGAL::sdf_values of the normalized facet values */
+
+/* Polyhedron with ids on its items, so the per facet values can live in a vector */
+typedef CGAL::Polyhedron_3<Kernel, CGAL::Polyhedron_items_with_id_3> Polyhedron_with_id;
+
+/* Property map of the sdf value of each facet, indexed by the facet id */
+class Facet_sdf_map
+{
+public:
+	typedef Polyhedron_with_id::Facet_const_handle key_type;
+	typedef double value_type;
+	typedef double & reference;
+	typedef boost::lvalue_property_map_tag category;
+
+	Facet_sdf_map(std::vector<double> &values) : m_values(&values) {}
+	reference operator[](key_type facet) const { return (*m_values)[facet->id()]; }
+	friend value_type get(const Facet_sdf_map &map, key_type facet) { return map[facet]; }
+	friend void put(const Facet_sdf_map &map, key_type facet, value_type value) { map[facet] = value; }
+
+private:
+	std::vector<double> *m_values;
+};
+
+/*
+ * Raw shape diameter function of the facets of a mesh, the values CGAL::sdf_values computes
+ * before its postprocessing. The facets are split into chunks computed in parallel, and all
+ * threads cast their rays into one AABB tree of the mesh. For each facet a cone of rays is cast
+ * from its centroid against its normal; the hits further than a standard deviation from the
+ * median are discarded and the others averaged with weights falling off with the angle to the
+ * normal. Facets no ray hits get -1, which CGAL::sdf_values_postprocessing fills in from their
+ * neighbors. The items ids of the mesh must be set (CGAL::set_halfedgeds_items_id).
+ */
+class SdfCalculator
+{
+public:
+	SdfCalculator(Polyhedron_with_id &mesh, double cone_angle = SDF_CONE_ANGLE, int number_of_rays = SDF_NUMBER_OF_RAYS,
+		bool adaptive = SDF_ADAPTIVE_RAYS, int min_rays = SDF_ADAPTIVE_MIN_RAYS);
+	~SdfCalculator();
+
+	/* nthreads: threads of the facets loop, 0 for one per core */
+	void compute(std::vector<double> &facets_sdf, int nthreads = 0);
+
+	/* Mean and largest absolute differences between the normalized facet values of compute and of CGAL::sdf_values */
+	static void parity(Polyhedron_with_id &mesh, double &mean_error, double &max_error);
+
+private:
+	typedef CGAL::AABB_face_graph_triangle_primitive<Polyhedron_with_id> Primitive;
+	typedef CGAL::AABB_traits<Kernel, Primitive> Traits;
+	typedef CGAL::AABB_tree<Traits> Tree;
+	typedef Polyhedron_with_id::Facet_handle Facet_handle;
+
+	/* Sample of the unit disk, the direction of a ray in the frame of the facet */
+	struct RaySample
+	{
+		double x;
+		double y;
+	};
+
+	/* Skips the facet the rays are cast from */
+	struct SkipFacet
+	{
+		Facet_handle facet;
+		SkipFacet(Facet_handle f) : facet(f) {}
+		bool operator()(const Primitive::Id &id) const { return id == facet; }
+	};
+
+	Polyhedron_with_id &m_mesh;
+	double m_cone_angle;
+	int m_number_of_rays;
+	bool m_adaptive;
+	int m_min_rays;
+	std::vector<Facet_handle> m_facets;    /* By facet id */
+	std::vector<Vector> m_normals;    /* Unit normals by facet id */
+
+	static void sampleDisk(int number_of_rays, std::vector<RaySample> &samples);
+	bool isSmooth(Facet_handle facet) const;
+	double facetSdf(const Tree &tree, Facet_handle facet, const std::vector<RaySample> &samples) const;
+};
+
+#endif // SDFCALCULATOR_H
@@ -1,13 +1,13 @@
 #include "sdfsubthread.h"
 
-SdfSubThread::SdfSubThread(int id, QStringList filelist, int start, int end, std::string modelClassName, QObject *parent)
+SdfSubThread::SdfSubThread(int id, QStringList filelist, int nlarge, QAtomicInt *next_task, std::string modelClassName, QObject *parent)
 	: QThread(parent)
 {
 	emit addDebugText("SdfSubThread-" + QString::number(id) + " is created.");
 	qDebug("SdfSubThread-%d is created.", id);
 	m_filelist = filelist;
-	m_start = start;
-	m_end = end;
+	m_nlarge = nlarge;
+	m_next_task = next_task;
 	m_id = id;
 	m_modelClassName = modelClassName;
 }
@@ -20,95 +20,137 @@ SdfSubThread::~SdfSubThread()
 
 void SdfSubThread::run()
 {
-	for (int i = m_start; i <= m_end; i++)
+	for (int i = m_next_task->fetchAndAddOrdered(1); i < m_filelist.size(); i = m_next_task->fetchAndAddOrdered(1))
 	{
 		emit addDebugText("SdfSubThread-" + QString::number(m_id) + ": computiong sdf of " + m_filelist[i] + "...");
 		qDebug() << "SdfSubThread-" + QString::number(m_id) + ": computiong sdf of " + m_filelist[i] + "...";
 
-		compute_sdf(m_filelist[i].toStdString().c_str());
+		compute_sdf(m_filelist[i].toStdString().c_str(), i);
 	}
 
 	emit computeSdfCompleted(m_id);
 }
 
 using namespace std;
-void SdfSubThread::compute_sdf(const char *filename)
+void SdfSubThread::compute_sdf(const char *filename, int task)
 {
 	/* create and read Polyhedron */
-	Polyhedron mesh;
+	Polyhedron_with_id mesh;
 	std::ifstream input(filename);
 	if (!input || !(input >> mesh) || mesh.empty())
 	{
 		std::cerr << "Not a valid off file." << std::endl;
 		return;
 	}
-	/* create a property-map */
-	typedef std::map<Polyhedron::Facet_const_handle, double> Facet_double_map;
-	Facet_double_map internal_map;
-	boost::associative_property_map<Facet_double_map> sdf_property_map(internal_map);
+	input.close();
+	/* Number the vertices in the order of the file and the facets for the property-map */
+	CGAL::set_halfedgeds_items_id(mesh);
 
-	const std::size_t number_of_rays = 100;    /* cast 100 rays per facet */
-	const double cone_angle = 45.0 / 180.0 * CGAL_PI;   /* set cone opening-angle to 45 degrees */
-	CGAL::sdf_values(mesh, sdf_property_map, cone_angle, number_of_rays, false);
+	/* create a property-map */
+	std::vector<double> facets_sdf(mesh.size_of_facets());
+	Facet_sdf_map sdf_property_map(facets_sdf);
+
+	/* Cast the rays of the facets, then smooth and normalize the values as CGAL::sdf_values does.
+	 * There is a subthread per core, so a mesh is computed by its subthread alone, but for the
+	 * large meshes once fewer of them remain than cores: they share the cores */
+	int nthreads = 1;
+	int large_left = m_nlarge - task;    /* This one and the large meshes after it */
+	if (large_left > 0)
+		nthreads = (std::max)(1, QThread::idealThreadCount() / (std::min)(large_left, QThread::idealThreadCount()));
+	SdfCalculator calculator(mesh, SDF_CONE_ANGLE, SDF_NUMBER_OF_RAYS, SDF_ADAPTIVE_RAYS, SDF_ADAPTIVE_MIN_RAYS);
+	calculator.compute(facets_sdf, nthreads);
 	std::pair<double, double> min_max_sdf = CGAL::sdf_values_postprocessing(mesh, sdf_property_map);
 
-	ifstream off_in(filename);  /* Used to read indices of vertices of each face */
-	const int BUFFER_SIZE = 128;
-	char buffer[BUFFER_SIZE];
-	off_in.getline(buffer, BUFFER_SIZE);
-	off_in.getline(buffer, BUFFER_SIZE);
-	/* Read the number of vertices and faces from the header */
-	QString line = QString(buffer);
-	int nvertices = line.section(' ', 0, 0).toInt();
-	int nfaces = line.section(' ', 1, 1).toInt();
-
-	QVector<int> sdf_count(nvertices);    /* Each component represents the nubmer of sdf values added into the corresponding vertex */
-	QVector<double> vertices_sdf(nvertices);    /* Sdf values vector, each of which stores the sdf value of corresponding vertex */
-
-	for (int i = 0; i < nvertices; i++)
-		off_in.getline(buffer, BUFFER_SIZE);    /* Skip the vertices part to read the faces part */
-
-	/* Get the sdf value of each facet in the mesh */
-	int count = 0;
-	for (Polyhedron::Facet_const_iterator facet_it = mesh.facets_begin();
-		facet_it != mesh.facets_end(); ++facet_it)
+	/* The sdf value of each vertex equals to the arithmetic mean of the sdf values of all faces containing it */
+	int nvertices = mesh.size_of_vertices();
+	std::vector<double> vertices_sdf(nvertices, 0.0);
+	for (Polyhedron_with_id::Vertex_const_iterator vertex_it = mesh.vertices_begin(); vertex_it != mesh.vertices_end(); ++vertex_it)
 	{
-		/* Read a face containing the indices of 3 vertieces */
-		off_in.getline(buffer, BUFFER_SIZE);
-		line = QString(buffer);
-		int v0 = line.section(' ', 1, 1).toInt();
-		int v1 = line.section(' ', 2, 2).toInt();
-		int v2 = line.section(' ', 3, 3).toInt();
-
-		sdf_count[v0]++;
-		sdf_count[v1]++;
-		sdf_count[v2]++;
-
-		double sdf = sdf_property_map[facet_it];    /* The sdf value of the current face triangle */
-		/* Add the sdf value to all three vertices of the face triangle */
-		vertices_sdf[v0] += sdf;
-		vertices_sdf[v1] += sdf;
-		vertices_sdf[v2] += sdf;
-
-		count++;
+		int sdf_count = 0;    /* The number of faces containing the vertex */
+		double sdf = 0;
+		Polyhedron_with_id::Halfedge_around_vertex_const_circulator he = vertex_it->vertex_begin(), end = he;
+		if (he != NULL)
+		{
+			do
+			{
+				if (!he->is_border())
+				{
+					sdf += facets_sdf[he->facet()->id()];
+					sdf_count++;
+				}
+			} while (++he != end);
+		}
+		if (sdf_count > 0)
+			vertices_sdf[vertex_it->id()] = sdf / (double)sdf_count;
 	}
 
-	/* Compute the average sdf value of each vertex */
-	/* The sdf value of each vertex equals to the arithmetic mean of the sdf values of all faces containing it */
-	/* Meanwhile save the sdf values into file */
-	QString outfile_str = "../data/sdf/" + QString::fromStdString(m_modelClassName) + "/" + Utils::getModelName(QString(filename)) + ".sdff";
-	ofstream out(outfile_str.toStdString().c_str());
-	for (int i = 0; i < nvertices; i++){
-		vertices_sdf[i] /= (double)sdf_count[i];
-		out << vertices_sdf[i] << endl;
+	/*
+	 * The reader drops the vertices of no face, the others keep the order of the file. The sdff has
+	 * a line per vertex of the off file, so map the values back to the vertices of the file; the
+	 * dropped vertices get 0, as the vertices of no face had before.
+	 */
+	std::ifstream off_in(filename);
+	std::string header;
+	int off_nvertices = 0, nfaces, nedges;
+	off_in >> header >> off_nvertices >> nfaces >> nedges;
+	std::vector<double> off_sdf(off_nvertices > 0 ? off_nvertices : 0, 0.0);
+	Polyhedron_with_id::Vertex_const_iterator vertex_it = mesh.vertices_begin();
+	int mapped = 0;
+	for (int i = 0; i < off_nvertices && vertex_it != mesh.vertices_end(); i++)
+	{
+		double x, y, z;
+		if (!(off_in >> x >> y >> z))
+			break;
+		if (vertex_it->point().x() == x && vertex_it->point().y() == y && vertex_it->point().z() == z)
+		{
+			off_sdf[i] = vertices_sdf[vertex_it->id()];
+			++vertex_it;
+			mapped++;
+		}
 	}
-
-	input.close();
 	off_in.close();
+	if (mapped != nvertices)
+	{
+		std::cerr << "The vertices of " << filename << " can't be matched to its mesh (" << mapped << " of " << nvertices << "), no sdf saved." << std::endl;
+		emit addDebugText("SdfSubThread-" + QString::number(m_id) + ": the vertices of " + QString(filename) + " can't be matched to its mesh, no sdf saved.");
+		return;
+	}
+
+	/* Save the sdf values into file */
+	QString outfile_str = "../data/sdf/" + QString::fromStdString(m_modelClassName) + "/" + Utils::getModelName(QString(filename)) + ".sdff";
+	ofstream out(outfile_str.toStdString().c_str());
+	for (int i = 0; i < off_nvertices; i++)
+		out << off_sdf[i] << endl;
 	out.close();
 
 	emit addDebugText("SdfSubThread-" + QString::number(m_id) + ": compute sdf of " + QString(filename) 
 		+ " done.\nSave the result to " + outfile_str + ".");
 	qDebug() << "SdfSubThread-" + QString::number(m_id) + ": compute sdf of " + QString(filename)
 		+ " done.\nSave the result to " + outfile_str + ".";
+
+	/* The last model of the list is the smallest one, the cheapest to check against CGAL */
+	if (task == m_filelist.size() - 1)
+		recordParity(mesh, filename);
+}
+
+void SdfSubThread::recordParity(Polyhedron_with_id &mesh, const char *filename)
+{
+	double mean_error, max_error;
+	SdfCalculator::parity(mesh, mean_error, max_error);
+	bool passed = mean_error <= SDF_PARITY_TOLERANCE;
+
+	QString parity_str = "../data/sdf/" + QString::fromStdString(m_modelClassName) + "/" + SDF_PARITY_FILE;
+	ofstream out(parity_str.toStdString().c_str());
+	out << "mesh " << filename << endl;
+	out << "facets " << mesh.size_of_facets() << endl;
+	out << "mean_error " << mean_error << endl;
+	out << "max_error " << max_error << endl;
+	out << "tolerance " << SDF_PARITY_TOLERANCE << endl;
+	out << "result " << (passed ? "passed" : "failed") << endl;
+	out.close();
+
+	QString text = "SdfSubThread-" + QString::number(m_id) + ": sdf of " + QString(filename) + " against CGAL::sdf_values: mean difference "
+		+ QString::number(mean_error) + ", largest " + QString::number(max_error) + ", " + (passed ? "passed" : "failed") + ".";
+	emit addDebugText(text);
+	qDebug() << text;
 }
\ No newline at end of file
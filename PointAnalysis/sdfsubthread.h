@@ -3,15 +3,29 @@
 
 #include <QThread>
 #include <QStringList>
+#include <QAtomicInt>
 #include <fstream>
 #include <string>
+#include <vector>
 #include "utils.h"
+#include "sdfcalculator.h"
+
+#define SDF_PARITY_FILE "parity.txt"    /* In the sdf directory of the class, the last parity check of its sdf values */
+
+/*
+ * Computes the sdf values of the models of a list. The subthreads share the index of the next
+ * model to compute and each takes the next one as soon as it is done, so a large mesh does not
+ * hold back the others. The list starts with the meshes of SDF_PARALLEL_MIN_FACETS facets or more,
+ * largest first; once fewer of them remain than cores, the cores are shared among them and each
+ * is computed by several threads. The subthread of the last model of the list also compares its
+ * values with CGAL::sdf_values and records the result (SDF_PARITY_FILE).
+ */
 class SdfSubThread : public QThread
 {
 	Q_OBJECT
 
 public:
-	SdfSubThread(int id, QStringList list, int start, int end, std::string modelClassName, QObject *parent);
+	SdfSubThread(int id, QStringList list, int nlarge, QAtomicInt *next_task, std::string modelClassName, QObject *parent);
 	~SdfSubThread();
 	
 signals:
@@ -23,12 +37,13 @@ protected:
 
 private:
 	QStringList m_filelist;
-	int m_start;
-	int m_end;
+	int m_nlarge;    /* The meshes at the head of m_filelist computed in parallel */
+	QAtomicInt *m_next_task;    /* The index of the next model of m_filelist to compute, shared by the subthreads */
 	int m_id;
 	std::string m_modelClassName;
 
-	void compute_sdf(const char *filename);
+	void compute_sdf(const char *filename, int task);
+	void recordParity(Polyhedron_with_id &mesh, const char *filename);
 };
 
 #endif // SDFSUBTHREAD_H
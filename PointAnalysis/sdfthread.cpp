@@ -76,18 +76,29 @@ void SdfThread::execute()
 			}
 		}
 
-		/* Create 8 subthreads to compute sdf values of all training models */
-		int one_part = count / NUM_OF_SUBTHREADS;
+		/* The largest meshes first, so the last ones to compute are small and the subthreads finish together */
+		QVector<QPair<int, QString>> tasks(count);
+		for (int i = 0; i < count; i++)
+			tasks[i] = qMakePair(-facetCount(m_filelist[i]), m_filelist[i]);
+		std::sort(tasks.begin(), tasks.end());
+		QStringList task_list;
+		int nlarge = 0;    /* The meshes of SDF_PARALLEL_MIN_FACETS facets or more, at the head of the list */
+		for (int i = 0; i < count; i++)
+		{
+			task_list.append(tasks[i].second);
+			if (-tasks[i].first >= SDF_PARALLEL_MIN_FACETS)
+				nlarge++;
+		}
+
+		/* Create the subthreads to compute sdf values of all training models, each takes the next model of the list when it is done */
 		int rounds = NUM_OF_SUBTHREADS < count ? NUM_OF_SUBTHREADS : count;
 		emit addDebugText("Create " + QString::number(rounds) + " threads to compute sdf values.");
 		subthreads.resize(rounds);
 		finish_count = rounds;
+		m_next_task.store(0);
 		for (int i = 0; i < rounds; i++)
 		{
-			int start = i * one_part;
-			int end = i == (rounds - 1) ? (count - 1) : ((i + 1) * one_part - 1);
-
-			SdfSubThread *thread = new SdfSubThread(i, m_filelist, start, end, m_modelClassName, this);
+			SdfSubThread *thread = new SdfSubThread(i, task_list, nlarge, &m_next_task, m_modelClassName, this);
 			connect(thread, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
 			connect(thread, SIGNAL(computeSdfCompleted(int)), this, SLOT(onSubthreadFinished(int)));
 			subthreads[i] = thread;
@@ -108,12 +119,23 @@ void SdfThread::onSubthreadFinished(int id)
 {
 	emit addDebugText("SdfSubThread-" + QString::number(id) + " has finished.");
 	qDebug("SdfSubThread-%d has finished.", id);
-	if (subthreads[id]->isRunning())
-		subthreads[id]->terminate();
+	/* The subthread emits it at the end of run, let it return */
+	subthreads[id]->wait();
 	delete(subthreads[id]);
 	subthreads[id] = NULL;
 
 	finish_count--;
 	if (finish_count == 0)
 		emit computeSdfCompleted();
+}
+
+int SdfThread::facetCount(QString filename)
+{
+	/* The header of an off file: OFF, then the numbers of vertices, faces and edges */
+	ifstream in(filename.toStdString().c_str());
+	string header;
+	int nvertices = 0, nfaces = 0;
+	if (!(in >> header >> nvertices >> nfaces))
+		return 0;
+	return nfaces;
 }
\ No newline at end of file
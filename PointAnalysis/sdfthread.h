@@ -6,9 +6,12 @@
 #include <fstream>
 #include <string>
 #include <QStringList>
+#include <QFileInfo>
+#include <QAtomicInt>
+#include <algorithm>
 #include "sdfsubthread.h"
 
-#define NUM_OF_SUBTHREADS  1
+#define NUM_OF_SUBTHREADS QThread::idealThreadCount()
 
 class SdfThread : public QObject
 {
@@ -31,10 +34,12 @@ signals:
 private:
 	std::string m_modelClassName;
 	QStringList m_filelist;
+	QAtomicInt m_next_task;    /* The queue of the subthreads, the index of the next model of the list they pass to compute */
 	QVector<SdfSubThread *> subthreads;
 	int finish_count;
 
 	void clean();
+	static int facetCount(QString filename);    /* Read from the header of the off file */
 };
 
 #endif // SDFTHREAD_H
@@ -0,0 +1,446 @@
+#include "spatialindex.h"
+#include <algorithm>
+#include <fstream>
+#include <utility>
+#include <cmath>
+#include <cstring>
+#include <QDebug>
+
+#define MORTON_BITS 21    /* Bits per axis of a Morton code */
+#define SMALL_BOX_CELLS 64    /* Boxes up to this many cells are looked up cell by cell, larger ones scan the code range */
+
+SpatialIndex::SpatialIndex() : m_file(NULL), m_header(NULL), m_codes(NULL), m_cell_starts(NULL), m_points(NULL), m_ids(NULL), m_ranks(NULL)
+{
+}
+
+SpatialIndex::~SpatialIndex()
+{
+	if (m_file != NULL)
+	{
+		m_file->close();    /* Unmaps the file */
+		delete(m_file);
+		m_file = NULL;
+	}
+}
+
+long long SpatialIndex::bufferSize(int npoints, int ncells)
+{
+	return sizeof(Header) + (long long)ncells * sizeof(unsigned long long) + (long long)(ncells + 1) * sizeof(int)
+		+ (long long)npoints * (3 * sizeof(float) + 2 * sizeof(int));
+}
+
+bool SpatialIndex::attach(const char *data, long long size)
+{
+	if (size < (long long)sizeof(Header))
+		return false;
+
+	const Header *header = (const Header *)data;
+	if (header->magic != SPATIAL_INDEX_MAGIC || header->version != SPATIAL_INDEX_VERSION
+		|| header->npoints < 0 || header->ncells < 0 || size != bufferSize(header->npoints, header->ncells))
+		return false;
+
+	/* The codes follow the 8-byte aligned header, the other arrays are 4-byte elements */
+	m_header = header;
+	m_codes = (const unsigned long long *)(data + sizeof(Header));
+	m_cell_starts = (const int *)(m_codes + header->ncells);
+	m_points = (const float *)(m_cell_starts + header->ncells + 1);
+	m_ids = (const int *)(m_points + 3 * header->npoints);
+	m_ranks = m_ids + header->npoints;
+	return true;
+}
+
+unsigned long long SpatialIndex::morton(int cx, int cy, int cz)
+{
+	unsigned long long code = 0;
+	for (int b = 0; b < MORTON_BITS; b++)
+	{
+		code |= ((unsigned long long)((cx >> b) & 1)) << (3 * b);
+		code |= ((unsigned long long)((cy >> b) & 1)) << (3 * b + 1);
+		code |= ((unsigned long long)((cz >> b) & 1)) << (3 * b + 2);
+	}
+	return code;
+}
+
+void SpatialIndex::demorton(unsigned long long code, int &cx, int &cy, int &cz)
+{
+	cx = cy = cz = 0;
+	for (int b = 0; b < MORTON_BITS; b++)
+	{
+		cx |= (int)((code >> (3 * b)) & 1) << b;
+		cy |= (int)((code >> (3 * b + 1)) & 1) << b;
+		cz |= (int)((code >> (3 * b + 2)) & 1) << b;
+	}
+}
+
+unsigned long long SpatialIndex::hashPoints(const float *x, const float *y, const float *z, int stride, int npoints)
+{
+	/* FNV-1a over the coordinates */
+	unsigned long long h = 14695981039346656037ULL;
+	for (int i = 0; i < npoints; i++)
+	{
+		float p[3] = { x[i * stride], y[i * stride], z[i * stride] };
+		const unsigned char *bytes = (const unsigned char *)p;
+		for (int b = 0; b < (int)sizeof(p); b++)
+		{
+			h ^= bytes[b];
+			h *= 1099511628211ULL;
+		}
+	}
+	return h;
+}
+
+void SpatialIndex::mortonOrder(const float *x, const float *y, const float *z, int stride, int npoints, std::vector<int> &order)
+{
+	const float *coords[3] = { x, y, z };
+	float min[3] = { 0, 0, 0 }, scale[3] = { 0, 0, 0 };
+	for (int a = 0; a < 3; a++)
+	{
+		float max = 0;
+		for (int i = 0; i < npoints; i++)
+		{
+			float v = coords[a][i * stride];
+			if (i == 0 || v < min[a]) min[a] = v;
+			if (i == 0 || v > max) max = v;
+		}
+		if (max > min[a])
+			scale[a] = ((1 << MORTON_BITS) - 1) / (max - min[a]);
+	}
+
+	std::vector<std::pair<unsigned long long, int>> codes(npoints);
+#pragma omp parallel for
+	for (int i = 0; i < npoints; i++)
+	{
+		int c[3];
+		for (int a = 0; a < 3; a++)
+		{
+			float v = (coords[a][i * stride] - min[a]) * scale[a];
+			c[a] = v > 0 ? (v < (1 << MORTON_BITS) - 1 ? (int)v : (1 << MORTON_BITS) - 1) : 0;
+		}
+		codes[i] = std::make_pair(morton(c[0], c[1], c[2]), i);
+	}
+	std::sort(codes.begin(), codes.end());
+
+	order.resize(npoints);
+	for (int i = 0; i < npoints; i++)
+		order[i] = codes[i].second;
+}
+
+SpatialIndex * SpatialIndex::build(const float *x, const float *y, const float *z, int stride, int npoints, float cell_size)
+{
+	Header header;
+	memset(&header, 0, sizeof(Header));
+	header.magic = SPATIAL_INDEX_MAGIC;
+	header.version = SPATIAL_INDEX_VERSION;
+	header.npoints = npoints;
+	header.hash = hashPoints(x, y, z, stride, npoints);
+
+	/* Bounding box and grid size, grow the cells if the grid doesn't fit in the Morton code */
+	float max[3] = { 0, 0, 0 };
+	for (int i = 0; i < npoints; i++)
+	{
+		float p[3] = { x[i * stride], y[i * stride], z[i * stride] };
+		for (int a = 0; a < 3; a++)
+		{
+			if (i == 0 || p[a] < header.min[a]) header.min[a] = p[a];
+			if (i == 0 || p[a] > max[a]) max[a] = p[a];
+		}
+	}
+	if (!(cell_size > 0))
+		cell_size = 1.0;
+	for (int a = 0; a < 3; a++)
+	{
+		float extent = max[a] - header.min[a];
+		if (extent / cell_size >= (1 << MORTON_BITS) - 1)
+			cell_size = extent / ((1 << MORTON_BITS) - 2);
+	}
+	header.cell_size = cell_size;
+	for (int a = 0; a < 3; a++)
+		header.dims[a] = (int)((max[a] - header.min[a]) / cell_size) + 1;
+
+	SpatialIndex *index = new SpatialIndex();
+	index->m_header = &header;    /* For cellOf() */
+
+	/* Sort the points by the Morton code of their cell */
+	std::vector<std::pair<unsigned long long, int>> order(npoints);
+	for (int i = 0; i < npoints; i++)
+	{
+		int cx = index->cellOf(x[i * stride], 0);
+		int cy = index->cellOf(y[i * stride], 1);
+		int cz = index->cellOf(z[i * stride], 2);
+		order[i] = std::make_pair(morton(cx, cy, cz), i);
+	}
+	std::sort(order.begin(), order.end());
+
+	int ncells = 0;
+	for (int i = 0; i < npoints; i++)
+	{
+		if (i == 0 || order[i].first != order[i - 1].first)
+			ncells++;
+	}
+	header.ncells = ncells;
+
+	/* Fill the flat buffer */
+	long long size = bufferSize(npoints, ncells);
+	index->m_buffer.resize(size);
+	char *data = index->m_buffer.data();
+	memcpy(data, &header, sizeof(Header));
+	index->attach(data, size);
+
+	unsigned long long *codes = (unsigned long long *)index->m_codes;
+	int *cell_starts = (int *)index->m_cell_starts;
+	float *points = (float *)index->m_points;
+	int *ids = (int *)index->m_ids;
+	int *ranks = (int *)index->m_ranks;
+	int cell = -1;
+	for (int i = 0; i < npoints; i++)
+	{
+		if (i == 0 || order[i].first != order[i - 1].first)
+		{
+			cell++;
+			codes[cell] = order[i].first;
+			cell_starts[cell] = i;
+		}
+		int id = order[i].second;
+		points[3 * i + 0] = x[id * stride];
+		points[3 * i + 1] = y[id * stride];
+		points[3 * i + 2] = z[id * stride];
+		ids[i] = id;
+		ranks[id] = i;
+	}
+	cell_starts[ncells] = npoints;
+
+	return index;
+}
+
+SpatialIndex * SpatialIndex::open(const std::string &filename)
+{
+	QFile *file = new QFile(QString::fromStdString(filename));
+	if (!file->open(QIODevice::ReadOnly))
+	{
+		delete(file);
+		return NULL;
+	}
+
+	uchar *data = file->map(0, file->size());
+	SpatialIndex *index = new SpatialIndex();
+	index->m_file = file;
+	if (data == NULL || !index->attach((const char *)data, file->size()))
+	{
+		delete(index);
+		return NULL;
+	}
+	return index;
+}
+
+SpatialIndex * SpatialIndex::openOrBuild(const std::string &filename, const float *x, const float *y, const float *z, int stride, int npoints, float cell_size)
+{
+	SpatialIndex *index = open(filename);
+	if (index != NULL)
+	{
+		if (index->size() == npoints && index->cellSize() >= cell_size && index->m_header->hash == hashPoints(x, y, z, stride, npoints))
+			return index;
+		delete(index);
+	}
+
+	index = build(x, y, z, stride, npoints, cell_size);
+	if (!index->save(filename))
+		qDebug("SpatialIndex: cannot save %s.", filename.c_str());
+	return index;
+}
+
+bool SpatialIndex::save(const std::string &filename) const
+{
+	std::ofstream out(filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+	out.write((const char *)m_header, bufferSize(m_header->npoints, m_header->ncells));
+	return out.good();
+}
+
+int SpatialIndex::size() const
+{
+	return m_header->npoints;
+}
+
+float SpatialIndex::cellSize() const
+{
+	return m_header->cell_size;
+}
+
+bool SpatialIndex::isMapped() const
+{
+	return m_file != NULL;
+}
+
+void SpatialIndex::getPoint(int index, float p[3]) const
+{
+	const float *q = m_points + 3 * m_ranks[index];
+	p[0] = q[0];
+	p[1] = q[1];
+	p[2] = q[2];
+}
+
+int SpatialIndex::cellOf(float v, int axis) const
+{
+	float cell = floor((v - m_header->min[axis]) / m_header->cell_size);    /* Clamp before the conversion, v may be far away */
+	if (!(cell > 0))
+		return 0;
+	if (cell > m_header->dims[axis] - 1)
+		return m_header->dims[axis] - 1;
+	return (int)cell;
+}
+
+int SpatialIndex::findCell(unsigned long long code) const
+{
+	const unsigned long long *end = m_codes + m_header->ncells;
+	const unsigned long long *it = std::lower_bound(m_codes, end, code);
+	if (it == end || *it != code)
+		return -1;
+	return it - m_codes;
+}
+
+void SpatialIndex::searchCell(int cell, const float p[3], float sqr_radius, std::vector<int> &indices, std::vector<float> &sqr_distances) const
+{
+	for (int i = m_cell_starts[cell]; i < m_cell_starts[cell + 1]; i++)
+	{
+		const float *q = m_points + 3 * i;
+		float dx = q[0] - p[0], dy = q[1] - p[1], dz = q[2] - p[2];
+		float d2 = dx * dx + dy * dy + dz * dz;
+		if (d2 <= sqr_radius)
+		{
+			indices.push_back(m_ids[i]);
+			sqr_distances.push_back(d2);
+		}
+	}
+}
+
+int SpatialIndex::radiusSearch(const float p[3], float radius, std::vector<int> &indices, std::vector<float> &sqr_distances) const
+{
+	indices.clear();
+	sqr_distances.clear();
+
+	int lo[3], hi[3];
+	long long nbox = 1;
+	for (int a = 0; a < 3; a++)
+	{
+		lo[a] = cellOf(p[a] - radius, a);
+		hi[a] = cellOf(p[a] + radius, a);
+		nbox *= hi[a] - lo[a] + 1;
+	}
+	float sqr_radius = radius * radius;
+
+	if (nbox <= SMALL_BOX_CELLS)
+	{
+		for (int cx = lo[0]; cx <= hi[0]; cx++)
+			for (int cy = lo[1]; cy <= hi[1]; cy++)
+				for (int cz = lo[2]; cz <= hi[2]; cz++)
+				{
+					int cell = findCell(morton(cx, cy, cz));
+					if (cell >= 0)
+						searchCell(cell, p, sqr_radius, indices, sqr_distances);
+				}
+	}
+	else
+	{
+		/* Every cell of the box has a code between the codes of its corners */
+		const unsigned long long *end = m_codes + m_header->ncells;
+		const unsigned long long *first = std::lower_bound(m_codes, end, morton(lo[0], lo[1], lo[2]));
+		const unsigned long long *last = std::upper_bound(first, end, morton(hi[0], hi[1], hi[2]));
+		for (const unsigned long long *it = first; it != last; ++it)
+		{
+			int cx, cy, cz;
+			demorton(*it, cx, cy, cz);
+			if (cx >= lo[0] && cx <= hi[0] && cy >= lo[1] && cy <= hi[1] && cz >= lo[2] && cz <= hi[2])
+				searchCell(it - m_codes, p, sqr_radius, indices, sqr_distances);
+		}
+	}
+
+	return indices.size();
+}
+
+int SpatialIndex::radiusSearch(int index, float radius, std::vector<int> &indices, std::vector<float> &sqr_distances) const
+{
+	float p[3];
+	getPoint(index, p);
+	return radiusSearch(p, radius, indices, sqr_distances);
+}
+
+void SpatialIndex::radiusSearch(const std::vector<int> &queries, float radius, std::vector<std::vector<int>> &indices) const
+{
+	int nqueries = queries.size();
+	indices.resize(nqueries);
+#pragma omp parallel
+	{
+		std::vector<float> sqr_distances;
+#pragma omp for schedule(dynamic, 256)
+		for (int i = 0; i < nqueries; i++)
+			radiusSearch(queries[i], radius, indices[i], sqr_distances);
+	}
+}
+
+int SpatialIndex::nearestKSearch(const float p[3], int k, std::vector<int> &indices, std::vector<float> &sqr_distances) const
+{
+	indices.clear();
+	sqr_distances.clear();
+	if (k <= 0 || size() == 0)
+		return 0;
+	if (k > size())
+		k = size();
+
+	/* Grow the radius until it holds k points, those contain the k nearest ones */
+	float diagonal = m_header->cell_size * sqrt((float)(m_header->dims[0] * m_header->dims[0] + m_header->dims[1] * m_header->dims[1] + m_header->dims[2] * m_header->dims[2]));
+	float radius = m_header->cell_size;
+	std::vector<int> found;
+	std::vector<float> found_distances;
+	while (radiusSearch(p, radius, found, found_distances) < k && radius < diagonal)
+		radius *= 2;
+	if ((int)found.size() < k)    /* p is far away from the points, take all of them */
+	{
+		found.clear();
+		found_distances.clear();
+		for (int i = 0; i < size(); i++)
+		{
+			const float *q = m_points + 3 * i;
+			found.push_back(m_ids[i]);
+			found_distances.push_back((q[0] - p[0]) * (q[0] - p[0]) + (q[1] - p[1]) * (q[1] - p[1]) + (q[2] - p[2]) * (q[2] - p[2]));
+		}
+	}
+
+	std::vector<std::pair<float, int>> sorted(found.size());
+	for (int i = 0; i < (int)found.size(); i++)
+		sorted[i] = std::make_pair(found_distances[i], found[i]);
+	std::partial_sort(sorted.begin(), sorted.begin() + k, sorted.end());
+	for (int i = 0; i < k; i++)
+	{
+		indices.push_back(sorted[i].second);
+		sqr_distances.push_back(sorted[i].first);
+	}
+	return k;
+}
+
+int SpatialIndex::coneSearch(const float apex[3], const float axis[3], float half_angle, std::vector<int> &indices) const
+{
+	indices.clear();
+	float cos_angle = cos(half_angle), sin_angle = sin(half_angle);
+	float cell_radius = 0.5 * sqrt(3.0) * m_header->cell_size;
+
+	for (int cell = 0; cell < m_header->ncells; cell++)
+	{
+		/* Skip the cell if its bounding sphere is outside of the cone */
+		int c[3];
+		demorton(m_codes[cell], c[0], c[1], c[2]);
+		float v[3];
+		for (int a = 0; a < 3; a++)
+			v[a] = m_header->min[a] + (c[a] + 0.5) * m_header->cell_size - apex[a];
+		float t = v[0] * axis[0] + v[1] * axis[1] + v[2] * axis[2];
+		float d2 = v[0] * v[0] + v[1] * v[1] + v[2] * v[2] - t * t;
+		float d = d2 > 0 ? sqrt(d2) : 0;
+		if (d * cos_angle - t * sin_angle > cell_radius)
+			continue;
+
+		for (int i = m_cell_starts[cell]; i < m_cell_starts[cell + 1]; i++)
+			indices.push_back(m_ids[i]);
+	}
+
+	return indices.size();
+}
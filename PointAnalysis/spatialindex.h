@@ -0,0 +1,86 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <QFile>
+#include <QString>
+#include <vector>
+#include <string>
+
+#define SPATIAL_INDEX_MAGIC 0x58444950    /* "PIDX" */
+#define SPATIAL_INDEX_VERSION 1
+#define SPATIAL_INDEX_CELL_COEF 0.05    /* Cell size relative to the radius of the model, half the smallest search radius */
+
+/*
+ * Uniform grid over a point cloud with the points stored in Morton (Z) order of their cells.
+ * The non-empty cells are a sorted array of Morton codes with the range of their points, so a
+ * cell is found by binary search and neighboring cells are mostly close in memory.
+ * The whole index is one flat buffer: it is saved next to the feature cache of a model and
+ * memory-mapped (QFile::map) when the model is analysed again, or it lives in memory only.
+ * All queries are const and may run from many threads at once.
+ */
+class SpatialIndex
+{
+public:
+	~SpatialIndex();
+
+	/* Build in memory from npoints points, point i being (x[i * stride], y[i * stride], z[i * stride]) */
+	static SpatialIndex * build(const float *x, const float *y, const float *z, int stride, int npoints, float cell_size);
+	/* Map the index saved in filename, NULL if there is no valid one */
+	static SpatialIndex * open(const std::string &filename);
+	/* Map the index saved in filename if it was built from the same points, otherwise build and save it */
+	static SpatialIndex * openOrBuild(const std::string &filename, const float *x, const float *y, const float *z, int stride, int npoints, float cell_size);
+	bool save(const std::string &filename) const;
+
+	int size() const;
+	float cellSize() const;
+	bool isMapped() const;
+	void getPoint(int index, float p[3]) const;
+
+	/* Indices (in the order given to build()) and squared distances of the points within radius of p, returns the count */
+	int radiusSearch(const float p[3], float radius, std::vector<int> &indices, std::vector<float> &sqr_distances) const;
+	int radiusSearch(int index, float radius, std::vector<int> &indices, std::vector<float> &sqr_distances) const;
+	/* Batched radius search around the points queries, run in parallel */
+	void radiusSearch(const std::vector<int> &queries, float radius, std::vector<std::vector<int>> &indices) const;
+	/* The k nearest points of p, sorted by distance */
+	int nearestKSearch(const float p[3], int k, std::vector<int> &indices, std::vector<float> &sqr_distances) const;
+	/* A superset of the points seen from apex within half_angle of the unit vector axis, culled cell by cell */
+	int coneSearch(const float apex[3], const float axis[3], float half_angle, std::vector<int> &indices) const;
+
+	static unsigned long long hashPoints(const float *x, const float *y, const float *z, int stride, int npoints);
+	/* The indices of the points sorted along the Z-order curve of the finest grid over their bounding box */
+	static void mortonOrder(const float *x, const float *y, const float *z, int stride, int npoints, std::vector<int> &order);
+
+private:
+	struct Header
+	{
+		int magic;
+		int version;
+		int npoints;
+		int ncells;
+		int dims[3];
+		float min[3];
+		float cell_size;
+		int reserved;
+		unsigned long long hash;    /* hashPoints() of the points it was built from */
+	};
+
+	std::vector<char> m_buffer;    /* Owned buffer of an index built in memory */
+	QFile *m_file;    /* Mapped file of an opened index */
+	const Header *m_header;
+	const unsigned long long *m_codes;    /* ncells Morton codes of the non-empty cells, ascending */
+	const int *m_cell_starts;    /* ncells + 1 offsets of the points of each cell */
+	const float *m_points;    /* npoints * 3 coordinates in Morton order */
+	const int *m_ids;    /* npoints original indices in Morton order */
+	const int *m_ranks;    /* npoints positions in Morton order of the original indices */
+
+	SpatialIndex();
+	bool attach(const char *data, long long size);
+	static long long bufferSize(int npoints, int ncells);
+	static unsigned long long morton(int cx, int cy, int cz);
+	static void demorton(unsigned long long code, int &cx, int &cy, int &cz);
+	int findCell(unsigned long long code) const;
+	int cellOf(float v, int axis) const;
+	void searchCell(int cell, const float p[3], float sqr_radius, std::vector<int> &indices, std::vector<float> &sqr_distances) const;
+};
+
+#endif // SPATIALINDEX_H
@@ -1,8 +1,10 @@
 #include "structureanalyser.h"
+#include <QCoreApplication>
 
 StructureAnalyser::StructureAnalyser(QObject *parent)
 	: QObject(parent), m_fe(NULL), classifier_loaded(false), m_testPCThread(NULL), m_genCandThread(NULL), m_pointcloud(NULL),
-	m_predictionThread(NULL)
+	m_predictionThread(NULL), m_mrf_session(NULL), m_mrf_session_key(0), m_index(NULL), m_checkpoints(NULL), m_run(-1), m_classification_source(NOT_CLASSIFIED),
+	m_trws_time_budget(TRWS_TIME_BUDGET)
 {
 	qRegisterMetaType<PAPointCloud *>("PAPointCloudPointer");
 	qRegisterMetaType<QVector<QMap<int, float>>>("ClassificationDistribution");
@@ -15,7 +17,8 @@ StructureAnalyser::StructureAnalyser(QObject *parent)
 
 StructureAnalyser::StructureAnalyser(PCModel *pcModel, QObject * parent)
 	: QObject(parent), m_fe(NULL), classifier_loaded(false), m_testPCThread(NULL), m_genCandThread(NULL), m_pointcloud(NULL),
-	m_predictionThread(NULL)
+	m_predictionThread(NULL), m_mrf_session(NULL), m_mrf_session_key(0), m_index(NULL), m_checkpoints(NULL), m_run(-1), m_classification_source(NOT_CLASSIFIED),
+	m_trws_time_budget(TRWS_TIME_BUDGET)
 {
 	qRegisterMetaType<PAPointCloud *>("PAPointCloudPointer");
 	qRegisterMetaType<QVector<QMap<int, float>>>("ClassificationDistribution");
@@ -28,74 +31,99 @@ StructureAnalyser::StructureAnalyser(PCModel *pcModel, QObject * parent)
 
 StructureAnalyser::~StructureAnalyser()
 {
-	if (m_fe != NULL)
-	{
-		delete(m_fe);
-		m_fe = NULL;
-	}
+	cancel();
 
 	if (m_testPCThread != NULL)
 	{
-		if (m_testPCThread->isRunning())
-			m_testPCThread->terminate();
 		delete(m_testPCThread);
 		m_testPCThread = NULL;
 	}
 
-	if (m_genCandThread != NULL)
-	{
-		if (m_genCandThread->isRunning())
-			m_genCandThread->terminate();
-		delete(m_genCandThread);
-		m_genCandThread = NULL;
-	}
-
-	if (m_predictionThread != NULL)
-	{
-		if (m_predictionThread->isRunning())
-			m_predictionThread->terminate();
-		delete(m_predictionThread);
-		m_predictionThread = NULL;
-	}
-
 	if (m_pointcloud != NULL)
 		delete(m_pointcloud);
 
+	if (m_index != NULL)
+		delete(m_index);
+
+	if (m_checkpoints != NULL)
+		delete(m_checkpoints);
+
 	delete(m_energy_functions);
 }
 
-void StructureAnalyser::execute()
+void StructureAnalyser::execute(int run)
 {
-	if (m_fe != NULL)
-	{
-		delete(m_fe);
-		m_fe = NULL;
-	}
-
-	/* Make sure the last run of TestPCThread is over */
-	if (m_testPCThread != NULL && m_testPCThread->isRunning())
-		m_testPCThread->terminate();
-
-	/* Make sure the last run of GenCandidatesThread is over */
-	if (m_genCandThread != NULL)
-	{
-		if (m_genCandThread->isRunning())
-			m_genCandThread->terminate();
-		delete(m_genCandThread);
-		m_genCandThread = NULL;
-	}
+	/* Make sure the last run is over */
+	cancel();
+	m_run = run;
+	m_classification_source = NOT_CLASSIFIED;
 
 	if (m_pointcloud != NULL)
 	{
 		delete(m_pointcloud);
 		m_pointcloud = NULL;
 	}
+
+	if (m_index != NULL)
+	{
+		delete(m_index);
+		m_index = NULL;
+	}
 	
 	/* Check if the point cloud featrues have been estimated before */
 	QString model_file_name = Utils::getModelName(QString::fromStdString(m_pcModel->getInputFilename()));
 	m_model_name = model_file_name.toStdString();
+
+	/* Resume from the checkpoint of the features if its inputs have not changed */
+	if (m_checkpoints != NULL)
+		delete(m_checkpoints);
+	m_checkpoints = new CheckpointManager(m_model_name);
+	updateCheckpointKeys();
+	removeStaleFeatures();
+	QByteArray payload;
+	if (m_checkpoints->load(CheckpointManager::FEATURES, payload))
+	{
+		PAPointCloud *pointcloud = CheckpointManager::unpackPointCloud(payload);
+		if (pointcloud != NULL && pointcloud->size() == m_pcModel->vertexCount())
+		{
+			LOG_INFO(Logger::General, "Load points features from the checkpoint.");
+			initialize(pointcloud);
+			return;
+		}
+		delete(pointcloud);
+	}
+
 	std::string pcFile = "../data/features_test/" + m_model_name + ".csv";
+	std::string storeFile = "../data/features_test/" + m_model_name + ".paf";
 	std::ifstream feat_file_in(pcFile.c_str());
+	std::ifstream store_in(storeFile.c_str(), std::ios::binary);
+	if (store_in.is_open())    /* If the features have been estimated tile by tile */
+	{
+		store_in.close();
+		PAPointCloud *pointcloud = FeatureStore::load(storeFile.c_str());
+		if (pointcloud != NULL && pointcloud->size() == m_pcModel->vertexCount())
+		{
+			/* The store is in the order the points were loaded */
+			QVector<int> load_order = m_pcModel->getLoadOrder();
+			if (!load_order.isEmpty())
+			{
+				PAPointCloud *reordered = new PAPointCloud(pointcloud->size());
+				for (int row = 0; row < pointcloud->size(); row++)
+					reordered->setPoint(load_order[row], pointcloud->getPoint(row));
+				delete(pointcloud);
+				pointcloud = reordered;
+			}
+			for (int i = 0; i < pointcloud->size(); i++)
+			{
+				GLfloat *point = m_pcModel->data() + i * 9;
+				pointcloud->setPosition(i, point[0], point[1], point[2]);
+			}
+			pointcloud->setRadius(m_pcModel->getRadius());
+			initialize(pointcloud);
+			return;
+		}
+		delete(pointcloud);
+	}
 	if (feat_file_in.is_open())    /* If there is already a features file of the point cloud */
 	{
 		initialize(NULL);
@@ -104,13 +132,76 @@ void StructureAnalyser::execute()
 	else    /* If the point cloud has not been estimated, then estimate it */
 	{
 		m_fe = new FeatureEstimator(m_pcModel, FeatureEstimator::PHASE::TESTING, this);
-		connect(m_fe, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
 		connect(m_fe, SIGNAL(estimateCompleted(PAPointCloud *)), this, SLOT(initialize(PAPointCloud *)));
-		onDebugTextAdded("Estimating points features...");
+		LOG_INFO(Logger::General, "Estimating points features...");
 		m_fe->estimateFeatures();
 	}
 }
 
+/* Mix a 64 bits hash into a key */
+static unsigned long long combineHash(unsigned long long key, unsigned long long h)
+{
+	key = DerivedCache::combine(key, (double)(h >> 32));
+	return DerivedCache::combine(key, (double)(h & 0xffffffffULL));
+}
+
+void StructureAnalyser::updateCheckpointKeys()
+{
+	/* Each key chains the key of the stage before it with the inputs and parameters of its own stage */
+	const GLfloat *data = m_pcModel->constData();
+	int nvertices = m_pcModel->vertexCount();
+	unsigned long long key = SpatialIndex::hashPoints(data, data + 1, data + 2, 9, nvertices);
+	key = combineHash(key, SpatialIndex::hashPoints(data + 3, data + 4, data + 5, 9, nvertices));    /* normals */
+	key = DerivedCache::combine(key, DIMEN);
+	key = DerivedCache::combine(key, m_pcModel->getRadius());
+	m_checkpoints->setKey(CheckpointManager::FEATURES, key);
+
+	std::string rfmodel_path = "../data/classifier/" + m_modelClassName + "_rfmodel.model";
+	key = combineHash(key, DerivedCache::hashFile(rfmodel_path.c_str()));
+	m_checkpoints->setKey(CheckpointManager::PROBABILITIES, key);
+
+	key = combineHash(key, DerivedCache::hashFile("../data/symmetry_groups.txt"));
+	m_checkpoints->setKey(CheckpointManager::CANDIDATES, key);
+
+	key = combineHash(key, m_energy_functions->getParametersKey());
+	m_checkpoints->setKey(CheckpointManager::POTENTIALS, key);
+
+	key = DerivedCache::combine(key, TRWS_MAX_ITER);
+	key = DerivedCache::combine(key, TRWS_GAP_EPS);
+	key = DerivedCache::combine(key, TRWS_STAGNATION_ITER);
+	key = DerivedCache::combine(key, TRWS_STAGNATION_EPS);
+	key = DerivedCache::combine(key, m_trws_time_budget);
+	m_checkpoints->setKey(CheckpointManager::SOLUTION, key);
+}
+
+void StructureAnalyser::removeStaleFeatures()
+{
+	/*
+	 * The .csv features file and the classification computed from it are only valid for the points
+	 * and normals they were computed from. The features key they were written under is kept in
+	 * <model name>.key next to them; a file without a key predates it and is stale as well.
+	 */
+	std::string pcFile = "../data/features_test/" + m_model_name + ".csv";
+	std::string keyFile = "../data/features_test/" + m_model_name + ".key";
+	unsigned long long key = m_checkpoints->getKey(CheckpointManager::FEATURES);
+	unsigned long long saved_key = 0;
+	std::ifstream key_in(keyFile.c_str());
+	bool has_key = (key_in >> std::hex >> saved_key) ? true : false;
+	key_in.close();
+	if (has_key && saved_key == key)
+		return;
+
+	if (QFile::exists(QString::fromStdString(pcFile)))
+	{
+		std::string prediction_path = "../data/predictions/" + m_model_name + ".txt";
+		LOG_WARNING(Logger::General, "The features of %s were computed from other points or normals, they are estimated again.", m_model_name.c_str());
+		QFile::remove(QString::fromStdString(pcFile));
+		QFile::remove(QString::fromStdString(prediction_path));
+	}
+	std::ofstream key_out(keyFile.c_str());
+	key_out << std::hex << key << std::endl;
+}
+
 void StructureAnalyser::onDebugTextAdded(QString text)
 {
 	emit addDebugText(text);
@@ -118,9 +209,7 @@ void StructureAnalyser::onDebugTextAdded(QString text)
 
 void StructureAnalyser::initialize(PAPointCloud *pointcloud)
 {
-	onDebugTextAdded("Points features estimation done.");
-	onDebugTextAdded("Start initialization.");
-	qDebug() << "Points features estimation done. Start initialization.";
+	LOG_INFO(Logger::General, "Points features estimation done. Start initialization.");
 
 	classifyPoints(pointcloud);
 }
@@ -135,13 +224,11 @@ void StructureAnalyser::classifyPoints(PAPointCloud *pointcloud)
 	if (pointcloud != NULL)    /* If there exists no features file of the point cloud */
 	{
 		m_pointcloud = pointcloud;
-		onDebugTextAdded("Classify each point to a certain part label.");
-		qDebug() << "Classify each point to a certain part label.";
-		onDebugTextAdded("Load points features.");
-		qDebug() << "Load points features.";
+		LOG_INFO(Logger::General, "Classify each point to a certain part label.");
+		LOG_DEBUG(Logger::General, "Load points features.");
 
 		/* Output the PAPointCloud to local file */
-		pointcloud->writeToFile(pcFile.c_str());
+		pointcloud->writeToFile(pcFile.c_str(), m_pcModel->getLoadOrder());
 	}
 	else    /* If there already exists a features file of the point cloud */
 	{
@@ -149,27 +236,58 @@ void StructureAnalyser::classifyPoints(PAPointCloud *pointcloud)
 		int nvertices = m_pcModel->vertexCount();
 		m_pointcloud = new PAPointCloud(nvertices);
 
+		/* The lines of the file are in the order the points were loaded */
+		QVector<int> load_order = m_pcModel->getLoadOrder();
 		char buffer[511];
-		for (int i = 0; i < nvertices; i++)
+		for (int row = 0; row < nvertices; row++)
 		{
 			features_in.getline(buffer, 511);
 			QStringList line_data = QString(buffer).split(',');
-			double feats[DIMEN];
 			for (int j = 0; j < DIMEN; j++)
-				feats[j] = line_data[j].toDouble();
-			PAPoint papoint(feats);
+				m_pointcloud->feature(j)[load_order.isEmpty() ? row : load_order[row]] = line_data[j].toFloat();
+		}
+		for (int i = 0; i < nvertices; i++)
+		{
 			GLfloat *point = m_pcModel->data() + i * 9;
 			GLfloat x = point[0];
 			GLfloat y = point[1];
 			GLfloat z = point[2];
-			papoint.setPosition(x, y, z);
-			m_pointcloud->at(i) = papoint;
+			m_pointcloud->setPosition(i, x, y, z);
 		}
 		m_pointcloud->setRadius(m_pcModel->getRadius());
 	}
 
 	/* Set the point cloud to EnergyFunctions object */
 	m_energy_functions->setPointCloud(m_pointcloud);
+	m_checkpoints->save(CheckpointManager::FEATURES, CheckpointManager::packPointCloud(*m_pointcloud));
+
+	/* Resume from the checkpoint of the classification */
+	QByteArray payload;
+	QVector<QMap<int, float>> distributions;
+	if (m_checkpoints->load(CheckpointManager::PROBABILITIES, payload) 
+		&& CheckpointManager::unpackDistributions(payload, distributions) && distributions.size() == m_pointcloud->size())
+	{
+		LOG_INFO(Logger::General, "Load the classification from the checkpoint.");
+		m_classification_source = CHECKPOINT;
+		/* The label of a point is its most probable one but the null label, the last one */
+		QVector<int> labels(distributions.size());
+		for (int i = 0; i < distributions.size(); i++)
+		{
+			float max = -1;
+			QMap<int, float>::const_iterator last = distributions[i].constEnd() - 1;
+			for (QMap<int, float>::const_iterator it = distributions[i].constBegin(); it != last; ++it)
+			{
+				if (it.value() > max)
+				{
+					labels[i] = it.key();
+					max = it.value();
+				}
+			}
+		}
+		onPointLabelsGot(labels);
+		onClassificationDone(distributions);
+		return;
+	}
 
 	/* Create a thread to do the points classification */
 	/* Check whether the point cloud has been classified */
@@ -179,6 +297,7 @@ void StructureAnalyser::classifyPoints(PAPointCloud *pointcloud)
 	if (prediction_in.is_open())    /* If the point cloud has been classified */
 	{
 		prediction_in.close();
+		m_classification_source = PREDICTION_FILE;
 		if (m_testPCThread == NULL)
 		{
 			m_testPCThread = new TestPCThread(0, prediction_path, m_modelClassName, this);
@@ -191,6 +310,7 @@ void StructureAnalyser::classifyPoints(PAPointCloud *pointcloud)
 	}
 	else    /* If the point cloud has not been classified */
 	{
+		m_classification_source = RANDOM_FOREST;
 		if (m_testPCThread == NULL)
 		{
 			m_testPCThread = new TestPCThread(QString::fromStdString(m_model_name), m_modelClassName, this);
@@ -201,6 +321,7 @@ void StructureAnalyser::classifyPoints(PAPointCloud *pointcloud)
 		else
 			m_testPCThread->setPcName(QString::fromStdString(m_model_name));
 	}
+	m_testPCThread->setLoadOrder(m_pcModel->getLoadOrder());
 
 	m_testPCThread->start();
 }
@@ -212,11 +333,30 @@ void StructureAnalyser::onClassificationDone(QVector<QMap<int, float>> distribut
 	m_label_names = distribution[0].keys();
 	/* Set the classification probability distribution to EnergyFunctions object */
 	m_energy_functions->setDistributions(distribution);
+	m_checkpoints->save(CheckpointManager::PROBABILITIES, CheckpointManager::packDistributions(distribution));
+
+	/* Resume from the checkpoint of the candidates */
+	QByteArray payload;
+	Part_Candidates part_candidates;
+	if (m_checkpoints->load(CheckpointManager::CANDIDATES, payload) && CheckpointManager::unpackCandidates(payload, part_candidates))
+	{
+		LOG_INFO(Logger::General, "Load the parts candidates from the checkpoint.");
+		onGenCandidatesDone(part_candidates.size(), part_candidates);
+		return;
+	}
 
 	/* Create a thread to generate the part candidates */
 	m_genCandThread = new GenCandidatesThread(m_pointcloud, m_model_name, distribution, this);
+	/* Map the spatial index the FeatureEstimator saved for the model, or build it if the features were loaded from a file */
+	if (m_index == NULL)
+	{
+		std::string index_filename = "../data/features_test/" + m_model_name + ".pidx";
+		const GLfloat *data = m_pcModel->constData();
+		m_index = SpatialIndex::openOrBuild(index_filename, data, data + 1, data + 2, 9, m_pcModel->vertexCount(), 
+			SPATIAL_INDEX_CELL_COEF * m_pcModel->getRadius());
+	}
+	m_genCandThread->setSpatialIndex(m_index);
 	//m_genCandThread = new GenCandidatesThread(144, this);    /* Directly load candidates from local files */
-	connect(m_genCandThread, SIGNAL(addDebugText(QString)), this, SLOT(onDebugTextAdded(QString)));
 	connect(m_genCandThread, SIGNAL(genCandidatesDone(int, Part_Candidates)), this, SLOT(onGenCandidatesDone(int, Part_Candidates)));
 	//connect(m_genCandThread, SIGNAL(setOBBs(QVector<OBB *>)), this, SLOT(setOBBs(QVector<OBB *>)));
 	m_genCandThread->start();
@@ -229,19 +369,71 @@ void StructureAnalyser::onPointLabelsGot(QVector<int> labels)
 
 void StructureAnalyser::onGenCandidatesDone(int num_of_candidates, Part_Candidates part_candidates)
 {
-	onDebugTextAdded("Genarating parts candidates has finished.");
-	qDebug() << "Generating parts candidates has finished.";
+	LOG_INFO(Logger::General, "Generating parts candidates has finished.");
 
 	m_parts_candidates = part_candidates;
+	m_checkpoints->save(CheckpointManager::CANDIDATES, CheckpointManager::packCandidates(part_candidates));
 
-	onDebugTextAdded("There are " + QString::number(part_candidates.size()) + " part candidates in total.");
-	qDebug("Threre are %d part candidates in total.", part_candidates.size());
+	LOG_INFO(Logger::General, "There are %d part candidates in total.", part_candidates.size());
+
+	predict();
+}
+
+void StructureAnalyser::repredict()
+{
+	if (m_parts_candidates.isEmpty())
+		return;
+	predict();
+}
 
+void StructureAnalyser::predict()
+{
 	/* Do part labels and orientations prediction */
-	onDebugTextAdded("Predict part labels and orientations.");
-	qDebug() << "Predict part labels and orientations.";
+	LOG_INFO(Logger::General, "Predict part labels and orientations.");
+
+	if (m_predictionThread != NULL)
+	{
+		m_predictionThread->cancel();
+		delete(m_predictionThread);
+		m_predictionThread = NULL;
+	}
 
-	m_predictionThread = new PredictionThread(m_energy_functions, part_candidates, m_label_names, this);
+	/* Reuse the inference session if it is of the same model and candidates and has been minimized,
+	 * the prediction thread then only replaces the changed potentials. The candidates key chains the
+	 * points, the classifier and the symmetry groups the candidates were generated from */
+	unsigned long long session_key = DerivedCache::combine(m_checkpoints->getKey(CheckpointManager::CANDIDATES),
+		qHash(QString::fromStdString(m_model_name)));
+	session_key = DerivedCache::combine(session_key, m_label_names.size());
+	session_key = DerivedCache::combine(session_key, m_parts_candidates.size());
+	if (m_mrf_session != NULL && (!m_mrf_session->isWarm() || m_mrf_session_key != session_key))
+	{
+		delete(m_mrf_session);
+		m_mrf_session = NULL;
+	}
+	if (m_mrf_session == NULL)
+	{
+		m_mrf_session = createMRFSolver(m_label_names.size(), m_parts_candidates.size());
+		m_mrf_session_key = session_key;
+	}
+
+	/* The weights may have changed since the last prediction */
+	updateCheckpointKeys();
+	QByteArray payload;
+	QMap<int, int> parts_picked;
+	if (m_checkpoints->load(CheckpointManager::SOLUTION, payload) && CheckpointManager::unpackSolution(payload, parts_picked))
+	{
+		LOG_INFO(Logger::General, "Load the prediction from the checkpoint.");
+		onPredictionDone(parts_picked);
+		return;
+	}
+
+	m_predictionThread = new PredictionThread(m_energy_functions, m_parts_candidates, m_label_names, this);
+	m_predictionThread->setInferenceSession(m_mrf_session);
+	m_predictionThread->setTimeBudget(m_trws_time_budget);
+	QVector<double> unary, pairwise;
+	if (m_checkpoints->load(CheckpointManager::POTENTIALS, payload) && CheckpointManager::unpackPotentials(payload, unary, pairwise))
+		m_predictionThread->setPotentials(unary, pairwise);
+	connect(m_predictionThread, SIGNAL(potentialsReady(QVector<double>, QVector<double>)), this, SLOT(onPotentialsReady(QVector<double>, QVector<double>)));
 	connect(m_predictionThread, SIGNAL(predictionDone(QMap<int, int>)), this, SLOT(onPredictionDone(QMap<int, int>)));
 	//connect(m_predictionThread, SIGNAL(predictionDone()), this, SLOT(onPredictionDone()));
 	m_predictionThread->execute();
@@ -249,7 +441,8 @@ void StructureAnalyser::onGenCandidatesDone(int num_of_candidates, Part_Candidat
 
 void StructureAnalyser::onPredictionDone(QMap<int, int> parts_picked)
 {
-	qDebug() << "Part labels and orientations prediction done.";
+	LOG_INFO(Logger::General, "Part labels and orientations prediction done.");
+	m_checkpoints->save(CheckpointManager::SOLUTION, CheckpointManager::packSolution(parts_picked));
 
 	int numLabels = m_label_names.size();
 	QVector<OBB *> obbs(parts_picked.size());
@@ -264,6 +457,23 @@ void StructureAnalyser::onPredictionDone(QMap<int, int> parts_picked)
 	}
 
 	emit sendOBBs(obbs);
+	exportTrace();
+}
+
+void StructureAnalyser::exportTrace()
+{
+	/* The spans since the last export, from the loading of the model to the prediction */
+	QDir().mkpath("../data/traces");
+	std::string trace_path = "../data/traces/" + m_model_name + ".json";
+	if (Tracer::writeChromeTrace(trace_path))
+		LOG_INFO(Logger::General, "Trace written to %s.", trace_path.c_str());
+	LOG_INFO(Logger::General, "%s", qPrintable(Tracer::summary()));
+	Tracer::clear();
+}
+
+void StructureAnalyser::onPotentialsReady(QVector<double> unary, QVector<double> pairwise)
+{
+	m_checkpoints->save(CheckpointManager::POTENTIALS, CheckpointManager::packPotentials(unary, pairwise));
 }
 
 //void StructureAnalyser::onPredictionDone()
@@ -274,14 +484,92 @@ void StructureAnalyser::onPredictionDone(QMap<int, int> parts_picked)
 
 void StructureAnalyser::setPointCloud(PCModel *pcModel)
 {
-	if (m_testPCThread != NULL && m_testPCThread->isRunning())
-		m_testPCThread->terminate();
-	if (m_genCandThread != NULL && m_genCandThread->isRunning())
-		m_genCandThread->terminate();
-	
+	/* The threads of the last run use the model, which the caller may free */
+	cancel();
 	m_pcModel = pcModel;
 }
 
+void StructureAnalyser::setModelClassName(std::string modelClassName)
+{
+	if (modelClassName == m_modelClassName)
+		return;
+	m_modelClassName = modelClassName;
+	cancel();
+	delete(m_energy_functions);
+	m_energy_functions = new EnergyFunctions(m_modelClassName);
+
+	/* The classification thread keeps the classifier of its class */
+	if (m_testPCThread != NULL)
+	{
+		delete(m_testPCThread);
+		m_testPCThread = NULL;
+	}
+}
+
+void StructureAnalyser::cancel()
+{
+	/* Each thread is asked to stop at its next check and waited for, none is terminated */
+	if (m_fe != NULL)
+	{
+		m_fe->cancel();
+		delete(m_fe);
+		m_fe = NULL;
+	}
+
+	if (m_testPCThread != NULL && m_testPCThread->isRunning())
+	{
+		m_testPCThread->requestInterruption();
+		m_testPCThread->wait();
+	}
+
+	if (m_genCandThread != NULL)
+	{
+		m_genCandThread->requestInterruption();
+		m_genCandThread->wait();
+		delete(m_genCandThread);
+		m_genCandThread = NULL;
+	}
+
+	if (m_predictionThread != NULL)
+	{
+		m_predictionThread->cancel();
+		delete(m_predictionThread);
+		m_predictionThread = NULL;
+	}
+
+	/* The candidates and the session are of the model of the cancelled run, and a cancelled minimization leaves the messages half updated */
+	m_parts_candidates.clear();
+	if (m_mrf_session != NULL)
+	{
+		delete(m_mrf_session);
+		m_mrf_session = NULL;
+	}
+
+	/* The results the threads queued before they stopped are of the cancelled run */
+	QCoreApplication::removePostedEvents(this, QEvent::MetaCall);
+	m_run = -1;
+}
+
+int StructureAnalyser::run() const
+{
+	return m_run;
+}
+
+StructureAnalyser::CLASSIFICATION_SOURCE StructureAnalyser::getClassificationSource() const
+{
+	return m_classification_source;
+}
+
+void StructureAnalyser::setTrwsTimeBudget(double seconds)
+{
+	m_trws_time_budget = seconds;
+}
+
+double StructureAnalyser::getTrwsTimeBudget() const
+{
+	return m_trws_time_budget;
+}
+
 void StructureAnalyser::setOBBs(QVector<OBB *> obbs)
 {
 	qDebug() << "StructureAnalyser::setOBBs()";
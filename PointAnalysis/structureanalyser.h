@@ -7,6 +7,8 @@
 #include <QVector>
 #include <string>
 #include <QDebug>
+#include <QDir>
+#include <QFile>
 #include <shark/Data/Csv.h>
 #include <shark/Data/Dataset.h> //importing the file
 #include <shark/Algorithms/Trainers/RFTrainer.h> //the random forest trainer
@@ -22,12 +24,16 @@
 #include "papart.h"
 #include "PAPointCloud.h"
 #include "PAPoint.h"
+#include "featurestore.h"
+#include "spatialindex.h"
 #include "featureestimator.h"
 #include "obbestimator.h"
 #include "testpcthread.h"
 #include "gencandidatesthread.h"
 #include "energyfunctions.h"
 #include "predictionthread.h"
+#include "derivedcache.h"
+#include "checkpointmanager.h"
 
 typedef boost::adjacency_list<boost::vecS, boost::vecS, boost::undirectedS> Graph;
 
@@ -36,12 +42,27 @@ class StructureAnalyser : public QObject
 	Q_OBJECT
 
 public:
+	enum CLASSIFICATION_SOURCE{
+		NOT_CLASSIFIED,
+		RANDOM_FOREST,
+		PREDICTION_FILE,    /* ../data/predictions/<model name>.txt */
+		CHECKPOINT,
+		NUM_OF_CLASSIFICATION_SOURCES
+	};
+
 	StructureAnalyser(PCModel *pcModel, QObject *parent = 0);
 	StructureAnalyser(QObject *parent = 0);
 	~StructureAnalyser();
 
-	void execute();
+	void execute(int run = 0);    /* run: id of the analysis, see run() */
 	void setPointCloud(PCModel *pcModel);
+	void setModelClassName(std::string modelClassName);    /* The classifier, label names and priors of the class */
+	/* Stops the threads of the current analysis and waits for them, the results they have sent meanwhile are dropped */
+	void cancel();
+	int run() const;    /* Id given to execute() of the current analysis, -1 once it is cancelled */
+	CLASSIFICATION_SOURCE getClassificationSource() const;    /* Of the points of the current analysis */
+	void setTrwsTimeBudget(double seconds);    /* Of the next predictions, TRWS_TIME_BUDGET by default, 0 for no limit */
+	double getTrwsTimeBudget() const;
 
 	public slots:
 	void onDebugTextAdded(QString text);
@@ -50,6 +71,8 @@ public:
 	void onPointLabelsGot(QVector<int> labels);
 	void onGenCandidatesDone(int num_of_candidates, Part_Candidates part_candidates);
 	void onPredictionDone(QMap<int, int> part_picked);
+	void onPotentialsReady(QVector<double> unary, QVector<double> pairwise);
+	void repredict();    /* Predict again on the current candidates, e.g. after EnergyFunctions::setWeights() */
 	void setOBBs(QVector<OBB *> obbs);
 	//void onPredictionDone();
 
@@ -70,8 +93,19 @@ private:
 	GenCandidatesThread *m_genCandThread;
 	EnergyFunctions *m_energy_functions;
 	PredictionThread *m_predictionThread;
+	MRFSolver *m_mrf_session;    /* Kept between predictions to warm-start TRW-S */
+	unsigned long long m_mrf_session_key;    /* The model and candidates the session was built for */
+	SpatialIndex *m_index;    /* Index of the points of m_pcModel, shared with the FeatureEstimator through its file */
+	CheckpointManager *m_checkpoints;    /* Outputs of the stages of the current model, a run resumes from the last valid one */
+	int m_run;
+	CLASSIFICATION_SOURCE m_classification_source;
+	double m_trws_time_budget;
 
 	void classifyPoints(PAPointCloud *pointcloud);
+	void predict();
+	void updateCheckpointKeys();
+	void removeStaleFeatures();    /* The features file and classification of the model, if computed under another features key */
+	void exportTrace();    /* Chrome trace of the analysis to ../data/traces, and its summary */
 	
 };
 
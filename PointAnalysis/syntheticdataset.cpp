@@ -0,0 +1,352 @@
+#include "syntheticdataset.h"
+#include <QDir>
+#include <cmath>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+#define SYNTHETIC_DATASET_MISLABELED 0.05    /* Fraction of the points classified with a wrong label */
+
+namespace
+{
+	const float PI = 3.14159265f;
+
+	/* Uniform in [0, 1), the same on every platform unlike std::uniform_real_distribution */
+	float uniform(std::mt19937 &rng)
+	{
+		return (rng() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	float uniform(std::mt19937 &rng, float low, float high)
+	{
+		return low + (high - low) * uniform(rng);
+	}
+
+	SyntheticDataset::Primitive primitive(bool cylinder, float cx, float cy, float cz, float hx, float hy, float hz, int label)
+	{
+		SyntheticDataset::Primitive p;
+		p.cylinder = cylinder;
+		p.center[0] = cx;
+		p.center[1] = cy;
+		p.center[2] = cz;
+		p.half[0] = hx;
+		p.half[1] = hy;
+		p.half[2] = hz;
+		p.label = label;
+		return p;
+	}
+
+	float area(const SyntheticDataset::Primitive &p)
+	{
+		const float *h = p.half;
+		if (p.cylinder)
+			return 2.0f * PI * h[0] * (2.0f * h[1]) + 2.0f * PI * h[0] * h[0];
+		return 8.0f * (h[0] * h[1] + h[1] * h[2] + h[0] * h[2]);
+	}
+}
+
+SyntheticDataset::SyntheticDataset(std::string class_name, SHAPE shape, int npoints, unsigned int seed)
+	: m_class_name(class_name), m_shape(shape), m_npoints(npoints), m_seed(seed)
+{
+
+}
+
+std::string SyntheticDataset::listFilename() const
+{
+	return "../data/" + m_class_name + "_list.txt";
+}
+
+QList<int> SyntheticDataset::labelNames(SHAPE shape)
+{
+	if (shape == TABLE)
+		return QList<int>() << 0 << 1 << 2;
+	return QList<int>() << 0 << 1 << 2 << 3;
+}
+
+std::vector<SyntheticDataset::Primitive> SyntheticDataset::chair(std::mt19937 &rng)
+{
+	/* y is up, the seat is the first primitive */
+	std::vector<Primitive> primitives;
+	float width = uniform(rng, 0.4f, 0.6f), depth = uniform(rng, 0.4f, 0.6f);
+	float thickness = uniform(rng, 0.03f, 0.08f), height = uniform(rng, 0.4f, 0.5f);
+	primitives.push_back(primitive(false, 0, height, 0, width / 2, thickness / 2, depth / 2, 1));
+
+	float back_height = uniform(rng, 0.3f, 0.6f), back_thickness = uniform(rng, 0.02f, 0.05f);
+	primitives.push_back(primitive(false, 0, height + thickness / 2 + back_height / 2, -depth / 2 + back_thickness / 2,
+		width / 2, back_height / 2, back_thickness / 2, 0));
+
+	bool round_legs = uniform(rng) < 0.5f;
+	float leg = uniform(rng, 0.015f, 0.035f), leg_half_height = (height - thickness / 2) / 2;
+	for (int k = 0; k < 4; k++)
+	{
+		float x = (k % 2 == 0 ? -1 : 1) * (width / 2 - leg), z = (k / 2 == 0 ? -1 : 1) * (depth / 2 - leg);
+		primitives.push_back(primitive(round_legs, x, leg_half_height, z, leg, leg_half_height, leg, 2));
+	}
+
+	if (uniform(rng) < 0.5f)
+	{
+		float arm = uniform(rng, 0.02f, 0.04f), arm_height = uniform(rng, 0.15f, 0.25f);
+		for (int k = 0; k < 2; k++)
+		{
+			float x = (k == 0 ? -1 : 1) * (width / 2 + arm);
+			primitives.push_back(primitive(false, x, height + arm_height, 0, arm, arm, depth * 0.45f, 3));
+		}
+	}
+	return primitives;
+}
+
+std::vector<SyntheticDataset::Primitive> SyntheticDataset::table(std::mt19937 &rng)
+{
+	/* y is up, the top is the first primitive */
+	std::vector<Primitive> primitives;
+	float thickness = uniform(rng, 0.03f, 0.06f), height = uniform(rng, 0.65f, 0.8f);
+	float leg_half_height = (height - thickness / 2) / 2;
+	if (uniform(rng) < 0.3f)    /* Round top on a pedestal */
+	{
+		float radius = uniform(rng, 0.4f, 0.7f);
+		primitives.push_back(primitive(true, 0, height, 0, radius, thickness / 2, radius, 0));
+		float pedestal = uniform(rng, 0.04f, 0.08f);
+		primitives.push_back(primitive(true, 0, leg_half_height, 0, pedestal, leg_half_height, pedestal, 1));
+		return primitives;
+	}
+
+	float width = uniform(rng, 0.8f, 1.6f), depth = uniform(rng, 0.5f, 0.9f);
+	primitives.push_back(primitive(false, 0, height, 0, width / 2, thickness / 2, depth / 2, 0));
+	bool round_legs = uniform(rng) < 0.5f;
+	float leg = uniform(rng, 0.02f, 0.04f), inset = uniform(rng, 0.0f, 0.08f);
+	for (int k = 0; k < 4; k++)
+	{
+		float x = (k % 2 == 0 ? -1 : 1) * (width / 2 - leg - inset), z = (k / 2 == 0 ? -1 : 1) * (depth / 2 - leg - inset);
+		primitives.push_back(primitive(round_legs, x, leg_half_height, z, leg, leg_half_height, leg, 1));
+	}
+
+	if (uniform(rng) < 0.5f)
+	{
+		float stretcher = leg * 0.6f, y = uniform(rng, 0.15f, 0.35f) * height;
+		for (int k = 0; k < 2; k++)
+		{
+			float z = (k == 0 ? -1 : 1) * (depth / 2 - leg - inset);
+			primitives.push_back(primitive(false, 0, y, z, width / 2 - 2 * leg - inset, stretcher, stretcher, 2));
+		}
+	}
+	return primitives;
+}
+
+void SyntheticDataset::sample(const std::vector<Primitive> &primitives, int npoints, std::mt19937 &rng,
+	std::vector<float> &coordinates, std::vector<int> &labels, std::vector<float> &sdf)
+{
+	int nprimitives = primitives.size();
+	float total_area = 0;
+	for (int p = 0; p < nprimitives; p++)
+		total_area += area(primitives[p]);
+
+	/* Points per primitive in proportion to its area, in triples, the rest on the first one */
+	int ntriples = npoints / 3;
+	std::vector<int> counts(nprimitives);
+	int assigned = 0;
+	for (int p = 0; p < nprimitives; p++)
+	{
+		counts[p] = (int)(ntriples * area(primitives[p]) / total_area);
+		assigned += counts[p];
+	}
+	counts[0] += ntriples - assigned;
+
+	coordinates.resize(9 * ntriples);
+	labels.resize(3 * ntriples);
+	sdf.resize(3 * ntriples);
+	int i = 0;
+	for (int p = 0; p < nprimitives; p++)
+	{
+		const Primitive &prim = primitives[p];
+		const float *c = prim.center, *h = prim.half;
+		for (int k = 0; k < 3 * counts[p]; k++, i++)
+		{
+			float *point = &coordinates[3 * i];
+			float sign = uniform(rng) < 0.5f ? -1.0f : 1.0f;
+			if (prim.cylinder)
+			{
+				float side_area = 2.0f * PI * h[0] * (2.0f * h[1]), cap_area = PI * h[0] * h[0];
+				if (uniform(rng) * (side_area + 2.0f * cap_area) < side_area)
+				{
+					float theta = 2.0f * PI * uniform(rng);
+					point[0] = c[0] + h[0] * std::cos(theta);
+					point[1] = c[1] + (2.0f * uniform(rng) - 1.0f) * h[1];
+					point[2] = c[2] + h[0] * std::sin(theta);
+					sdf[i] = 2.0f * h[0];
+				}
+				else
+				{
+					float theta = 2.0f * PI * uniform(rng), rho = h[0] * std::sqrt(uniform(rng));
+					point[0] = c[0] + rho * std::cos(theta);
+					point[1] = c[1] + sign * h[1];
+					point[2] = c[2] + rho * std::sin(theta);
+					sdf[i] = 2.0f * h[1];
+				}
+			}
+			else
+			{
+				/* A face orthogonal to x, y or z in proportion to its area */
+				float face_area[3] = { h[1] * h[2], h[0] * h[2], h[0] * h[1] };
+				float pick = uniform(rng) * (face_area[0] + face_area[1] + face_area[2]);
+				int axis = pick < face_area[0] ? 0 : (pick < face_area[0] + face_area[1] ? 1 : 2);
+				for (int d = 0; d < 3; d++)
+					point[d] = c[d] + (d == axis ? sign : 2.0f * uniform(rng) - 1.0f) * h[d];
+				sdf[i] = 2.0f * h[axis];
+			}
+			labels[i] = prim.label;
+		}
+	}
+}
+
+bool SyntheticDataset::writeModel(const std::string &name, const std::vector<float> &coordinates, const std::vector<int> &labels,
+	const std::vector<float> &sdf, std::mt19937 &rng) const
+{
+	std::string class_dir = "../data/" + m_class_name + "/";
+	std::ofstream off_out((class_dir + "off/" + name + ".off").c_str());
+	std::ofstream seg_out((class_dir + "gt/" + name + ".seg").c_str());
+	std::ofstream sdf_out(("../data/sdf/" + m_class_name + "/" + name + ".sdff").c_str());
+	std::ofstream prediction_out(("../data/predictions/" + name + ".txt").c_str());
+	if (!off_out.is_open() || !seg_out.is_open() || !sdf_out.is_open() || !prediction_out.is_open())
+		return false;
+
+	/* The loaders split the lines on single spaces */
+	int nvertices = labels.size();
+	/* Scaled to [0, 1] over the model, as CGAL::sdf_values_postprocessing does for the sdf of the meshes */
+	float min_sdf = nvertices > 0 ? *std::min_element(sdf.begin(), sdf.end()) : 0;
+	float max_sdf = nvertices > 0 ? *std::max_element(sdf.begin(), sdf.end()) : 0;
+	float sdf_range = max_sdf - min_sdf;
+	off_out << "OFF" << std::endl;
+	off_out << nvertices << " " << nvertices / 3 << " 0" << std::endl;
+	for (int i = 0; i < nvertices; i++)
+	{
+		off_out << coordinates[3 * i] << " " << coordinates[3 * i + 1] << " " << coordinates[3 * i + 2] << std::endl;
+		sdf_out << (sdf_range > 0 ? (sdf[i] - min_sdf) / sdf_range : 0.0f) << std::endl;
+	}
+	for (int f = 0; f < nvertices / 3; f++)
+	{
+		off_out << "3 " << 3 * f << " " << 3 * f + 1 << " " << 3 * f + 2 << std::endl;
+		seg_out << labels[3 * f] << std::endl;
+	}
+
+	/* In the format of TestPCThread::saveClassification, the null label last */
+	QList<int> label_names = labelNames(m_shape);
+	int nlabels = label_names.size();
+	float other = (1.0f - (float)SYNTHETIC_DATASET_CONFIDENCE) / (nlabels - 1);
+	for (int i = 0; i < nvertices; i++)
+	{
+		int label = labels[i];
+		if (uniform(rng) < SYNTHETIC_DATASET_MISLABELED)
+			label = label_names[(label_names.indexOf(label) + 1 + rng() % (nlabels - 1)) % nlabels];
+		for (int l = 0; l < nlabels; l++)
+			prediction_out << label_names[l] << "_" << (label_names[l] == label ? (float)SYNTHETIC_DATASET_CONFIDENCE : other) << " ";
+		prediction_out << label_names.last() + 1 << "_" << SYNTHETIC_DATASET_NULL_PROBABILITY << std::endl;
+	}
+	return !off_out.fail() && !seg_out.fail() && !sdf_out.fail() && !prediction_out.fail();
+}
+
+void SyntheticDataset::accumulateRelations(const std::vector<float> &coordinates, const std::vector<int> &labels,
+	QMap<QPair<int, int>, RelationStatistics> &statistics)
+{
+	/* In the unit of the loaded models, as TrainPartsThread::accumulateModel */
+	std::vector<float> normalized(coordinates);
+	Utils::normalizePoints(normalized.data(), (int)labels.size());
+
+	QMap<int, pcl::PointCloud<pcl::PointXYZ>::Ptr> part_clouds;
+	for (int i = 0; i < (int)labels.size(); i++)
+	{
+		if (!part_clouds.contains(labels[i]))
+			part_clouds.insert(labels[i], pcl::PointCloud<pcl::PointXYZ>::Ptr(new pcl::PointCloud<pcl::PointXYZ>));
+		part_clouds[labels[i]]->push_back(pcl::PointXYZ(normalized[3 * i], normalized[3 * i + 1], normalized[3 * i + 2]));
+	}
+
+	QVector<PAPart> parts;
+	for (QMap<int, pcl::PointCloud<pcl::PointXYZ>::Ptr>::iterator it = part_clouds.begin(); it != part_clouds.end(); ++it)
+	{
+		OBBEstimator obbe(it.key(), it.value());
+		OBB *obb = obbe.computeOBB();
+		parts.push_back(PAPart(obb));
+		delete(obb);
+	}
+
+	for (int i = 0; i < parts.size(); i++)
+	{
+		for (int j = 0; j < parts.size(); j++)
+		{
+			if (i != j)
+			{
+				PAPartRelation relation(parts[i], parts[j]);
+				statistics[QPair<int, int>(parts[i].getLabel(), parts[j].getLabel())].add(relation.getFeatureVector());
+			}
+		}
+	}
+}
+
+bool SyntheticDataset::writeClassFiles(const QMap<QPair<int, int>, RelationStatistics> &statistics, const QStringList &off_files) const
+{
+	std::ofstream label_names_out(("../data/label_names/" + m_class_name + "_labelnames.txt").c_str());
+	QList<int> label_names = labelNames(m_shape);
+	for (int l = 0; l < label_names.size(); l++)
+		label_names_out << label_names[l] << std::endl;
+
+	std::ofstream list_out(listFilename().c_str());
+	for (int i = 0; i < off_files.size(); i++)
+		list_out << off_files[i].toStdString() << std::endl;
+
+	QMap<QPair<int, int>, Eigen::VectorXd> means;
+	QMap<QPair<int, int>, Eigen::MatrixXd> covariances;
+	for (QMap<QPair<int, int>, RelationStatistics>::const_iterator it = statistics.constBegin(); it != statistics.constEnd(); ++it)
+	{
+		means.insert(it.key(), it.value().mean());
+		covariances.insert(it.key(), it.value().covariance());
+	}
+	RelationPriors *priors = RelationPriors::build(means, covariances);
+	bool saved = priors->save("../data/parts_relations/" + m_class_name + RELATION_PRIORS_SUFFIX);
+	delete(priors);
+	return saved && !label_names_out.fail() && !list_out.fail();
+}
+
+QStringList SyntheticDataset::generate(int nmodels)
+{
+	QDir dir;
+	QString class_dir = "../data/" + QString::fromStdString(m_class_name);
+	dir.mkpath(class_dir + "/off");
+	dir.mkpath(class_dir + "/gt");
+	dir.mkpath("../data/sdf/" + QString::fromStdString(m_class_name));
+	dir.mkpath("../data/predictions");
+	dir.mkpath("../data/label_names");
+	dir.mkpath("../data/parts_relations");
+
+	QStringList off_files;
+	QMap<QPair<int, int>, RelationStatistics> statistics;
+	std::vector<float> coordinates, sdf;
+	std::vector<int> labels;
+	for (int m = 0; m < nmodels; m++)
+	{
+		/* A generator per model, a model does not depend on the number of models */
+		std::seed_seq seeds = { m_seed, (unsigned int)m };
+		std::mt19937 rng(seeds);
+		char name_buffer[16];
+		sprintf(name_buffer, "_%04d", m);
+		std::string name = m_class_name + name_buffer;
+
+		std::vector<Primitive> primitives = m_shape == TABLE ? table(rng) : chair(rng);
+		sample(primitives, m_npoints, rng, coordinates, labels, sdf);
+		if (!writeModel(name, coordinates, labels, sdf, rng))
+		{
+			LOG_ERROR(Logger::General, "Can't write the synthetic model %s.", name.c_str());
+			return QStringList();
+		}
+		accumulateRelations(coordinates, labels, statistics);
+		off_files.append(class_dir + "/off/" + QString::fromStdString(name) + ".off");
+		LOG_DEBUG(Logger::General, "Synthetic model %s: %d primitives, %d points.", name.c_str(), (int)primitives.size(), (int)labels.size());
+	}
+
+	if (!writeClassFiles(statistics, off_files))
+	{
+		LOG_ERROR(Logger::General, "Can't write the files of the synthetic class %s.", m_class_name.c_str());
+		return QStringList();
+	}
+	LOG_INFO(Logger::General, "%d synthetic models of %d points written to %s, listed in %s.", nmodels, m_npoints / 3 * 3,
+		qPrintable(class_dir), listFilename().c_str());
+	return off_files;
+}
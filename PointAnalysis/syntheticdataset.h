@@ -0,0 +1,77 @@
+#ifndef SYNTHETICDATASET_H
+#define SYNTHETICDATASET_H
+
+#include <QStringList>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <vector>
+#include <string>
+#include <random>
+#include "trainpartsthread.h"
+
+#define SYNTHETIC_DATASET_SEED 20161019u
+#define SYNTHETIC_DATASET_POINTS 10000    /* Points of a model, about the size of the COSEG models */
+#define SYNTHETIC_DATASET_CONFIDENCE 0.7    /* Probability of the true label in the written classification */
+#define SYNTHETIC_DATASET_NULL_PROBABILITY 0.1    /* Of the null label, as TestPCThread sets it */
+
+/*
+ * COSEG-like datasets of parametric chairs or tables, so the pipeline can be run and timed
+ * without the COSEG models. A model is a set of labeled primitives (boxes and cylinders along y)
+ * whose dimensions, number of legs and optional parts are drawn from the seed; its points are
+ * sampled uniformly on the surface of the primitives. For a class name <class> it writes:
+ *   ../data/<class>/off/<class>_NNNN.off    consecutive triples of points of a primitive are the faces
+ *   ../data/<class>/gt/<class>_NNNN.seg     the label of each face
+ *   ../data/sdf/<class>/<class>_NNNN.sdff   the sdf of each point, the thickness of its primitive along its normal
+ *                                           scaled to [0, 1] over the model as the sdf of the meshes
+ *   ../data/predictions/<class>_NNNN.txt    a classification (SYNTHETIC_DATASET_CONFIDENCE on the true label)
+ *                                           which StructureAnalyser loads in place of the random forest
+ *   ../data/label_names/<class>_labelnames.txt and ../data/parts_relations/<class>_priors.papr
+ *                                           the part relation priors of the ground truth parts of the models
+ *   ../data/<class>_list.txt                the off files, one per line
+ * The same class, shape, size and seed give the same files.
+ */
+class SyntheticDataset
+{
+public:
+	enum SHAPE{
+		CHAIR,    /* 0 back, 1 seat, 2 legs, 3 arms (optional) */
+		TABLE    /* 0 top, 1 legs, 2 stretchers (optional) */
+	};
+
+	struct Primitive
+	{
+		bool cylinder;    /* Along y, of radius half[0] */
+		float center[3];
+		float half[3];    /* Half lengths along x, y and z */
+		int label;
+	};
+
+	SyntheticDataset(std::string class_name, SHAPE shape = CHAIR, int npoints = SYNTHETIC_DATASET_POINTS, unsigned int seed = SYNTHETIC_DATASET_SEED);
+
+	/* Write nmodels models and the files of the class, the off files of the models or an empty list if a file can't be written */
+	QStringList generate(int nmodels);
+	std::string listFilename() const;
+
+	static std::vector<Primitive> chair(std::mt19937 &rng);
+	static std::vector<Primitive> table(std::mt19937 &rng);
+	static QList<int> labelNames(SHAPE shape);
+
+private:
+	std::string m_class_name;
+	SHAPE m_shape;
+	int m_npoints;
+	unsigned int m_seed;
+
+	/* npoints / 3 * 3 points with their labels and sdf, the points of a primitive are consecutive */
+	static void sample(const std::vector<Primitive> &primitives, int npoints, std::mt19937 &rng,
+		std::vector<float> &coordinates, std::vector<int> &labels, std::vector<float> &sdf);
+	bool writeModel(const std::string &name, const std::vector<float> &coordinates, const std::vector<int> &labels,
+		const std::vector<float> &sdf, std::mt19937 &rng) const;
+	/* Add the relations of the ground truth parts of a model to the statistics, as TrainPartsThread does */
+	static void accumulateRelations(const std::vector<float> &coordinates, const std::vector<int> &labels,
+		QMap<QPair<int, int>, RelationStatistics> &statistics);
+	bool writeClassFiles(const QMap<QPair<int, int>, RelationStatistics> &statistics, const QStringList &off_files) const;
+};
+
+#endif // SYNTHETICDATASET_H
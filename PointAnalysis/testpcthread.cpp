@@ -47,6 +47,7 @@ using namespace shark;
 
 void TestPCThread::test()
 {
+	TRACE_SCOPE("classification");
 	/* Test each point cloud with the random forest model */
 	emit addDebugText("Testing the point cloud...");
 	QVector<QMap<int, float>> predictions;
@@ -97,8 +98,11 @@ void TestPCThread::test()
 			/* Set the label to labels vector */
 			labels[li++] = label_names[idx];
 		}
-		emit setPCLabels(labels);
-		emit classifyProbabilityDistribution(predictions);
+		/* Stopped by StructureAnalyser::cancel(), the forest can't be interrupted but its result is dropped */
+		if (isInterruptionRequested())
+			return;
+		emit setPCLabels(toModelOrder(labels));
+		emit classifyProbabilityDistribution(toModelOrder(predictions));
 		std::string out_path = "D:\\Projects\\point-analysis-master\\data\\predictions\\" + pcname.toStdString() + ".txt";
 		saveClassification(out_path, predictions);
 		emit addDebugText("Testing point clouds done.");
@@ -243,10 +247,20 @@ void TestPCThread::loadPredictionFromFile()
 			}
 		}
 
-		emit setPCLabels(labels);
-		emit classifyProbabilityDistribution(predictions);
+		if (isInterruptionRequested())
+		{
+			in.close();
+			return;
+		}
+		emit setPCLabels(toModelOrder(labels));
+		emit classifyProbabilityDistribution(toModelOrder(predictions));
 		emit addDebugText("Load prediction from file done.");
 
 		in.close();
 	}
+}
+
+void TestPCThread::setLoadOrder(QVector<int> load_order)
+{
+	m_load_order = load_order;
 }
\ No newline at end of file
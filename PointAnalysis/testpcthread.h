@@ -7,6 +7,7 @@
 #include <QList>
 #include <QMap>
 #include <fstream>
+#include "tracer.h"
 #include <string>
 #include <shark/Data/Csv.h>
 #include <shark/Data/Dataset.h> //importing the file
@@ -28,6 +29,7 @@ public:
 
 	void setPcName(QString name);
 	void setPredictionFilePath(std::string prediction_path);
+	void setLoadOrder(QVector<int> load_order);    /* The features and prediction files are in this order of the points */
 
 signals:
 	void addDebugText(QString text);
@@ -45,6 +47,7 @@ private:
 	bool modelLoaded;
 	std::string m_modelClassName;
 	std::string m_prediction_path;
+	QVector<int> m_load_order;
 
 	void test();
 	int loadTestPoints();
@@ -52,6 +55,17 @@ private:
 	void loadLabelNames(QList<int> &label_names);
 	void saveClassification(std::string path, QVector<QMap<int, float>> distributions);
 	void loadPredictionFromFile();
+
+	/* Move the values of the rows of a file to the points of the model */
+	template <class T> QVector<T> toModelOrder(const QVector<T> &rows) const
+	{
+		if (m_load_order.isEmpty())
+			return rows;
+		QVector<T> values(rows.size());
+		for (int row = 0; row < rows.size(); row++)
+			values[m_load_order[row]] = rows[row];
+		return values;
+	}
 };
 
 #endif // TESTPCTHREAD_H
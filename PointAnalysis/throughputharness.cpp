@@ -0,0 +1,318 @@
+#include "throughputharness.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+#include <QCoreApplication>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <cstdio>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#endif
+
+ThroughputHarness::ThroughputHarness(QStringList models, std::string modelClassName, bool warm, QObject *parent)
+	: QObject(parent), m_models(models), m_warm(warm), m_current(-1), m_model(NULL), m_begin(0), m_run_begin(0), m_run_end(0)
+{
+	qRegisterMetaType<PCModel *>("PCModelPointer");
+	m_load_thread.setPhase(LoadThread::PHASE::TESTING);
+	m_analyser.setModelClassName(modelClassName);
+	connect(&m_load_thread, SIGNAL(loadPointsCompleted(PCModel *)), this, SLOT(onModelLoaded(PCModel *)));
+	connect(&m_analyser, SIGNAL(sendOBBs(QVector<OBB *>)), this, SLOT(onOBBsReceived(QVector<OBB *>)));
+	m_timeout.setSingleShot(true);
+	m_timeout.setInterval(THROUGHPUT_MODEL_TIMEOUT_MS);
+	connect(&m_timeout, SIGNAL(timeout()), this, SLOT(onTimeout()));
+
+	/* The CGAL loader writes the models it has read there */
+	QDir().mkpath("../data/off_modified");
+	QDir().mkpath("../data/features_test");
+}
+
+ThroughputHarness::~ThroughputHarness()
+{
+	m_analyser.cancel();
+	if (m_load_thread.isRunning())
+		m_load_thread.wait();
+	if (m_model != NULL)
+		delete(m_model);
+}
+
+void ThroughputHarness::setTrwsTimeBudget(double seconds)
+{
+	m_analyser.setTrwsTimeBudget(seconds);
+}
+
+void ThroughputHarness::start()
+{
+	m_records.clear();
+	m_stage_names.clear();
+	m_current = -1;
+	Tracer::clear();
+	m_run_begin = Tracer::now();
+	next();
+}
+
+void ThroughputHarness::next()
+{
+	m_current++;
+	if (m_current >= m_models.size())
+	{
+		m_run_end = Tracer::now();
+		emit finished();
+		return;
+	}
+
+	QString filename = m_models[m_current];
+	if (!m_warm)
+		removeDerivedFiles(filename);
+	qDebug().noquote() << QString("Analysing %1 (%2/%3)...").arg(filename).arg(m_current + 1).arg(m_models.size());
+	m_begin = Tracer::now();
+	m_timeout.start();
+	m_load_thread.setLoadFileName(filename.toStdString());
+	m_load_thread.start();
+}
+
+void ThroughputHarness::onModelLoaded(PCModel *model)
+{
+	if (!m_timeout.isActive())    /* Loaded after its timeout */
+	{
+		if (model != NULL)
+			delete(model);
+		return;
+	}
+	if (model == NULL)
+	{
+		qDebug().noquote() << QString("Can't load %1, skipped.").arg(m_models[m_current]);
+		recordFailure();
+		next();
+		return;
+	}
+
+	/* The analyser keeps the model it analyses, the previous one is freed once it has the new one */
+	m_analyser.setPointCloud(model);
+	if (m_model != NULL)
+		delete(m_model);
+	m_model = model;
+	m_analyser.execute(m_current);
+}
+
+void ThroughputHarness::onOBBsReceived(QVector<OBB *> obbs)
+{
+	/* Called from StructureAnalyser::onPredictionDone before it exports and clears the spans of the model */
+	long long end = Tracer::now();
+	for (int i = 0; i < obbs.size(); i++)
+		delete(obbs[i]);
+	if (!m_timeout.isActive() || m_analyser.run() != m_current)    /* Of a model that has timed out, or of another analysis */
+		return;
+	m_timeout.stop();
+
+	ModelRecord record;
+	record.filename = m_models[m_current];
+	record.npoints = m_model->vertexCount();
+	record.latency = (end - m_begin) / 1e6;
+
+	QMap<QString, long long> first_begin, last_end;
+	std::vector<Tracer::Event> events = Tracer::events();
+	for (int i = 0; i < (int)events.size(); i++)
+	{
+		const Tracer::Event &e = events[i];
+		if (e.begin < m_begin)
+			continue;
+		QString name(e.name);
+		if (!first_begin.contains(name))
+		{
+			first_begin.insert(name, e.begin);
+			last_end.insert(name, e.begin + e.duration);
+			if (!m_stage_names.contains(name))
+				m_stage_names.append(name);
+		}
+		first_begin[name] = (std::min)(first_begin[name], e.begin);
+		last_end[name] = (std::max)(last_end[name], e.begin + e.duration);
+	}
+	for (QMap<QString, long long>::iterator it = first_begin.begin(); it != first_begin.end(); ++it)
+		record.stages.insert(it.key(), (last_end[it.key()] - it.value()) / 1e6);
+	record.resident = residentBytes();
+	record.failed = false;
+	record.classification = m_analyser.getClassificationSource();
+	m_records.append(record);
+
+	qDebug().noquote() << QString("%1 done in %2 ms.").arg(record.filename).arg(record.latency, 0, 'f', 0);
+	/* After StructureAnalyser::onPredictionDone has returned */
+	QTimer::singleShot(0, this, SLOT(next()));
+}
+
+void ThroughputHarness::onTimeout()
+{
+	qDebug().noquote() << QString("%1 not analysed in %2 s, skipped.").arg(m_models[m_current]).arg(THROUGHPUT_MODEL_TIMEOUT_MS / 1000);
+	/* The threads of the analysis use the model and the analyser, they are stopped before the next model */
+	m_analyser.cancel();
+	/* The loading can't be interrupted; a model it sends meanwhile is freed by onModelLoaded, the timeout being over */
+	if (m_load_thread.isRunning())
+		m_load_thread.wait();
+	QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+	recordFailure();
+	next();
+}
+
+void ThroughputHarness::recordFailure()
+{
+	m_timeout.stop();
+	ModelRecord record;
+	record.filename = m_models[m_current];
+	record.npoints = 0;
+	record.latency = (Tracer::now() - m_begin) / 1e6;
+	record.resident = residentBytes();
+	record.failed = true;
+	record.classification = StructureAnalyser::NOT_CLASSIFIED;
+	m_records.append(record);
+}
+
+void ThroughputHarness::removeDerivedFiles(const QString &filename) const
+{
+	QString name = Utils::getModelName(filename);
+	QDir(QString(CHECKPOINT_DIR) + name).removeRecursively();
+	QFile::remove("../data/features_test/" + name + ".csv");
+	QFile::remove("../data/features_test/" + name + ".paf");
+	QFile::remove("../data/features_test/" + name + ".pidx");
+}
+
+const char * ThroughputHarness::classificationName(StructureAnalyser::CLASSIFICATION_SOURCE source)
+{
+	switch (source)
+	{
+	case StructureAnalyser::RANDOM_FOREST:
+		return "forest";
+	case StructureAnalyser::PREDICTION_FILE:
+		return "file";
+	case StructureAnalyser::CHECKPOINT:
+		return "checkpoint";
+	default:
+		return "none";
+	}
+}
+
+double ThroughputHarness::percentile(QVector<double> values, double p)
+{
+	/* Nearest rank */
+	if (values.isEmpty())
+		return 0;
+	std::sort(values.begin(), values.end());
+	int rank = (int)std::ceil(p / 100.0 * values.size());
+	return values[(std::max)(0, (std::min)(rank, values.size()) - 1)];
+}
+
+bool ThroughputHarness::writeReport(const QString &filename) const
+{
+	int nmodels = 0, nfailed = 0;
+	int nclassified[StructureAnalyser::NUM_OF_CLASSIFICATION_SOURCES] = { 0 };    /* Of the models analysed, by source */
+	for (int i = 0; i < m_records.size(); i++)
+	{
+		if (m_records[i].failed)
+			nfailed++;
+		else
+		{
+			nmodels++;
+			nclassified[m_records[i].classification]++;
+		}
+	}
+	double seconds = (m_run_end - m_run_begin) / 1e9;
+	double models_per_hour = seconds > 0 ? nmodels * 3600.0 / seconds : 0;
+	long long peak = peakResidentBytes();
+	static const double PERCENTILES[] = { 50, 90, 99, 100 };
+	const int NUM_OF_PERCENTILES = sizeof(PERCENTILES) / sizeof(PERCENTILES[0]);
+
+	/* The whole model first, then the stages, of the models analysed */
+	QStringList rows = QStringList() << "model" << m_stage_names;
+	QVector<QVector<double>> values(rows.size());
+	for (int i = 0; i < m_records.size(); i++)
+	{
+		if (m_records[i].failed)
+			continue;
+		values[0].append(m_records[i].latency);
+		for (int s = 1; s < rows.size(); s++)
+		{
+			if (m_records[i].stages.contains(rows[s]))
+				values[s].append(m_records[i].stages.value(rows[s]));
+		}
+	}
+
+	QString summary;
+	summary.sprintf("%d models in %.1f s (%d failed): %.1f models/hour, peak resident memory %.1f MB\n", nmodels, seconds, nfailed,
+		models_per_hour, peak / 1048576.0);
+	summary += QString("classification: %1 by the random forest, %2 read from prediction files, %3 from checkpoints\n")
+		.arg(nclassified[StructureAnalyser::RANDOM_FOREST]).arg(nclassified[StructureAnalyser::PREDICTION_FILE]).arg(nclassified[StructureAnalyser::CHECKPOINT]);
+	summary += QString("%1 %2 %3 %4 %5 %6\n").arg("latency (ms)", -24).arg("count", 6).arg("p50", 10).arg("p90", 10).arg("p99", 10).arg("max", 10);
+	for (int s = 0; s < rows.size(); s++)
+	{
+		summary += QString("%1 %2").arg(rows[s], -24).arg(values[s].size(), 6);
+		for (int p = 0; p < NUM_OF_PERCENTILES; p++)
+			summary += QString(" %1").arg(percentile(values[s], PERCENTILES[p]), 10, 'f', 1);
+		summary += "\n";
+	}
+	qDebug().noquote() << summary;
+
+	QDir().mkpath(QFileInfo(filename).absolutePath());
+	std::ofstream out(filename.toStdString().c_str());
+	if (!out.is_open())
+		return false;
+	char line[512];
+	snprintf(line, sizeof(line), "{\"models\":%d,\"failed\":%d,\"seconds\":%.3f,\"models_per_hour\":%.3f,\"peak_resident_bytes\":%lld,\"warm\":%s,\n",
+		nmodels, nfailed, seconds, models_per_hour, peak, m_warm ? "true" : "false");
+	out << line;
+	snprintf(line, sizeof(line), "\"classification\":{\"forest\":%d,\"file\":%d,\"checkpoint\":%d},\n",
+		nclassified[StructureAnalyser::RANDOM_FOREST], nclassified[StructureAnalyser::PREDICTION_FILE], nclassified[StructureAnalyser::CHECKPOINT]);
+	out << line << "\"latency_ms\":{";
+	for (int s = 0; s < rows.size(); s++)
+	{
+		snprintf(line, sizeof(line), "%s\n\"%s\":{\"count\":%d,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f}", s == 0 ? "" : ",",
+			qPrintable(rows[s]), values[s].size(), percentile(values[s], 50), percentile(values[s], 90), percentile(values[s], 99), percentile(values[s], 100));
+		out << line;
+	}
+	out << "},\n\"runs\":[";
+	for (int i = 0; i < m_records.size(); i++)
+	{
+		const ModelRecord &r = m_records[i];
+		QString path = QDir::fromNativeSeparators(r.filename);
+		snprintf(line, sizeof(line), "%s\n{\"file\":\"%s\",\"failed\":%s,\"points\":%d,\"classification\":\"%s\",\"latency_ms\":%.3f,\"resident_bytes\":%lld,\"stages_ms\":{",
+			i == 0 ? "" : ",", qPrintable(path), r.failed ? "true" : "false", r.npoints, classificationName(r.classification), r.latency, r.resident);
+		out << line;
+		bool first = true;
+		for (QMap<QString, double>::const_iterator it = r.stages.constBegin(); it != r.stages.constEnd(); ++it)
+		{
+			snprintf(line, sizeof(line), "%s\"%s\":%.3f", first ? "" : ",", qPrintable(it.key()), it.value());
+			out << line;
+			first = false;
+		}
+		out << "}}";
+	}
+	out << "\n]}" << std::endl;
+	return !out.fail();
+}
+
+long long ThroughputHarness::residentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return (long long)counters.WorkingSetSize;
+	return 0;
+#else
+	return 0;
+#endif
+}
+
+long long ThroughputHarness::peakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return (long long)counters.PeakWorkingSetSize;
+	return 0;
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,90 @@
+#ifndef THROUGHPUTHARNESS_H
+#define THROUGHPUTHARNESS_H
+
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+#include <QMap>
+#include <QTimer>
+#include <string>
+#include "loadthread.h"
+#include "structureanalyser.h"
+#include "obb.h"
+
+#define THROUGHPUT_REPORT "../data/benchmarks/throughput.json"
+#define THROUGHPUT_MODEL_TIMEOUT_MS 600000    /* A model not analysed by then is recorded as failed and the next one started */
+
+/*
+ * Runs the whole analysis (loading, normals, features, classification, candidates and prediction)
+ * on a list of models one after the other, as the GUI does, and reports the models per hour, the
+ * percentiles of the latency of each stage and of a whole model, and the peak resident memory.
+ * The latency of a stage in a model is the time from the first begin to the last end of its
+ * Tracer spans, the stages running on several threads (features, unary...) counting once.
+ * The checkpoints and the features files of a model are removed before it is analysed, unless
+ * warm is set, so every stage runs; the normals in the DerivedCache are kept (they are only
+ * estimated again for new files, e.g. models generated with another seed). A classification in
+ * ../data/predictions is kept as well and read in place of the random forest (as for the synthetic
+ * datasets), so the report gives for each model whether the forest ran or its classification was read.
+ * A model that can't be loaded or is not analysed within THROUGHPUT_MODEL_TIMEOUT_MS is
+ * recorded as failed, and left out of the latencies. The analysis of a model that times out is
+ * cancelled before the next one starts; each analysis is tagged with the index of its model, so
+ * a result sent for another model is ignored.
+ */
+class ThroughputHarness : public QObject
+{
+	Q_OBJECT
+
+public:
+	ThroughputHarness(QStringList models, std::string modelClassName, bool warm = false, QObject *parent = 0);
+	~ThroughputHarness();
+
+	void start();
+	void setTrwsTimeBudget(double seconds);    /* See StructureAnalyser::setTrwsTimeBudget */
+	/* The report as json, and its summary on the console */
+	bool writeReport(const QString &filename) const;
+
+	/* Of the process (working set on Windows), 0 where they can't be read */
+	static long long residentBytes();
+	static long long peakResidentBytes();
+
+signals:
+	void finished();
+
+private slots:
+	void next();
+	void onModelLoaded(PCModel *model);
+	void onOBBsReceived(QVector<OBB *> obbs);
+	void onTimeout();
+
+private:
+	struct ModelRecord
+	{
+		QString filename;
+		int npoints;
+		double latency;    /* ms, from the loading to the prediction */
+		QMap<QString, double> stages;    /* ms */
+		long long resident;    /* bytes, after the model */
+		bool failed;
+		StructureAnalyser::CLASSIFICATION_SOURCE classification;
+	};
+
+	QStringList m_models;
+	bool m_warm;
+	int m_current;
+	LoadThread m_load_thread;
+	StructureAnalyser m_analyser;
+	PCModel *m_model;
+	long long m_begin;    /* of the current model, Tracer::now() */
+	long long m_run_begin;
+	long long m_run_end;
+	QVector<ModelRecord> m_records;
+	QStringList m_stage_names;    /* In the order they first ran */
+	QTimer m_timeout;    /* Of the current model, stopped once it is done */
+
+	void removeDerivedFiles(const QString &filename) const;
+	void recordFailure();
+	static double percentile(QVector<double> values, double p);
+	static const char * classificationName(StructureAnalyser::CLASSIFICATION_SOURCE source);
+};
+
+#endif // THROUGHPUTHARNESS_H
@@ -0,0 +1,655 @@
+#include "tiledfeaturethread.h"
+#include <boost/tuple/tuple.hpp>
+#include <algorithm>
+#include <cstdio>
+
+typedef boost::tuple<Point3, Vector, int> IndexedPointVector;    /* point, normal and index in the tile */
+
+TiledFeatureThread::TiledFeatureThread(std::string input_filename, std::string output_filename, int max_points, QObject *parent)
+	: QThread(parent), m_input_filename(input_filename), m_output_filename(output_filename), m_max_points(max_points), m_npoints(0), m_radius(0)
+{
+	for (int a = 0; a < 3; a++)
+	{
+		m_center[a] = 0;
+		m_min[a] = m_max[a] = 0;
+		m_cell_size[a] = 0;
+	}
+}
+
+TiledFeatureThread::~TiledFeatureThread()
+{
+	if (isRunning())
+		terminate();
+}
+
+void TiledFeatureThread::run()
+{
+	long start_time = Utils::getCurrentTime();
+
+	emit addDebugText("Scanning points of " + QString::fromStdString(m_input_filename) + "...");
+	std::vector<float> candidates;
+	if (!scanPoints(candidates) || !computeMiniball(candidates) || !countPoints())
+	{
+		emit addDebugText("Cannot read points from " + QString::fromStdString(m_input_filename) + ".");
+		return;
+	}
+
+	if (!splitIntoTiles())
+	{
+		emit addDebugText("The points within " + QString::number(TILE_HALO) + " of a cell of " + QString::fromStdString(m_input_filename)
+			+ " are more than " + QString::number(m_max_points) + ", the tiles can't be held in memory.");
+		return;
+	}
+	int ntiles = m_tiles.size();
+	emit addDebugText(QString::number(m_npoints) + " points, radius " + QString::number(m_radius) + ", split into "
+		+ QString::number(ntiles) + " tiles.");
+
+	if (!spillPoints())
+	{
+		emit addDebugText("Cannot write the tiles of " + QString::fromStdString(m_input_filename) + ".");
+		return;
+	}
+
+	/* The normals of all points, by index, 0 until their tile is oriented */
+	{
+		std::ofstream out(normalsFilename().c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		std::vector<float> zeros(3 * TILE_SPILL_BUFFER, 0.0f);
+		for (int i = 0; i < m_npoints; i += TILE_SPILL_BUFFER)
+			out.write((const char *)zeros.data(), 3 * std::min(TILE_SPILL_BUFFER, m_npoints - i) * sizeof(float));
+		if (!out)
+		{
+			emit addDebugText("Cannot write " + QString::fromStdString(normalsFilename()) + ".");
+			return;
+		}
+	}
+	std::fstream normals_file(normalsFilename().c_str(), std::ios::in | std::ios::out | std::ios::binary);
+
+	std::vector<int> order = orientationOrder();
+	for (int t = 0; t < ntiles; t++)
+	{
+		estimateNormals(order[t], normals_file);
+		emit tileDone(t, 2 * ntiles);
+	}
+
+	FeatureStore store;
+	if (!store.open(m_output_filename.c_str(), m_npoints))
+	{
+		emit addDebugText("Cannot open " + QString::fromStdString(m_output_filename) + ".");
+		return;
+	}
+	for (int t = 0; t < ntiles; t++)
+	{
+		estimateTile(t, normals_file, store);
+		std::remove(spillFilename(t).c_str());
+		emit tileDone(ntiles + t, 2 * ntiles);
+	}
+	store.close();
+	normals_file.close();
+	std::remove(normalsFilename().c_str());
+
+	qDebug("Tiled feature estimation done in %ld ms.", Utils::getCurrentTime() - start_time);
+	emit estimateCompleted(QString::fromStdString(m_output_filename));
+}
+
+bool TiledFeatureThread::openPoints(std::ifstream &in, int &npoints)
+{
+	in.open(m_input_filename.c_str());
+	if (!in.is_open())
+		return false;
+
+	npoints = -1;    /* Read to the end of an .xyz file */
+	int name_len = m_input_filename.length();
+	if (name_len > 3 && m_input_filename.compare(name_len - 3, 3, "off") == 0)
+	{
+		std::string line;
+		int nfaces, nedges;
+		std::getline(in, line);    /* Read "OFF" header */
+		in >> npoints >> nfaces >> nedges;
+		std::getline(in, line);
+	}
+	return true;
+}
+
+bool TiledFeatureThread::readPoint(std::ifstream &in, float &x, float &y, float &z)
+{
+	std::string rest;
+	if (!(in >> x >> y >> z))
+		return false;
+	std::getline(in, rest);    /* Skip normals or colors */
+
+	/* Normalized once the smallest enclosing ball is known */
+	if (m_radius > 0)
+	{
+		x = (x - m_center[0]) / m_radius;
+		y = (y - m_center[1]) / m_radius;
+		z = (z - m_center[2]) / m_radius;
+	}
+	return true;
+}
+
+bool TiledFeatureThread::scanPoints(std::vector<float> &candidates)
+{
+	std::ifstream in;
+	int npoints;
+	if (!openPoints(in, npoints))
+		return false;
+
+	/* The points extreme along the axes and the diagonals of the faces and of the cube, the first candidates of the ball */
+	static const int DIRECTIONS[13][3] = { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 }, { 1, 1, 0 }, { 1, -1, 0 }, { 1, 0, 1 }, { 1, 0, -1 },
+		{ 0, 1, 1 }, { 0, 1, -1 }, { 1, 1, 1 }, { 1, 1, -1 }, { 1, -1, 1 }, { 1, -1, -1 } };
+	float extremes[26][3];
+	float extreme_values[26];
+	float x, y, z;
+	m_radius = 0;
+	m_npoints = 0;
+	while ((npoints < 0 || m_npoints < npoints) && readPoint(in, x, y, z))
+	{
+		float p[3] = { x, y, z };
+		for (int d = 0; d < 13; d++)
+		{
+			float v = DIRECTIONS[d][0] * x + DIRECTIONS[d][1] * y + DIRECTIONS[d][2] * z;
+			for (int side = 0; side < 2; side++)
+			{
+				int e = 2 * d + side;
+				if (m_npoints == 0 || (side == 0 ? v < extreme_values[e] : v > extreme_values[e]))
+				{
+					extreme_values[e] = v;
+					for (int a = 0; a < 3; a++)
+						extremes[e][a] = p[a];
+				}
+			}
+		}
+		m_npoints++;
+	}
+	if (m_npoints == 0)
+		return false;
+
+	candidates.clear();
+	for (int e = 0; e < 26; e++)
+		candidates.insert(candidates.end(), extremes[e], extremes[e] + 3);
+	return true;
+}
+
+bool TiledFeatureThread::computeMiniball(std::vector<float> &candidates)
+{
+	/* The ball of the candidates is the smallest enclosing ball of all points once it contains them all */
+	const int d = 3;
+	std::vector<double> coords(d);
+	for (int pass = 1;; pass++)
+	{
+		PointVector S;
+		for (int i = 0; i < (int)candidates.size(); i += 3)
+		{
+			coords[0] = candidates[i];
+			coords[1] = candidates[i + 1];
+			coords[2] = candidates[i + 2];
+			S.push_back(MiniPoint(d, coords.begin()));
+		}
+		Miniball mb(d, S);
+		double radius = mb.radius();
+		Miniball::Coordinate_iterator center_it = mb.center_begin();
+		double center[3] = { center_it[0], center_it[1], center_it[2] };
+
+		std::ifstream in;
+		int npoints;
+		if (!openPoints(in, npoints))
+			return false;
+		double limit = radius * (1.0 + 1e-5);    /* The float ball leaves its support points barely outside */
+		int outside = 0;
+		float x, y, z;
+		for (int i = 0; i < m_npoints && readPoint(in, x, y, z); i++)
+		{
+			double dx = x - center[0], dy = y - center[1], dz = z - center[2];
+			if (dx * dx + dy * dy + dz * dz > limit * limit)
+			{
+				if (outside < TILE_MINIBALL_CANDIDATES)
+				{
+					candidates.push_back(x);
+					candidates.push_back(y);
+					candidates.push_back(z);
+				}
+				outside++;
+			}
+		}
+		qDebug("Smallest enclosing ball, pass %d: radius %f, %d points outside.", pass, radius, outside);
+		if (outside > 0)
+			continue;
+
+		for (int a = 0; a < 3; a++)
+			m_center[a] = center[a];
+		m_radius = radius > 0 ? radius : 1.0;
+		return true;
+	}
+}
+
+bool TiledFeatureThread::countPoints()
+{
+	std::ifstream in;
+	int npoints;
+	if (!openPoints(in, npoints))
+		return false;
+
+	/* Box of the normalized points, then the points of each cell */
+	float x, y, z;
+	for (int i = 0; i < m_npoints && readPoint(in, x, y, z); i++)
+	{
+		float p[3] = { x, y, z };
+		for (int a = 0; a < 3; a++)
+		{
+			if (i == 0 || p[a] < m_min[a]) m_min[a] = p[a];
+			if (i == 0 || p[a] > m_max[a]) m_max[a] = p[a];
+		}
+	}
+	for (int a = 0; a < 3; a++)
+		m_cell_size[a] = m_max[a] > m_min[a] ? (m_max[a] - m_min[a]) / TILE_GRID_CELLS : 1.0;
+
+	in.close();
+	if (!openPoints(in, npoints))
+		return false;
+	const int G = TILE_GRID_CELLS;
+	std::vector<long long> counts(G * G * G, 0);
+	for (int i = 0; i < m_npoints && readPoint(in, x, y, z); i++)
+	{
+		float p[3] = { x, y, z };
+		counts[cellIndex(p)]++;
+	}
+
+	/* Summed volume of the counts */
+	const int S = G + 1;
+	m_cell_sums.assign(S * S * S, 0);
+	for (int cx = 1; cx <= G; cx++)
+	{
+		for (int cy = 1; cy <= G; cy++)
+		{
+			for (int cz = 1; cz <= G; cz++)
+			{
+				m_cell_sums[(cx * S + cy) * S + cz] = counts[((cx - 1) * G + cy - 1) * G + cz - 1]
+					+ m_cell_sums[((cx - 1) * S + cy) * S + cz] + m_cell_sums[(cx * S + cy - 1) * S + cz] + m_cell_sums[(cx * S + cy) * S + cz - 1]
+					- m_cell_sums[((cx - 1) * S + cy - 1) * S + cz] - m_cell_sums[((cx - 1) * S + cy) * S + cz - 1] - m_cell_sums[(cx * S + cy - 1) * S + cz - 1]
+					+ m_cell_sums[((cx - 1) * S + cy - 1) * S + cz - 1];
+			}
+		}
+	}
+	return true;
+}
+
+long long TiledFeatureThread::pointsIn(const int first[3], const int last[3]) const
+{
+	const int S = TILE_GRID_CELLS + 1;
+	const int *f = first, *l = last;
+	return m_cell_sums[(l[0] * S + l[1]) * S + l[2]]
+		- m_cell_sums[(f[0] * S + l[1]) * S + l[2]] - m_cell_sums[(l[0] * S + f[1]) * S + l[2]] - m_cell_sums[(l[0] * S + l[1]) * S + f[2]]
+		+ m_cell_sums[(f[0] * S + f[1]) * S + l[2]] + m_cell_sums[(f[0] * S + l[1]) * S + f[2]] + m_cell_sums[(l[0] * S + f[1]) * S + f[2]]
+		- m_cell_sums[(f[0] * S + f[1]) * S + f[2]];
+}
+
+long long TiledFeatureThread::pointsAround(const Tile &tile, float halo) const
+{
+	int first[3], last[3];
+	for (int a = 0; a < 3; a++)
+	{
+		first[a] = cellOf(tile.min[a] - halo, a);
+		last[a] = cellOf(tile.max[a] + halo, a) + 1;
+	}
+	return pointsIn(first, last);
+}
+
+void TiledFeatureThread::setBox(Tile &tile) const
+{
+	for (int a = 0; a < 3; a++)
+	{
+		tile.min[a] = m_min[a] + tile.first[a] * m_cell_size[a];
+		tile.max[a] = m_min[a] + tile.last[a] * m_cell_size[a];
+	}
+}
+
+bool TiledFeatureThread::splitIntoTiles()
+{
+	m_tiles.clear();
+	Tile all;
+	for (int a = 0; a < 3; a++)
+	{
+		all.first[a] = 0;
+		all.last[a] = TILE_GRID_CELLS;
+	}
+	setBox(all);
+	if (!splitTile(all))
+		return false;
+
+	/* The tiles each cell spills its points to */
+	const int G = TILE_GRID_CELLS;
+	m_cell_tiles.assign(G * G * G, std::vector<int>());
+	for (int t = 0; t < (int)m_tiles.size(); t++)
+	{
+		int first[3], last[3];
+		for (int a = 0; a < 3; a++)
+		{
+			first[a] = cellOf(m_tiles[t].min[a] - TILE_HALO, a);
+			last[a] = cellOf(m_tiles[t].max[a] + TILE_HALO, a);
+		}
+		for (int cx = first[0]; cx <= last[0]; cx++)
+		{
+			for (int cy = first[1]; cy <= last[1]; cy++)
+			{
+				for (int cz = first[2]; cz <= last[2]; cz++)
+					m_cell_tiles[(cx * G + cy) * G + cz].push_back(t);
+			}
+		}
+	}
+	return true;
+}
+
+bool TiledFeatureThread::splitTile(Tile tile)
+{
+	long long core = pointsIn(tile.first, tile.last);
+	if (core == 0)
+		return true;
+	if (pointsAround(tile, TILE_HALO) <= m_max_points)
+	{
+		m_tiles.push_back(tile);
+		return true;
+	}
+
+	/* Split the longest side at the median of the points */
+	int axis = -1;
+	for (int a = 0; a < 3; a++)
+	{
+		if (tile.last[a] - tile.first[a] > 1 && (axis < 0 || tile.max[a] - tile.min[a] > tile.max[axis] - tile.min[axis]))
+			axis = a;
+	}
+	if (axis < 0)    /* A single cell and its halo are over max_points */
+		return false;
+
+	int split = tile.first[axis] + 1;
+	Tile lower = tile;
+	for (; split < tile.last[axis] - 1; split++)
+	{
+		lower.last[axis] = split;
+		if (2 * pointsIn(lower.first, lower.last) >= core)
+			break;
+	}
+	Tile upper = tile;
+	lower.last[axis] = split;
+	upper.first[axis] = split;
+	setBox(lower);
+	setBox(upper);
+	return splitTile(lower) && splitTile(upper);
+}
+
+float TiledFeatureThread::distance(const Tile &tile, const float p[3]) const
+{
+	float d2 = 0;
+	for (int a = 0; a < 3; a++)
+	{
+		float d = std::max(std::max(tile.min[a] - p[a], p[a] - tile.max[a]), 0.0f);
+		d2 += d * d;
+	}
+	return sqrt(d2);
+}
+
+int TiledFeatureThread::cellOf(float v, int axis) const
+{
+	int cell = (int)((v - m_min[axis]) / m_cell_size[axis]);
+	if (cell < 0)
+		cell = 0;
+	if (cell > TILE_GRID_CELLS - 1)
+		cell = TILE_GRID_CELLS - 1;
+	return cell;
+}
+
+int TiledFeatureThread::cellIndex(const float p[3]) const
+{
+	return (cellOf(p[0], 0) * TILE_GRID_CELLS + cellOf(p[1], 1)) * TILE_GRID_CELLS + cellOf(p[2], 2);
+}
+
+std::string TiledFeatureThread::spillFilename(int tile) const
+{
+	return m_output_filename + ".tile" + std::to_string(tile);
+}
+
+std::string TiledFeatureThread::normalsFilename() const
+{
+	return m_output_filename + ".normals";
+}
+
+void TiledFeatureThread::flushSpill(int tile, std::vector<TilePoint> &buffer)
+{
+	if (buffer.empty())
+		return;
+	std::ofstream out(spillFilename(tile).c_str(), std::ios::out | std::ios::binary | std::ios::app);
+	out.write((const char *)buffer.data(), buffer.size() * sizeof(TilePoint));
+	buffer.clear();
+}
+
+bool TiledFeatureThread::spillPoints()
+{
+	int ntiles = m_tiles.size();
+	for (int t = 0; t < ntiles; t++)
+	{
+		std::ofstream out(spillFilename(t).c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			return false;
+	}
+
+	std::ifstream in;
+	int npoints;
+	if (!openPoints(in, npoints))
+		return false;
+
+	std::vector<std::vector<TilePoint>> buffers(ntiles);
+	float x, y, z;
+	for (int i = 0; i < m_npoints && readPoint(in, x, y, z); i++)
+	{
+		/* Add the point to every tile whose box grown by the halo contains it, the tile of its cell holds it */
+		float p[3] = { x, y, z };
+		int cell[3] = { cellOf(x, 0), cellOf(y, 1), cellOf(z, 2) };
+		const std::vector<int> &tiles = m_cell_tiles[(cell[0] * TILE_GRID_CELLS + cell[1]) * TILE_GRID_CELLS + cell[2]];
+		for (int k = 0; k < (int)tiles.size(); k++)
+		{
+			int t = tiles[k];
+			const Tile &tile = m_tiles[t];
+			bool inside = true;
+			for (int a = 0; a < 3; a++)
+				inside = inside && cell[a] >= tile.first[a] && cell[a] < tile.last[a];
+			float d = inside ? 0.0f : std::max(distance(tile, p), 1e-6f);
+			if (d > TILE_HALO)
+				continue;
+
+			TilePoint tp = { i, x, y, z, d };
+			buffers[t].push_back(tp);
+			if (buffers[t].size() >= TILE_SPILL_BUFFER)
+				flushSpill(t, buffers[t]);
+		}
+	}
+	for (int t = 0; t < ntiles; t++)
+		flushSpill(t, buffers[t]);
+
+	return true;
+}
+
+std::vector<int> TiledFeatureThread::orientationOrder() const
+{
+	/* Breadth first over the tiles whose boxes are within the normals halo of each other */
+	int ntiles = m_tiles.size();
+	std::vector<int> order;
+	std::vector<bool> visited(ntiles, false);
+	for (int start = 0; start < ntiles; start++)
+	{
+		if (visited[start])
+			continue;
+		visited[start] = true;
+		order.push_back(start);
+		for (int k = order.size() - 1; k < (int)order.size(); k++)
+		{
+			const Tile &tile = m_tiles[order[k]];
+			for (int t = 0; t < ntiles; t++)
+			{
+				bool adjacent = !visited[t];
+				for (int a = 0; a < 3 && adjacent; a++)
+					adjacent = m_tiles[t].min[a] <= tile.max[a] + TILE_NORMAL_HALO && tile.min[a] <= m_tiles[t].max[a] + TILE_NORMAL_HALO;
+				if (adjacent)
+				{
+					visited[t] = true;
+					order.push_back(t);
+				}
+			}
+		}
+	}
+	return order;
+}
+
+void TiledFeatureThread::loadTile(int tile, std::vector<TilePoint> &points) const
+{
+	/* The points of the tile first, then the halo from the nearest */
+	std::string spill_filename = spillFilename(tile);
+	std::ifstream in(spill_filename.c_str(), std::ios::in | std::ios::binary | std::ios::ate);
+	std::streamoff bytes = in.tellg();
+	points.resize(bytes > 0 ? bytes / sizeof(TilePoint) : 0);
+	in.seekg(0);
+	in.read((char *)points.data(), points.size() * sizeof(TilePoint));
+	std::stable_sort(points.begin(), points.end(), [](const TilePoint &a, const TilePoint &b) { return a.distance < b.distance; });
+}
+
+/* The points of points (sorted by distance) up to the halo */
+static int pointsWithin(const std::vector<TilePoint> &points, float halo)
+{
+	int n = 0;
+	while (n < (int)points.size() && points[n].distance <= halo)
+		n++;
+	return n;
+}
+
+void TiledFeatureThread::readNormals(std::fstream &file, const std::vector<TilePoint> &points, int npoints, pcl::PointCloud<pcl::Normal> &normals) const
+{
+	/* In the order of the file */
+	std::vector<std::pair<int, int>> rows(npoints);
+	for (int i = 0; i < npoints; i++)
+		rows[i] = std::make_pair(points[i].index, i);
+	std::sort(rows.begin(), rows.end());
+
+	normals.resize(npoints);
+	float n[3];
+	for (int r = 0; r < npoints; r++)
+	{
+		file.seekg((std::streamoff)rows[r].first * 3 * sizeof(float));
+		file.read((char *)n, sizeof(n));
+		normals.at(rows[r].second) = pcl::Normal(n[0], n[1], n[2]);
+	}
+}
+
+using namespace pcl;
+
+void TiledFeatureThread::estimateNormals(int tile, std::fstream &normals_file)
+{
+	std::vector<TilePoint> points;
+	loadTile(tile, points);
+	int ncore = pointsWithin(points, 0);
+	int size = pointsWithin(points, TILE_NORMAL_HALO);
+	if (ncore == 0)
+		return;
+
+	/* Normals the way Utils::loadPointCloud_CGAL estimates them, within the tile and its halo */
+	std::vector<IndexedPointVector> points_normals(size);
+	for (int i = 0; i < size; i++)
+		points_normals[i] = IndexedPointVector(Point3(points[i].x, points[i].y, points[i].z), Vector(), i);
+	CGAL::jet_estimate_normals<Concurrency_tag>(points_normals.begin(), points_normals.end(),
+		CGAL::Nth_of_tuple_property_map<0, IndexedPointVector>(),
+		CGAL::Nth_of_tuple_property_map<1, IndexedPointVector>(),
+		18);
+	CGAL::mst_orient_normals(points_normals.begin(), points_normals.end(),
+		CGAL::Nth_of_tuple_property_map<0, IndexedPointVector>(),
+		CGAL::Nth_of_tuple_property_map<1, IndexedPointVector>(),
+		16);
+	std::vector<Vector> normals(size);
+	for (std::vector<IndexedPointVector>::iterator it = points_normals.begin(); it != points_normals.end(); ++it)
+		normals[boost::get<2>(*it)] = boost::get<1>(*it);
+	std::vector<IndexedPointVector>().swap(points_normals);
+
+	/* Flip the tile if it disagrees with the halo points the tiles before it have oriented */
+	PointCloud<Normal> oriented;
+	readNormals(normals_file, points, size, oriented);
+	double agreement = 0;
+	for (int i = ncore; i < size; i++)
+	{
+		const Normal &n = oriented.at(i);
+		double dot = normals[i].x() * n.normal_x + normals[i].y() * n.normal_y + normals[i].z() * n.normal_z;
+		agreement += dot > 0 ? 1 : (dot < 0 ? -1 : 0);
+	}
+	bool flip = agreement < 0;
+
+	/* The points of the tile are in the order of the file */
+	for (int i = 0; i < ncore; i++)
+	{
+		float n[3] = { (float)normals[i].x(), (float)normals[i].y(), (float)normals[i].z() };
+		if (flip)
+		{
+			for (int a = 0; a < 3; a++)
+				n[a] = -n[a];
+		}
+		normals_file.seekp((std::streamoff)points[i].index * 3 * sizeof(float));
+		normals_file.write((const char *)n, sizeof(n));
+	}
+	normals_file.flush();
+
+	QString dtext = "Tile-" + QString::number(tile) + ": normals of " + QString::number(ncore) + " points" + (flip ? ", flipped." : ".");
+	qDebug() << dtext;
+	emit addDebugText(dtext);
+}
+
+void TiledFeatureThread::estimateTile(int tile, std::fstream &normals_file, FeatureStore &store)
+{
+	std::vector<TilePoint> points;
+	loadTile(tile, points);
+	int ncore = pointsWithin(points, 0);
+	int size = points.size();
+	if (ncore == 0)
+		return;
+
+	QString dtext = "Tile-" + QString::number(tile) + ": " + QString::number(ncore) + " points and "
+		+ QString::number(size - ncore) + " halo points.";
+	qDebug() << dtext;
+	emit addDebugText(dtext);
+
+	PointCloud<PointXYZ>::Ptr cloud(new PointCloud<PointXYZ>);
+	PointCloud<Normal>::Ptr normals(new PointCloud<Normal>);
+	cloud->resize(size);
+	for (int i = 0; i < size; i++)
+		cloud->at(i) = PointXYZ(points[i].x, points[i].y, points[i].z);
+	readNormals(normals_file, points, size, *normals);
+
+	/* The features of the 5 search radii, as the FeatureThreads compute them, each within the halo of its radius.
+	 * The index of a radius holds the points up to it, PointXYZ is 4 floats */
+	const PointXYZ *first = &cloud->points[0];
+	PAPointCloud features(ncore);
+	SpatialIndex *index = NULL;
+	for (int part = 0; part < NUM_OF_THREADS - 1; part++)
+	{
+		double search_radius = 0.1 * (part + 1);    /* Of the unit radius */
+		if (index != NULL)
+			delete(index);
+		index = SpatialIndex::build(&first->x, &first->y, &first->z, sizeof(PointXYZ) / sizeof(float), pointsWithin(points, search_radius), SPATIAL_INDEX_CELL_COEF);
+		int one = ncore / NUM_OF_SUBTHREAD;
+#pragma omp parallel for
+		for (int s = 0; s < NUM_OF_SUBTHREAD; s++)
+		{
+			int end = (s == NUM_OF_SUBTHREAD - 1) ? (ncore - 1) : ((s + 1) * one - 1);
+			PointFeatureThread::estimateRange(cloud, index, search_radius, s * one, end, &features, part);
+		}
+	}
+
+	/* Height and sdf, the sdf rays reach the points within the largest search radius */
+	PASpan<float> heights = features.feature(PAPoint::height);
+	PASpan<float> sdfs = features.feature(PAPoint::sdf);
+#pragma omp parallel for
+	for (int i = 0; i < ncore; i++)
+	{
+		heights[i] = points[i].y;
+		sdfs[i] = Utils::sdf(cloud, normals, i, index);
+	}
+	delete(index);
+
+	std::vector<int> indices(ncore);
+	for (int i = 0; i < ncore; i++)
+		indices[i] = points[i].index;
+	store.writeChunk(features, indices.data(), ncore);
+}
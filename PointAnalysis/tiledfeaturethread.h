@@ -0,0 +1,111 @@
+#ifndef TILEDFEATURETHREAD_H
+#define TILEDFEATURETHREAD_H
+
+#include <QThread>
+#include <QDebug>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include "utils.h"
+#include "PAPointCloud.h"
+#include "featurestore.h"
+#include "spatialindex.h"
+#include "featurethread.h"
+#include "pointfeaturethread.h"
+
+#define TILE_MAX_POINTS 2000000    /* Points of a tile and its halo held at once, the tiles over it are split */
+#define TILE_SPILL_BUFFER 8192    /* Points buffered per tile before they are appended to its spill file */
+#define TILE_GRID_CELLS 32    /* Cells per axis of the histogram of the points the tiles are split on */
+#define TILE_HALO (0.1 * (NUM_OF_THREADS - 1))    /* The largest search radius of the FeatureThreads, of the unit radius */
+#define TILE_NORMAL_HALO 0.1    /* Halo of the normals estimation, the smallest search radius */
+#define TILE_MINIBALL_CANDIDATES 65536    /* Points outside the ball of the candidates added to them per pass */
+
+/*
+ * Streaming version of FeatureEstimator for point clouds that don't fit in memory.
+ * The points are read from an .off or .xyz file a few times, never all held:
+ *   - the smallest enclosing ball of the points, grown from the extreme points by adding the
+ *     points outside the ball of the candidates until there is none. The points are centered
+ *     on it and scaled to a unit radius, as PCModel::normalize does, so the features are those
+ *     of the loaded model;
+ *   - a histogram of the points, on which the box of the points is split at the median of the
+ *     longest side until every tile holds at most max_points points with its halo of the
+ *     largest search radius. A cloud whose single cells are over it is rejected;
+ *   - every point is spilled to the files of the tiles whose box grown by the halo contains it.
+ * The normals of the tiles are then estimated within a halo of the smallest search radius,
+ * tile after neighboring tile; a tile is flipped if its normals disagree with the normals of
+ * its halo oriented by the tiles before it, so the orientation is consistent across tiles.
+ * Last the features of each radius are computed within the halo of that radius, the height
+ * and sdf within the whole halo, and written to a FeatureStore.
+ */
+class TiledFeatureThread : public QThread
+{
+	Q_OBJECT
+
+public:
+	TiledFeatureThread(std::string input_filename, std::string output_filename, int max_points = TILE_MAX_POINTS, QObject *parent = 0);
+	~TiledFeatureThread();
+
+signals:
+	void tileDone(int tile, int ntiles);
+	void estimateCompleted(QString store_filename);
+	void addDebugText(QString text);
+
+protected:
+	void run();
+
+private:
+	struct TilePoint
+	{
+		int index;    /* The index of the point in the whole point cloud */
+		float x, y, z;    /* Normalized */
+		float distance;    /* To the box of the tile, 0 for the points of the tile */
+	};
+
+	struct Tile
+	{
+		int first[3];    /* Cells of the histogram, from first to last - 1 */
+		int last[3];
+		float min[3];
+		float max[3];
+	};
+
+	std::string m_input_filename;
+	std::string m_output_filename;
+	int m_max_points;
+	int m_npoints;
+	float m_center[3];    /* Of the smallest enclosing ball of the points of the file */
+	float m_radius;
+	float m_min[3];    /* Box of the normalized points */
+	float m_max[3];
+	float m_cell_size[3];
+	std::vector<long long> m_cell_sums;    /* Points of the cells before x, y and z, TILE_GRID_CELLS + 1 per axis */
+	std::vector<Tile> m_tiles;
+	std::vector<std::vector<int>> m_cell_tiles;    /* The tiles whose box grown by the halo overlaps each cell */
+
+	bool openPoints(std::ifstream &in, int &npoints);
+	bool readPoint(std::ifstream &in, float &x, float &y, float &z);
+	bool scanPoints(std::vector<float> &candidates);
+	bool computeMiniball(std::vector<float> &candidates);
+	bool countPoints();
+	bool splitIntoTiles();
+	bool splitTile(Tile tile);
+	void setBox(Tile &tile) const;
+	long long pointsIn(const int first[3], const int last[3]) const;
+	long long pointsAround(const Tile &tile, float halo) const;    /* Upper bound of the points of tile and its halo */
+	float distance(const Tile &tile, const float p[3]) const;
+	int cellOf(float v, int axis) const;
+	int cellIndex(const float p[3]) const;
+	bool spillPoints();
+	std::vector<int> orientationOrder() const;
+	void loadTile(int tile, std::vector<TilePoint> &points) const;
+	void readNormals(std::fstream &file, const std::vector<TilePoint> &points, int npoints, pcl::PointCloud<pcl::Normal> &normals) const;
+	void estimateNormals(int tile, std::fstream &normals_file);
+	void estimateTile(int tile, std::fstream &normals_file, FeatureStore &store);
+	std::string spillFilename(int tile) const;
+	std::string normalsFilename() const;
+	void flushSpill(int tile, std::vector<TilePoint> &buffer);
+};
+
+#endif // TILEDFEATURETHREAD_H
@@ -0,0 +1,252 @@
+#include "tracer.h"
+#include <QThread>
+#include <QCoreApplication>
+#include <chrono>
+#include <mutex>
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <cstdio>
+
+namespace
+{
+	/* Written by one thread only: the event at head % TRACE_BUFFER_EVENTS, then head + 1 */
+	struct ThreadBuffer
+	{
+		Tracer::Event events[TRACE_BUFFER_EVENTS];
+		std::atomic<unsigned long long> head;
+		unsigned long long cleared;    /* The events before it are dropped, guarded by the registry */
+		int tid;
+	};
+
+	struct Registry
+	{
+		std::mutex mutex;
+		std::vector<ThreadBuffer *> buffers;
+		std::vector<ThreadBuffer *> free_buffers;    /* Of the threads that finished */
+		std::map<int, std::string> thread_names;    /* Of the threads running or whose spans are not cleared yet */
+		std::vector<int> finished_tids;    /* Whose names are erased with their spans by clear() */
+		int next_tid;
+
+		Registry() : next_tid(0) {}
+	};
+
+	Registry & registry()
+	{
+		static Registry r;
+		return r;
+	}
+
+	const std::chrono::steady_clock::time_point & origin()
+	{
+		static const std::chrono::steady_clock::time_point t = std::chrono::steady_clock::now();
+		return t;
+	}
+
+	std::string currentThreadName()
+	{
+		QThread *thread = QThread::currentThread();
+		if (QCoreApplication::instance() != NULL && thread == QCoreApplication::instance()->thread())
+			return "main";
+		if (thread != NULL && !thread->objectName().isEmpty())
+			return thread->objectName().toStdString();
+		return thread != NULL ? thread->metaObject()->className() : "thread";
+	}
+
+	/* Gives the buffer of a thread back when the thread finishes */
+	struct BufferHolder
+	{
+		ThreadBuffer *buffer;
+
+		BufferHolder() : buffer(NULL) {}
+		~BufferHolder()
+		{
+			if (buffer == NULL)
+				return;
+			Registry &r = registry();
+			std::lock_guard<std::mutex> lock(r.mutex);
+			r.free_buffers.push_back(buffer);
+			/* The name is kept as long as the spans of the thread may be exported */
+			if (buffer->head.load(std::memory_order_acquire) == buffer->cleared)
+				r.thread_names.erase(buffer->tid);
+			else
+				r.finished_tids.push_back(buffer->tid);
+		}
+	};
+
+	ThreadBuffer * threadBuffer()
+	{
+		static thread_local BufferHolder holder;
+		if (holder.buffer != NULL)
+			return holder.buffer;
+
+		std::string name = currentThreadName();
+		Registry &r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		ThreadBuffer *buffer;
+		if (!r.free_buffers.empty())
+		{
+			/* Its events stay, with the tid of the thread that recorded them */
+			buffer = r.free_buffers.back();
+			r.free_buffers.pop_back();
+		}
+		else
+		{
+			buffer = new ThreadBuffer;
+			buffer->head.store(0);
+			buffer->cleared = 0;
+			r.buffers.push_back(buffer);
+		}
+		buffer->tid = r.next_tid++;
+		r.thread_names[buffer->tid] = name;
+		holder.buffer = buffer;
+		return buffer;
+	}
+
+	std::string stageName(const Tracer::Event &e)
+	{
+		if (e.arg == TRACE_NO_ARG)
+			return e.name;
+		return std::string(e.name) + "[" + std::to_string(e.arg) + "]";
+	}
+
+	struct StageStats
+	{
+		std::string name;
+		int count;
+		long long total;
+		long long max;
+	};
+
+	bool longerStage(const StageStats &a, const StageStats &b)
+	{
+		return a.total > b.total;
+	}
+
+	bool earlierEvent(const Tracer::Event &a, const Tracer::Event &b)
+	{
+		return a.begin < b.begin;
+	}
+}
+
+long long Tracer::now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin()).count();
+}
+
+void Tracer::record(const char *name, long long begin, long long end, int arg)
+{
+	ThreadBuffer *buffer = threadBuffer();
+	unsigned long long head = buffer->head.load(std::memory_order_relaxed);
+	Event &e = buffer->events[head % TRACE_BUFFER_EVENTS];
+	e.name = name;
+	e.begin = begin;
+	e.duration = end - begin;
+	e.arg = arg;
+	e.tid = buffer->tid;
+	buffer->head.store(head + 1, std::memory_order_release);
+}
+
+std::vector<Tracer::Event> Tracer::events()
+{
+	std::vector<Event> result;
+	Registry &r = registry();
+	{
+		std::lock_guard<std::mutex> lock(r.mutex);
+		for (int i = 0; i < (int)r.buffers.size(); i++)
+		{
+			ThreadBuffer *buffer = r.buffers[i];
+			unsigned long long head = buffer->head.load(std::memory_order_acquire);
+			unsigned long long first = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+			first = std::max(first, buffer->cleared);
+			for (unsigned long long k = first; k < head; k++)
+				result.push_back(buffer->events[k % TRACE_BUFFER_EVENTS]);
+		}
+	}
+	std::sort(result.begin(), result.end(), earlierEvent);
+	return result;
+}
+
+void Tracer::clear()
+{
+	Registry &r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	for (int i = 0; i < (int)r.buffers.size(); i++)
+		r.buffers[i]->cleared = r.buffers[i]->head.load(std::memory_order_acquire);
+	for (int i = 0; i < (int)r.finished_tids.size(); i++)
+		r.thread_names.erase(r.finished_tids[i]);
+	r.finished_tids.clear();
+}
+
+bool Tracer::writeChromeTrace(const std::string &filename)
+{
+	std::vector<Event> all = events();
+	std::map<int, std::string> names;
+	{
+		Registry &r = registry();
+		std::lock_guard<std::mutex> lock(r.mutex);
+		names = r.thread_names;
+	}
+
+	std::ofstream out(filename.c_str());
+	if (!out.is_open())
+		return false;
+
+	/* Complete events ("X") with their time and duration in microseconds */
+	out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << std::endl;
+	char line[512];
+	bool first = true;
+	for (std::map<int, std::string>::const_iterator it = names.begin(); it != names.end(); ++it)
+	{
+		snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s-%d\"}}",
+			first ? "" : ",\n", it->first, it->second.c_str(), it->first);
+		out << line;
+		first = false;
+	}
+	for (int i = 0; i < (int)all.size(); i++)
+	{
+		const Event &e = all[i];
+		snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"cat\":\"pipeline\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+			first ? "" : ",\n", e.name, e.tid, e.begin / 1000.0, e.duration / 1000.0);
+		out << line;
+		if (e.arg != TRACE_NO_ARG)
+			out << ",\"args\":{\"arg\":" << e.arg << "}";
+		out << "}";
+		first = false;
+	}
+	out << std::endl << "]}" << std::endl;
+	out.close();
+	return true;
+}
+
+QString Tracer::summary()
+{
+	std::vector<Event> all = events();
+	std::map<std::string, int> index;
+	std::vector<StageStats> stages;
+	for (int i = 0; i < (int)all.size(); i++)
+	{
+		std::string name = stageName(all[i]);
+		std::map<std::string, int>::iterator it = index.find(name);
+		if (it == index.end())
+		{
+			StageStats s = { name, 0, 0, 0 };
+			it = index.insert(std::make_pair(name, (int)stages.size())).first;
+			stages.push_back(s);
+		}
+		StageStats &s = stages[it->second];
+		s.count++;
+		s.total += all[i].duration;
+		s.max = std::max(s.max, all[i].duration);
+	}
+	std::sort(stages.begin(), stages.end(), longerStage);
+
+	QString table = QString("%1 %2 %3 %4 %5").arg("stage", -24).arg("count", 8).arg("total ms", 12).arg("mean ms", 12).arg("max ms", 12);
+	for (int i = 0; i < (int)stages.size(); i++)
+	{
+		const StageStats &s = stages[i];
+		table.append("\n" + QString("%1 %2 %3 %4 %5").arg(QString::fromStdString(s.name), -24).arg(s.count, 8)
+			.arg(s.total / 1e6, 12, 'f', 2).arg(s.total / 1e6 / s.count, 12, 'f', 2).arg(s.max / 1e6, 12, 'f', 2));
+	}
+	return table;
+}
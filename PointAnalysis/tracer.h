@@ -0,0 +1,88 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <atomic>
+#include <string>
+#include <vector>
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1    /* 0 compiles the spans out */
+#endif
+#define TRACE_BUFFER_EVENTS 16384    /* Spans kept per thread, the oldest are overwritten */
+#define TRACE_NO_ARG -1
+
+/*
+ * Timing of the stages of the pipeline. A span is the time between its creation and its
+ * destruction (or end()) measured with a monotonic clock; it is written to a ring buffer of the
+ * thread, so recording takes no lock and the threads never wait for each other. Buffers of the
+ * threads that finished are reused by the next threads, each span keeps the id of its thread.
+ * writeChromeTrace() exports the spans for chrome://tracing, summary() is a table of the total
+ * and mean time of each stage. Both read the buffers while they may be written, so call them
+ * between the stages (the spans being written then may be lost, never the finished ones).
+ *
+ *   TRACE_SCOPE("normals");
+ *   TRACE_SCOPE_ARG("features", radius_id);    // "features[2]" in the summary
+ *
+ * A stage that starts in one slot and ends in another records itself with record(name, begin, end),
+ * within #if TRACE_ENABLED as the spans are.
+ */
+class Tracer
+{
+public:
+	struct Event
+	{
+		const char *name;    /* A string literal */
+		long long begin;    /* ns since the start of the process */
+		long long duration;    /* ns */
+		int arg;
+		int tid;
+	};
+
+	/* ns since the start of the process, monotonic */
+	static long long now();
+	static void record(const char *name, long long begin, long long end, int arg = TRACE_NO_ARG);
+
+	/* The spans of all threads, sorted by begin */
+	static std::vector<Event> events();
+	/* Drop the spans recorded so far */
+	static void clear();
+	static bool writeChromeTrace(const std::string &filename);
+	/* One line per stage: count, total, mean and max duration in ms, the longest stages first */
+	static QString summary();
+};
+
+class TraceSpan
+{
+public:
+	TraceSpan(const char *name, int arg = TRACE_NO_ARG) : m_name(name), m_arg(arg), m_begin(Tracer::now()) {}
+	~TraceSpan() { end(); }
+
+	/* Record the span before the end of the scope */
+	void end()
+	{
+		if (m_name != NULL)
+			Tracer::record(m_name, m_begin, Tracer::now(), m_arg);
+		m_name = NULL;
+	}
+
+private:
+	const char *m_name;
+	int m_arg;
+	long long m_begin;
+
+	TraceSpan(const TraceSpan &);
+	TraceSpan & operator=(const TraceSpan &);
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#if TRACE_ENABLED
+#define TRACE_SCOPE(name) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#define TRACE_SCOPE_ARG(name, arg) TraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name, arg)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_SCOPE_ARG(name, arg)
+#endif
+
+#endif // TRACER_H
@@ -3,7 +3,7 @@
 using namespace std;
 
 TrainPartsThread::TrainPartsThread(QObject *parent)
-	: QThread(parent), currentId(0)
+	: QThread(parent), currentId(0), m_fast(TRAIN_PARTS_FAST)
 {
 	qRegisterMetaType<QVector<PAPart>>("QVector<PAPart>");
 	cout << "TrainPartsThread is created." << endl;
@@ -35,6 +35,13 @@ TrainPartsThread::TrainPartsThread(QObject *parent)
 		}
 	}
 
+	if (m_fast)
+	{
+		/* All the models are loaded and analysed in run() */
+		start();
+		return;
+	}
+
 	cout << "Load point cloud from" << file_list[currentId] << endl;
 	loadThread.setLoadFileName(file_list[currentId]);
 	loadThread.start();
@@ -48,8 +55,14 @@ TrainPartsThread::~TrainPartsThread()
 
 void TrainPartsThread::run()
 {
-	analyseProbPartModel();
+	long start_time = Utils::getCurrentTime();
+	if (m_fast)
+		trainParallel();
+	else
+		analyseProbPartModel();
 	savePartRelationPriors();
+	emit addDebugText("Training part relation priors done in " + QString::number(Utils::getCurrentTime() - start_time) + " ms.");
+	emit finish();
 }
 
 void TrainPartsThread::receiveModel(PCModel *pc)
@@ -179,6 +192,132 @@ void TrainPartsThread::analyseProbPartModel()
 	}
 }
 
+void RelationStatistics::add(const std::vector<double> &feature)
+{
+	Eigen::Map<const Eigen::VectorXd> x(feature.data(), RELATION_PRIORS_DIMENSION);
+	m_count++;
+	Eigen::VectorXd delta = x - m_mean;
+	m_mean += delta / (double)m_count;
+	m_comoment += delta * (x - m_mean).transpose();
+}
+
+void RelationStatistics::merge(const RelationStatistics &other)
+{
+	if (other.m_count == 0)
+		return;
+	if (m_count == 0)
+	{
+		*this = other;
+		return;
+	}
+	long long count = m_count + other.m_count;
+	Eigen::VectorXd delta = other.m_mean - m_mean;
+	double factor = (double)m_count * (double)other.m_count / (double)count;
+	m_mean += delta * ((double)other.m_count / (double)count);
+	m_comoment += other.m_comoment + delta * delta.transpose() * factor;
+	m_count = count;
+}
+
+Eigen::MatrixXd RelationStatistics::covariance() const
+{
+	if (m_count < 2)
+		return Eigen::MatrixXd::Zero(RELATION_PRIORS_DIMENSION, RELATION_PRIORS_DIMENSION);
+	return m_comoment / (double)(m_count - 1);
+}
+
+bool TrainPartsThread::accumulateModel(const std::string &filename, QMap<QPair<int, int>, RelationStatistics> &statistics)
+{
+	QVector<float> coordinates;
+	QVector<int> labels;
+	if (!Utils::loadLabeledPoints(filename.c_str(), coordinates, labels))
+		return false;
+	/* In the unit of the point clouds the relations are evaluated on */
+	Utils::normalizePoints(coordinates.data(), labels.size());
+
+	/* The points of each part */
+	QMap<int, pcl::PointCloud<pcl::PointXYZ>::Ptr> part_clouds;
+	for (int i = 0; i < labels.size(); i++)
+	{
+		if (!part_clouds.contains(labels[i]))
+			part_clouds.insert(labels[i], pcl::PointCloud<pcl::PointXYZ>::Ptr(new pcl::PointCloud<pcl::PointXYZ>));
+		part_clouds[labels[i]]->push_back(pcl::PointXYZ(coordinates[3 * i], coordinates[3 * i + 1], coordinates[3 * i + 2]));
+	}
+
+	/* The part of each label from its oriented bounding box, as PCAThread does */
+	QVector<PAPart> parts;
+	for (QMap<int, pcl::PointCloud<pcl::PointXYZ>::Ptr>::iterator it = part_clouds.begin(); it != part_clouds.end(); ++it)
+	{
+		OBBEstimator obbe(it.key(), it.value());
+		OBB *obb = obbe.computeOBB();
+		parts.push_back(PAPart(obb));
+		delete(obb);
+	}
+
+	/* The relations of all ordered pairs of different labels */
+	for (int i = 0; i < parts.size(); i++)
+	{
+		for (int j = 0; j < parts.size(); j++)
+		{
+			if (i != j)
+			{
+				PAPartRelation relation(parts[i], parts[j]);
+				statistics[QPair<int, int>(parts[i].getLabel(), parts[j].getLabel())].add(relation.getFeatureVector());
+			}
+		}
+	}
+	return true;
+}
+
+void TrainPartsThread::trainParallel()
+{
+	/* Each thread accumulates the relations of the models it takes, then the statistics of the threads are merged */
+	QMap<QPair<int, int>, RelationStatistics> statistics;
+	int nmodels = file_list.size();
+	int done = 0;
+#pragma omp parallel
+	{
+		QMap<QPair<int, int>, RelationStatistics> thread_statistics;
+#pragma omp for schedule(dynamic, 1)
+		for (int i = 0; i < nmodels; i++)
+		{
+			bool loaded = accumulateModel(file_list[i], thread_statistics);
+#pragma omp critical(train_parts_progress)
+			{
+				done++;
+				if (loaded)
+					emit addDebugText("Analysed parts of " + QString::fromStdString(file_list[i]) + " (" + QString::number(done) + "/" + QString::number(nmodels) + ").");
+				else
+					emit addDebugText("Can't load the labeled points of " + QString::fromStdString(file_list[i]) + ".");
+			}
+		}
+#pragma omp critical(train_parts_merge)
+		{
+			for (QMap<QPair<int, int>, RelationStatistics>::iterator it = thread_statistics.begin(); it != thread_statistics.end(); ++it)
+				statistics[it.key()].merge(it.value());
+		}
+	}
+
+	/* Mean vector and covariance matrix of each parts pair */
+	QList<QPair<int, int>> label_pairs = statistics.keys();
+	int npairs = label_pairs.size();
+	QVector<RelationStatistics> pair_statistics = QVector<RelationStatistics>::fromList(statistics.values());
+	std::vector<Eigen::VectorXd> means(npairs);
+	std::vector<Eigen::MatrixXd> covariances(npairs);
+#pragma omp parallel for
+	for (int i = 0; i < npairs; i++)
+	{
+		means[i] = pair_statistics[i].mean();
+		covariances[i] = pair_statistics[i].covariance();
+	}
+
+	for (int i = 0; i < npairs; i++)
+	{
+		qDebug("(%d, %d) has %lld pairwise part relations.", label_pairs[i].first, label_pairs[i].second, pair_statistics[i].count());
+		mean_vecs.insert(label_pairs[i], means[i]);
+		cov_mats.insert(label_pairs[i], covariances[i]);
+	}
+}
+
 void TrainPartsThread::savePartRelationPriors()
 {
 	std::string mean_path = "../data/parts_relations/" + class_name + "_mean.txt";
@@ -218,5 +357,12 @@ void TrainPartsThread::savePartRelationPriors()
 	mean_out.close();
 	cov_out.close();
 
+	/* The binary bundle EnergyFunctions maps, with the factorized covariances */
+	std::string priors_path = "../data/parts_relations/" + class_name + RELATION_PRIORS_SUFFIX;
+	RelationPriors *priors = RelationPriors::build(mean_vecs, cov_mats);
+	if (!priors->save(priors_path))
+		cout << "Can't write " << priors_path << endl;
+	delete(priors);
+
 	cout << "Writting part relations done." << endl;
 }
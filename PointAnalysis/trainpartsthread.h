@@ -20,6 +20,32 @@
 #include "papartrelation.h"
 #include "papart.h"
 #include "utils.h"
+#include "obbestimator.h"
+#include "relationpriors.h"
+
+#define TRAIN_PARTS_FAST true    /* Load only the labeled points of the models and train the priors in parallel */
+
+/*
+ * Running mean and co-moment of the part relation vectors of a label pair (Welford), so
+ * the relation vectors need not be kept. Two statistics are merged with the formula of Chan et al.
+ */
+class RelationStatistics
+{
+public:
+	RelationStatistics() : m_count(0), m_mean(Eigen::VectorXd::Zero(RELATION_PRIORS_DIMENSION)), 
+		m_comoment(Eigen::MatrixXd::Zero(RELATION_PRIORS_DIMENSION, RELATION_PRIORS_DIMENSION)) {}
+
+	void add(const std::vector<double> &feature);
+	void merge(const RelationStatistics &other);
+	long long count() const { return m_count; }
+	Eigen::VectorXd mean() const { return m_mean; }
+	Eigen::MatrixXd covariance() const;    /* Sample covariance, normalized by count - 1 as mlpack's GaussianDistribution */
+
+private:
+	long long m_count;
+	Eigen::VectorXd m_mean;
+	Eigen::MatrixXd m_comoment;    /* Sum of the outer products of the deviations from the mean */
+};
 
 class TrainPartsThread : public QThread
 {
@@ -37,6 +63,7 @@ public:
 signals:
 	void addDebugText(QString text);
 	void showModel(PCModel *pc); 
+	void finish();
 
 protected:
 	void run();
@@ -49,8 +76,11 @@ private:
 	QMap<QPair<int, int>, Eigen::MatrixXd> cov_mats;
 	int currentId;
 	std::string class_name;
+	bool m_fast;
 
 	void analyseProbPartModel();
+	void trainParallel();
+	bool accumulateModel(const std::string &filename, QMap<QPair<int, int>, RelationStatistics> &statistics);
 	void savePartRelationPriors();
 };
 
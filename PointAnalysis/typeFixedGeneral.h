@@ -0,0 +1,293 @@
+/******************************************************************
+typeFixedGeneral.h
+
+Same energy as TypeGeneral with GENERAL interactions:
+   E(x)   =   \sum_i D_i(x_i)   +   \sum_ij V_ij(x_i,x_j)
+   where x_i \in {0, 1, ..., K-1}
+   V_ij(ki, kj) are given as matrices K*K.
+
+   The number of labels K is a template parameter and is the same for all nodes.
+   Unary terms, edge matrices and messages are stored inline at compile-time size
+   (no per-edge message pointer), and message updates use GeneralKernels<K>.
+   MRFEnergy is instantiated for K = 2..16 (see instances.inc).
+
+
+Example usage:
+
+	MRFEnergy<TypeFixedGeneral<3> >* mrf;
+	MRFEnergy<TypeFixedGeneral<3> >::NodeId* nodes;
+
+	mrf = new MRFEnergy<TypeFixedGeneral<3> >(TypeFixedGeneral<3>::GlobalSize());
+	nodes[0] = mrf->AddNode(TypeFixedGeneral<3>::LocalSize(), TypeFixedGeneral<3>::NodeData(Dx));
+	nodes[1] = mrf->AddNode(TypeFixedGeneral<3>::LocalSize(), TypeFixedGeneral<3>::NodeData(Dy));
+	mrf->AddEdge(nodes[0], nodes[1], TypeFixedGeneral<3>::EdgeData(V)); // V(x,y) = V[x + 3*y]
+
+*******************************************************************/
+
+
+
+
+
+
+
+
+
+
+
+
+#ifndef __TYPEFIXEDGENERAL_H__
+#define __TYPEFIXEDGENERAL_H__
+
+#include <string.h>
+#include <assert.h>
+#include "typeGeneral.h" // GeneralKernels
+
+
+template <class T> class MRFEnergy;
+
+
+template <int K> class TypeFixedGeneral
+{
+private:
+	struct Vector; // node parameters and messages
+	struct Edge; // stores edge information and either forward or backward message
+
+public:
+	// types declarations
+	typedef int Label;
+	typedef double REAL;
+	struct GlobalSize; // global information about number of labels
+	struct LocalSize; // local information about number of labels (stored at each node)
+	struct NodeData; // argument to MRFEnergy::AddNode()
+	struct EdgeData; // argument to MRFEnergy::AddEdge()
+
+
+	struct GlobalSize // number of labels is the template parameter K
+	{
+	};
+
+	struct LocalSize
+	{
+	};
+
+	struct NodeData
+	{
+		NodeData(REAL* data); // data = pointer to array of size K
+
+	private:
+	friend struct Vector;
+	friend struct Edge;
+		REAL*		m_data;
+	};
+
+	struct EdgeData
+	{
+		EdgeData(REAL* data); // data = pointer to array of size K*K
+		                      // such that V(ki,kj) = data[ki + K*kj]
+
+	private:
+	friend struct Vector;
+	friend struct Edge;
+		REAL*		m_data;
+	};
+
+
+
+
+
+
+
+	//////////////////////////////////////////////////////////////////////////////////
+	////////////////////////// Visible only to MRFEnergy /////////////////////////////
+	//////////////////////////////////////////////////////////////////////////////////
+
+private:
+friend class MRFEnergy<TypeFixedGeneral<K> >;
+
+	struct Vector
+	{
+		static int GetSizeInBytes(GlobalSize Kglobal, LocalSize Klocal); // returns -1 if invalid K's
+		void Initialize(GlobalSize Kglobal, LocalSize Klocal, NodeData data);  // called once when user adds a node
+		void Add(GlobalSize Kglobal, LocalSize Klocal, NodeData data); // called once when user calls MRFEnergy::AddNodeData()
+
+		void SetZero(GlobalSize Kglobal, LocalSize Klocal);                            // set this[k] = 0
+		void Copy(GlobalSize Kglobal, LocalSize Klocal, Vector* V);                    // set this[k] = V[k]
+		void Add(GlobalSize Kglobal, LocalSize Klocal, Vector* V);                     // set this[k] = this[k] + V[k]
+		REAL GetValue(GlobalSize Kglobal, LocalSize Klocal, Label k);                  // return this[k]
+		REAL ComputeMin(GlobalSize Kglobal, LocalSize Klocal, Label& kMin);            // return min_k { this[k] }, set kMin
+		REAL ComputeAndSubtractMin(GlobalSize Kglobal, LocalSize Klocal);              // same as previous, but additionally set this[k] -= vMin (and kMin is not returned)
+
+		static int GetArraySize(GlobalSize Kglobal, LocalSize Klocal);
+		REAL GetArrayValue(GlobalSize Kglobal, LocalSize Klocal, int k); // note: k is an integer in [0..GetArraySize()-1].
+		void SetArrayValue(GlobalSize Kglobal, LocalSize Klocal, int k, REAL x);
+
+	private:
+	friend struct Edge;
+		REAL		m_data[K];
+	};
+
+	struct Edge
+	{
+		static int GetSizeInBytes(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data); // returns -1 if invalid data
+		static int GetBufSizeInBytes(int vectorMaxSizeInBytes); // returns size of buffer need for UpdateMessage()
+		void Initialize(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data, Vector* Di, Vector* Dj); // called once when user adds an edge
+		Vector* GetMessagePtr();
+		void Swap(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj); // if the client calls this function, then the meaning of 'dir'
+								                                               // in distance transform functions is swapped
+
+		// See TypeGeneral::Edge::UpdateMessage().
+		REAL UpdateMessage(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Vector* source, REAL gamma, int dir, void* buf);
+
+		// If dir==0, then sets dest[kj] += V(ksource,kj).
+		// If dir==1, then sets dest[ki] += V(ki,ksource).
+		// If Swap() has been called odd number of times, then the meaning of dir is swapped.
+		void AddColumn(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Label ksource, Vector* dest, int dir);
+
+	private:
+		Vector		m_message; // stored next to the matrix, no indirection
+		int			m_dir; // 0 if Swap() was called even number of times, 1 otherwise
+		REAL		m_data[K*K]; // V(ki,kj) = m_data[ki + K*kj]
+	};
+};
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////
+/////////////////////////////// Implementation ///////////////////////////////////
+//////////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////// NodeData and EdgeData ///////////////////////
+
+template <int K> inline TypeFixedGeneral<K>::NodeData::NodeData(REAL* data)
+{
+	m_data = data;
+}
+
+template <int K> inline TypeFixedGeneral<K>::EdgeData::EdgeData(REAL* data)
+{
+	m_data = data;
+}
+
+///////////////////// Vector ///////////////////////
+
+template <int K> inline int TypeFixedGeneral<K>::Vector::GetSizeInBytes(GlobalSize Kglobal, LocalSize Klocal)
+{
+	return sizeof(Vector);
+}
+
+template <int K> inline void TypeFixedGeneral<K>::Vector::Initialize(GlobalSize Kglobal, LocalSize Klocal, NodeData data)
+{
+	memcpy(m_data, data.m_data, K*sizeof(REAL));
+}
+
+template <int K> inline void TypeFixedGeneral<K>::Vector::Add(GlobalSize Kglobal, LocalSize Klocal, NodeData data)
+{
+	GeneralKernels<K>::Add(m_data, data.m_data, K);
+}
+
+template <int K> inline void TypeFixedGeneral<K>::Vector::SetZero(GlobalSize Kglobal, LocalSize Klocal)
+{
+	memset(m_data, 0, K*sizeof(REAL));
+}
+
+template <int K> inline void TypeFixedGeneral<K>::Vector::Copy(GlobalSize Kglobal, LocalSize Klocal, Vector* V)
+{
+	memcpy(m_data, V->m_data, K*sizeof(REAL));
+}
+
+template <int K> inline void TypeFixedGeneral<K>::Vector::Add(GlobalSize Kglobal, LocalSize Klocal, Vector* V)
+{
+	GeneralKernels<K>::Add(m_data, V->m_data, K);
+}
+
+template <int K> inline typename TypeFixedGeneral<K>::REAL TypeFixedGeneral<K>::Vector::GetValue(GlobalSize Kglobal, LocalSize Klocal, Label k)
+{
+	assert(k>=0 && k<K);
+	return m_data[k];
+}
+
+template <int K> inline typename TypeFixedGeneral<K>::REAL TypeFixedGeneral<K>::Vector::ComputeMin(GlobalSize Kglobal, LocalSize Klocal, Label& kMin)
+{
+	return GeneralKernels<K>::ArgMin(m_data, K, kMin);
+}
+
+template <int K> inline typename TypeFixedGeneral<K>::REAL TypeFixedGeneral<K>::Vector::ComputeAndSubtractMin(GlobalSize Kglobal, LocalSize Klocal)
+{
+	return GeneralKernels<K>::SubtractMin(m_data, K);
+}
+
+template <int K> inline int TypeFixedGeneral<K>::Vector::GetArraySize(GlobalSize Kglobal, LocalSize Klocal)
+{
+	return K;
+}
+
+template <int K> inline typename TypeFixedGeneral<K>::REAL TypeFixedGeneral<K>::Vector::GetArrayValue(GlobalSize Kglobal, LocalSize Klocal, int k)
+{
+	assert(k>=0 && k<K);
+	return m_data[k];
+}
+
+template <int K> inline void TypeFixedGeneral<K>::Vector::SetArrayValue(GlobalSize Kglobal, LocalSize Klocal, int k, REAL x)
+{
+	assert(k>=0 && k<K);
+	m_data[k] = x;
+}
+
+///////////////////// EdgeDataAndMessage implementation /////////////////////////
+
+template <int K> inline int TypeFixedGeneral<K>::Edge::GetSizeInBytes(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data)
+{
+	return sizeof(Edge);
+}
+
+template <int K> inline int TypeFixedGeneral<K>::Edge::GetBufSizeInBytes(int vectorMaxSizeInBytes)
+{
+	return vectorMaxSizeInBytes;
+}
+
+template <int K> inline void TypeFixedGeneral<K>::Edge::Initialize(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj, EdgeData data, Vector* Di, Vector* Dj)
+{
+	m_dir = 0;
+	memcpy(m_data, data.m_data, K*K*sizeof(REAL));
+	memset(m_message.m_data, 0, K*sizeof(REAL));
+}
+
+template <int K> inline typename TypeFixedGeneral<K>::Vector* TypeFixedGeneral<K>::Edge::GetMessagePtr()
+{
+	return &m_message;
+}
+
+template <int K> inline void TypeFixedGeneral<K>::Edge::Swap(GlobalSize Kglobal, LocalSize Ki, LocalSize Kj)
+{
+	m_dir = 1 - m_dir;
+}
+
+template <int K> inline typename TypeFixedGeneral<K>::REAL TypeFixedGeneral<K>::Edge::UpdateMessage(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Vector* source, REAL gamma, int dir, void* buf)
+{
+	return GeneralKernels<K>::UpdateMessage(m_message.m_data, source->m_data, gamma, ((Vector*)buf)->m_data, m_data, dir != m_dir, K, K);
+}
+
+template <int K> inline void TypeFixedGeneral<K>::Edge::AddColumn(GlobalSize Kglobal, LocalSize Ksource, LocalSize Kdest, Label ksource, Vector* dest, int dir)
+{
+	assert(ksource>=0 && ksource<K);
+
+	int k;
+
+	if (dir == m_dir)
+	{
+		for (k=0; k<K; k++)
+		{
+			dest->m_data[k] += m_data[ksource + k*K];
+		}
+	}
+	else
+	{
+		GeneralKernels<K>::Add(dest->m_data, m_data + ksource*K, K);
+	}
+}
+
+//////////////////////////////////////////////////////////////////////////////////
+
+#endif
@@ -8,6 +8,8 @@ Energy function with general interactions:
    (V_ij(ki, kj) = 0 if ki==kj, and lambda_ij otherwise, with non-negative lambda_ij).
 
    Inefficient! If possible, use other type*.h files.
+   (GENERAL message updates use the SSE2 kernels in GeneralKernels, with
+   compile-time sizes for Ki == Kj <= 16.)
 
 
 Example usage:
@@ -110,6 +112,212 @@ void testGeneral()
 #include <string.h>
 #include <assert.h>
 
+// SSE2 is always available on x64; other targets use the scalar code below
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define TYPEGENERAL_SSE2
+#include <emmintrin.h>
+#endif
+
+
+// Min-sum kernels on arrays of doubles used by TypeGeneral.
+// N is the array size if known at compile time (the compiler can then unroll
+// the loops), N == 0 means that the size n is given at run time.
+template <int N> struct GeneralKernels
+{
+	// dst[k] += src[k]
+	static inline void Add(double* dst, const double* src, int n)
+	{
+		const int K = N ? N : n;
+		int k = 0;
+#ifdef TYPEGENERAL_SSE2
+		for ( ; k+2<=K; k+=2)
+		{
+			_mm_storeu_pd(dst+k, _mm_add_pd(_mm_loadu_pd(dst+k), _mm_loadu_pd(src+k)));
+		}
+#endif
+		for ( ; k<K; k++)
+		{
+			dst[k] += src[k];
+		}
+	}
+
+	// dst[k] = gamma*source[k] - message[k]
+	static inline void Reparameterize(double* dst, const double* source, double gamma, const double* message, int n)
+	{
+		const int K = N ? N : n;
+		int k = 0;
+#ifdef TYPEGENERAL_SSE2
+		__m128d g = _mm_set1_pd(gamma);
+		for ( ; k+2<=K; k+=2)
+		{
+			_mm_storeu_pd(dst+k, _mm_sub_pd(_mm_mul_pd(g, _mm_loadu_pd(source+k)), _mm_loadu_pd(message+k)));
+		}
+#endif
+		for ( ; k<K; k++)
+		{
+			dst[k] = gamma*source[k] - message[k];
+		}
+	}
+
+	// returns min_k v[k]
+	static inline double Min(const double* v, int n)
+	{
+		const int K = N ? N : n;
+		double vMin = v[0];
+		int k = 1;
+#ifdef TYPEGENERAL_SSE2
+		if (K >= 2)
+		{
+			__m128d m = _mm_loadu_pd(v);
+			for (k=2; k+2<=K; k+=2)
+			{
+				m = _mm_min_pd(m, _mm_loadu_pd(v+k));
+			}
+			vMin = _mm_cvtsd_f64(_mm_min_sd(m, _mm_unpackhi_pd(m, m)));
+		}
+#endif
+		for ( ; k<K; k++)
+		{
+			if (vMin > v[k]) vMin = v[k];
+		}
+		return vMin;
+	}
+
+	// returns min_k v[k], sets kMin to the first k with v[k] == min
+	static inline double ArgMin(const double* v, int n, int& kMin)
+	{
+		const int K = N ? N : n;
+		double vMin = Min(v, K);
+		for (kMin=0; kMin<K-1 && v[kMin]!=vMin; kMin++) {}
+		return vMin;
+	}
+
+	// v[k] -= vMin where vMin = min_k v[k], returns vMin
+	static inline double SubtractMin(double* v, int n)
+	{
+		const int K = N ? N : n;
+		double vMin = Min(v, K);
+		int k = 0;
+#ifdef TYPEGENERAL_SSE2
+		__m128d m = _mm_set1_pd(vMin);
+		for ( ; k+2<=K; k+=2)
+		{
+			_mm_storeu_pd(v+k, _mm_sub_pd(_mm_loadu_pd(v+k), m));
+		}
+#endif
+		for ( ; k<K; k++)
+		{
+			v[k] -= vMin;
+		}
+		return vMin;
+	}
+
+	// message[kdest] = min_{ksource} (buf[ksource] + data[ksource + kdest*Ksource]), Ksource = N or n
+	// (columns of data are contiguous: vectorized over ksource, two columns at a time
+	// so that their horizontal mins are combined in one register)
+	static inline void DistanceTransformColumns(double* message, const double* buf, const double* data, int n, int Kdest)
+	{
+		const int K = N ? N : n;
+		int kdest = 0, k;
+#ifdef TYPEGENERAL_SSE2
+		if (K >= 2)
+		{
+			for ( ; kdest+2<=Kdest; kdest+=2, data+=2*K)
+			{
+				__m128d b = _mm_loadu_pd(buf);
+				__m128d m0 = _mm_add_pd(b, _mm_loadu_pd(data));
+				__m128d m1 = _mm_add_pd(b, _mm_loadu_pd(data+K));
+				for (k=2; k+2<=K; k+=2)
+				{
+					b = _mm_loadu_pd(buf+k);
+					m0 = _mm_min_pd(m0, _mm_add_pd(b, _mm_loadu_pd(data+k)));
+					m1 = _mm_min_pd(m1, _mm_add_pd(b, _mm_loadu_pd(data+K+k)));
+				}
+				if (k < K) // odd K: the last entry of both columns
+				{
+					b = _mm_set1_pd(buf[k]);
+					__m128d last = _mm_add_pd(b, _mm_set_pd(data[K+k], data[k]));
+					m0 = _mm_min_sd(m0, last);
+					m1 = _mm_min_sd(m1, _mm_unpackhi_pd(last, last));
+				}
+				_mm_storeu_pd(message+kdest, _mm_min_pd(_mm_unpacklo_pd(m0, m1), _mm_unpackhi_pd(m0, m1)));
+			}
+		}
+#endif
+		for ( ; kdest<Kdest; kdest++, data+=K)
+		{
+			double vMin = buf[0] + data[0];
+			for (k=1; k<K; k++)
+			{
+				if (vMin > buf[k] + data[k]) vMin = buf[k] + data[k];
+			}
+			message[kdest] = vMin;
+		}
+	}
+
+	// message[kdest] = min_{ksource} (buf[ksource] + data[kdest + ksource*Kdest]), Kdest = N or n
+	// (rows of data are contiguous: vectorized over kdest, four entries of message are kept
+	// in registers while going through the rows)
+	static inline void DistanceTransformRows(double* message, const double* buf, const double* data, int n, int Ksource)
+	{
+		const int K = N ? N : n;
+		int k = 0, ksource;
+#ifdef TYPEGENERAL_SSE2
+		for ( ; k+4<=K; k+=4)
+		{
+			__m128d b = _mm_set1_pd(buf[0]);
+			__m128d m0 = _mm_add_pd(b, _mm_loadu_pd(data+k));
+			__m128d m1 = _mm_add_pd(b, _mm_loadu_pd(data+k+2));
+			for (ksource=1; ksource<Ksource; ksource++)
+			{
+				const double* row = data + ksource*K + k;
+				b = _mm_set1_pd(buf[ksource]);
+				m0 = _mm_min_pd(m0, _mm_add_pd(b, _mm_loadu_pd(row)));
+				m1 = _mm_min_pd(m1, _mm_add_pd(b, _mm_loadu_pd(row+2)));
+			}
+			_mm_storeu_pd(message+k, m0);
+			_mm_storeu_pd(message+k+2, m1);
+		}
+		for ( ; k+2<=K; k+=2)
+		{
+			__m128d m0 = _mm_add_pd(_mm_set1_pd(buf[0]), _mm_loadu_pd(data+k));
+			for (ksource=1; ksource<Ksource; ksource++)
+			{
+				m0 = _mm_min_pd(m0, _mm_add_pd(_mm_set1_pd(buf[ksource]), _mm_loadu_pd(data+ksource*K+k)));
+			}
+			_mm_storeu_pd(message+k, m0);
+		}
+#endif
+		for ( ; k<K; k++)
+		{
+			double vMin = buf[0] + data[k];
+			for (ksource=1; ksource<Ksource; ksource++)
+			{
+				if (vMin > buf[ksource] + data[k+ksource*K]) vMin = buf[ksource] + data[k+ksource*K];
+			}
+			message[k] = vMin;
+		}
+	}
+
+	// the GENERAL message update of TypeGeneral::Edge::UpdateMessage(), steps 1-5;
+	// transposed == false if V(ksource,kdest) = data[ksource + kdest*Ksource].
+	// If N != 0 then Ksource == Kdest == N.
+	static inline double UpdateMessage(double* message, const double* source, double gamma, double* buf, const double* data, bool transposed, int Ksource, int Kdest)
+	{
+		if (!transposed)
+		{
+			GeneralKernels<N>::Reparameterize(buf, source, gamma, message, Ksource);
+			GeneralKernels<N>::DistanceTransformColumns(message, buf, data, Ksource, Kdest);
+		}
+		else
+		{
+			GeneralKernels<N>::Reparameterize(buf, source, gamma, message, Ksource);
+			GeneralKernels<N>::DistanceTransformRows(message, buf, data, Kdest, Ksource);
+		}
+		return GeneralKernels<N>::SubtractMin(message, Kdest);
+	}
+};
+
 
 template <class T> class MRFEnergy;
 
@@ -329,10 +537,7 @@ inline void TypeGeneral::Vector::Initialize(GlobalSize Kglobal, LocalSize K, Nod
 
 inline void TypeGeneral::Vector::Add(GlobalSize Kglobal, LocalSize K, NodeData data)
 {
-	for (int k=0; k<K.m_K; k++)
-	{
-		m_data[k] += data.m_data[k];
-	}
+	GeneralKernels<0>::Add(m_data, data.m_data, K.m_K);
 }
 
 inline void TypeGeneral::Vector::SetZero(GlobalSize Kglobal, LocalSize K)
@@ -347,10 +552,7 @@ inline void TypeGeneral::Vector::Copy(GlobalSize Kglobal, LocalSize K, Vector* V
 
 inline void TypeGeneral::Vector::Add(GlobalSize Kglobal, LocalSize K, Vector* V)
 {
-	for (int k=0; k<K.m_K; k++)
-	{
-		m_data[k] += V->m_data[k];
-	}
+	GeneralKernels<0>::Add(m_data, V->m_data, K.m_K);
 }
 
 inline TypeGeneral::REAL TypeGeneral::Vector::GetValue(GlobalSize Kglobal, LocalSize K, Label k)
@@ -361,36 +563,12 @@ inline TypeGeneral::REAL TypeGeneral::Vector::GetValue(GlobalSize Kglobal, Local
 
 inline TypeGeneral::REAL TypeGeneral::Vector::ComputeMin(GlobalSize Kglobal, LocalSize K, Label& kMin)
 {
-	REAL vMin = m_data[0];
-	kMin = 0;
-	for (int k=1; k<K.m_K; k++)
-	{
-		if (vMin > m_data[k])
-		{
-			vMin = m_data[k];
-			kMin = k;
-		}
-	}
-
-	return vMin;
+	return GeneralKernels<0>::ArgMin(m_data, K.m_K, kMin);
 }
 
 inline TypeGeneral::REAL TypeGeneral::Vector::ComputeAndSubtractMin(GlobalSize Kglobal, LocalSize K)
 {
-	REAL vMin = m_data[0];
-	for (int k=1; k<K.m_K; k++)
-	{
-		if (vMin > m_data[k])
-		{
-			vMin = m_data[k];
-		}
-	}
-	for (int k=0; k<K.m_K; k++)
-	{
-		m_data[k] -= vMin;
-	}
-
-	return vMin;
+	return GeneralKernels<0>::SubtractMin(m_data, K.m_K);
 }
 
 inline int TypeGeneral::Vector::GetArraySize(GlobalSize Kglobal, LocalSize K)
@@ -509,57 +687,20 @@ inline TypeGeneral::REAL TypeGeneral::Edge::UpdateMessage(GlobalSize Kglobal, Lo
 	}
 	else if (m_type == GENERAL)
 	{
-		int ksource, kdest;
 		REAL* data = ((EdgeGeneral*)this)->m_data;
+		bool transposed = (dir != ((EdgeGeneral*)this)->m_dir);
 
-		for (ksource=0; ksource<Ksource.m_K; ksource++)
-		{
-			buf->m_data[ksource] = gamma*source->m_data[ksource] - m_message->m_data[ksource];
-		}
-
-		if (dir == ((EdgeGeneral*)this)->m_dir)
-		{
-			for (kdest=0; kdest<Kdest.m_K; kdest++)
-			{
-				vMin = buf->m_data[0] + data[0 + kdest*Ksource.m_K];
-				for (ksource=1; ksource<Ksource.m_K; ksource++)
-				{
-					if (vMin > buf->m_data[ksource] + data[ksource + kdest*Ksource.m_K])
-					{
-						vMin = buf->m_data[ksource] + data[ksource + kdest*Ksource.m_K];
-					}
-				}
-				m_message->m_data[kdest] = vMin;
-			}
-		}
-		else
-		{
-			for (kdest=0; kdest<Kdest.m_K; kdest++)
-			{
-				vMin = buf->m_data[0] + data[kdest + 0*Kdest.m_K];
-				for (ksource=1; ksource<Ksource.m_K; ksource++)
-				{
-					if (vMin > buf->m_data[ksource] + data[kdest + ksource*Kdest.m_K])
-					{
-						vMin = buf->m_data[ksource] + data[kdest + ksource*Kdest.m_K];
-					}
-				}
-				m_message->m_data[kdest] = vMin;
-			}
-		}
-
-		vMin = m_message->m_data[0];
-		for (kdest=1; kdest<Kdest.m_K; kdest++)
-		{
-			if (vMin > m_message->m_data[kdest])
-			{
-				vMin = m_message->m_data[kdest];
-			}
-		}
-
-		for (kdest=0; kdest<Kdest.m_K; kdest++)
+		// compile-time sizes for the common case Ksource == Kdest
+		switch ((Ksource.m_K == Kdest.m_K) ? Ksource.m_K : 0)
 		{
-			m_message->m_data[kdest] -= vMin;
+#define TYPEGENERAL_UPDATE_MESSAGE(N) case N: vMin = GeneralKernels<N>::UpdateMessage(m_message->m_data, source->m_data, gamma, buf->m_data, data, transposed, N, N); break;
+			TYPEGENERAL_UPDATE_MESSAGE(2)  TYPEGENERAL_UPDATE_MESSAGE(3)  TYPEGENERAL_UPDATE_MESSAGE(4)  TYPEGENERAL_UPDATE_MESSAGE(5)
+			TYPEGENERAL_UPDATE_MESSAGE(6)  TYPEGENERAL_UPDATE_MESSAGE(7)  TYPEGENERAL_UPDATE_MESSAGE(8)  TYPEGENERAL_UPDATE_MESSAGE(9)
+			TYPEGENERAL_UPDATE_MESSAGE(10) TYPEGENERAL_UPDATE_MESSAGE(11) TYPEGENERAL_UPDATE_MESSAGE(12) TYPEGENERAL_UPDATE_MESSAGE(13)
+			TYPEGENERAL_UPDATE_MESSAGE(14) TYPEGENERAL_UPDATE_MESSAGE(15) TYPEGENERAL_UPDATE_MESSAGE(16)
+#undef TYPEGENERAL_UPDATE_MESSAGE
+			default:
+				vMin = GeneralKernels<0>::UpdateMessage(m_message->m_data, source->m_data, gamma, buf->m_data, data, transposed, Ksource.m_K, Kdest.m_K);
 		}
 	}
 	else
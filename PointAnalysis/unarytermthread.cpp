@@ -11,7 +11,7 @@ UnaryTermThread::UnaryTermThread(int id, Part_Candidates part_candidates, int st
 	: QThread(parent), m_id(id), m_part_candidates(part_candidates), 
 	m_start(start), m_end(end), m_energy_functions(energy_functions), m_label_names(label_names)
 {
-	qDebug("Create UnaryTermThread-%d to compute unary potentials of Node-%d to Node-%d", id, start, end);
+	LOG_DEBUG(Logger::Inference, "Create UnaryTermThread-%d to compute unary potentials of Node-%d to Node-%d", id, start, end);
 	qRegisterMetaType<Unary_Potentials>("UnaryPotentials");
 }
 
@@ -27,6 +27,7 @@ void UnaryTermThread::run()
 
 void UnaryTermThread::computeUnaryPotentials()
 {
+	TRACE_SCOPE_ARG("unary", m_id);
 	Unary_Potentials unary_potentials(m_end - m_start + 1);
 	int labelNum = m_label_names.size();
 
@@ -1,4 +1,6 @@
  #include "utils.h"
+#include "normalestimator.h"
+#include "derivedcache.h"
 
 int Utils::mat_no = 19;
 
@@ -171,27 +173,9 @@ PCModel * Utils::loadPointCloud_CGAL(const char *filename)
 			origin_points.push_back(point);    /* Add the point to origin_points list which keep the origin order of the points */
 		}
 
-		// Estimates normals direction.
-		// Note: pca_estimate_normals() requires an iterator over points
-		// as well as property maps to access each point's position and normal.
-		qDebug() << "Estimating normals direction...";
-		const int nb_neighbors = 18; // K-nearest neighbors = 3 rings
-		CGAL::jet_estimate_normals<Concurrency_tag>(points.begin(), points.end(),
-			CGAL::First_of_pair_property_map<PointVectorPair>(),
-			CGAL::Second_of_pair_property_map<PointVectorPair>(),
-			18);
-		qDebug() << "Normals estimation done.";
-
-		// Orients normals.
-		// Note: mst_orient_normals() requires an iterator over points
-		// as well as property maps to access each point's position and normal.
-		qDebug() << "Orienting normals...";
-		PointList::iterator unoriented_points_begin =
-			CGAL::mst_orient_normals(points.begin(), points.end(),
-			CGAL::First_of_pair_property_map<PointVectorPair>(),
-			CGAL::Second_of_pair_property_map<PointVectorPair>(),
-			16);
-		qDebug() << "Normals orientation done.";
+		/* Estimate and orient the normals, the points keep their order unless they are oriented by MST */
+		unsigned long long file_hash = DerivedCache::hashFile(filename);
+		bool order_kept = estimateNormals(file_hash, points);
 
 		std::ofstream off_out(meshFilename.toStdString().c_str());    /* Output file stream to save the model modified by CGAL algorithm to a new off file */
 		/* Write the header to new off file storing the model modified */
@@ -243,7 +227,7 @@ PCModel * Utils::loadPointCloud_CGAL(const char *filename)
 
 				/* Find the current indices of three points in the face i*/
 				Point3 sps[3] = { origin_points[v1], origin_points[v2], origin_points[v3] };
-				QVector<int> indices = searchPoints(sps, points);
+				QVector<int> indices = order_kept ? (QVector<int>() << v1 << v2 << v3) : searchPoints(sps, points);
 				//qDebug("Iteration-%d, indices of 3 points in current list: %d, %d, %d", i, indices[0], indices[1], indices[2]);
 
 				/* Set the point label for each point in labels array */
@@ -274,6 +258,7 @@ PCModel * Utils::loadPointCloud_CGAL(const char *filename)
 		off_out.close();
 		delete(outModel);    /* Delete the current empty model object */
 		outModel = new PCModel(nvertices, points_data, points_labels);
+		outModel->setContentHash(file_hash);
 	}
 	/* Read point cloud from xyz file */
 	else if (strcmp(suffix, "xyz") == 0)
@@ -373,27 +358,9 @@ PCModel * Utils::loadPointCloud_CGAL_SDF(const char *filename)
 			sdfs_origin[i] = std::atof(sdf_buffer);
 		}
 
-		// Estimates normals direction.
-		// Note: pca_estimate_normals() requires an iterator over points
-		// as well as property maps to access each point's position and normal.
-		qDebug() << "Estimating normals direction...";
-		const int nb_neighbors = 18; // K-nearest neighbors = 3 rings
-		CGAL::jet_estimate_normals<Concurrency_tag>(points.begin(), points.end(),
-			CGAL::First_of_pair_property_map<PointVectorPair>(),
-			CGAL::Second_of_pair_property_map<PointVectorPair>(),
-			18);
-		qDebug() << "Normals estimation done.";
-
-		// Orients normals.
-		// Note: mst_orient_normals() requires an iterator over points
-		// as well as property maps to access each point's position and normal.
-		qDebug() << "Orienting normals...";
-		PointList::iterator unoriented_points_begin =
-			CGAL::mst_orient_normals(points.begin(), points.end(),
-			CGAL::First_of_pair_property_map<PointVectorPair>(),
-			CGAL::Second_of_pair_property_map<PointVectorPair>(),
-			16);
-		qDebug() << "Normals orientation done.";
+		/* Estimate and orient the normals, the points keep their order unless they are oriented by MST */
+		unsigned long long file_hash = DerivedCache::hashFile(filename);
+		bool order_kept = estimateNormals(file_hash, points);
 
 		/* Add points after normals estimation into points_data which is to be sent to create PCModel object */
 		for (std::vector<PointVectorPair>::iterator it = points.begin(); it != points.end(); ++it)
@@ -436,7 +403,7 @@ PCModel * Utils::loadPointCloud_CGAL_SDF(const char *filename)
 
 				/* Find the current indices of three points in the face i*/
 				Point3 sps[3] = { origin_points[v1], origin_points[v2], origin_points[v3] };
-				QVector<int> indices = searchPoints(sps, points);
+				QVector<int> indices = order_kept ? (QVector<int>() << v1 << v2 << v3) : searchPoints(sps, points);
 				//qDebug("Iteration-%d, indices of 3 points in current list: %d, %d, %d", i, indices[0], indices[1], indices[2]);
 
 				/* Set the point label for each point in labels array */
@@ -469,13 +436,114 @@ PCModel * Utils::loadPointCloud_CGAL_SDF(const char *filename)
 		sdf_in.close();
 		delete(outModel);    /* Delete the current empty model object */
 		outModel = new PCModel(nvertices, points_data, points_labels);
+		outModel->setContentHash(file_hash);
 		outModel->setSdf(sdfs_current);
 	}
 	return outModel;
 }
+bool Utils::loadLabeledPoints(const char *filename, QVector<float> &coordinates, QVector<int> &labels)
+{
+	std::ifstream off_in(filename);
+	std::ifstream seg_in(Utils::getSegFilename(filename).toStdString().c_str());
+	if (!off_in.is_open() || !seg_in.is_open())
+		return false;
+
+	std::string header;
+	int nvertices, nfaces, nedges;
+	off_in >> header >> nvertices >> nfaces >> nedges;
+	if (!off_in || nvertices <= 0)
+		return false;
+
+	coordinates.resize(3 * nvertices);
+	for (int i = 0; i < 3 * nvertices; i++)
+		off_in >> coordinates[i];
+
+	/* The label of a vertex is the label of the last face containing it, as in loadPointCloud_CGAL_SDF */
+	labels.fill(9294, nvertices);
+	for (int i = 0; i < nfaces; i++)
+	{
+		int face_size, label;
+		off_in >> face_size;
+		seg_in >> label;
+		for (int j = 0; j < face_size; j++)
+		{
+			int v;
+			off_in >> v;
+			if (v >= 0 && v < nvertices)
+				labels[v] = label;
+		}
+	}
+	return !off_in.fail();
+}
+
+void Utils::normalizePoints(float *coordinates, int npoints)
+{
+	if (npoints <= 0)
+		return;
+
+	const int d = 3;
+	PointVector S;
+	vector<double> coords(d);
+	for (int i = 0; i < npoints; i++)
+	{
+		coords[0] = coordinates[3 * i];
+		coords[1] = coordinates[3 * i + 1];
+		coords[2] = coordinates[3 * i + 2];
+		S.push_back(MiniPoint(d, coords.begin()));
+	}
+
+	Miniball mb(d, S);
+	double rad = mb.radius();
+	Miniball::Coordinate_iterator center_it = mb.center_begin();
+	float center[3] = { center_it[0], center_it[1], center_it[2] };
+	for (int i = 0; i < npoints; i++)
+	{
+		for (int j = 0; j < d; j++)
+			coordinates[3 * i + j] = (coordinates[3 * i + j] - center[j]) / rad;
+	}
+}
+
+bool Utils::estimateNormals(unsigned long long file_hash, PointList &points)
+{
+	/* The normals of a file are cached with the parameters of their estimation, in the order of the file */
+	DerivedCache cache;
+	unsigned long long key = DerivedCache::combine(file_hash, DERIVED_CACHE_NORMALS);
+	key = DerivedCache::combine(key, LOAD_NORMAL_ORIENTATION);
+	key = DerivedCache::combine(key, NORMAL_JET_NEIGHBORS);
+	key = DerivedCache::combine(key, NORMAL_ORIENT_NEIGHBORS);
+	int npoints = points.size();
+	std::vector<float> normals;
+	if (file_hash != 0 && cache.load(key, 3, npoints, normals))
+	{
+		for (int i = 0; i < npoints; i++)
+			points[i].second = Vector(normals[i], normals[npoints + i], normals[2 * npoints + i]);
+		qDebug() << "Normals loaded from the cache.";
+		return true;
+	}
+
+	qDebug() << "Estimating normals...";
+	NormalEstimator normal_estimator(LOAD_NORMAL_ORIENTATION);
+	bool order_kept = normal_estimator.estimate(points);
+	qDebug() << "Normals estimation done." << normal_estimator.timingReport();
+
+	if (file_hash != 0 && order_kept)
+	{
+		normals.resize(3 * npoints);
+		for (int i = 0; i < npoints; i++)
+		{
+			normals[i] = points[i].second.x();
+			normals[npoints + i] = points[i].second.y();
+			normals[2 * npoints + i] = points[i].second.z();
+		}
+		cache.store(key, 3, npoints, normals.data());
+	}
+	return order_kept;
+}
+
 using namespace pcl;
 using namespace Eigen;
-double Utils::sdf(pcl::PointCloud<pcl::PointXYZ>::Ptr points, pcl::PointCloud<pcl::Normal>::Ptr normals, int searchPointIdx)
+double Utils::sdf(pcl::PointCloud<pcl::PointXYZ>::Ptr points, pcl::PointCloud<pcl::Normal>::Ptr normals, int searchPointIdx,
+	const SpatialIndex *index)
 {
 	const double pi = 3.14159265359;
 	double raysAngle = 30.0 / 180.0 * pi;  /* angle of the cone */
@@ -490,8 +558,17 @@ double Utils::sdf(pcl::PointCloud<pcl::PointXYZ>::Ptr points, pcl::PointCloud<pc
 
 	QList<double> dists; 
 	QList<double> weights;
-	for (int i = 0; i < points->size(); i++)
+	std::vector<int> candidates;
+	if (index != NULL)
+	{
+		float apex[3] = { searchPoint.x, searchPoint.y, searchPoint.z };
+		float axis[3] = { cone_axis.x(), cone_axis.y(), cone_axis.z() };
+		index->coneSearch(apex, axis, raysAngle, candidates);
+	}
+	int ncandidates = index != NULL ? candidates.size() : points->size();
+	for (int k = 0; k < ncandidates; k++)
 	{
+		int i = index != NULL ? candidates[k] : k;
 		Vector3d p(points->at(i).x, points->at(i).y, points->at(i).z);
 
 		Vector3d vec = p - searchPointVec;
@@ -916,8 +993,6 @@ void Utils::saveFeatureToFile(vector<float> feature)
 
 long Utils::getCurrentTime()
 {
-	boost::posix_time::ptime time = boost::posix_time::microsec_clock::local_time();
-	boost::posix_time::time_duration duration(time.time_of_day());
-	long int time_ms = duration.total_milliseconds();
-	return time_ms;
+	/* Monotonic, the durations stay right across midnight and clock changes */
+	return (long)(Tracer::now() / 1000000);
 }
\ No newline at end of file
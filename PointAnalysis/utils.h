@@ -8,6 +8,9 @@
 #include <string>
 #include <cstdlib>
 #include "pcmodel.h"
+#include "spatialindex.h"
+#include "tracer.h"
+#include "logger.h"
 #include <QDebug>
 #include <QVector>
 #include <QPair>
@@ -66,8 +69,14 @@ public:
 	static PCModel * loadPointCloud(const char *filename);
 	static PCModel * loadPointCloud_CGAL(const char *filename);
 	static PCModel * loadPointCloud_CGAL_SDF(const char *filename);
-	static double sdf(pcl::PointCloud<pcl::PointXYZ>::Ptr points, pcl::PointCloud<pcl::Normal>::Ptr normals, int searchPointIdx);
+	/* Only the coordinates (x, y, z of each vertex) and the labels of the vertices of a labeled off file, no normals */
+	static bool loadLabeledPoints(const char *filename, QVector<float> &coordinates, QVector<int> &labels);
+	/* Center x, y, z triples on their Miniball and scale it to a unit radius, as PCModel::normalize does */
+	static void normalizePoints(float *coordinates, int npoints);
+	static double sdf(pcl::PointCloud<pcl::PointXYZ>::Ptr points, pcl::PointCloud<pcl::Normal>::Ptr normals, int searchPointIdx,
+		const SpatialIndex *index = NULL);    /* index: of points, only the points in the cells of the ray cone are tested, all points if NULL */
 	static QVector<double> sdf_mesh(QString off_mesh_filename);
+	static bool estimateNormals(unsigned long long file_hash, PointList &points);    /* Returns false if the points have been reordered */
 	static bool double_equal(double a, double b);
 	static bool float_equal(double a, double b);
 	static QString getSegFilename(QString modelFilename);
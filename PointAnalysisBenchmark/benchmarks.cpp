@@ -0,0 +1,298 @@
+#include <benchmark/benchmark.h>
+#include <QDir>
+#include <random>
+#include "syntheticcloud.h"
+#include "utils.h"
+#include "pointfeaturethread.h"
+#include "obbestimator.h"
+#include "papartrelation.h"
+#include "energyfunctions.h"
+#include "pairwisetermthread.h"
+#include "mrfsolver.h"
+
+#define BENCHMARK_MIN_POINTS 10000
+#define BENCHMARK_MAX_POINTS 10000000
+#define BENCHMARK_MAX_DENSE_POINTS 1000000    /* Of the benchmarks holding features or distributions per point */
+#define BENCHMARK_SDF_QUERIES 256    /* Points whose sdf is computed per iteration */
+#define BENCHMARK_FEATURE_QUERIES 4096    /* Points whose features are computed per iteration */
+#define BENCHMARK_RELATIONS 1024    /* Candidate pairs of the Epair benchmark */
+#define BENCHMARK_TRWS_LABELS 5
+#define BENCHMARK_TRWS_ITERATIONS 10
+
+/*
+ * The hot kernels of the analysis on synthetic chairs (SyntheticCloud) of 10k to 10M points.
+ * Each benchmark takes the number of points as its first argument, the inputs of a size are
+ * generated once and shared. Run with --benchmark_filter=<regex> to select the kernels.
+ */
+
+namespace
+{
+	/* Evenly spread points of the cloud, the same for every run */
+	std::vector<int> queryPoints(const SyntheticCloud *synthetic, int nqueries)
+	{
+		std::vector<int> queries(nqueries);
+		for (int q = 0; q < nqueries; q++)
+			queries[q] = (int)((long long)q * synthetic->size() / nqueries);
+		return queries;
+	}
+
+	EnergyFunctions * syntheticEnergyFunctions(SyntheticCloud *synthetic)
+	{
+		static bool priors_written = SyntheticCloud::writePriors();
+		(void)priors_written;
+		EnergyFunctions *energy_functions = new EnergyFunctions(SYNTHETIC_CLASS_NAME);
+		energy_functions->setPointCloud(synthetic->pointCloud());
+		energy_functions->setDistributions(synthetic->distributions());
+		return energy_functions;
+	}
+
+	bool silentIteration(void *, int, MRFSolver::REAL, MRFSolver::REAL, double)
+	{
+		return true;
+	}
+
+	/* The off and seg files of the synthetic cloud of npoints, written once to the temporary directory */
+	std::string syntheticOffFile(int npoints)
+	{
+		QString dir = QDir::tempPath() + "/pointanalysis_benchmark";
+		QString name = "synthetic_" + QString::number(npoints);
+		QString off_path = QDir::toNativeSeparators(dir + "/off/" + name + ".off");
+		QString seg_path = QDir::toNativeSeparators(dir + "/gt/" + name + ".seg");
+		if (!QFile::exists(off_path) || !QFile::exists(seg_path))
+		{
+			QDir().mkpath(dir + "/off");
+			QDir().mkpath(dir + "/gt");
+			SyntheticCloud::get(npoints)->writeOff(off_path.toStdString(), seg_path.toStdString());
+		}
+		return off_path.toStdString();
+	}
+}
+
+static void BM_Sdf(benchmark::State &state)
+{
+	SyntheticCloud *synthetic = SyntheticCloud::get(state.range(0));
+	std::vector<int> queries = queryPoints(synthetic, BENCHMARK_SDF_QUERIES);
+	while (state.KeepRunning())
+	{
+		for (int q = 0; q < BENCHMARK_SDF_QUERIES; q++)
+			benchmark::DoNotOptimize(Utils::sdf(synthetic->cloud(), synthetic->normals(), queries[q], synthetic->index()));
+	}
+	state.SetItemsProcessed(state.iterations() * BENCHMARK_SDF_QUERIES);
+}
+BENCHMARK(BM_Sdf)->RangeMultiplier(10)->Range(BENCHMARK_MIN_POINTS, BENCHMARK_MAX_POINTS)->Unit(benchmark::kMillisecond);
+
+/* Points, then the radius of the FeatureThread (0.1 to 0.5 of the radius of the model) */
+static void BM_PointFeatures(benchmark::State &state)
+{
+	SyntheticCloud *synthetic = SyntheticCloud::get(state.range(0));
+	PAPointCloud *features = synthetic->pointCloud();
+	int part = state.range(1);
+	double search_radius = 0.1 * (part + 1) * synthetic->radius();
+	int nqueries = std::min(BENCHMARK_FEATURE_QUERIES, synthetic->size());
+	int begin = 0;
+	while (state.KeepRunning())
+	{
+		/* A new range of points each iteration, as the subthreads of a FeatureThread */
+		PointFeatureThread::estimateRange(synthetic->cloud(), synthetic->index(), search_radius, begin, begin + nqueries - 1, features, part);
+		begin = (begin + nqueries) % (synthetic->size() - nqueries + 1);
+	}
+	state.SetItemsProcessed(state.iterations() * nqueries);
+}
+
+static void pointFeaturesArguments(benchmark::internal::Benchmark *b)
+{
+	for (int n = BENCHMARK_MIN_POINTS; n <= BENCHMARK_MAX_DENSE_POINTS; n *= 10)
+	{
+		b->Args({ n, 0 });
+		b->Args({ n, 4 });
+	}
+}
+BENCHMARK(BM_PointFeatures)->Apply(pointFeaturesArguments)->Unit(benchmark::kMillisecond);
+
+static void BM_OBBCandidates(benchmark::State &state)
+{
+	/* The seat, the largest box */
+	SyntheticCloud *synthetic = SyntheticCloud::get(state.range(0));
+	pcl::PointCloud<pcl::PointXYZ>::Ptr part_cloud(new pcl::PointCloud<pcl::PointXYZ>);
+	for (int i = synthetic->boxBegin(0); i < synthetic->boxBegin(0) + synthetic->boxSize(0); i++)
+		part_cloud->push_back(synthetic->cloud()->points[i]);
+
+	OBBEstimator estimator;
+	while (state.KeepRunning())
+	{
+		estimator.reset(synthetic->labels()[0], part_cloud);
+		QVector<OBB *> obbs = estimator.computeOBBCandidates();
+		for (int k = 0; k < obbs.size(); k++)
+			delete(obbs[k]);
+	}
+	state.SetItemsProcessed(state.iterations() * part_cloud->size());
+}
+BENCHMARK(BM_OBBCandidates)->RangeMultiplier(10)->Range(BENCHMARK_MIN_POINTS, BENCHMARK_MAX_POINTS)->Unit(benchmark::kMillisecond);
+
+static void BM_PartRelation(benchmark::State &state)
+{
+	/* Only the boxes of the candidates matter, not the number of points */
+	const Part_Candidates &candidates = SyntheticCloud::get(state.range(0))->candidates();
+	int n = candidates.size();
+	int i = 0, j = 1;
+	while (state.KeepRunning())
+	{
+		PAPartRelation relation(candidates[i], candidates[j]);
+		benchmark::DoNotOptimize(&relation);
+		if (++j == n)
+		{
+			i = (i + 1) % (n - 1);
+			j = i + 1;
+		}
+	}
+	state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PartRelation)->Arg(BENCHMARK_MIN_POINTS);
+
+static void BM_Epnt(benchmark::State &state)
+{
+	SyntheticCloud *synthetic = SyntheticCloud::get(state.range(0));
+	const Part_Candidates &candidates = synthetic->candidates();
+	QList<int> label_names = SyntheticCloud::labelNames();
+	EnergyFunctions *energy_functions = syntheticEnergyFunctions(synthetic);
+	while (state.KeepRunning())
+	{
+		for (int c = 0; c < candidates.size(); c++)
+			for (int l = 0; l < label_names.size(); l++)
+				benchmark::DoNotOptimize(energy_functions->Epnt(candidates[c], label_names[l]));
+	}
+	state.SetItemsProcessed(state.iterations() * candidates.size() * label_names.size());
+	delete(energy_functions);
+}
+BENCHMARK(BM_Epnt)->RangeMultiplier(10)->Range(BENCHMARK_MIN_POINTS, BENCHMARK_MAX_DENSE_POINTS)->Unit(benchmark::kMillisecond);
+
+static void BM_Epair(benchmark::State &state)
+{
+	SyntheticCloud *synthetic = SyntheticCloud::get(state.range(0));
+	const Part_Candidates &candidates = synthetic->candidates();
+	QList<int> label_names = SyntheticCloud::labelNames();
+	EnergyFunctions *energy_functions = syntheticEnergyFunctions(synthetic);
+
+	/* Pairs of candidates of different clusters, the ones that reach the priors */
+	std::vector<PAPartRelation> relations;
+	std::vector<std::pair<int, int>> clusters;
+	std::mt19937 rng(SYNTHETIC_SEED);
+	while ((int)relations.size() < BENCHMARK_RELATIONS)
+	{
+		int i = rng() % candidates.size(), j = rng() % candidates.size();
+		if (candidates[i].getClusterNo() == candidates[j].getClusterNo())
+			continue;
+		relations.push_back(PAPartRelation(candidates[i], candidates[j]));
+		clusters.push_back(std::make_pair(candidates[i].getClusterNo(), candidates[j].getClusterNo()));
+	}
+
+	int r = 0;
+	while (state.KeepRunning())
+	{
+		for (int l1 = 0; l1 < label_names.size(); l1++)
+			for (int l2 = 0; l2 < label_names.size(); l2++)
+				benchmark::DoNotOptimize(energy_functions->Epair(relations[r], clusters[r].first, clusters[r].second, label_names[l1], label_names[l2]));
+		r = (r + 1) % BENCHMARK_RELATIONS;
+	}
+	state.SetItemsProcessed(state.iterations() * label_names.size() * label_names.size());
+	delete(energy_functions);
+}
+BENCHMARK(BM_Epair)->Arg(BENCHMARK_MIN_POINTS);
+
+/* Points, then the number of candidates whose pairwise potentials the thread computes */
+static void BM_PairwiseTermThread(benchmark::State &state)
+{
+	SyntheticCloud *synthetic = SyntheticCloud::get(state.range(0));
+	Part_Candidates candidates = synthetic->candidates().mid(0, state.range(1));
+	EnergyFunctions *energy_functions = syntheticEnergyFunctions(synthetic);
+	QList<int> label_names = SyntheticCloud::labelNames();
+	int ncandidates = candidates.size();
+
+	while (state.KeepRunning())
+	{
+		PairwiseTermThread thread(0, candidates, 0, ncandidates - 1, energy_functions, label_names);
+		/* Called in the thread, the tables are only freed */
+		QObject::connect(&thread, &PairwiseTermThread::computeDone, [](int, int, Pairwise_Potentials potentials)
+		{
+			for (int i = 0; i < potentials.size(); i++)
+				for (int j = 0; j < potentials[i].size(); j++)
+					delete[](potentials[i][j]);
+		});
+		thread.start();
+		thread.wait();
+	}
+	state.SetItemsProcessed(state.iterations() * ncandidates * (ncandidates - 1) / 2);
+	delete(energy_functions);
+}
+BENCHMARK(BM_PairwiseTermThread)->Args({ BENCHMARK_MIN_POINTS, 48 })->Args({ BENCHMARK_MIN_POINTS, 96 })->Args({ BENCHMARK_MIN_POINTS, 192 })
+	->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/* The number of nodes, fully connected as the candidates in PredictionThread */
+static void BM_TRWS(benchmark::State &state)
+{
+	int nnodes = state.range(0);
+	int nlabels = BENCHMARK_TRWS_LABELS;
+	std::mt19937 rng(SYNTHETIC_SEED);
+	std::vector<double> unary(nnodes * nlabels);
+	for (int i = 0; i < (int)unary.size(); i++)
+		unary[i] = (rng() >> 8) * (1.0 / 16777216.0);
+	std::vector<double> pairwise(nlabels * nlabels);
+
+	while (state.KeepRunning())
+	{
+		state.PauseTiming();
+		MRFSolver *mrf = createMRFSolver(nlabels, nnodes);
+		for (int i = 0; i < nnodes; i++)
+			mrf->addNode(i, unary.data() + i * nlabels);
+		std::mt19937 edge_rng(SYNTHETIC_SEED);
+		for (int i = 0; i < nnodes; i++)
+		{
+			for (int j = i + 1; j < nnodes; j++)
+			{
+				for (int k = 0; k < nlabels * nlabels; k++)
+					pairwise[k] = (edge_rng() >> 8) * (1.0 / 16777216.0);
+				mrf->addEdge(i, j, pairwise.data());
+			}
+		}
+		mrf->setAutomaticOrdering();
+		MRFSolver::Options options;
+		options.m_iterMax = BENCHMARK_TRWS_ITERATIONS;
+		/* The energy is never computed nor printed, only the message passing is timed */
+		options.m_printIter = BENCHMARK_TRWS_ITERATIONS;
+		options.m_printMinIter = BENCHMARK_TRWS_ITERATIONS + 1;
+		options.m_iterFn = &silentIteration;
+		options.m_threadNum = QThread::idealThreadCount();
+		MRFSolver::REAL lower_bound, energy;
+		state.ResumeTiming();
+
+		mrf->minimize_TRW_S(options, lower_bound, energy);
+
+		state.PauseTiming();
+		delete(mrf);
+		state.ResumeTiming();
+	}
+	state.SetItemsProcessed(state.iterations() * BENCHMARK_TRWS_ITERATIONS);
+}
+BENCHMARK(BM_TRWS)->Arg(48)->Arg(96)->Arg(192)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_LoadLabeledPoints(benchmark::State &state)
+{
+	std::string off_path = syntheticOffFile(state.range(0));
+	QVector<float> coordinates;
+	QVector<int> labels;
+	while (state.KeepRunning())
+		Utils::loadLabeledPoints(off_path.c_str(), coordinates, labels);
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadLabeledPoints)->RangeMultiplier(10)->Range(BENCHMARK_MIN_POINTS, BENCHMARK_MAX_DENSE_POINTS)->Unit(benchmark::kMillisecond);
+
+/* The normals are estimated by the first load only, then read from the DerivedCache as when a model is opened again */
+static void BM_LoadPointCloudCGAL(benchmark::State &state)
+{
+	std::string off_path = syntheticOffFile(state.range(0));
+	delete(Utils::loadPointCloud_CGAL(off_path.c_str()));
+	while (state.KeepRunning())
+		delete(Utils::loadPointCloud_CGAL(off_path.c_str()));
+	state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadPointCloudCGAL)->RangeMultiplier(10)->Range(BENCHMARK_MIN_POINTS, BENCHMARK_MAX_DENSE_POINTS)->Unit(benchmark::kMillisecond);
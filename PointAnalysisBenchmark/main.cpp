@@ -0,0 +1,46 @@
+#include <benchmark/benchmark.h>
+#include <QCoreApplication>
+#include <QDir>
+#include <cstring>
+#include <vector>
+#include "logger.h"
+
+#define BENCHMARK_OUT_DIR "../data/benchmarks"
+#define BENCHMARK_OUT_FILE "../data/benchmarks/results.json"
+
+/*
+ * PointAnalysisBenchmark [--benchmark_filter=<regex>] [--benchmark_out=<file>] [google benchmark options]
+ *
+ * The results are written as json to BENCHMARK_OUT_FILE unless --benchmark_out is given; two runs are
+ * compared with tools/compare.py of google benchmark:
+ *   compare.py benchmarks baseline.json ../data/benchmarks/results.json
+ */
+int main(int argc, char *argv[])
+{
+	/* The worker threads and the Logger need an application, no event loop runs */
+	QCoreApplication a(argc, argv);
+	Logger::instance()->setConsoleLevel(LOG_LEVEL_WARNING);
+
+	std::vector<char *> args(argv, argv + argc);
+	bool has_out = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strncmp(argv[i], "--benchmark_out=", strlen("--benchmark_out=")) == 0)
+			has_out = true;
+	}
+	char out_arg[] = "--benchmark_out=" BENCHMARK_OUT_FILE;
+	char format_arg[] = "--benchmark_out_format=json";
+	if (!has_out)
+	{
+		QDir().mkpath(BENCHMARK_OUT_DIR);
+		args.push_back(out_arg);
+		args.push_back(format_arg);
+	}
+
+	int nargs = (int)args.size();
+	benchmark::Initialize(&nargs, args.data());
+	if (benchmark::ReportUnrecognizedArguments(nargs, args.data()))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
@@ -0,0 +1,270 @@
+#include "syntheticcloud.h"
+#include <QDir>
+#include <random>
+#include <algorithm>
+#include <map>
+#include <cmath>
+#include <fstream>
+#include "obbestimator.h"
+#include "relationpriors.h"
+
+namespace
+{
+	/* Uniform in [0, 1), the same on every platform unlike std::uniform_real_distribution */
+	float uniform(std::mt19937 &rng)
+	{
+		return (rng() >> 8) * (1.0f / 16777216.0f);
+	}
+
+	float boxArea(const SyntheticCloud::Box &box)
+	{
+		const float *h = box.half;
+		return 8.0f * (h[0] * h[1] + h[1] * h[2] + h[0] * h[2]);
+	}
+}
+
+SyntheticCloud::SyntheticCloud(int npoints, unsigned int seed)
+	: m_cloud(new pcl::PointCloud<pcl::PointXYZ>), m_normals(new pcl::PointCloud<pcl::Normal>), m_radius(0), m_index(NULL), m_pointcloud(NULL)
+{
+	std::vector<Box> boxes = chair();
+	int nboxes = boxes.size();
+	float total_area = 0;
+	for (int b = 0; b < nboxes; b++)
+		total_area += boxArea(boxes[b]);
+
+	/* Points per box in proportion to its area, in triples, the rest on the first box */
+	std::vector<int> counts(nboxes);
+	int assigned = 0;
+	for (int b = 0; b < nboxes; b++)
+	{
+		counts[b] = (int)(npoints * boxArea(boxes[b]) / total_area) / 3 * 3;
+		assigned += counts[b];
+	}
+	counts[0] += npoints - assigned;
+
+	m_cloud->resize(npoints);
+	m_normals->resize(npoints);
+	m_labels.resize(npoints);
+	m_box_begin.resize(nboxes + 1);
+	std::mt19937 rng(seed);
+	int i = 0;
+	for (int b = 0; b < nboxes; b++)
+	{
+		const Box &box = boxes[b];
+		const float *h = box.half;
+		/* Area of the faces orthogonal to x, y and z */
+		float face_area[3] = { h[1] * h[2], h[0] * h[2], h[0] * h[1] };
+		float face_total = face_area[0] + face_area[1] + face_area[2];
+
+		m_box_begin[b] = i;
+		for (int k = 0; k < counts[b]; k++, i++)
+		{
+			float pick = uniform(rng) * face_total;
+			int axis = pick < face_area[0] ? 0 : (pick < face_area[0] + face_area[1] ? 1 : 2);
+			float sign = uniform(rng) < 0.5f ? -1.0f : 1.0f;
+
+			float p[3], n[3] = { 0, 0, 0 };
+			for (int d = 0; d < 3; d++)
+				p[d] = box.center[d] + (d == axis ? sign : 2.0f * uniform(rng) - 1.0f) * h[d];
+			n[axis] = sign;
+
+			m_cloud->points[i] = pcl::PointXYZ(p[0], p[1], p[2]);
+			m_normals->points[i] = pcl::Normal(n[0], n[1], n[2]);
+			m_labels[i] = box.label;
+		}
+	}
+	m_box_begin[nboxes] = i;
+
+	/* Radius of the sphere around the centroid */
+	double c[3] = { 0, 0, 0 };
+	for (int k = 0; k < npoints; k++)
+	{
+		c[0] += m_cloud->points[k].x;
+		c[1] += m_cloud->points[k].y;
+		c[2] += m_cloud->points[k].z;
+	}
+	for (int d = 0; d < 3; d++)
+		c[d] /= npoints;
+	double max_sqr = 0;
+	for (int k = 0; k < npoints; k++)
+	{
+		double dx = m_cloud->points[k].x - c[0], dy = m_cloud->points[k].y - c[1], dz = m_cloud->points[k].z - c[2];
+		max_sqr = std::max(max_sqr, dx * dx + dy * dy + dz * dz);
+	}
+	m_radius = std::sqrt(max_sqr);
+
+	const float *data = &m_cloud->points[0].x;
+	int stride = sizeof(pcl::PointXYZ) / sizeof(float);
+	m_index = SpatialIndex::build(data, data + 1, data + 2, stride, npoints, SPATIAL_INDEX_CELL_COEF * m_radius);
+}
+
+SyntheticCloud::~SyntheticCloud()
+{
+	if (m_index != NULL)
+		delete(m_index);
+	if (m_pointcloud != NULL)
+		delete(m_pointcloud);
+}
+
+SyntheticCloud * SyntheticCloud::get(int npoints)
+{
+	/* Kept until the end of the run, the benchmarks of a size share them */
+	static std::map<int, SyntheticCloud *> clouds;
+	std::map<int, SyntheticCloud *>::iterator it = clouds.find(npoints);
+	if (it != clouds.end())
+		return it->second;
+	SyntheticCloud *cloud = new SyntheticCloud(npoints);
+	clouds[npoints] = cloud;
+	return cloud;
+}
+
+std::vector<SyntheticCloud::Box> SyntheticCloud::chair()
+{
+	/* Labels: 0 back, 1 seat, 2 legs, 3 arms; y is up */
+	static const Box boxes[] = {
+		{ { 0.0f, 0.45f, 0.0f }, { 0.25f, 0.03f, 0.25f }, 1 },
+		{ { 0.0f, 0.80f, -0.23f }, { 0.25f, 0.32f, 0.02f }, 0 },
+		{ { -0.21f, 0.21f, -0.21f }, { 0.025f, 0.21f, 0.025f }, 2 },
+		{ { 0.21f, 0.21f, -0.21f }, { 0.025f, 0.21f, 0.025f }, 2 },
+		{ { -0.21f, 0.21f, 0.21f }, { 0.025f, 0.21f, 0.025f }, 2 },
+		{ { 0.21f, 0.21f, 0.21f }, { 0.025f, 0.21f, 0.025f }, 2 },
+		{ { -0.25f, 0.62f, 0.0f }, { 0.02f, 0.02f, 0.22f }, 3 },
+		{ { 0.25f, 0.62f, 0.0f }, { 0.02f, 0.02f, 0.22f }, 3 }
+	};
+	return std::vector<Box>(boxes, boxes + sizeof(boxes) / sizeof(boxes[0]));
+}
+
+QList<int> SyntheticCloud::labelNames()
+{
+	return QList<int>() << 0 << 1 << 2 << 3 << 4;
+}
+
+PAPointCloud * SyntheticCloud::pointCloud()
+{
+	if (m_pointcloud != NULL)
+		return m_pointcloud;
+
+	int npoints = size();
+	m_pointcloud = new PAPointCloud(npoints);
+	m_pointcloud->setRadius(m_radius);
+	for (int i = 0; i < npoints; i++)
+	{
+		const pcl::PointXYZ &p = m_cloud->points[i];
+		m_pointcloud->setPosition(i, p.x, p.y, p.z);
+		m_pointcloud->setLabel(i, m_labels[i]);
+	}
+	return m_pointcloud;
+}
+
+const Part_Candidates & SyntheticCloud::candidates()
+{
+	if (!m_candidates.isEmpty())
+		return m_candidates;
+
+	for (int b = 0; b < numOfBoxes(); b++)
+	{
+		pcl::PointCloud<pcl::PointXYZ>::Ptr part_cloud(new pcl::PointCloud<pcl::PointXYZ>);
+		QList<int> indices;
+		for (int i = boxBegin(b); i < boxBegin(b) + boxSize(b); i++)
+		{
+			part_cloud->push_back(m_cloud->points[i]);
+			indices.push_back(i);
+		}
+
+		OBBEstimator estimator(m_labels[boxBegin(b)], part_cloud);
+		QVector<OBB *> obbs = estimator.computeOBBCandidates();
+		for (int k = 0; k < obbs.size(); k++)
+		{
+			PAPart candidate(obbs[k]);
+			candidate.setClusterNo(b);
+			candidate.setVerticesIndices(indices);
+			m_candidates.push_back(candidate);
+			delete(obbs[k]);
+		}
+	}
+	return m_candidates;
+}
+
+const QVector<QMap<int, float>> & SyntheticCloud::distributions()
+{
+	if (!m_distributions.isEmpty())
+		return m_distributions;
+
+	QList<int> label_names = labelNames();
+	int nlabels = label_names.size();
+	float other = (1.0f - SYNTHETIC_CONFIDENCE) / (nlabels - 1);
+	m_distributions.resize(size());
+	for (int i = 0; i < size(); i++)
+	{
+		QMap<int, float> distribution;
+		for (int l = 0; l < nlabels; l++)
+			distribution.insert(label_names[l], label_names[l] == m_labels[i] ? SYNTHETIC_CONFIDENCE : other);
+		m_distributions[i] = distribution;
+	}
+	return m_distributions;
+}
+
+bool SyntheticCloud::writeOff(const std::string &off_filename, const std::string &seg_filename) const
+{
+	std::ofstream off_out(off_filename.c_str());
+	std::ofstream seg_out(seg_filename.c_str());
+	if (!off_out.is_open() || !seg_out.is_open())
+		return false;
+
+	int nfaces = 0;
+	for (int b = 0; b < numOfBoxes(); b++)
+		nfaces += boxSize(b) / 3;
+
+	off_out << "OFF" << std::endl;
+	off_out << size() << " " << nfaces << " 0" << std::endl;
+	for (int i = 0; i < size(); i++)
+	{
+		const pcl::PointXYZ &p = m_cloud->points[i];
+		off_out << p.x << " " << p.y << " " << p.z << std::endl;
+	}
+	for (int b = 0; b < numOfBoxes(); b++)
+	{
+		for (int i = boxBegin(b); i + 2 < boxBegin(b) + boxSize(b); i += 3)
+		{
+			off_out << "3 " << i << " " << i + 1 << " " << i + 2 << std::endl;
+			seg_out << m_labels[i] << std::endl;
+		}
+	}
+	return !off_out.fail() && !seg_out.fail();
+}
+
+bool SyntheticCloud::writePriors(unsigned int seed)
+{
+	const int dim = RELATION_PRIORS_DIMENSION;
+	QList<int> label_names = labelNames();
+	std::mt19937 rng(seed);
+
+	QMap<QPair<int, int>, Eigen::VectorXd> means;
+	QMap<QPair<int, int>, Eigen::MatrixXd> covariances;
+	/* All the ordered pairs of part labels, the null label has no prior */
+	for (int l1 = 0; l1 < label_names.size() - 1; l1++)
+	{
+		for (int l2 = 0; l2 < label_names.size() - 1; l2++)
+		{
+			if (l1 == l2)
+				continue;
+			Eigen::VectorXd mean(dim);
+			Eigen::MatrixXd a(dim, dim);
+			for (int r = 0; r < dim; r++)
+			{
+				mean(r) = 2.0 * uniform(rng) - 1.0;
+				for (int c = 0; c < dim; c++)
+					a(r, c) = uniform(rng) - 0.5;
+			}
+			QPair<int, int> pair(label_names[l1], label_names[l2]);
+			means.insert(pair, mean);
+			covariances.insert(pair, a * a.transpose() / dim + 0.1 * Eigen::MatrixXd::Identity(dim, dim));
+		}
+	}
+
+	RelationPriors *priors = RelationPriors::build(means, covariances);
+	QDir().mkpath("../data/parts_relations");
+	bool saved = priors->save(std::string("../data/parts_relations/") + SYNTHETIC_CLASS_NAME + RELATION_PRIORS_SUFFIX);
+	delete(priors);
+	return saved;
+}
@@ -0,0 +1,80 @@
+#ifndef SYNTHETICCLOUD_H
+#define SYNTHETICCLOUD_H
+
+#include <QList>
+#include <QMap>
+#include <QVector>
+#include <vector>
+#include <string>
+#include <pcl/point_types.h>
+#include <pcl/point_cloud.h>
+#include "spatialindex.h"
+#include "PAPointCloud.h"
+#include "gencandidatesthread.h"
+
+#define SYNTHETIC_SEED 20161019u
+#define SYNTHETIC_CONFIDENCE 0.7    /* Probability of the true label in the synthetic classification */
+#define SYNTHETIC_CLASS_NAME "synthetic"    /* The priors are ../data/parts_relations/synthetic_priors.papr */
+
+/*
+ * A chair made of boxes (seat, back, four legs and two arms, four part labels), with npoints
+ * sampled uniformly on the surface of the boxes and the normals of their faces. The same size
+ * and seed give the same points, so the benchmarks run offline without the COSEG data.
+ * The points are generated box by box: consecutive triples of points of a box are the faces
+ * of the off file and the boxes are the connected components of the candidates.
+ */
+class SyntheticCloud
+{
+public:
+	struct Box
+	{
+		float center[3];
+		float half[3];    /* Half lengths along x, y and z */
+		int label;
+	};
+
+	SyntheticCloud(int npoints, unsigned int seed = SYNTHETIC_SEED);
+	~SyntheticCloud();
+
+	/* The cloud of npoints points with the default seed, generated at the first call */
+	static SyntheticCloud * get(int npoints);
+	static std::vector<Box> chair();
+
+	int size() const { return (int)m_cloud->size(); }
+	float radius() const { return m_radius; }
+	pcl::PointCloud<pcl::PointXYZ>::Ptr cloud() const { return m_cloud; }
+	pcl::PointCloud<pcl::Normal>::Ptr normals() const { return m_normals; }
+	const SpatialIndex * index() const { return m_index; }
+	const std::vector<int> & labels() const { return m_labels; }
+	/* The first point of box b and the number of its points */
+	int boxBegin(int b) const { return m_box_begin[b]; }
+	int boxSize(int b) const { return m_box_begin[b + 1] - m_box_begin[b]; }
+	int numOfBoxes() const { return (int)m_box_begin.size() - 1; }
+	/* The part labels, then the null label */
+	static QList<int> labelNames();
+
+	/* Positions and labels set, the features left to the estimators */
+	PAPointCloud * pointCloud();
+	/* The 24 OBB candidates of each box, the boxes being the point clusters */
+	const Part_Candidates & candidates();
+	/* SYNTHETIC_CONFIDENCE on the label of each point, the rest spread over the other labels */
+	const QVector<QMap<int, float>> & distributions();
+
+	/* The points as an off file of their triples and the labels of the triples as a seg file */
+	bool writeOff(const std::string &off_filename, const std::string &seg_filename) const;
+	/* Gaussian priors of all the label pairs of the chair, saved where EnergyFunctions looks for SYNTHETIC_CLASS_NAME */
+	static bool writePriors(unsigned int seed = SYNTHETIC_SEED);
+
+private:
+	pcl::PointCloud<pcl::PointXYZ>::Ptr m_cloud;
+	pcl::PointCloud<pcl::Normal>::Ptr m_normals;
+	std::vector<int> m_labels;
+	std::vector<int> m_box_begin;
+	float m_radius;
+	SpatialIndex *m_index;
+	PAPointCloud *m_pointcloud;
+	Part_Candidates m_candidates;
+	QVector<QMap<int, float>> m_distributions;
+};
+
+#endif // SYNTHETICCLOUD_H